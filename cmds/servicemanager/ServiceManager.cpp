@@ -419,6 +419,19 @@ Status ServiceManager::checkService(const std::string& name, os::Service* outSer
     return Status::ok();
 }
 
+Status ServiceManager::getServicesNoWait(const std::vector<std::string>& names,
+                                         std::vector<os::Service>* outServices) {
+    SM_PERFETTO_TRACE_FUNC();
+
+    outServices->clear();
+    outServices->reserve(names.size());
+    for (const auto& name : names) {
+        outServices->push_back(tryGetService(name, true));
+    }
+    // returns ok regardless of result, like getService2
+    return Status::ok();
+}
+
 os::Service ServiceManager::tryGetService(const std::string& name, bool startIfNotFound) {
     std::optional<std::string> accessorName;
 #ifndef VENDORSERVICEMANAGER
@@ -1171,4 +1184,13 @@ void ServiceManager::clear() {
     mNameToClientCallback.clear();
 }
 
+Status ServiceLookup::getServicesNoWait(const std::vector<std::string>& names,
+                                        std::vector<os::Service>* outServices) {
+    sp<ServiceManager> manager = mManager.promote();
+    if (manager == nullptr) {
+        return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE, "ServiceManager is gone.");
+    }
+    return manager->getServicesNoWait(names, outServices);
+}
+
 }  // namespace android
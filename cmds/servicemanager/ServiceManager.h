@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <android/os/BnServiceLookup.h>
 #include <android/os/BnServiceManager.h>
 #include <android/os/IClientCallback.h>
 #include <android/os/IServiceCallback.h>
@@ -70,6 +71,10 @@ public:
     void binderDied(const wp<IBinder>& who) override;
     void handleClientCallbacks();
 
+    // See IServiceLookup::getServicesNoWait
+    binder::Status getServicesNoWait(const std::vector<std::string>& names,
+                                     std::vector<os::Service>* outServices);
+
     /**
      *  This API is added for debug purposes. It clears members which hold service and callback
      * information.
@@ -127,4 +132,18 @@ private:
     std::unique_ptr<Access> mAccess;
 };
 
+// Served as the extension of the ServiceManager binder, so that IServiceManager
+// itself doesn't change (see IServiceLookup).
+class ServiceLookup : public os::BnServiceLookup {
+public:
+    explicit ServiceLookup(const sp<ServiceManager>& manager) : mManager(manager) {}
+
+    binder::Status getServicesNoWait(const std::vector<std::string>& names,
+                                     std::vector<os::Service>* outServices) override;
+
+private:
+    // the ServiceManager holds on to this, as its extension
+    wp<ServiceManager> mManager;
+};
+
 }  // namespace android
@@ -30,6 +30,7 @@
 using android::Access;
 using android::BBinder;
 using android::IBinder;
+using android::ServiceLookup;
 using android::ServiceManager;
 using android::sp;
 using android::base::EndsWith;
@@ -295,6 +296,54 @@ TEST(GetService, NotAllowedFromIsolated) {
     EXPECT_EQ(nullptr, outBinder);
 }
 
+TEST(GetServicesNoWait, HappyHappy) {
+    auto sm = getPermissiveServiceManager();
+    sp<IBinder> foo = getBinder();
+    sp<IBinder> bar = getBinder();
+
+    EXPECT_TRUE(sm->addService("foo", foo, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->addService("bar", bar, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    // as served to clients
+    sp<ServiceLookup> lookup = sp<ServiceLookup>::make(sm);
+    std::vector<Service> out;
+    EXPECT_TRUE(lookup->getServicesNoWait({"bar", "baz", "foo", "bar"}, &out).isOk());
+    ASSERT_EQ(4u, out.size());
+    EXPECT_EQ(bar, out[0].get<Service::Tag::binder>());
+    EXPECT_EQ(nullptr, out[1].get<Service::Tag::binder>());
+    EXPECT_EQ(foo, out[2].get<Service::Tag::binder>());
+    EXPECT_EQ(bar, out[3].get<Service::Tag::binder>());
+}
+
+TEST(GetServicesNoWait, Empty) {
+    auto sm = getPermissiveServiceManager();
+
+    std::vector<Service> out;
+    EXPECT_TRUE(sm->getServicesNoWait({}, &out).isOk());
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(GetServicesNoWait, StartsMissingServices) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canFind(_, _)).WillRepeatedly(Return(true));
+
+    sp<NiceMock<MockServiceManager>> sm =
+            sp<NiceMock<MockServiceManager>>::make(std::move(access));
+
+    EXPECT_CALL(*sm, tryStartService(_, "foo")).Times(1);
+    EXPECT_CALL(*sm, tryStartService(_, "bar")).Times(1);
+
+    std::vector<Service> out;
+    EXPECT_TRUE(sm->getServicesNoWait({"foo", "bar"}, &out).isOk());
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(nullptr, out[0].get<Service::Tag::binder>());
+    EXPECT_EQ(nullptr, out[1].get<Service::Tag::binder>());
+}
+
 TEST(ListServices, NoPermissions) {
     std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
 
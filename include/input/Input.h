@@ -34,6 +34,7 @@
 #include <ui/Transform.h>
 #include <utils/BitSet.h>
 #include <utils/Timers.h>
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <queue>
@@ -518,7 +519,16 @@ struct PointerCoords {
         return !(*this == other);
     }
 
-    inline void copyFrom(const PointerCoords& other) { *this = other; }
+    // Copies only the axis values that are present in other. Most events use a handful of the
+    // MAX_AXES slots, so this is much cheaper than a full assignment on the hot paths that move
+    // coordinates between InputMessages and MotionEvents.
+    inline void copyFrom(const PointerCoords& other) {
+        bits = other.bits;
+        // Clamped, since other may have come straight off the wire.
+        const size_t count = std::min<size_t>(BitSet64::count(other.bits), MAX_AXES);
+        std::copy_n(other.values.begin(), count, values.begin());
+        isResampled = other.isResampled;
+    }
     PointerCoords& operator=(const PointerCoords&) = default;
 
 private:
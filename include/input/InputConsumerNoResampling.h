@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <optional>
@@ -153,7 +154,7 @@ private:
      * events. Therefore, events should only be erased from the queue after they've been
      * successfully written to the InputChannel.
      */
-    std::queue<InputMessage> mOutboundQueue;
+    std::deque<InputMessage> mOutboundQueue;
     /**
      * Try to send all of the events in mOutboundQueue over the InputChannel. Not all events might
      * actually get sent, because it's possible that the channel is blocked.
@@ -28,8 +28,11 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <android-base/chrono_utils.h>
 #include <android-base/result.h>
@@ -277,6 +280,27 @@ public:
      */
     virtual android::base::Result<InputMessage> receiveMessage();
 
+    /* Send several messages to the other endpoint, in order, with as few syscalls as possible.
+     *
+     * Each message is sent whole or not at all. If the channel fills up part way through, the
+     * messages after the last one sent are guaranteed not to have been sent.
+     *
+     * Return the number of messages sent, which is at least 1.
+     * Return WOULD_BLOCK if the channel is full and no message was sent.
+     * Return DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    virtual android::base::Result<size_t> sendMessages(std::span<const InputMessage* const> msgs);
+
+    /* Receive as many of the messages sent by the other endpoint as fit in outMessages, with as
+     * few syscalls as possible.
+     *
+     * Return the number of messages received, which is at least 1. If an invalid message follows
+     * valid ones, the valid ones are returned first and the next receive returns BAD_VALUE.
+     * Otherwise fail like receiveMessage().
+     */
+    virtual android::base::Result<size_t> receiveMessages(std::span<InputMessage> outMessages);
+
     /* Tells whether there is a message in the channel available to be received.
      *
      * This is only a performance hint and may return false negative results. Clients should not
@@ -329,6 +353,10 @@ protected:
 private:
     static std::unique_ptr<InputChannel> create(const std::string& name,
                                                 android::base::unique_fd fd, sp<IBinder> token);
+
+    // Error found by receiveMessages() after messages it already handed out. Returned by the next
+    // receive.
+    std::optional<status_t> mPendingReceiveError;
 };
 
 /*
@@ -415,6 +443,25 @@ public:
      */
     status_t publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode);
 
+    /* Holds the events published from now on back, so that sendBatch() can send them together.
+     *
+     * Until sendBatch() is called, the publish methods check each event as usual, but return OK
+     * once the event is added to the batch rather than after it is sent.
+     */
+    void beginBatch();
+
+    /* Sends the events published since beginBatch(), in order, with as few syscalls as possible,
+     * and stops batching.
+     *
+     * Returns the number of events sent, counted from the start of the batch. The events after
+     * those were not sent and are dropped from the batch; publish them again to retry.
+     * Returns 0 if the batch is empty.
+     * Returns WOULD_BLOCK if the channel is full and no event was sent.
+     * Returns DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    android::base::Result<size_t> sendBatch();
+
     struct Finished {
         uint32_t seq;
         bool handled;
@@ -452,6 +499,14 @@ public:
 private:
     std::shared_ptr<InputChannel> mChannel;
     InputVerifier mInputVerifier;
+
+    bool mBatching = false;
+    // Events published since beginBatch(). Kept across batches so that they don't reallocate.
+    std::vector<InputMessage> mBatch;
+    std::vector<const InputMessage*> mBatchMessages;
+
+    // Sends msg, or adds it to the batch if one was started.
+    status_t sendOrBatch(const InputMessage& msg);
 };
 
 } // namespace android
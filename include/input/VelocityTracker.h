@@ -18,11 +18,12 @@
 
 #include <android/os/IInputConstants.h>
 #include <input/Input.h>
-#include <input/RingBuffer.h>
 #include <utils/BitSet.h>
 #include <utils/Timers.h>
+#include <array>
 #include <map>
 #include <set>
+#include <span>
 
 namespace android {
 
@@ -165,16 +166,42 @@ public:
     void clearPointer(int32_t pointerId) override;
 
 protected:
-    struct Movement {
-        nsecs_t eventTime;
-        float position;
-    };
-
     // Number of samples to keep.
     // If different strategies would like to maintain different history size, we can make this a
     // protected const field.
     static constexpr uint32_t HISTORY_SIZE = 20;
 
+    /**
+     * The movements of one pointer, oldest first, holding at most HISTORY_SIZE samples.
+     *
+     * Event times and positions are stored in separate arrays, and the samples are always
+     * contiguous, so that the strategies can run over them as plain arrays.
+     */
+    class MovementHistory {
+    public:
+        size_t size() const { return mSize; }
+        nsecs_t eventTime(size_t index) const { return mEventTimes[mStart + index]; }
+        float position(size_t index) const { return mPositions[mStart + index]; }
+        std::span<const nsecs_t> eventTimes() const { return {mEventTimes.data() + mStart, mSize}; }
+        std::span<const float> positions() const { return {mPositions.data() + mStart, mSize}; }
+
+        // Adds a sample, dropping the oldest one if the history is full.
+        void pushBack(nsecs_t eventTime, float position);
+        void popBack() { mSize--; }
+        void popFront() {
+            mStart++;
+            mSize--;
+        }
+
+    private:
+        // Room for twice the history, so that the samples only need to be moved back to the start
+        // once every HISTORY_SIZE additions.
+        std::array<nsecs_t, 2 * HISTORY_SIZE> mEventTimes;
+        std::array<float, 2 * HISTORY_SIZE> mPositions;
+        uint32_t mStart = 0;
+        uint32_t mSize = 0;
+    };
+
     /**
      * Duration, in nanoseconds, since the latest movement where a movement may be considered for
      * velocity calculation.
@@ -185,7 +212,7 @@ protected:
      * addition of a new movement.
      */
     const bool mMaintainHorizonDuringAdd;
-    std::map<int32_t /*pointerId*/, RingBuffer<Movement>> mMovements;
+    std::map<int32_t /*pointerId*/, MovementHistory> mMovements;
 };
 
 /*
@@ -220,14 +247,12 @@ private:
     // changes in direction.
     static const nsecs_t HORIZON = 100 * 1000000; // 100 ms
 
-    float chooseWeight(int32_t pointerId, uint32_t index) const;
+    float chooseWeight(const MovementHistory& movements, uint32_t index) const;
     /**
      * An optimized least-squares solver for degree 2 and no weight (i.e. `Weighting.NONE`).
-     * The provided container of movements shall NOT be empty, and shall have the movements in
-     * chronological order.
+     * The provided movements shall NOT be empty.
      */
-    std::optional<float> solveUnweightedLeastSquaresDeg2(
-            const RingBuffer<Movement>& movements) const;
+    std::optional<float> solveUnweightedLeastSquaresDeg2(const MovementHistory& movements) const;
 
     const uint32_t mDegree;
     const Weighting mWeighting;
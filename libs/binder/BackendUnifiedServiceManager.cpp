@@ -18,6 +18,8 @@
 #include <android/os/IAccessor.h>
 #include <binder/RpcSession.h>
 
+#include "file.h"
+
 #if defined(__BIONIC__) && !defined(__ANDROID_VNDK__)
 #include <android-base/properties.h>
 #endif
@@ -109,6 +111,36 @@ bool BinderCacheWithInvalidation::isClientSideCachingEnabled(const std::string&
     return false;
 }
 
+void BinderCacheWithInvalidation::dump(std::string* out) const {
+    uint64_t hits = 0, notFoundHits = 0, misses = 0, invalidations = 0;
+    size_t services = 0, notFound = 0;
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (const Shard& shard : mShards) {
+        hits += shard.hits.load(std::memory_order_relaxed);
+        notFoundHits += shard.notFoundHits.load(std::memory_order_relaxed);
+        misses += shard.misses.load(std::memory_order_relaxed);
+        invalidations += shard.invalidations.load(std::memory_order_relaxed);
+
+        std::shared_lock lock(shard.mutex);
+        for (const auto& [name, entry] : shard.entries) {
+            if (entry.service != nullptr) {
+                services++;
+            } else if (now < entry.expiry) {
+                // expired entries stay until the shard's next setNotFound
+                notFound++;
+            }
+        }
+    }
+
+    *out += "Service cache:\n";
+    *out += "  cached services: " + std::to_string(services) + "\n";
+    *out += "  cached services not found: " + std::to_string(notFound) + "\n";
+    *out += "  hits: " + std::to_string(hits) + "\n";
+    *out += "  hits for services not found: " + std::to_string(notFoundHits) + "\n";
+    *out += "  misses: " + std::to_string(misses) + "\n";
+    *out += "  invalidations: " + std::to_string(invalidations) + "\n";
+}
+
 binder::Status BackendUnifiedServiceManager::updateCache(const std::string& serviceName,
                                                          const os::Service& service) {
     if (!kUseCache) {
@@ -125,13 +157,15 @@ binder::Status BackendUnifiedServiceManager::updateCache(const std::string& serv
 }
 
 bool BackendUnifiedServiceManager::returnIfCached(const std::string& serviceName,
-                                                  os::Service* _out) {
+                                                  bool allowNotFound, os::Service* _out) {
     if (!kUseCache) {
         return false;
     }
-    sp<IBinder> item = mCacheForGetService->getItem(serviceName);
-    // TODO(b/363177618): Enable caching for binders which are always null.
-    if (item != nullptr && item->isBinderAlive()) {
+    sp<IBinder> item;
+    if (!mCacheForGetService->getItem(serviceName, allowNotFound, &item)) {
+        return false;
+    }
+    if (item == nullptr || item->isBinderAlive()) {
         *_out = os::Service::make<os::Service::Tag::binder>(item);
         return true;
     }
@@ -157,7 +191,8 @@ binder::Status BackendUnifiedServiceManager::getService(const ::std::string& nam
 
 binder::Status BackendUnifiedServiceManager::getService2(const ::std::string& name,
                                                          os::Service* _out) {
-    if (returnIfCached(name, _out)) {
+    // services which weren't found may be lazy services, which this starts
+    if (returnIfCached(name, false /*allowNotFound*/, _out)) {
         return binder::Status::ok();
     }
     os::Service service;
@@ -175,7 +210,7 @@ binder::Status BackendUnifiedServiceManager::getService2(const ::std::string& na
 binder::Status BackendUnifiedServiceManager::checkService(const ::std::string& name,
                                                           os::Service* _out) {
     os::Service service;
-    if (returnIfCached(name, _out)) {
+    if (returnIfCached(name, true /*allowNotFound*/, _out)) {
         return binder::Status::ok();
     }
 
@@ -183,6 +218,14 @@ binder::Status BackendUnifiedServiceManager::checkService(const ::std::string& n
     if (status.isOk()) {
         status = toBinderService(name, service, _out);
         if (status.isOk()) {
+            // Daemons which start up with many threads tend to check for the
+            // same missing services at once.
+            if (kUseCache && _out->getTag() == os::Service::Tag::binder &&
+                _out->get<os::Service::Tag::binder>() == nullptr &&
+                mCacheForGetService->isClientSideCachingEnabled(name)) {
+                mCacheForGetService->setNotFound(name);
+                return binder::Status::ok();
+            }
             return updateCache(name, service);
         }
     }
@@ -254,7 +297,12 @@ binder::Status BackendUnifiedServiceManager::toBinderService(const ::std::string
 binder::Status BackendUnifiedServiceManager::addService(const ::std::string& name,
                                                         const sp<IBinder>& service,
                                                         bool allowIsolated, int32_t dumpPriority) {
-    return mTheRealServiceManager->addService(name, service, allowIsolated, dumpPriority);
+    binder::Status status =
+            mTheRealServiceManager->addService(name, service, allowIsolated, dumpPriority);
+    if (kUseCache && status.isOk()) {
+        mCacheForGetService->removeNotFound(name);
+    }
+    return status;
 }
 binder::Status BackendUnifiedServiceManager::listServices(
         int32_t dumpPriority, ::std::vector<::std::string>* _aidl_return) {
@@ -302,6 +350,80 @@ binder::Status BackendUnifiedServiceManager::getServiceDebugInfo(
     return mTheRealServiceManager->getServiceDebugInfo(_aidl_return);
 }
 
+sp<os::IServiceLookup> BackendUnifiedServiceManager::getServiceLookup() {
+    std::call_once(mServiceLookupOnce, [this]() {
+        sp<IBinder> extension;
+        if (status_t status =
+                    IInterface::asBinder(mTheRealServiceManager)->getExtension(&extension);
+            status != OK) {
+            ALOGW("Failed to get the extension of the service manager: %s",
+                  statusToString(status).c_str());
+            return;
+        }
+        mServiceLookup = interface_cast<os::IServiceLookup>(extension);
+    });
+    return mServiceLookup;
+}
+
+binder::Status BackendUnifiedServiceManager::getServicesNoWait(
+        const ::std::vector<::std::string>& names, ::std::vector<os::Service>* _out) {
+    _out->assign(names.size(), os::Service::make<os::Service::Tag::binder>(nullptr));
+
+    // only ask for the services which aren't cached, like getService2
+    std::vector<size_t> missIndices;
+    std::vector<std::string> missNames;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!returnIfCached(names[i], false /*allowNotFound*/, &(*_out)[i])) {
+            missIndices.push_back(i);
+            missNames.push_back(names[i]);
+        }
+    }
+    if (missNames.empty()) {
+        return binder::Status::ok();
+    }
+
+    sp<os::IServiceLookup> lookup = getServiceLookup();
+    if (lookup == nullptr) {
+        // an older service manager, look the services up one at a time
+        for (size_t i : missIndices) {
+            binder::Status status = getService2(names[i], &(*_out)[i]);
+            if (!status.isOk()) return status;
+        }
+        return binder::Status::ok();
+    }
+
+    std::vector<os::Service> services;
+    binder::Status status = lookup->getServicesNoWait(missNames, &services);
+    if (!status.isOk()) {
+        return status;
+    }
+    if (services.size() != missNames.size()) {
+        ALOGE("Service manager returned %zu services, but %zu were requested", services.size(),
+              missNames.size());
+        return binder::Status::fromStatusT(BAD_VALUE);
+    }
+
+    for (size_t j = 0; j < missIndices.size(); j++) {
+        const std::string& name = missNames[j];
+        status = toBinderService(name, services[j], &(*_out)[missIndices[j]]);
+        if (!status.isOk()) return status;
+        status = updateCache(name, services[j]);
+        if (!status.isOk()) return status;
+    }
+    return binder::Status::ok();
+}
+
+status_t BackendUnifiedServiceManager::dump(int fd, const Vector<String16>& /*args*/) {
+    std::string out;
+    if (kUseCache) {
+        mCacheForGetService->dump(&out);
+    } else {
+        out = "Service cache: disabled\n";
+    }
+    if (!binder::WriteFully(fd, out.data(), out.size())) return -errno;
+    return OK;
+}
+
 [[clang::no_destroy]] static std::once_flag gUSmOnce;
 [[clang::no_destroy]] static sp<BackendUnifiedServiceManager> gUnifiedServiceManager;
 
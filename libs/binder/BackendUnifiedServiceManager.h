@@ -16,13 +16,23 @@
 #pragma once
 
 #include <android/os/BnServiceManager.h>
+#include <android/os/IServiceLookup.h>
 #include <android/os/IServiceManager.h>
 #include <binder/IPCThreadState.h>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
 
 namespace android {
 
+// Cache of services, split into shards by name, so that lookups of different
+// services don't contend with each other, and lookups of the same service only
+// take a shared lock.
 class BinderCacheWithInvalidation
       : public std::enable_shared_from_this<BinderCacheWithInvalidation> {
     class BinderInvalidation : public IBinder::DeathRecipient {
@@ -44,29 +54,54 @@ class BinderCacheWithInvalidation
         std::string mKey;
     };
     struct Entry {
+        // nullptr if the service wasn't found
         sp<IBinder> service;
         sp<BinderInvalidation> deathRecipient;
+        // only for entries without a service
+        std::chrono::steady_clock::time_point expiry;
     };
 
 public:
-    sp<IBinder> getItem(const std::string& key) const {
-        std::lock_guard<std::mutex> lock(mCacheMutex);
-
-        if (auto it = mCache.find(key); it != mCache.end()) {
-            return it->second.service;
+    // How long a service which wasn't found is remembered for. This is
+    // shorter than the retry interval of IServiceManager::getService, so that
+    // waiting for a service isn't delayed by it.
+    static constexpr std::chrono::milliseconds kNotFoundTtl{50};
+
+    // Returns whether `key` is cached, and sets `item` to the service if so.
+    // With `allowNotFound`, a service which recently wasn't found is also
+    // cached, as nullptr.
+    bool getItem(const std::string& key, bool allowNotFound, sp<IBinder>* item) {
+        Shard& shard = shardFor(key);
+        std::shared_lock lock(shard.mutex);
+
+        if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+            const Entry& entry = it->second;
+            if (entry.service != nullptr) {
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                *item = entry.service;
+                return true;
+            }
+            if (allowNotFound && std::chrono::steady_clock::now() < entry.expiry) {
+                shard.notFoundHits.fetch_add(1, std::memory_order_relaxed);
+                *item = nullptr;
+                return true;
+            }
         }
-        return nullptr;
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
 
     bool removeItem(const std::string& key, const sp<IBinder>& who) {
-        std::lock_guard<std::mutex> lock(mCacheMutex);
-        if (auto it = mCache.find(key); it != mCache.end()) {
+        Shard& shard = shardFor(key);
+        std::unique_lock lock(shard.mutex);
+        if (auto it = shard.entries.find(key); it != shard.entries.end()) {
             if (it->second.service == who) {
                 status_t result = who->unlinkToDeath(it->second.deathRecipient);
                 if (result != DEAD_OBJECT) {
                     ALOGW("Unlinking to dead binder resulted in: %d", result);
                 }
-                mCache.erase(key);
+                shard.entries.erase(it);
+                shard.invalidations.fetch_add(1, std::memory_order_relaxed);
                 return true;
             }
         }
@@ -86,17 +121,63 @@ public:
                 return binder::Status::fromStatusT(status);
             }
         }
-        std::lock_guard<std::mutex> lock(mCacheMutex);
+        Shard& shard = shardFor(key);
+        std::unique_lock lock(shard.mutex);
         Entry entry = {.service = item, .deathRecipient = deathRecipient};
-        mCache[key] = entry;
+        shard.entries[key] = entry;
         return binder::Status::ok();
     }
 
+    // Remembers that `key` wasn't found, for kNotFoundTtl. Doesn't replace a
+    // service which was found in the meantime. Services of the same shard
+    // which expired are forgotten, so that the shard doesn't keep growing.
+    void setNotFound(const std::string& key) {
+        Shard& shard = shardFor(key);
+        std::unique_lock lock(shard.mutex);
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::erase_if(shard.entries, [&](const auto& item) {
+            return item.second.service == nullptr && item.second.expiry <= now;
+        });
+        Entry& entry = shard.entries[key];
+        if (entry.service == nullptr) {
+            entry.expiry = now + kNotFoundTtl;
+        }
+    }
+
+    // Forgets that `key` wasn't found, e.g. because it was just added.
+    void removeNotFound(const std::string& key) {
+        Shard& shard = shardFor(key);
+        std::unique_lock lock(shard.mutex);
+        if (auto it = shard.entries.find(key);
+            it != shard.entries.end() && it->second.service == nullptr) {
+            shard.entries.erase(it);
+            shard.invalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
     bool isClientSideCachingEnabled(const std::string& serviceName);
 
+    void dump(std::string* out) const;
+
 private:
-    std::map<std::string, Entry> mCache;
-    mutable std::mutex mCacheMutex;
+    static constexpr size_t kNumShards = 16;
+
+    // aligned, so that counting lookups in one shard doesn't slow down others
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex; // for entries
+        std::map<std::string, Entry> entries;
+
+        std::atomic<uint64_t> hits = 0;
+        std::atomic<uint64_t> notFoundHits = 0;
+        std::atomic<uint64_t> misses = 0;
+        std::atomic<uint64_t> invalidations = 0;
+    };
+
+    Shard& shardFor(const std::string& key) {
+        return mShards[std::hash<std::string>{}(key) % kNumShards];
+    }
+
+    std::array<Shard, kNumShards> mShards;
 };
 
 class BackendUnifiedServiceManager : public android::os::BnServiceManager {
@@ -130,6 +211,14 @@ public:
                                         const sp<IBinder>& service) override;
     binder::Status getServiceDebugInfo(::std::vector<os::ServiceDebugInfo>* _aidl_return) override;
 
+    // See IServiceLookup::getServicesNoWait. With a service manager which
+    // doesn't serve IServiceLookup, this looks the services up one at a time.
+    binder::Status getServicesNoWait(const ::std::vector<::std::string>& names,
+                                     ::std::vector<os::Service>* _out);
+
+    // Reports the statistics of the cache of services.
+    status_t dump(int fd, const Vector<String16>& args) override;
+
     // for legacy ABI
     const String16& getInterfaceDescriptor() const override {
         return mTheRealServiceManager->getInterfaceDescriptor();
@@ -138,10 +227,14 @@ public:
 private:
     std::shared_ptr<BinderCacheWithInvalidation> mCacheForGetService;
     sp<os::IServiceManager> mTheRealServiceManager;
+    // the extension of mTheRealServiceManager, nullptr for older service managers
+    std::once_flag mServiceLookupOnce;
+    sp<os::IServiceLookup> mServiceLookup;
+    sp<os::IServiceLookup> getServiceLookup();
     binder::Status toBinderService(const ::std::string& name, const os::Service& in,
                                    os::Service* _out);
     binder::Status updateCache(const std::string& serviceName, const os::Service& service);
-    bool returnIfCached(const std::string& serviceName, os::Service* _out);
+    bool returnIfCached(const std::string& serviceName, bool allowNotFound, os::Service* _out);
 };
 
 sp<BackendUnifiedServiceManager> getBackendUnifiedServiceManager();
@@ -58,6 +58,14 @@ bool FdTrigger::isTriggered() {
 #endif
 }
 
+binder::borrowed_fd FdTrigger::hangupFd() {
+#ifdef BINDER_RPC_SINGLE_THREADED
+    return binder::borrowed_fd(-1);
+#else
+    return mRead;
+#endif
+}
+
 status_t FdTrigger::triggerablePoll(const android::RpcTransportFd& transportFd, int16_t event) {
 #ifdef BINDER_RPC_SINGLE_THREADED
     if (mTriggered) {
@@ -65,28 +73,50 @@ status_t FdTrigger::triggerablePoll(const android::RpcTransportFd& transportFd,
     }
 #endif
 
-    LOG_ALWAYS_FATAL_IF(event == 0, "triggerablePoll %d with event 0 is not allowed",
-                        transportFd.fd.get());
-    pollfd pfd[]{
-            {.fd = transportFd.fd.get(), .events = static_cast<int16_t>(event), .revents = 0},
-#ifndef BINDER_RPC_SINGLE_THREADED
-            {.fd = mRead.get(), .events = 0, .revents = 0},
-#endif
-    };
-
     LOG_ALWAYS_FATAL_IF(transportFd.isInPollingState() == true,
                         "Only one thread should be polling on Fd!");
 
     transportFd.setPollingState(true);
     auto pollingStateGuard = make_scope_guard([&]() { transportFd.setPollingState(false); });
 
-    int ret = TEMP_FAILURE_RETRY(poll(pfd, countof(pfd), -1));
+    return poll(transportFd.fd, event, -1);
+}
+
+status_t FdTrigger::triggerablePoll(binder::borrowed_fd fd, int16_t event,
+                                    std::chrono::milliseconds timeout) {
+#ifdef BINDER_RPC_SINGLE_THREADED
+    if (mTriggered) {
+        return DEAD_OBJECT;
+    }
+#endif
+
+    status_t status = poll(fd, event, static_cast<int>(timeout.count()));
+    if (status == TIMED_OUT) {
+        LOG_RPC_DETAIL("poll(%d) timed out after %lldms", fd.get(),
+                       static_cast<long long>(timeout.count()));
+    }
+    return status;
+}
+
+status_t FdTrigger::poll(binder::borrowed_fd fd, int16_t event, int timeoutMs) {
+    LOG_ALWAYS_FATAL_IF(event == 0, "triggerablePoll %d with event 0 is not allowed", fd.get());
+    pollfd pfd[]{
+            {.fd = fd.get(), .events = static_cast<int16_t>(event), .revents = 0},
+#ifndef BINDER_RPC_SINGLE_THREADED
+            {.fd = mRead.get(), .events = 0, .revents = 0},
+#endif
+    };
+
+    int ret = TEMP_FAILURE_RETRY(::poll(pfd, countof(pfd), timeoutMs));
     if (ret < 0) {
         int saved_errno = errno;
         ALOGE("FdTrigger poll returned error: %d, with error: %s", ret, strerror(saved_errno));
         return -saved_errno;
     }
-    LOG_ALWAYS_FATAL_IF(ret == 0, "poll(%d) returns 0 with infinite timeout", transportFd.fd.get());
+    if (ret == 0) {
+        LOG_ALWAYS_FATAL_IF(timeoutMs < 0, "poll(%d) returns 0 with infinite timeout", fd.get());
+        return TIMED_OUT;
+    }
 
     // At least one FD has events. Check them.
 
@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include <utils/Errors.h>
@@ -57,7 +58,26 @@ public:
     [[nodiscard]] status_t triggerablePoll(const android::RpcTransportFd& transportFd,
                                            int16_t event);
 
+    /**
+     * Like triggerablePoll, but gives up after `timeout`.
+     *
+     * Return:
+     *   TIMED_OUT - neither the event nor the trigger happened in time
+     */
+    [[nodiscard]] status_t triggerablePoll(binder::borrowed_fd fd, int16_t event,
+                                           std::chrono::milliseconds timeout);
+
+    /**
+     * For waiting with something other than poll(2) (e.g. epoll): an FD which reports
+     * POLLHUP once this has been triggered. Returns an invalid FD when there
+     * is nothing to wait on, in which case callers should rely on isTriggered().
+     */
+    [[nodiscard]] binder::borrowed_fd hangupFd();
+
 private:
+    // timeoutMs < 0 waits forever
+    [[nodiscard]] status_t poll(binder::borrowed_fd fd, int16_t event, int timeoutMs);
+
 #ifdef BINDER_RPC_SINGLE_THREADED
     bool mTriggered = false;
 #else
@@ -85,6 +85,15 @@ const String16& IServiceManager::getInterfaceDescriptor() const {
 IServiceManager::IServiceManager() {}
 IServiceManager::~IServiceManager() {}
 
+std::vector<sp<IBinder>> IServiceManager::getServicesNoWait(const std::vector<String16>& names) {
+    std::vector<sp<IBinder>> ret;
+    ret.reserve(names.size());
+    for (const auto& name : names) {
+        ret.push_back(checkService(name));
+    }
+    return ret;
+}
+
 // From the old libbinder IServiceManager interface to IServiceManager.
 class CppBackendShim : public IServiceManager {
 public:
@@ -121,6 +130,7 @@ public:
                                         const sp<AidlRegistrationCallback>& cb) override;
 
     std::vector<IServiceManager::ServiceDebugInfo> getServiceDebugInfo() override;
+    std::vector<sp<IBinder>> getServicesNoWait(const std::vector<String16>& names) override;
     // for legacy ABI
     const String16& getInterfaceDescriptor() const override {
         return mUnifiedServiceManager->getInterfaceDescriptor();
@@ -823,6 +833,28 @@ std::vector<IServiceManager::ServiceDebugInfo> CppBackendShim::getServiceDebugIn
     return ret;
 }
 
+std::vector<sp<IBinder>> CppBackendShim::getServicesNoWait(const std::vector<String16>& names) {
+    std::vector<std::string> names8;
+    names8.reserve(names.size());
+    for (const auto& name : names) {
+        names8.push_back(String8(name).c_str());
+    }
+
+    std::vector<Service> services;
+    if (Status status = mUnifiedServiceManager->getServicesNoWait(names8, &services); !status.isOk()) {
+        ALOGW("%s Failed to get %zu services: %s", __FUNCTION__, names.size(),
+              status.toString8().c_str());
+        return std::vector<sp<IBinder>>(names.size());
+    }
+
+    std::vector<sp<IBinder>> ret;
+    ret.reserve(services.size());
+    for (const auto& service : services) {
+        ret.push_back(service.get<Service::Tag::binder>());
+    }
+    return ret;
+}
+
 #ifndef __ANDROID__
 // CppBackendShim for host. Implements the old libbinder android::IServiceManager API.
 // The internal implementation of the AIDL interface android::os::IServiceManager calls into
@@ -836,6 +868,10 @@ public:
     sp<IBinder> checkService(const String16& name) const override {
         return getDeviceService({String8(name).c_str()}, mOptions);
     }
+    // each service is its own connection to the device
+    std::vector<sp<IBinder>> getServicesNoWait(const std::vector<String16>& names) override {
+        return IServiceManager::getServicesNoWait(names);
+    }
 
 protected:
     // Override realGetService for CppBackendShim::waitForService.
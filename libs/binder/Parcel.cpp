@@ -114,6 +114,9 @@ static std::atomic<size_t> gParcelGlobalAllocSize;
 // Maximum number of file descriptors per Parcel.
 constexpr size_t kMaxFds = 1024;
 
+// Maximum segment size for Parcels using segmented storage.
+constexpr size_t kMaxDataSegmentSize = 16 * 1024 * 1024;
+
 // Maximum size of a blob to transfer in-place.
 [[maybe_unused]] static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
 
@@ -392,6 +395,7 @@ status_t Parcel::unflattenBinder(sp<IBinder>* out) const
 Parcel::Parcel()
 {
     LOG_ALLOC("Parcel %p: constructing", this);
+    mSegmentSize = 0;
     initState();
 }
 
@@ -486,6 +490,32 @@ status_t Parcel::setDataCapacity(size_t size)
     return NO_ERROR;
 }
 
+status_t Parcel::setDataSegmentSize(size_t segmentSize)
+{
+    if (mData != nullptr) {
+        ALOGE("Cannot change the segment size of a Parcel which already has data.");
+        return INVALID_OPERATION;
+    }
+    if (segmentSize == 0) {
+        mSegmentSize = 0;
+        return NO_ERROR;
+    }
+#ifdef __linux__
+    if (segmentSize > kMaxDataSegmentSize) return BAD_VALUE;
+
+    const size_t pageSize = getpagesize();
+    mSegmentSize = ((segmentSize + pageSize - 1) / pageSize) * pageSize;
+    return NO_ERROR;
+#else
+    return INVALID_OPERATION;
+#endif
+}
+
+size_t Parcel::dataSegmentSize() const
+{
+    return mSegmentSize;
+}
+
 status_t Parcel::setData(const uint8_t* buffer, size_t len)
 {
     if (len > INT32_MAX) {
@@ -2907,6 +2937,79 @@ void Parcel::acquireObjects()
 #endif // BINDER_WITH_KERNEL_IPC
 }
 
+static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity, size_t newCapacity, bool zero) {
+    if (!zero) {
+        return (uint8_t*)realloc(data, newCapacity);
+    }
+    uint8_t* newData = (uint8_t*)malloc(newCapacity);
+    if (!newData) {
+        return nullptr;
+    }
+
+    memcpy(newData, data, std::min(oldCapacity, newCapacity));
+    zeroMemory(data, oldCapacity);
+    free(data);
+    return newData;
+}
+
+// Returns the capacity actually allocated for a request of 'desired' bytes. Segmented
+// storage is always a whole number of segments.
+static size_t storageCapacity(size_t desired, size_t segmentSize) {
+    if (segmentSize == 0) return desired;
+    // desired <= INT32_MAX and segmentSize <= kMaxDataSegmentSize, so this can't overflow.
+    return ((desired + segmentSize - 1) / segmentSize) * segmentSize;
+}
+
+static uint8_t* allocStorage(size_t capacity, size_t segmentSize) {
+    if (segmentSize == 0) {
+        return (uint8_t*)malloc(capacity);
+    }
+#ifdef __linux__
+    if (capacity == 0) return nullptr;
+    void* data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+    return data == MAP_FAILED ? nullptr : (uint8_t*)data;
+#else
+    LOG_ALWAYS_FATAL("Segmented Parcel storage is not supported on this platform");
+    return nullptr;
+#endif
+}
+
+static void freeStorage(uint8_t* data, [[maybe_unused]] size_t capacity, size_t segmentSize) {
+    if (segmentSize == 0) {
+        free(data);
+        return;
+    }
+#ifdef __linux__
+    if (data && ::munmap(data, capacity) != 0) {
+        ALOGW("munmap() of Parcel storage failed: %s", strerror(errno));
+    }
+#else
+    LOG_ALWAYS_FATAL("Segmented Parcel storage is not supported on this platform");
+#endif
+}
+
+static uint8_t* reallocStorage(uint8_t* data, size_t oldCapacity, size_t newCapacity,
+                               size_t segmentSize, bool zero) {
+    if (segmentSize == 0) {
+        return reallocZeroFree(data, oldCapacity, newCapacity, zero);
+    }
+#ifdef __linux__
+    if (data == nullptr) return allocStorage(newCapacity, segmentSize);
+    if (newCapacity == 0) {
+        freeStorage(data, oldCapacity, segmentSize);
+        return nullptr;
+    }
+    // mremap() moves the existing pages instead of copying their contents, and leaves no
+    // stale copy behind, so there is nothing extra to zero for sensitive Parcels.
+    void* newData = ::mremap(data, oldCapacity, newCapacity, MREMAP_MAYMOVE);
+    return newData == MAP_FAILED ? nullptr : (uint8_t*)newData;
+#else
+    LOG_ALWAYS_FATAL("Segmented Parcel storage is not supported on this platform");
+    return nullptr;
+#endif
+}
+
 void Parcel::freeData()
 {
     freeDataNoInit();
@@ -2933,7 +3036,7 @@ void Parcel::freeDataNoInit()
             if (mDeallocZero) {
                 zeroMemory(mData, mDataSize);
             }
-            free(mData);
+            freeStorage(mData, mDataCapacity, mSegmentSize);
         }
         auto* kernelFields = maybeKernelFields();
         if (kernelFields && kernelFields->mObjects) free(kernelFields->mObjects);
@@ -2949,6 +3052,13 @@ status_t Parcel::growData(size_t len)
     }
 
     if (len > SIZE_MAX - mDataSize) return NO_MEMORY; // overflow
+    if (mSegmentSize != 0) {
+        // Segmented storage is extended by remapping pages, so there is no copy to amortize
+        // and no reason to over-allocate: just add as many segments as the write needs.
+        const size_t end = std::max(mDataSize, mDataPos);
+        if (len > SIZE_MAX - end) return NO_MEMORY; // overflow
+        return continueWrite(end + len);
+    }
     if (mDataSize + len > SIZE_MAX / 3) return NO_MEMORY; // overflow
     size_t newSize = ((mDataSize+len)*3)/2;
     return (newSize <= mDataSize)
@@ -2956,21 +3066,6 @@ status_t Parcel::growData(size_t len)
             : continueWrite(std::max(newSize, (size_t) 128));
 }
 
-static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity, size_t newCapacity, bool zero) {
-    if (!zero) {
-        return (uint8_t*)realloc(data, newCapacity);
-    }
-    uint8_t* newData = (uint8_t*)malloc(newCapacity);
-    if (!newData) {
-        return nullptr;
-    }
-
-    memcpy(newData, data, std::min(oldCapacity, newCapacity));
-    zeroMemory(data, oldCapacity);
-    free(data);
-    return newData;
-}
-
 status_t Parcel::restartWrite(size_t desired)
 {
     if (desired > INT32_MAX) {
@@ -2986,7 +3081,8 @@ status_t Parcel::restartWrite(size_t desired)
 
     releaseObjects();
 
-    uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+    desired = storageCapacity(desired, mSegmentSize);
+    uint8_t* data = reallocStorage(mData, mDataCapacity, desired, mSegmentSize, mDeallocZero);
     if (!data && desired > mDataCapacity) {
         LOG_ALWAYS_FATAL("out of memory");
         mError = NO_MEMORY;
@@ -3071,7 +3167,8 @@ status_t Parcel::continueWrite(size_t desired)
 
         // If there is a different owner, we need to take
         // posession.
-        uint8_t* data = (uint8_t*)malloc(desired);
+        const size_t capacity = storageCapacity(desired, mSegmentSize);
+        uint8_t* data = allocStorage(capacity, mSegmentSize);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3081,7 +3178,7 @@ status_t Parcel::continueWrite(size_t desired)
         if (kernelFields && objectsSize) {
             objects = (binder_size_t*)calloc(objectsSize, sizeof(binder_size_t));
             if (!objects) {
-                free(data);
+                freeStorage(data, capacity, mSegmentSize);
 
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -3096,7 +3193,7 @@ status_t Parcel::continueWrite(size_t desired)
         }
         if (rpcFields) {
             if (status_t status = truncateRpcObjects(objectsSize); status != OK) {
-                free(data);
+                freeStorage(data, capacity, mSegmentSize);
                 return status;
             }
         }
@@ -3117,14 +3214,14 @@ status_t Parcel::continueWrite(size_t desired)
                kernelFields ? kernelFields->mObjectsSize : 0);
         mOwner = nullptr;
 
-        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: taking ownership of %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = (mDataSize < desired) ? mDataSize : desired;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
         if (kernelFields) {
             kernelFields->mObjects = objects;
             kernelFields->mObjectsSize = kernelFields->mObjectsCapacity = objectsSize;
@@ -3175,14 +3272,16 @@ status_t Parcel::continueWrite(size_t desired)
 
         // We own the data, so we can just do a realloc().
         if (desired > mDataCapacity) {
-            uint8_t* data = reallocZeroFree(mData, mDataCapacity, desired, mDeallocZero);
+            const size_t capacity = storageCapacity(desired, mSegmentSize);
+            uint8_t* data =
+                    reallocStorage(mData, mDataCapacity, capacity, mSegmentSize, mDeallocZero);
             if (data) {
                 LOG_ALLOC("Parcel %p: continue from %zu to %zu capacity", this, mDataCapacity,
-                        desired);
-                gParcelGlobalAllocSize += desired;
+                        capacity);
+                gParcelGlobalAllocSize += capacity;
                 gParcelGlobalAllocSize -= mDataCapacity;
                 mData = data;
-                mDataCapacity = desired;
+                mDataCapacity = capacity;
             } else {
                 mError = NO_MEMORY;
                 return NO_MEMORY;
@@ -3200,7 +3299,8 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        const size_t capacity = storageCapacity(desired, mSegmentSize);
+        uint8_t* data = allocStorage(capacity, mSegmentSize);
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -3214,15 +3314,15 @@ status_t Parcel::continueWrite(size_t desired)
                   kernelFields ? kernelFields->mObjectsCapacity : 0, desired);
         }
 
-        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
@@ -34,8 +34,10 @@
 #include "BuildFlags.h"
 #include "FdTrigger.h"
 #include "OS.h"
+#include "RpcServerThreadPool.h"
 #include "RpcSocketAddress.h"
 #include "RpcState.h"
+#include "RpcTransportShm.h"
 #include "RpcTransportUtils.h"
 #include "RpcWireFormat.h"
 #include "Utils.h"
@@ -139,6 +141,17 @@ size_t RpcServer::getMaxThreads() {
     return mMaxThreads;
 }
 
+void RpcServer::setSharedThreadPoolSize(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(threads > 0 && !kEnableRpcThreads,
+                        "Shared thread pools are not supported on single-threaded libbinder");
+    LOG_ALWAYS_FATAL_IF(mJoinThreadRunning, "Cannot set shared thread pool size while running");
+    mSharedThreadPoolSize = threads;
+}
+
+size_t RpcServer::getSharedThreadPoolSize() {
+    return mSharedThreadPoolSize;
+}
+
 bool RpcServer::setProtocolVersion(uint32_t version) {
     if (!RpcState::validateProtocolVersion(version)) {
         return false;
@@ -253,7 +266,8 @@ status_t RpcServer::recvmsgSocketConnection(const RpcServer& server, RpcTranspor
 }
 
 void RpcServer::join() {
-
+    std::function<void(sp<RpcSession>&&, RpcSession::PreJoinSetupResult&&)> joinFn =
+            RpcSession::join;
     {
         RpcMutexLockGuard _l(mLock);
         LOG_ALWAYS_FATAL_IF(!mServer.fd.ok(), "RpcServer must be setup to join.");
@@ -262,6 +276,15 @@ void RpcServer::join() {
         mJoinThreadRunning = true;
         mShutdownTrigger = FdTrigger::make();
         LOG_ALWAYS_FATAL_IF(mShutdownTrigger == nullptr, "Cannot create join signaler");
+
+        if (mSharedThreadPoolSize > 0) {
+            mThreadPool = RpcServerThreadPool::make(mSharedThreadPoolSize);
+            LOG_ALWAYS_FATAL_IF(mThreadPool == nullptr, "Cannot create shared thread pool");
+            joinFn = [pool = mThreadPool](sp<RpcSession>&& session,
+                                          RpcSession::PreJoinSetupResult&& setupResult) {
+                pool->join(std::move(session), std::move(setupResult));
+            };
+        }
     }
 
     status_t status;
@@ -296,7 +319,7 @@ void RpcServer::join() {
             RpcMaybeThread thread =
                     RpcMaybeThread(&RpcServer::establishConnection,
                                    sp<RpcServer>::fromExisting(this), std::move(clientSocket), addr,
-                                   addrLen, RpcSession::join);
+                                   addrLen, joinFn);
 
             auto& threadRef = mConnectingThreads[thread.get_id()];
             threadRef = std::move(thread);
@@ -364,6 +387,12 @@ bool RpcServer::shutdown() {
     LOG_RPC_DETAIL("Finished waiting on shutdown.");
 
     mShutdownTrigger = nullptr;
+
+    // all sessions are gone, so the pool is idle. Its threads are joined once
+    // connecting threads which may still be holding onto it are done.
+    std::shared_ptr<RpcServerThreadPool> threadPool = std::move(mThreadPool);
+    _l.unlock();
+    threadPool = nullptr;
     return true;
 }
 
@@ -404,10 +433,14 @@ void RpcServer::establishConnection(
     }
 
     RpcConnectionHeader header;
+    // only shared memory is sent with the header, see RPC_CONNECTION_OPTION_SHARED_MEMORY
+    std::vector<std::variant<unique_fd, borrowed_fd>> headerFds;
     if (status == OK) {
         iovec iov{&header, sizeof(header)};
         status = client->interruptableReadFully(server->mShutdownTrigger.get(), &iov, 1,
-                                                std::nullopt, /*ancillaryFds=*/nullptr);
+                                                std::nullopt,
+                                                client->allowsSharedMemory() ? &headerFds
+                                                                             : nullptr);
         if (status != OK) {
             ALOGE("Failed to read ID for client connecting to RPC server: %s",
                   statusToString(status).c_str());
@@ -439,6 +472,7 @@ void RpcServer::establishConnection(
     bool incoming = false;
     uint32_t protocolVersion = 0;
     bool requestingNewSession = false;
+    std::unique_ptr<RpcShmRegion> shm;
 
     if (status == OK) {
         incoming = header.options & RPC_CONNECTION_OPTION_INCOMING;
@@ -446,9 +480,21 @@ void RpcServer::establishConnection(
                                    server->mProtocolVersion.value_or(RPC_WIRE_PROTOCOL_VERSION));
         requestingNewSession = sessionId.empty();
 
+        bool requestingShm = header.options & RPC_CONNECTION_OPTION_SHARED_MEMORY;
+        if (requestingShm && headerFds.size() == 1 &&
+            header.fileDescriptorTransportMode ==
+                    static_cast<uint8_t>(RpcSession::FileDescriptorTransportMode::NONE)) {
+            shm = RpcShmRegion::fromPeer(std::move(std::get<unique_fd>(headerFds.at(0))));
+        } else if (requestingShm) {
+            ALOGE("Rejecting shared memory for connection with %zu fds and fd transport mode %hhu",
+                  headerFds.size(), header.fileDescriptorTransportMode);
+        }
+
         if (requestingNewSession) {
             RpcNewSessionResponse response{
                     .version = protocolVersion,
+                    .options = static_cast<uint8_t>(
+                            shm != nullptr ? RPC_NEW_SESSION_RESPONSE_OPTION_SHARED_MEMORY : 0),
             };
 
             iovec iov{&response, sizeof(response)};
@@ -458,6 +504,22 @@ void RpcServer::establishConnection(
                 ALOGE("Failed to send new session response: %s", statusToString(status).c_str());
                 // still need to cleanup before we can return
             }
+        } else if (requestingShm) {
+            RpcSharedMemoryResponse response{
+                    .accepted = shm != nullptr,
+            };
+
+            iovec iov{&response, sizeof(response)};
+            status = client->interruptableWriteFully(server->mShutdownTrigger.get(), &iov, 1,
+                                                     std::nullopt, nullptr);
+            if (status != OK) {
+                ALOGE("Failed to send shared memory response: %s", statusToString(status).c_str());
+                // still need to cleanup before we can return
+            }
+        }
+
+        if (status == OK && shm != nullptr) {
+            client = newRpcTransportShm(std::move(client), std::move(shm), false /*isClient*/);
         }
     }
 
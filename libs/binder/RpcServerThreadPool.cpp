@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcServerThreadPool"
+
+#include "RpcServerThreadPool.h"
+
+#include <log/log.h>
+
+#include <chrono>
+
+#include "FdTrigger.h"
+#include "OS.h"
+#include "RpcState.h"
+
+#if defined(__linux__) && !defined(BINDER_RPC_SINGLE_THREADED)
+#include <string.h>
+#include <sys/epoll.h>
+#endif
+
+namespace android {
+
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+#if defined(__linux__) && !defined(BINDER_RPC_SINGLE_THREADED)
+
+// epoll_event::data of the pool's own shutdown trigger, never used for entries
+constexpr uint64_t kShutdownId = 0;
+
+// How long a client may take to send the rest of a command after it started
+// arriving. Reading it holds up a thread of the pool, so a client which stops
+// halfway through a command has its session shut down instead.
+constexpr std::chrono::milliseconds kCommandReadTimeout = std::chrono::seconds(1);
+
+std::unique_ptr<RpcServerThreadPool> RpcServerThreadPool::make(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(threads == 0, "RpcServerThreadPool is useless without threads");
+
+    std::unique_ptr<RpcServerThreadPool> pool(new RpcServerThreadPool());
+
+    pool->mEpoll.reset(TEMP_FAILURE_RETRY(epoll_create1(EPOLL_CLOEXEC)));
+    if (!pool->mEpoll.ok()) {
+        ALOGE("Could not create epoll instance: %s", strerror(errno));
+        return nullptr;
+    }
+
+    pool->mShutdownTrigger = FdTrigger::make();
+    if (pool->mShutdownTrigger == nullptr) return nullptr;
+
+    // level-triggered, so that every thread sees it
+    epoll_event event{.events = EPOLLIN, .data = {.u64 = kShutdownId}};
+    if (0 !=
+        epoll_ctl(pool->mEpoll.get(), EPOLL_CTL_ADD, pool->mShutdownTrigger->hangupFd().get(),
+                  &event)) {
+        ALOGE("Could not add shutdown trigger to epoll: %s", strerror(errno));
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        pool->mThreads.emplace_back(&RpcServerThreadPool::threadMain, pool.get());
+    }
+    return pool;
+}
+
+RpcServerThreadPool::~RpcServerThreadPool() {
+    if (mShutdownTrigger != nullptr) mShutdownTrigger->trigger();
+    for (auto& thread : mThreads) thread.join();
+}
+
+void RpcServerThreadPool::join(sp<RpcSession>&& session,
+                               RpcSession::PreJoinSetupResult&& setupResult) {
+    const sp<RpcSession::RpcConnection>& connection = setupResult.connection;
+    borrowed_fd fd =
+            setupResult.status == OK ? connection->rpcTransport->pollableFd() : borrowed_fd(-1);
+    if (fd.get() < 0) {
+        RpcSession::join(std::move(session), std::move(setupResult));
+        return;
+    }
+
+    // this thread only set up the connection, the pool serves it from now on
+    session->clearConnectionTid(connection);
+    (void)session->releaseJoinThread();
+
+    auto entry = std::make_shared<Entry>(Entry{
+            .kind = Entry::Kind::CONNECTION,
+            .session = session,
+            .connection = connection,
+    });
+    uint64_t id;
+    bool added;
+    {
+        RpcMutexLockGuard _l(mMutex);
+        SessionState& state = mSessions[session.get()];
+        if (state.numConnections++ == 0) {
+            state.shutdownId = mNextId++;
+            mEntries[state.shutdownId] = std::make_shared<Entry>(Entry{
+                    .kind = Entry::Kind::SESSION_SHUTDOWN,
+                    .session = session,
+            });
+            if (!addLocked(state.shutdownId, session->mShutdownTrigger->hangupFd())) {
+                ALOGE("Shutdown of this session won't end its idle connections");
+            }
+        }
+
+        id = mNextId++;
+        mEntries[id] = entry;
+        // if the session already shut down, its SESSION_SHUTDOWN entry may have fired already
+        added = !session->mShutdownTrigger->isTriggered() && addLocked(id, fd);
+        if (!added) entry->busy = true;
+    }
+
+    if (!added) endConnection(id, entry);
+}
+
+void RpcServerThreadPool::threadMain() {
+    while (true) {
+        epoll_event event;
+        int ret = TEMP_FAILURE_RETRY(epoll_wait(mEpoll.get(), &event, 1, -1));
+        if (ret < 0) {
+            ALOGE("RpcServerThreadPool thread exiting, epoll_wait failed: %s", strerror(errno));
+            return;
+        }
+        if (ret == 0) continue;
+
+        uint64_t id = event.data.u64;
+        if (id == kShutdownId) return;
+
+        std::shared_ptr<Entry> entry;
+        {
+            RpcMutexLockGuard _l(mMutex);
+            auto it = mEntries.find(id);
+            if (it == mEntries.end()) continue; // removed after the event was delivered
+            entry = it->second;
+            entry->busy = true;
+        }
+
+        switch (entry->kind) {
+            case Entry::Kind::CONNECTION:
+                serve(id, entry);
+                break;
+            case Entry::Kind::SESSION_SHUTDOWN:
+                endSession(entry->session);
+                break;
+        }
+    }
+}
+
+void RpcServerThreadPool::serve(uint64_t id, const std::shared_ptr<Entry>& entry) {
+    const sp<RpcSession>& session = entry->session;
+    const sp<RpcSession::RpcConnection>& connection = entry->connection;
+
+    // must be registered to allow arbitrary client code executing commands to
+    // be able to do nested calls, see RpcSession::preJoinSetup
+    {
+        RpcMutexLockGuard _l(session->mMutex);
+        connection->exclusiveTid = binder::os::GetThreadId();
+    }
+
+    // The transport may have read more than the command epoll woke us up for
+    // (e.g. TLS records), so keep going until it has nothing buffered. Epoll
+    // may also wake us up without a command (e.g. for RpcTransportShm wakeups
+    // which were already handled), so check before blocking on a read.
+    status_t status;
+    while ((status = connection->rpcTransport->pollRead()) == OK) {
+        connection->commandReadTimeout = kCommandReadTimeout;
+        status = session->state()->getAndExecuteCommand(connection, session,
+                                                        RpcState::CommandType::ANY);
+        connection->commandReadTimeout.reset();
+        if (status != OK) break;
+    }
+    if (status == WOULD_BLOCK) status = OK;
+
+    session->clearConnectionTid(connection);
+
+    // If the session shuts down after this check, its SESSION_SHUTDOWN entry
+    // ends this connection, since it is no longer busy.
+    if (status == OK && !session->mShutdownTrigger->isTriggered()) {
+        RpcMutexLockGuard _l(mMutex);
+        entry->busy = false;
+        if (rearmLocked(id, connection->rpcTransport->pollableFd())) return;
+        entry->busy = true;
+    }
+
+    LOG_RPC_DETAIL("Binder connection closing in thread pool w/ status %s",
+                   statusToString(status).c_str());
+    endConnection(id, entry);
+}
+
+void RpcServerThreadPool::endSession(const sp<RpcSession>& session) {
+    std::vector<std::pair<uint64_t, std::shared_ptr<Entry>>> idle;
+    {
+        RpcMutexLockGuard _l(mMutex);
+        for (auto& [id, entry] : mEntries) {
+            if (entry->kind != Entry::Kind::CONNECTION || entry->session != session) continue;
+            // busy connections are ended by their threads, which check for
+            // shutdown before re-arming
+            if (entry->busy) continue;
+            entry->busy = true;
+            idle.emplace_back(id, entry);
+        }
+    }
+
+    for (auto& [id, entry] : idle) endConnection(id, entry);
+}
+
+void RpcServerThreadPool::endConnection(uint64_t id, const std::shared_ptr<Entry>& entry) {
+    const sp<RpcSession>& session = entry->session;
+    {
+        RpcMutexLockGuard _l(mMutex);
+        removeLocked(id, entry->connection->rpcTransport->pollableFd());
+
+        auto it = mSessions.find(session.get());
+        LOG_ALWAYS_FATAL_IF(it == mSessions.end(), "Bad state, unknown session");
+        if (--it->second.numConnections == 0) {
+            removeLocked(it->second.shutdownId, session->mShutdownTrigger->hangupFd());
+            mSessions.erase(it);
+        }
+    }
+
+    sp<RpcSession::EventListener> listener;
+    {
+        RpcMutexLockGuard _l(session->mMutex);
+        listener = session->mEventListener.promote();
+    }
+
+    // done after all cleanup, since session shutdown progresses via callbacks here
+    LOG_ALWAYS_FATAL_IF(!session->removeIncomingConnection(entry->connection),
+                        "bad state: connection object guaranteed to be in list");
+
+    if (listener != nullptr) {
+        listener->onSessionIncomingThreadEnded();
+    }
+}
+
+bool RpcServerThreadPool::addLocked(uint64_t id, borrowed_fd fd) {
+    epoll_event event{.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, .data = {.u64 = id}};
+    if (0 != epoll_ctl(mEpoll.get(), EPOLL_CTL_ADD, fd.get(), &event)) {
+        ALOGE("Could not add fd %d to epoll: %s", fd.get(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool RpcServerThreadPool::rearmLocked(uint64_t id, borrowed_fd fd) {
+    epoll_event event{.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, .data = {.u64 = id}};
+    if (0 != epoll_ctl(mEpoll.get(), EPOLL_CTL_MOD, fd.get(), &event)) {
+        ALOGE("Could not re-arm fd %d in epoll: %s", fd.get(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void RpcServerThreadPool::removeLocked(uint64_t id, borrowed_fd fd) {
+    // may not have been added, if that failed
+    (void)epoll_ctl(mEpoll.get(), EPOLL_CTL_DEL, fd.get(), nullptr);
+    mEntries.erase(id);
+}
+
+#else // __linux__ && !BINDER_RPC_SINGLE_THREADED
+
+std::unique_ptr<RpcServerThreadPool> RpcServerThreadPool::make(size_t threads) {
+    ALOGE("Cannot create RpcServerThreadPool of %zu threads, not supported on this platform",
+          threads);
+    return nullptr;
+}
+
+RpcServerThreadPool::~RpcServerThreadPool() {}
+
+void RpcServerThreadPool::join(sp<RpcSession>&& session,
+                               RpcSession::PreJoinSetupResult&& setupResult) {
+    RpcSession::join(std::move(session), std::move(setupResult));
+}
+
+#endif // __linux__ && !BINDER_RPC_SINGLE_THREADED
+
+} // namespace android
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <binder/RpcSession.h>
+#include <binder/RpcThreads.h>
+#include <binder/unique_fd.h>
+
+namespace android {
+
+class FdTrigger;
+
+/**
+ * Serves the incoming connections of all sessions of an RpcServer from a
+ * fixed number of threads, instead of from a thread per connection (see
+ * RpcServer::setSharedThreadPoolSize).
+ *
+ * Every connection is registered with a single epoll instance, which all of
+ * the threads wait on. A connection is armed for one event at a time, so the
+ * kernel hands a ready connection to exactly one idle thread. That thread
+ * owns the connection (for nested transactions, exactly like a thread in
+ * RpcSession::join) until it has processed all of the buffered commands, and
+ * then re-arms it. A busy thread never holds up a connection that an idle
+ * thread could be serving.
+ */
+class RpcServerThreadPool {
+public:
+    /** Returns nullptr for error case */
+    static std::unique_ptr<RpcServerThreadPool> make(size_t threads);
+
+    /**
+     * Stops all threads. Connections which are still registered are dropped
+     * without notifying their sessions, so the server should make sure that
+     * all sessions have ended first.
+     */
+    ~RpcServerThreadPool();
+
+    /**
+     * Replacement for RpcSession::join, with the same preconditions. Hands
+     * the connection over to the pool and releases the calling thread. If the
+     * connection's transport can't be waited on with epoll, this falls back to
+     * RpcSession::join.
+     */
+    void join(sp<RpcSession>&& session, RpcSession::PreJoinSetupResult&& setupResult);
+
+private:
+    RpcServerThreadPool() = default;
+
+    struct Entry {
+        enum class Kind {
+            // one of the incoming connections of `session`
+            CONNECTION,
+            // `session` is shutting down
+            SESSION_SHUTDOWN,
+        };
+        Kind kind;
+        sp<RpcSession> session;
+        sp<RpcSession::RpcConnection> connection; // for CONNECTION
+        // being served by a thread, and not armed in epoll
+        bool busy = false;
+    };
+
+    void threadMain();
+    void serve(uint64_t id, const std::shared_ptr<Entry>& entry);
+    void endSession(const sp<RpcSession>& session);
+    // Must only be called by the thread which set the entry's busy bit.
+    void endConnection(uint64_t id, const std::shared_ptr<Entry>& entry);
+
+    [[nodiscard]] bool addLocked(uint64_t id, binder::borrowed_fd fd);
+    [[nodiscard]] bool rearmLocked(uint64_t id, binder::borrowed_fd fd);
+    void removeLocked(uint64_t id, binder::borrowed_fd fd);
+
+    binder::unique_fd mEpoll;
+    std::unique_ptr<FdTrigger> mShutdownTrigger;
+    std::vector<RpcMaybeThread> mThreads;
+
+    RpcMutex mMutex; // for below
+    // epoll_event::data is the ID, so that an event which raced with removing
+    // its entry refers to nothing, rather than to a dangling pointer
+    uint64_t mNextId = 1;
+    std::map<uint64_t, std::shared_ptr<Entry>> mEntries;
+    struct SessionState {
+        uint64_t shutdownId = 0; // of the session's SESSION_SHUTDOWN entry
+        size_t numConnections = 0;
+    };
+    // for each session with connections here
+    std::map<RpcSession*, SessionState> mSessions;
+};
+
+} // namespace android
@@ -39,6 +39,7 @@
 #include "OS.h"
 #include "RpcSocketAddress.h"
 #include "RpcState.h"
+#include "RpcTransportShm.h"
 #include "RpcTransportUtils.h"
 #include "RpcWireFormat.h"
 #include "Utils.h"
@@ -140,6 +141,16 @@ RpcSession::FileDescriptorTransportMode RpcSession::getFileDescriptorTransportMo
     return mFileDescriptorTransportMode;
 }
 
+void RpcSession::setUseSharedMemory(bool enabled) {
+    RpcMutexLockGuard _l(mMutex);
+    LOG_ALWAYS_FATAL_IF(mStartedSetup, "Must set shared memory use before setting up connections");
+    mUseSharedMemory = enabled;
+}
+
+void RpcSession::setOnewayBatching(size_t maxBytes, std::chrono::microseconds maxDelay) {
+    mRpcBinderState->setOnewayBatching(sp<RpcSession>::fromExisting(this), maxBytes, maxDelay);
+}
+
 status_t RpcSession::setupUnixDomainClient(const char* path) {
     return setupSocketClient(UnixSocketAddress(path));
 }
@@ -291,6 +302,14 @@ status_t RpcSession::sendDecStrongToTarget(uint64_t address, size_t target) {
                                           address, target);
 }
 
+status_t RpcSession::flushOnewayBatch() {
+    ExclusiveConnection connection;
+    status_t status = ExclusiveConnection::find(sp<RpcSession>::fromExisting(this),
+                                                ConnectionUse::CLIENT_ASYNC, &connection);
+    if (status != OK) return status;
+    return state()->flushOnewayBatch(connection.get(), sp<RpcSession>::fromExisting(this));
+}
+
 status_t RpcSession::readId() {
     {
         RpcMutexLockGuard _l(mMutex);
@@ -443,16 +462,7 @@ void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult
               statusToString(setupResult.status).c_str());
     }
 
-    sp<RpcSession::EventListener> listener;
-    {
-        RpcMutexLockGuard _l(session->mMutex);
-        auto it = session->mConnections.mThreads.find(rpc_this_thread::get_id());
-        LOG_ALWAYS_FATAL_IF(it == session->mConnections.mThreads.end());
-        it->second.detach();
-        session->mConnections.mThreads.erase(it);
-
-        listener = session->mEventListener.promote();
-    }
+    sp<RpcSession::EventListener> listener = session->releaseJoinThread();
 
     // done after all cleanup, since session shutdown progresses via callbacks here
     if (connection != nullptr) {
@@ -467,6 +477,16 @@ void RpcSession::join(sp<RpcSession>&& session, PreJoinSetupResult&& setupResult
     }
 }
 
+sp<RpcSession::EventListener> RpcSession::releaseJoinThread() {
+    RpcMutexLockGuard _l(mMutex);
+    auto it = mConnections.mThreads.find(rpc_this_thread::get_id());
+    LOG_ALWAYS_FATAL_IF(it == mConnections.mThreads.end());
+    it->second.detach();
+    mConnections.mThreads.erase(it);
+
+    return mEventListener.promote();
+}
+
 sp<RpcServer> RpcSession::server() {
     RpcServer* unsafeServer = mForServer.unsafe_get();
     sp<RpcServer> server = mForServer.promote();
@@ -511,6 +531,7 @@ status_t RpcSession::setupClient(const std::function<status_t(const std::vector<
         // to connect to another server, force that server to request a
         // downgrade again
         mProtocolVersion = oldProtocolVersion;
+        mServerSupportsSharedMemory = false;
 
         mConnections = {};
 
@@ -518,24 +539,9 @@ status_t RpcSession::setupClient(const std::function<status_t(const std::vector<
         mStartedSetup = false;
     });
 
+    // also negotiates the protocol version, see initAndAddConnection
     if (status_t status = connectAndInit({}, false /*incoming*/); status != OK) return status;
 
-    {
-        ExclusiveConnection connection;
-        if (status_t status = ExclusiveConnection::find(sp<RpcSession>::fromExisting(this),
-                                                        ConnectionUse::CLIENT, &connection);
-            status != OK)
-            return status;
-
-        uint32_t version;
-        if (status_t status =
-                    state()->readNewSessionResponse(connection.get(),
-                                                    sp<RpcSession>::fromExisting(this), &version);
-            status != OK)
-            return status;
-        if (!setProtocolVersionInternal(version, false)) return BAD_VALUE;
-    }
-
     // TODO(b/189955605): we should add additional sessions dynamically
     // instead of all at once.
     size_t numThreadsAvailable;
@@ -704,9 +710,24 @@ status_t RpcSession::initAndAddConnection(RpcTransportFd fd, const std::vector<u
         header.options |= RPC_CONNECTION_OPTION_INCOMING;
     }
 
+    // Only offered on later connections if the server accepted it for the
+    // first one, since older servers don't respond to it there.
+    std::unique_ptr<RpcShmRegion> shm;
+    std::vector<std::variant<unique_fd, borrowed_fd>> shmFds;
+    if (mUseSharedMemory && (sessionId.empty() || mServerSupportsSharedMemory) &&
+        mFileDescriptorTransportMode == FileDescriptorTransportMode::NONE &&
+        server->allowsSharedMemory()) {
+        shm = RpcShmRegion::create(server->pollableFd());
+    }
+    if (shm != nullptr) {
+        header.options |= RPC_CONNECTION_OPTION_SHARED_MEMORY;
+        shmFds.push_back(shm->fd());
+    }
+
     iovec headerIov{&header, sizeof(header)};
     auto sendHeaderStatus = server->interruptableWriteFully(mShutdownTrigger.get(), &headerIov, 1,
-                                                            std::nullopt, nullptr);
+                                                            std::nullopt,
+                                                            shm != nullptr ? &shmFds : nullptr);
     if (sendHeaderStatus != OK) {
         ALOGE("Could not write connection header to socket: %s",
               statusToString(sendHeaderStatus).c_str());
@@ -729,6 +750,39 @@ status_t RpcSession::initAndAddConnection(RpcTransportFd fd, const std::vector<u
 
     LOG_RPC_DETAIL("Socket at client: header sent");
 
+    // the server responds before anything else is sent, so that everything
+    // after this can go through shared memory
+    bool useShm = false;
+    if (sessionId.empty()) {
+        RpcNewSessionResponse response;
+        iovec responseIov{&response, sizeof(response)};
+        if (status_t status = server->interruptableReadFully(mShutdownTrigger.get(), &responseIov,
+                                                             1, std::nullopt, nullptr);
+            status != OK) {
+            ALOGE("Could not read new session response: %s", statusToString(status).c_str());
+            return status;
+        }
+        if (!setProtocolVersionInternal(response.version, false)) return BAD_VALUE;
+        mServerSupportsSharedMemory =
+                shm != nullptr && (response.options & RPC_NEW_SESSION_RESPONSE_OPTION_SHARED_MEMORY);
+        useShm = mServerSupportsSharedMemory;
+    } else if (shm != nullptr) {
+        RpcSharedMemoryResponse response;
+        iovec responseIov{&response, sizeof(response)};
+        if (status_t status = server->interruptableReadFully(mShutdownTrigger.get(), &responseIov,
+                                                             1, std::nullopt, nullptr);
+            status != OK) {
+            ALOGE("Could not read shared memory response: %s", statusToString(status).c_str());
+            return status;
+        }
+        useShm = response.accepted;
+    }
+
+    if (useShm) {
+        LOG_RPC_DETAIL("Socket at client: using shared memory");
+        server = newRpcTransportShm(std::move(server), std::move(shm), true /*isClient*/);
+    }
+
     if (incoming) {
         return addIncomingConnection(std::move(server));
     } else {
@@ -24,13 +24,17 @@
 #include <binder/RpcServer.h>
 
 #include "Debug.h"
+#include "FdTrigger.h"
 #include "RpcWireFormat.h"
 #include "Utils.h"
 
+#include <array>
+#include <cstddef>
 #include <random>
 #include <sstream>
 
 #include <inttypes.h>
+#include <poll.h>
 
 #ifdef __ANDROID__
 #include <cutils/properties.h>
@@ -67,7 +71,9 @@ static bool enableAncillaryFds(RpcSession::FileDescriptorTransportMode mode) {
 }
 
 RpcState::RpcState() {}
-RpcState::~RpcState() {}
+RpcState::~RpcState() {
+    stopOnewayBatching();
+}
 
 status_t RpcState::onBinderLeaving(const sp<RpcSession>& session, const sp<IBinder>& binder,
                                    uint64_t* outAddress) {
@@ -277,6 +283,7 @@ void RpcState::clear(RpcMutexUniqueLock nodeLock) {
         return;
     }
     mTerminated = true;
+    stopOnewayBatching();
 
     if (SHOULD_LOG_RPC_DETAIL) {
         ALOGE("RpcState::clear()");
@@ -336,6 +343,80 @@ std::string RpcState::BinderNode::toString() const {
     return ss.str();
 }
 
+// Pool of receive buffers for transaction and reply bodies. Bodies are sized exactly by the
+// RpcWireHeader, so buffers of at least kMinPooledSize are rounded up to a power of two and
+// kept around after use, up to kMaxBuffersPerClass of each size. Reply buffers outlive the
+// RpcState they were received on (they are owned by the reply Parcel), so the pool is
+// process-wide, and each buffer records its own capacity in a header in front of the data.
+class ReceiveBufferPool {
+public:
+    static ReceiveBufferPool& get() {
+        static ReceiveBufferPool* pool = new ReceiveBufferPool();
+        return *pool;
+    }
+
+    uint8_t* acquire(size_t size) {
+        size_t sizeClass;
+        size_t capacity = capacityFor(size, &sizeClass);
+        if (sizeClass != kNotPooled) {
+            RpcMutexLockGuard _l(mMutex);
+            if (mFreeCount[sizeClass] > 0) {
+                return dataOf(mFree[sizeClass][--mFreeCount[sizeClass]]);
+            }
+        }
+        auto* header = static_cast<Header*>(malloc(sizeof(Header) + capacity));
+        if (header == nullptr) return nullptr;
+        header->capacity = capacity;
+        return dataOf(header);
+    }
+
+    void recycle(uint8_t* data) {
+        // Empty bodies never get a buffer.
+        if (data == nullptr) return;
+        Header* header = headerOf(data);
+        size_t sizeClass;
+        (void)capacityFor(header->capacity, &sizeClass);
+        if (sizeClass != kNotPooled) {
+            RpcMutexLockGuard _l(mMutex);
+            if (mFreeCount[sizeClass] < kMaxBuffersPerClass) {
+                mFree[sizeClass][mFreeCount[sizeClass]++] = header;
+                return;
+            }
+        }
+        free(header);
+    }
+
+private:
+    static constexpr size_t kMinPooledSize = 4096;
+    static constexpr size_t kNumSizeClasses = 6; // 4KB .. 128KB
+    static constexpr size_t kMaxBuffersPerClass = 2;
+    static constexpr size_t kNotPooled = kNumSizeClasses;
+
+    struct alignas(std::max_align_t) Header {
+        size_t capacity;
+    };
+
+    static uint8_t* dataOf(Header* header) { return reinterpret_cast<uint8_t*>(header + 1); }
+    static Header* headerOf(uint8_t* data) { return reinterpret_cast<Header*>(data) - 1; }
+
+    static size_t capacityFor(size_t size, size_t* sizeClass) {
+        *sizeClass = kNotPooled;
+        if (size < kMinPooledSize) return size;
+        size_t capacity = kMinPooledSize;
+        for (size_t i = 0; i < kNumSizeClasses; i++, capacity *= 2) {
+            if (size <= capacity) {
+                *sizeClass = i;
+                return capacity;
+            }
+        }
+        return size;
+    }
+
+    RpcMutex mMutex;
+    std::array<std::array<Header*, kMaxBuffersPerClass>, kNumSizeClasses> mFree = {};
+    std::array<size_t, kNumSizeClasses> mFreeCount = {};
+};
+
 RpcState::CommandData::CommandData(size_t size) : mSize(size) {
     // The maximum size for regular binder is 1MB for all concurrent
     // transactions. A very small proportion of transactions are even
@@ -354,7 +435,12 @@ RpcState::CommandData::CommandData(size_t size) : mSize(size) {
         ALOGW("Transaction requested too much data allocation %zu", size);
         return;
     }
-    mData.reset(new (std::nothrow) uint8_t[size]);
+    mData.reset(ReceiveBufferPool::get().acquire(size));
+}
+
+void RpcState::CommandData::recycle(uint8_t* data) {
+    if (data == nullptr) return;
+    ReceiveBufferPool::get().recycle(data);
 }
 
 status_t RpcState::rpcSend(const sp<RpcSession::RpcConnection>& connection,
@@ -384,11 +470,23 @@ status_t RpcState::rpcSend(const sp<RpcSession::RpcConnection>& connection,
 status_t RpcState::rpcRec(const sp<RpcSession::RpcConnection>& connection,
                           const sp<RpcSession>& session, const char* what, iovec* iovs, int niovs,
                           std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
+    std::optional<SmallFunction<status_t()>> altPoll;
+    if (connection->commandReadTimeout.has_value()) {
+        altPoll = [&connection, &session]() {
+            return session->mShutdownTrigger->triggerablePoll(
+                    connection->rpcTransport->pollableFd(), POLLIN,
+                    *connection->commandReadTimeout);
+        };
+    }
     if (status_t status =
                 connection->rpcTransport->interruptableReadFully(session->mShutdownTrigger.get(),
-                                                                 iovs, niovs, std::nullopt,
+                                                                 iovs, niovs, altPoll,
                                                                  ancillaryFds);
         status != OK) {
+        if (status == TIMED_OUT) {
+            ALOGW("Peer took more than %lldms to send more of %s, shutting down session",
+                  static_cast<long long>(connection->commandReadTimeout->count()), what);
+        }
         LOG_RPC_DETAIL("Failed to read %s (%d iovs) on RpcTransport %p, error: %s", what, niovs,
                        connection->rpcTransport.get(), statusToString(status).c_str());
         (void)session->shutdownAndWait(false);
@@ -427,18 +525,6 @@ bool RpcState::validateProtocolVersion(uint32_t version) {
     return true;
 }
 
-status_t RpcState::readNewSessionResponse(const sp<RpcSession::RpcConnection>& connection,
-                                          const sp<RpcSession>& session, uint32_t* version) {
-    RpcNewSessionResponse response;
-    iovec iov{&response, sizeof(response)};
-    if (status_t status = rpcRec(connection, session, "new session response", &iov, 1, nullptr);
-        status != OK) {
-        return status;
-    }
-    *version = response.version;
-    return OK;
-}
-
 status_t RpcState::sendConnectionInit(const sp<RpcSession::RpcConnection>& connection,
                                       const sp<RpcSession>& session) {
     RpcOutgoingConnectionInit init{
@@ -588,6 +674,57 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
             .parcelDataSize = static_cast<uint32_t>(data.dataSize()),
     };
 
+    iovec iovs[]{
+            {nullptr, 0}, // for batched oneway transactions, see below
+            {&command, sizeof(RpcWireHeader)},
+            {&transaction, sizeof(RpcWireTransaction)},
+            {const_cast<uint8_t*>(data.data()), data.dataSize()},
+            objectTableSpan.toIovec(),
+    };
+
+    bool hasFds = rpcFields->mFds != nullptr && !rpcFields->mFds->empty();
+    if ((flags & IBinder::FLAG_ONEWAY) && !hasFds) {
+        std::vector<uint8_t> fullBatch;
+        if (batchOneway(iovs + 1, countof(iovs) - 1, &fullBatch)) {
+            if (fullBatch.empty()) return OK;
+
+            LOG_RPC_DETAIL("Oneway batch full, writing %zu bytes", fullBatch.size());
+            iovec iov{fullBatch.data(), fullBatch.size()};
+            return rpcSendDraining(connection, session, "oneway batch", &iov, 1, nullptr);
+        }
+    }
+
+    // Anything still held back for batching must reach the other side first,
+    // so write it out in front of this transaction.
+    std::vector<uint8_t> batched = takeOnewayBatch();
+    iovs[0] = {batched.data(), batched.size()};
+
+    if (status_t status = rpcSendDraining(connection, session, "transaction", iovs,
+                                          countof(iovs), rpcFields->mFds.get());
+        status != OK) {
+        // rpcSend calls shutdownAndWait, so all refcounts should be reset. If we ever tolerate
+        // errors here, then we may need to undo the binder-sent counts for the transaction as
+        // well as for the binder objects in the Parcel
+        return status;
+    }
+
+    if (flags & IBinder::FLAG_ONEWAY) {
+        LOG_RPC_DETAIL("Oneway command, so no longer waiting on RpcTransport %p",
+                       connection->rpcTransport.get());
+
+        // Do not wait on result.
+        return OK;
+    }
+
+    LOG_ALWAYS_FATAL_IF(reply == nullptr, "Reply parcel must be used for synchronous transaction.");
+
+    return waitForReply(connection, session, reply);
+}
+
+status_t RpcState::rpcSendDraining(
+        const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+        const char* what, iovec* iovs, int niovs,
+        const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
     // Oneway calls have no sync point, so if many are sent before, whether this
     // is a twoway or oneway transaction, they may have filled up the socket.
     // So, make sure we drain them before polling
@@ -595,12 +732,6 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
     constexpr size_t kWaitLogUs = 10000;
     size_t waitUs = 0;
 
-    iovec iovs[]{
-            {&command, sizeof(RpcWireHeader)},
-            {&transaction, sizeof(RpcWireTransaction)},
-            {const_cast<uint8_t*>(data.data()), data.dataSize()},
-            objectTableSpan.toIovec(),
-    };
     auto altPoll = [&] {
         if (waitUs > kWaitLogUs) {
             ALOGE("Cannot send command, trying to process pending refcounts. Waiting "
@@ -617,31 +748,132 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
 
         return drainCommands(connection, session, CommandType::CONTROL_ONLY);
     };
-    if (status_t status = rpcSend(connection, session, "transaction", iovs, countof(iovs),
-                                  std::ref(altPoll), rpcFields->mFds.get());
-        status != OK) {
-        // rpcSend calls shutdownAndWait, so all refcounts should be reset. If we ever tolerate
-        // errors here, then we may need to undo the binder-sent counts for the transaction as
-        // well as for the binder objects in the Parcel
-        return status;
+    return rpcSend(connection, session, what, iovs, niovs, std::ref(altPoll), ancillaryFds);
+}
+
+void RpcState::setOnewayBatching(const sp<RpcSession>& session, size_t maxBytes,
+                                 std::chrono::microseconds maxDelay) {
+#ifdef BINDER_RPC_SINGLE_THREADED
+    (void)session;
+    (void)maxDelay;
+    ALOGW_IF(maxBytes != 0, "Oneway batching requires threads, ignoring.");
+#else
+    RpcMutexLockGuard _l(mOnewayBatch->mutex);
+    if (mOnewayBatch->stopped) return;
+
+    mOnewayBatch->maxBytes = maxBytes;
+    mOnewayBatch->maxDelay = maxDelay;
+    if (maxBytes == 0) return; // anything still pending is written on its deadline
+
+    mOnewayBatchingUsed = true;
+    if (!mOnewayBatch->flusherStarted) {
+        mOnewayBatch->flusherStarted = true;
+        RpcMaybeThread(onewayBatchFlusher, mOnewayBatch, wp<RpcSession>(session)).detach();
     }
+#endif
+}
 
-    if (flags & IBinder::FLAG_ONEWAY) {
-        LOG_RPC_DETAIL("Oneway command, so no longer waiting on RpcTransport %p",
-                       connection->rpcTransport.get());
+bool RpcState::batchOneway(const iovec* iovs, int niovs, std::vector<uint8_t>* outFull) {
+    if (!mOnewayBatchingUsed) return false;
 
-        // Do not wait on result.
-        return OK;
+    size_t frameSize = 0;
+    for (int i = 0; i < niovs; i++) frameSize += iovs[i].iov_len;
+
+    OnewayBatch& batch = *mOnewayBatch;
+    RpcMutexLockGuard _l(batch.mutex);
+    if (batch.stopped || frameSize > batch.maxBytes) return false;
+
+    if (batch.frames.empty()) {
+        batch.deadline = std::chrono::steady_clock::now() + batch.maxDelay;
+        batch.cv.notify_all();
     }
+    for (int i = 0; i < niovs; i++) {
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(iovs[i].iov_base);
+        batch.frames.insert(batch.frames.end(), base, base + iovs[i].iov_len);
+    }
+    batch.frameCount++;
 
-    LOG_ALWAYS_FATAL_IF(reply == nullptr, "Reply parcel must be used for synchronous transaction.");
+    if (batch.frames.size() >= batch.maxBytes) {
+        outFull->swap(batch.frames);
+        batch.frameCount = 0;
+    }
+    return true;
+}
 
-    return waitForReply(connection, session, reply);
+std::vector<uint8_t> RpcState::takeOnewayBatch() {
+    std::vector<uint8_t> frames;
+    if (!mOnewayBatchingUsed) return frames;
+
+    RpcMutexLockGuard _l(mOnewayBatch->mutex);
+    frames.swap(mOnewayBatch->frames);
+    mOnewayBatch->frameCount = 0;
+    return frames;
+}
+
+status_t RpcState::flushOnewayBatch(const sp<RpcSession::RpcConnection>& connection,
+                                    const sp<RpcSession>& session) {
+    std::vector<uint8_t> frames = takeOnewayBatch();
+    if (frames.empty()) return OK;
+
+    LOG_RPC_DETAIL("Writing %zu bytes of batched oneway transactions", frames.size());
+    iovec iov{frames.data(), frames.size()};
+    return rpcSendDraining(connection, session, "oneway batch", &iov, 1, nullptr);
+}
+
+void RpcState::stopOnewayBatching() {
+    RpcMutexLockGuard _l(mOnewayBatch->mutex);
+    mOnewayBatch->stopped = true;
+    // There is no connection left to write them to.
+    if (mOnewayBatch->frameCount != 0) {
+        ALOGW("Dropping %zu batched oneway transactions (%zu bytes) on shutdown",
+              mOnewayBatch->frameCount, mOnewayBatch->frames.size());
+    }
+    mOnewayBatch->frames.clear();
+    mOnewayBatch->frameCount = 0;
+    mOnewayBatch->cv.notify_all();
+}
+
+void RpcState::onewayBatchFlusher(std::shared_ptr<OnewayBatch> batch, wp<RpcSession> weakSession) {
+#ifdef BINDER_RPC_SINGLE_THREADED
+    (void)batch;
+    (void)weakSession;
+    LOG_ALWAYS_FATAL("Oneway batching requires threads");
+#else
+    RpcMutexUniqueLock _l(batch->mutex);
+    while (!batch->stopped) {
+        if (batch->frames.empty()) {
+            batch->cv.wait(_l);
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now < batch->deadline) {
+            batch->cv.wait_for(_l, batch->deadline - now);
+            continue;
+        }
+
+        _l.unlock();
+        status_t status;
+        {
+            // this may be the last reference to the session
+            sp<RpcSession> session = weakSession.promote();
+            if (session == nullptr) return;
+            status = session->flushOnewayBatch();
+        }
+        _l.lock();
+
+        if (status != OK) {
+            ALOGE("Dropping %zu batched oneway transactions, failed to write them: %s",
+                  batch->frameCount, statusToString(status).c_str());
+            batch->frames.clear();
+            batch->frameCount = 0;
+        }
+    }
+#endif
 }
 
 static void cleanup_reply_data(const uint8_t* data, size_t dataSize, const binder_size_t* objects,
                                size_t objectsCount) {
-    delete[] const_cast<uint8_t*>(data);
+    ReceiveBufferPool::get().recycle(const_cast<uint8_t*>(data));
     (void)dataSize;
     LOG_ALWAYS_FATAL_IF(objects != nullptr);
     (void)objectsCount;
@@ -759,6 +991,9 @@ status_t RpcState::sendDecStrongToTarget(const sp<RpcSession::RpcConnection>& co
             .command = RPC_COMMAND_DEC_STRONG,
             .bodySize = sizeof(RpcDecStrong),
     };
+    // oneway transactions held back for batching may still use this binder
+    if (status_t status = flushOnewayBatch(connection, session); status != OK) return status;
+
     iovec iovs[]{{&cmd, sizeof(cmd)}, {&body, sizeof(body)}};
     return rpcSend(connection, session, "dec ref", iovs, countof(iovs), std::nullopt);
 }
@@ -847,6 +1082,7 @@ status_t RpcState::processTransact(
     if (status_t status = rpcRec(connection, session, "transaction body", &iov, 1, nullptr);
         status != OK)
         return status;
+    connection->commandReadTimeout.reset();
 
     return processTransactInternal(connection, session, std::move(transactionData),
                                    std::move(ancillaryFds));
@@ -1137,7 +1373,11 @@ processTransactInternalTailCall:
             .parcelDataSize = static_cast<uint32_t>(reply.dataSize()),
             .reserved = {0, 0, 0},
     };
+    // Oneway transactions made by the handler of this command, and still held
+    // back for batching, must reach the other side before the reply does.
+    std::vector<uint8_t> batched = takeOnewayBatch();
     iovec iovs[]{
+            {batched.data(), batched.size()},
             {&cmdReply, sizeof(RpcWireHeader)},
             {&rpcReply, rpcReplyWireSize},
             {const_cast<uint8_t*>(reply.data()), reply.dataSize()},
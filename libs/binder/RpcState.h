@@ -22,7 +22,10 @@
 #include <binder/RpcThreads.h>
 #include <binder/unique_fd.h>
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <optional>
 #include <queue>
 
@@ -66,8 +69,6 @@ public:
 
     [[nodiscard]] static bool validateProtocolVersion(uint32_t version);
 
-    [[nodiscard]] status_t readNewSessionResponse(const sp<RpcSession::RpcConnection>& connection,
-                                                  const sp<RpcSession>& session, uint32_t* version);
     [[nodiscard]] status_t sendConnectionInit(const sp<RpcSession::RpcConnection>& connection,
                                               const sp<RpcSession>& session);
     [[nodiscard]] status_t readConnectionInit(const sp<RpcSession::RpcConnection>& connection,
@@ -122,6 +123,17 @@ public:
     [[nodiscard]] status_t drainCommands(const sp<RpcSession::RpcConnection>& connection,
                                          const sp<RpcSession>& session, CommandType type);
 
+    /**
+     * See RpcSession::setOnewayBatching.
+     */
+    void setOnewayBatching(const sp<RpcSession>& session, size_t maxBytes,
+                           std::chrono::microseconds maxDelay);
+    /**
+     * Writes out any oneway transactions which are held back for batching.
+     */
+    [[nodiscard]] status_t flushOnewayBatch(const sp<RpcSession::RpcConnection>& connection,
+                                            const sp<RpcSession>& session);
+
     /**
      * Called by Parcel for outgoing binders. This implies one refcount of
      * ownership to the outgoing binder.
@@ -176,15 +188,24 @@ private:
 
     // Alternative to std::vector<uint8_t> that doesn't abort on allocation failure and caps
     // large allocations to avoid being requested from allocating too much data.
+    //
+    // Buffers large enough to matter are borrowed from a small process-wide pool, so that
+    // receiving a stream of large transactions or replies doesn't churn the allocator.
     struct CommandData {
         explicit CommandData(size_t size);
         bool valid() { return mSize == 0 || mData != nullptr; }
         size_t size() { return mSize; }
         uint8_t* data() { return mData.get(); }
+        // The returned buffer must be given back with CommandData::recycle.
         uint8_t* release() { return mData.release(); }
 
+        static void recycle(uint8_t* data);
+
     private:
-        std::unique_ptr<uint8_t[]> mData;
+        struct Recycler {
+            void operator()(uint8_t* data) const { recycle(data); }
+        };
+        std::unique_ptr<uint8_t[], Recycler> mData;
         size_t mSize;
     };
 
@@ -194,6 +215,13 @@ private:
             const std::optional<binder::impl::SmallFunction<status_t()>>& altPoll,
             const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds =
                     nullptr);
+    // rpcSend for commands which may be queued up behind a lot of oneway
+    // transactions. While the socket is full, incoming refcount commands are
+    // processed, so that both sides can't block each other.
+    [[nodiscard]] status_t rpcSendDraining(
+            const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+            const char* what, iovec* iovs, int niovs,
+            const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds);
     [[nodiscard]] status_t rpcRec(const sp<RpcSession::RpcConnection>& connection,
                                   const sp<RpcSession>& session, const char* what, iovec* iovs,
                                   int niovs,
@@ -291,6 +319,36 @@ private:
     // false - session shutdown, halt
     [[nodiscard]] bool nodeProgressAsyncNumber(BinderNode* node);
 
+    // Oneway transactions which are fully serialized, but held back so that a
+    // burst of them can be written at once (see RpcSession::setOnewayBatching).
+    // Shared with the thread flushing them on a timeout, which may outlive
+    // this object.
+    struct OnewayBatch {
+        RpcMutex mutex; // for all below
+        RpcConditionVariable cv;
+        size_t maxBytes = 0; // 0 when batching is disabled
+        std::chrono::microseconds maxDelay{0};
+        std::vector<uint8_t> frames;
+        size_t frameCount = 0; // number of transactions in frames
+        // when frames must be written by, valid when frames isn't empty
+        std::chrono::steady_clock::time_point deadline;
+        bool flusherStarted = false;
+        bool stopped = false;
+    };
+
+    // Appends the frame in `iovs` to the batch. Returns false if the frame
+    // can't be batched. If this fills up the batch, the batch is taken and
+    // returned in `outFull` for the caller to write out.
+    [[nodiscard]] bool batchOneway(const iovec* iovs, int niovs, std::vector<uint8_t>* outFull);
+    // Takes all batched frames, so they can be written ahead of another command.
+    std::vector<uint8_t> takeOnewayBatch();
+    void stopOnewayBatching();
+    static void onewayBatchFlusher(std::shared_ptr<OnewayBatch> batch, wp<RpcSession> session);
+
+    const std::shared_ptr<OnewayBatch> mOnewayBatch = std::make_shared<OnewayBatch>();
+    // avoids taking mOnewayBatch->mutex for sessions which never use batching
+    std::atomic<bool> mOnewayBatchingUsed = false;
+
     RpcMutex mNodeMutex;
     bool mTerminated = false;
     uint32_t mNextId = 0;
@@ -85,6 +85,10 @@ public:
 
     bool isWaiting() override { return mSocket.isInPollingState(); }
 
+    borrowed_fd pollableFd() override { return mSocket.fd; }
+
+    bool allowsSharedMemory() override { return true; }
+
 private:
     android::RpcTransportFd mSocket;
 };
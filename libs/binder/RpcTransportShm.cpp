@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcTransportShm"
+
+#include "RpcTransportShm.h"
+
+#include <log/log.h>
+
+#include "FdTrigger.h"
+#include "RpcState.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+// The region is a sealed memfd, so this is only available where libc has
+// memfd_create (bionic, musl and glibc 2.27 and later).
+#if defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+#define BINDER_RPC_SHARED_MEMORY
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#endif
+
+namespace android {
+
+using namespace android::binder::impl;
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+#ifdef BINDER_RPC_SHARED_MEMORY
+
+// Both sides of a connection must agree on the layout of the region, so
+// changing any of this is a wire protocol change.
+constexpr size_t kShmControlSize = 4096;
+constexpr uint32_t kShmRingSize = 128 * 1024;
+constexpr size_t kShmRegionSize = kShmControlSize + 2 * kShmRingSize;
+static_assert((kShmRingSize & (kShmRingSize - 1)) == 0, "indices must wrap around evenly");
+
+constexpr size_t kClient = 0;
+constexpr size_t kServer = 1;
+
+struct alignas(64) ShmIndex {
+    std::atomic<uint32_t> value;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared with another process");
+
+// Start of the region. The ring written by the client follows it, and then the
+// ring written by the server.
+struct ShmControl {
+    // total bytes ever written into each side's ring, by that side
+    ShmIndex head[2];
+    // total bytes ever read from each side's ring, by the other side
+    ShmIndex tail[2];
+    // set by each side before waiting on the socket, and cleared by the other
+    // side when it sends a wakeup over the socket
+    ShmIndex wantsWakeup[2];
+};
+static_assert(sizeof(ShmControl) <= kShmControlSize);
+
+std::unique_ptr<RpcShmRegion> RpcShmRegion::create(borrowed_fd socket) {
+    int domain;
+    socklen_t domainLen = sizeof(domain);
+    if (0 != getsockopt(socket.get(), SOL_SOCKET, SO_DOMAIN, &domain, &domainLen) ||
+        domain != AF_UNIX) {
+        LOG_RPC_DETAIL("Not using shared memory, connection is not over a UNIX domain socket");
+        return nullptr;
+    }
+
+    unique_fd fd(TEMP_FAILURE_RETRY(memfd_create("RpcShmRegion", MFD_CLOEXEC | MFD_ALLOW_SEALING)));
+    if (!fd.ok()) {
+        ALOGE("Could not create shared memory for RPC connection: %s", strerror(errno));
+        return nullptr;
+    }
+    if (0 != TEMP_FAILURE_RETRY(ftruncate(fd.get(), kShmRegionSize))) {
+        ALOGE("Could not size shared memory for RPC connection: %s", strerror(errno));
+        return nullptr;
+    }
+    // the server relies on the size of its mapping, see fromPeer
+    if (0 != fcntl(fd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+        ALOGE("Could not seal shared memory for RPC connection: %s", strerror(errno));
+        return nullptr;
+    }
+
+    std::unique_ptr<RpcShmRegion> region = map(fd);
+    if (region != nullptr) region->mFd = std::move(fd);
+    return region;
+}
+
+std::unique_ptr<RpcShmRegion> RpcShmRegion::fromPeer(unique_fd fd) {
+    // otherwise, accessing the mapping could fault
+    int seals = fcntl(fd.get(), F_GET_SEALS);
+    if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+        ALOGE("Rejecting shared memory for RPC connection, it can be shrunk");
+        return nullptr;
+    }
+
+    struct stat st;
+    if (0 != fstat(fd.get(), &st) || st.st_size != static_cast<off_t>(kShmRegionSize)) {
+        ALOGE("Rejecting shared memory for RPC connection, it has the wrong size");
+        return nullptr;
+    }
+
+    return map(fd);
+}
+
+std::unique_ptr<RpcShmRegion> RpcShmRegion::map(borrowed_fd fd) {
+    void* base = mmap(nullptr, kShmRegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (base == MAP_FAILED) {
+        ALOGE("Could not map shared memory for RPC connection: %s", strerror(errno));
+        return nullptr;
+    }
+
+    std::unique_ptr<RpcShmRegion> region(new RpcShmRegion());
+    region->mBase = base;
+    region->mSize = kShmRegionSize;
+    return region;
+}
+
+RpcShmRegion::~RpcShmRegion() {
+    if (mBase != nullptr) munmap(mBase, mSize);
+}
+
+// Each side writes into its own ring and reads from the other side's ring.
+// Nothing but wakeups is sent over the socket, and a side only sends one when
+// the other side has said that it is about to wait for one.
+//
+// Everything in the region may be changed by the peer at any time, so indices
+// written by the peer are checked before being used, and data is only ever
+// copied out of the region once.
+//
+// Data is still copied twice, into the ring and out of it, just like it is
+// copied into and out of the kernel by a socket. What this saves is the
+// sendmsg/recvmsg and poll syscalls (and the wakeups of the other side) for
+// every command while both sides are busy.
+class RpcTransportShm : public RpcTransport {
+public:
+    RpcTransportShm(std::unique_ptr<RpcTransport> socket, std::unique_ptr<RpcShmRegion> region,
+                    size_t side)
+          : mSocket(std::move(socket)), mRegion(std::move(region)), mSide(side), mPeer(1 - side) {
+        uint8_t* base = static_cast<uint8_t*>(mRegion->mBase);
+        mControl = reinterpret_cast<ShmControl*>(base);
+        mRings[kClient] = base + kShmControlSize;
+        mRings[kServer] = base + kShmControlSize + kShmRingSize;
+    }
+
+    status_t pollRead(void) override {
+        uint32_t available;
+        if (status_t status = readable(&available); status != OK || available > 0) return status;
+
+        // the peer sends a wakeup for anything it writes after this, so the
+        // socket becomes readable (see pollableFd)
+        armWakeup();
+        if (status_t status = drainWakeups(); status != OK) return status;
+
+        if (status_t status = readable(&available); status != OK) return status;
+        return available > 0 ? OK : WOULD_BLOCK;
+    }
+
+    status_t interruptableWriteFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        if (ancillaryFds != nullptr && !ancillaryFds->empty()) {
+            ALOGE("File descriptors can't be sent through shared memory");
+            return BAD_VALUE;
+        }
+        if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+
+        uint8_t* ring = mRings[mSide];
+        for (int i = 0; i < niovs; i++) {
+            const uint8_t* data = static_cast<const uint8_t*>(iovs[i].iov_base);
+            size_t size = iovs[i].iov_len;
+            while (size > 0) {
+                uint32_t space;
+                if (status_t status = writable(&space); status != OK) return status;
+                if (space == 0) {
+                    if (status_t status = waitForPeer(fdTrigger, altPoll, &RpcTransportShm::writable);
+                        status != OK)
+                        return status;
+                    continue;
+                }
+
+                size_t len = std::min<size_t>(size, space);
+                uint32_t offset = mWritten & (kShmRingSize - 1);
+                size_t first = std::min<size_t>(len, kShmRingSize - offset);
+                memcpy(ring + offset, data, first);
+                memcpy(ring, data + first, len - first);
+
+                mWritten += len;
+                mControl->head[mSide].value.store(mWritten, std::memory_order_release);
+                data += len;
+                size -= len;
+            }
+        }
+        return wakePeer();
+    }
+
+    status_t interruptableReadFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            std::vector<std::variant<unique_fd, borrowed_fd>>* /*ancillaryFds*/) override {
+        if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+
+        const uint8_t* ring = mRings[mPeer];
+        for (int i = 0; i < niovs; i++) {
+            uint8_t* data = static_cast<uint8_t*>(iovs[i].iov_base);
+            size_t size = iovs[i].iov_len;
+            while (size > 0) {
+                uint32_t available;
+                if (status_t status = readable(&available); status != OK) return status;
+                if (available == 0) {
+                    if (status_t status = waitForPeer(fdTrigger, altPoll, &RpcTransportShm::readable);
+                        status != OK)
+                        return status;
+                    continue;
+                }
+
+                size_t len = std::min<size_t>(size, available);
+                uint32_t offset = mRead & (kShmRingSize - 1);
+                size_t first = std::min<size_t>(len, kShmRingSize - offset);
+                memcpy(data, ring + offset, first);
+                memcpy(data + first, ring, len - first);
+
+                mRead += len;
+                mControl->tail[mPeer].value.store(mRead, std::memory_order_release);
+                data += len;
+                size -= len;
+            }
+        }
+        return wakePeer();
+    }
+
+    bool isWaiting() override { return mSocket->isWaiting(); }
+
+    borrowed_fd pollableFd() override { return mSocket->pollableFd(); }
+
+private:
+    status_t readable(uint32_t* available) {
+        *available = mControl->head[mPeer].value.load(std::memory_order_acquire) - mRead;
+        if (*available > kShmRingSize) return corrupted();
+        return OK;
+    }
+
+    status_t writable(uint32_t* space) {
+        uint32_t used = mWritten - mControl->tail[mSide].value.load(std::memory_order_acquire);
+        if (used > kShmRingSize) return corrupted();
+        *space = kShmRingSize - used;
+        return OK;
+    }
+
+    status_t corrupted() {
+        ALOGE("Shared memory of RPC connection is corrupted by the peer");
+        return BAD_VALUE;
+    }
+
+    void armWakeup() {
+        mControl->wantsWakeup[mSide].value.store(1, std::memory_order_relaxed);
+        // pairs with wakePeer, so that the peer either sees this or we see
+        // what it did before checking
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    status_t wakePeer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::atomic<uint32_t>& wantsWakeup = mControl->wantsWakeup[mPeer].value;
+        if (wantsWakeup.load(std::memory_order_relaxed) == 0 || wantsWakeup.exchange(0) == 0) {
+            return OK;
+        }
+
+        uint8_t wakeup = 0;
+        ssize_t ret = TEMP_FAILURE_RETRY(
+                send(pollableFd().get(), &wakeup, sizeof(wakeup), MSG_DONTWAIT | MSG_NOSIGNAL));
+        if (ret < 0) {
+            int savedErrno = errno;
+            // a full socket has plenty of wakeups in it already
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) return OK;
+            LOG_RPC_DETAIL("RpcTransportShm wakePeer(): %s", strerror(savedErrno));
+            return -savedErrno;
+        }
+        return OK;
+    }
+
+    // Reads the wakeups which are already on the socket, without blocking.
+    status_t drainWakeups() {
+        uint8_t buf[64];
+        ssize_t ret = TEMP_FAILURE_RETRY(recv(pollableFd().get(), buf, sizeof(buf), MSG_DONTWAIT));
+        if (ret < 0) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) return OK;
+            LOG_RPC_DETAIL("RpcTransportShm drainWakeups(): %s", strerror(savedErrno));
+            return -savedErrno;
+        }
+        if (ret == 0) return DEAD_OBJECT;
+        return OK;
+    }
+
+    // Called when `check` found that nothing can be done, to wait until the
+    // peer may have changed that.
+    status_t waitForPeer(FdTrigger* fdTrigger,
+                         const std::optional<SmallFunction<status_t()>>& altPoll,
+                         status_t (RpcTransportShm::*check)(uint32_t*)) {
+        // the peer may be waiting for what we did so far
+        if (status_t status = wakePeer(); status != OK) return status;
+
+        armWakeup();
+        uint32_t ready;
+        if (status_t status = (this->*check)(&ready); status != OK || ready > 0) return status;
+
+        if (altPoll) {
+            if (status_t status = (*altPoll)(); status != OK) return status;
+            if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+            // altPoll only waits for the socket to become readable. Consume the
+            // wakeups, or every later wait would return right away.
+            return drainWakeups();
+        }
+
+        uint8_t wakeup;
+        iovec iov{&wakeup, sizeof(wakeup)};
+        return mSocket->interruptableReadFully(fdTrigger, &iov, 1, std::nullopt, nullptr);
+    }
+
+    std::unique_ptr<RpcTransport> mSocket;
+    std::unique_ptr<RpcShmRegion> mRegion;
+    const size_t mSide;
+    const size_t mPeer;
+
+    ShmControl* mControl;
+    uint8_t* mRings[2];
+    // own copies of the indices owned by this side
+    uint32_t mWritten = 0;
+    uint32_t mRead = 0;
+};
+
+std::unique_ptr<RpcTransport> newRpcTransportShm(std::unique_ptr<RpcTransport> socket,
+                                                 std::unique_ptr<RpcShmRegion> region,
+                                                 bool isClient) {
+    LOG_ALWAYS_FATAL_IF(!socket->allowsSharedMemory(), "Transport can't be bypassed");
+    return std::make_unique<RpcTransportShm>(std::move(socket), std::move(region),
+                                             isClient ? kClient : kServer);
+}
+
+#else // BINDER_RPC_SHARED_MEMORY
+
+std::unique_ptr<RpcShmRegion> RpcShmRegion::create(borrowed_fd) {
+    LOG_RPC_DETAIL("Not using shared memory, not supported on this platform");
+    return nullptr;
+}
+
+std::unique_ptr<RpcShmRegion> RpcShmRegion::fromPeer(unique_fd) {
+    ALOGE("Rejecting shared memory for RPC connection, not supported on this platform");
+    return nullptr;
+}
+
+RpcShmRegion::~RpcShmRegion() {}
+
+std::unique_ptr<RpcTransport> newRpcTransportShm(std::unique_ptr<RpcTransport>,
+                                                 std::unique_ptr<RpcShmRegion>, bool) {
+    LOG_ALWAYS_FATAL("Shared memory is not supported on this platform");
+    return nullptr;
+}
+
+#endif // BINDER_RPC_SHARED_MEMORY
+
+} // namespace android
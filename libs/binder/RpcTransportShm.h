@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+
+#include <binder/Common.h>
+#include <binder/RpcTransport.h>
+#include <binder/unique_fd.h>
+
+namespace android {
+
+/**
+ * Memory shared by both ends of a single connection, holding a ring buffer
+ * for each direction (see RpcSession::setUseSharedMemory). The client creates
+ * it and sends it with its RpcConnectionHeader.
+ */
+class LIBBINDER_INTERNAL_EXPORTED RpcShmRegion {
+public:
+    /**
+     * Creates a region for a connection over `socket`. Returns nullptr if it
+     * can't be sent over that socket, or if shared memory isn't supported
+     * here.
+     */
+    static std::unique_ptr<RpcShmRegion> create(binder::borrowed_fd socket);
+
+    /**
+     * Maps a region received from a client. Returns nullptr if it can't be
+     * used safely, e.g. because the client could still resize it.
+     */
+    static std::unique_ptr<RpcShmRegion> fromPeer(binder::unique_fd fd);
+
+    ~RpcShmRegion();
+
+    binder::borrowed_fd fd() const { return mFd; }
+
+private:
+    friend class RpcTransportShm;
+
+    RpcShmRegion() = default;
+    static std::unique_ptr<RpcShmRegion> map(binder::borrowed_fd fd);
+
+    binder::unique_fd mFd; // only kept by the client, to send it
+    void* mBase = nullptr;
+    size_t mSize = 0;
+};
+
+/**
+ * Returns a transport which sends all data through `region`, and only uses
+ * `socket` to wake up the other side when it is waiting. Both sides must
+ * switch at the same point in the stream. `socket` must be a transport which
+ * allows this (see RpcTransport::allowsSharedMemory).
+ */
+LIBBINDER_INTERNAL_EXPORTED std::unique_ptr<RpcTransport> newRpcTransportShm(
+        std::unique_ptr<RpcTransport> socket, std::unique_ptr<RpcShmRegion> region,
+        bool isClient);
+
+} // namespace android
@@ -300,6 +300,8 @@ public:
 
     bool isWaiting() override { return mSocket.isInPollingState(); };
 
+    borrowed_fd pollableFd() override { return mSocket.fd; }
+
 private:
     android::RpcTransportFd mSocket;
     Ssl mSsl;
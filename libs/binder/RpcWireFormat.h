@@ -21,6 +21,11 @@ namespace android {
 #pragma clang diagnostic error "-Wpadded"
 
 constexpr uint8_t RPC_CONNECTION_OPTION_INCOMING = 0x1; // default is outgoing
+// a memfd is sent with the header, see RpcShmRegion
+constexpr uint8_t RPC_CONNECTION_OPTION_SHARED_MEMORY = 0x2;
+
+// the server accepted RPC_CONNECTION_OPTION_SHARED_MEMORY
+constexpr uint8_t RPC_NEW_SESSION_RESPONSE_OPTION_SHARED_MEMORY = 0x1;
 
 constexpr uint32_t RPC_WIRE_ADDRESS_OPTION_CREATED = 1 << 0; // distinguish from '0' address
 constexpr uint32_t RPC_WIRE_ADDRESS_OPTION_FOR_SERVER = 1 << 1;
@@ -59,10 +64,24 @@ static_assert(sizeof(RpcConnectionHeader) == 16);
  */
 struct RpcNewSessionResponse {
     uint32_t version; // maximum supported by callee <= maximum supported by caller
-    uint8_t reserved[4];
+    uint8_t options;
+    uint8_t reserved[3];
 };
 static_assert(sizeof(RpcNewSessionResponse) == 8);
 
+/**
+ * In response to an RpcConnectionHeader with RPC_CONNECTION_OPTION_SHARED_MEMORY
+ * which corresponds to an existing session. Clients only request this from
+ * servers which set RPC_NEW_SESSION_RESPONSE_OPTION_SHARED_MEMORY for the
+ * session, since older servers don't send it. If accepted, everything after
+ * this goes through the shared memory, in both directions.
+ */
+struct RpcSharedMemoryResponse {
+    uint8_t accepted;
+    uint8_t reserved[7];
+};
+static_assert(sizeof(RpcSharedMemoryResponse) == 8);
+
 #define RPC_CONNECTION_INIT_OKAY "cci"
 
 /**
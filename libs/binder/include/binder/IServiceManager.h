@@ -149,6 +149,23 @@ public:
         int pid;
     };
     virtual std::vector<ServiceDebugInfo> getServiceDebugInfo() = 0;
+
+    // New methods go below, with a default implementation, so that the
+    // vtable and implementations outside of libbinder keep working.
+
+    /**
+     * Retrieve several existing services at once, non-blocking. Returns a
+     * binder for each of names, in the same order, which is nullptr for each
+     * service which isn't available. This is a single call into the service
+     * manager, so it is much faster than calling checkService for each name,
+     * e.g. for processes which need many services when they start.
+     *
+     * Unlike checkService, this starts any lazy services which aren't running,
+     * like getService, but it doesn't wait for them. The default
+     * implementation calls checkService for each name, so it doesn't start
+     * them.
+     */
+    virtual std::vector<sp<IBinder>> getServicesNoWait(const std::vector<String16>& names);
 };
 
 LIBBINDER_EXPORTED sp<IServiceManager> defaultServiceManager();
@@ -88,6 +88,18 @@ public:
     LIBBINDER_EXPORTED void setDataPosition(size_t pos) const;
     LIBBINDER_EXPORTED status_t setDataCapacity(size_t size);
 
+    // Opts this Parcel into segmented storage. The data buffer is then backed by anonymous
+    // memory mappings that always hold a whole number of segments of 'segmentSize' bytes
+    // (rounded up to the page size), and it grows by remapping pages rather than by
+    // reallocating and copying its contents. This is intended for Parcels which are
+    // expected to carry multiple megabytes of data. Must be called before any data is
+    // written. Passing 0 restores the default heap-backed storage.
+    //
+    // Returns INVALID_OPERATION if data was already written, or if segmented storage is not
+    // supported on this platform.
+    LIBBINDER_EXPORTED status_t setDataSegmentSize(size_t segmentSize);
+    LIBBINDER_EXPORTED size_t dataSegmentSize() const;
+
     LIBBINDER_EXPORTED status_t setData(const uint8_t* buffer, size_t len);
 
     LIBBINDER_EXPORTED status_t appendFrom(const Parcel* parcel, size_t start, size_t len);
@@ -1388,7 +1400,9 @@ private:
 
     release_func        mOwner;
 
-    size_t mReserved;
+    // Zero for heap-backed storage, otherwise the size of each segment of mapped storage.
+    // See setDataSegmentSize(). Preserved across freeData().
+    size_t mSegmentSize;
 
     class Blob {
     public:
@@ -31,6 +31,7 @@
 namespace android {
 
 class FdTrigger;
+class RpcServerThreadPool;
 class RpcServerTrusty;
 class RpcSocketAddress;
 
@@ -140,6 +141,26 @@ public:
     LIBBINDER_EXPORTED void setMaxThreads(size_t threads);
     LIBBINDER_EXPORTED size_t getMaxThreads();
 
+    /**
+     * Serve the incoming connections of all sessions from a shared pool of
+     * this many threads, rather than from a thread per connection. This keeps
+     * the thread count of a server with many mostly idle clients bounded.
+     * setMaxThreads still determines how many connections each client makes,
+     * and so how many of its calls may be in flight at once.
+     *
+     * A call which blocks holds on to a thread of the pool, so the pool must be
+     * large enough for all calls which may block at the same time. A client
+     * which takes more than a second to send the rest of a command, once it
+     * started sending it, has its session shut down, so that it can't hold on
+     * to a thread this way.
+     *
+     * By default, this is 0 (a thread per connection). This must be called
+     * before join(). Connections over transports which can't be polled still
+     * get a thread each.
+     */
+    LIBBINDER_EXPORTED void setSharedThreadPoolSize(size_t threads);
+    LIBBINDER_EXPORTED size_t getSharedThreadPoolSize();
+
     /**
      * By default, the latest protocol version which is supported by a client is
      * used. However, this can be used in order to prevent newer protocol
@@ -272,6 +293,7 @@ private:
 
     const std::unique_ptr<RpcTransportCtx> mCtx;
     size_t mMaxThreads = 1;
+    size_t mSharedThreadPoolSize = 0;
     std::optional<uint32_t> mProtocolVersion;
     // A mode is supported if the N'th bit is on, where N is the mode enum's value.
     std::bitset<8> mSupportedFileDescriptorTransportModes = std::bitset<8>().set(
@@ -282,6 +304,8 @@ private:
     std::unique_ptr<RpcMaybeThread> mJoinThread;
     bool mJoinThreadRunning = false;
     std::map<RpcMaybeThread::id, RpcMaybeThread> mConnectingThreads;
+    // set while joined, if mSharedThreadPoolSize > 0
+    std::shared_ptr<RpcServerThreadPool> mThreadPool;
 
     sp<IBinder> mRootObject;
     wp<IBinder> mRootObjectWeak;
@@ -23,6 +23,7 @@
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
 
+#include <chrono>
 #include <map>
 #include <optional>
 #include <vector>
@@ -31,6 +32,7 @@ namespace android {
 
 class Parcel;
 class RpcServer;
+class RpcServerThreadPool;
 class RpcServerTrusty;
 class RpcSocketAddress;
 class RpcState;
@@ -116,6 +118,40 @@ public:
     LIBBINDER_EXPORTED void setFileDescriptorTransportMode(FileDescriptorTransportMode mode);
     LIBBINDER_EXPORTED FileDescriptorTransportMode getFileDescriptorTransportMode();
 
+    /**
+     * Opt-in to sending data through memory shared with the server, for
+     * sessions with servers on the same host. Each connection then gets a
+     * ring buffer for each direction, and its socket is only used to wake up
+     * the other side. This is negotiated for each connection when it is set
+     * up, and connections fall back to sending everything over the socket if
+     * the server doesn't support it. Only used for raw UNIX domain socket
+     * connections which don't send file descriptors, and only where
+     * memfd_create is available.
+     *
+     * This doesn't save copies, since data is still copied into and out of the
+     * ring buffers. It saves the syscalls for sending and receiving each
+     * command, and the wakeups, while both sides keep up with each other.
+     *
+     * Must be called before setting up connections.
+     */
+    LIBBINDER_EXPORTED void setUseSharedMemory(bool enabled);
+
+    /**
+     * Opt-in batching of outgoing oneway transactions. When enabled, oneway
+     * transactions which don't carry file descriptors are held back and
+     * written out together in a single write, once |maxBytes| of them are
+     * pending, once the oldest one has waited for |maxDelay|, or ahead of any
+     * other command this session sends, whichever happens first. This is
+     * useful for bursts of small asynchronous calls (e.g. callbacks), where the
+     * cost of a syscall per transaction dominates.
+     *
+     * Ordering of oneway transactions on each binder is preserved. Pending
+     * transactions are dropped if the session shuts down before they are
+     * written. A |maxBytes| of 0 disables batching (the default). This may be
+     * called at any time, but it is not supported on single-threaded builds.
+     */
+    LIBBINDER_EXPORTED void setOnewayBatching(size_t maxBytes, std::chrono::microseconds maxDelay);
+
     /**
      * This should be called once per thread, matching 'join' in the remote
      * process.
@@ -229,6 +265,7 @@ public:
 private:
     friend sp<RpcSession>;
     friend RpcServer;
+    friend RpcServerThreadPool;
     friend RpcServerTrusty;
     friend RpcState;
     explicit RpcSession(std::unique_ptr<RpcTransportCtx> ctx);
@@ -242,6 +279,9 @@ private:
     // for 'target', see RpcState::sendDecStrongToTarget
     [[nodiscard]] status_t sendDecStrongToTarget(uint64_t address, size_t target);
 
+    // writes out oneway transactions held back by setOnewayBatching
+    [[nodiscard]] status_t flushOnewayBatch();
+
     class EventListener : public virtual RefBase {
     public:
         virtual void onSessionAllIncomingThreadsEnded(const sp<RpcSession>& session) = 0;
@@ -268,6 +308,12 @@ private:
         std::optional<uint64_t> exclusiveTid;
 
         bool allowNested = false;
+
+        // While set, each wait for more of the command being read gives up
+        // after this long. Cleared once a transaction has been read, since
+        // waits after that (e.g. for the reply of a nested transaction) are
+        // up to the peer.
+        std::optional<std::chrono::milliseconds> commandReadTimeout;
     };
 
     [[nodiscard]] status_t readId();
@@ -290,6 +336,9 @@ private:
     PreJoinSetupResult preJoinSetup(std::unique_ptr<RpcTransport> rpcTransport);
     // join on thread passed to preJoinThreadOwnership
     static void join(sp<RpcSession>&& session, PreJoinSetupResult&& result);
+    // gives up the thread passed to preJoinThreadOwnership, for when it is
+    // done serving this session. Returns the listener to notify after that.
+    sp<EventListener> releaseJoinThread();
 
     [[nodiscard]] status_t setupClient(
             const std::function<status_t(const std::vector<uint8_t>& sessionId, bool incoming)>&
@@ -387,6 +436,9 @@ private:
     size_t mMaxOutgoingConnections = kDefaultMaxOutgoingConnections;
     std::optional<uint32_t> mProtocolVersion;
     FileDescriptorTransportMode mFileDescriptorTransportMode = FileDescriptorTransportMode::NONE;
+    bool mUseSharedMemory = false;
+    // the server accepted shared memory for the first connection
+    bool mServerSupportsSharedMemory = false;
 
     RpcConditionVariable mAvailableConnectionCv; // for mWaitingThreads
 
@@ -45,6 +45,7 @@ class RpcTransportRaw;
 class RpcTransportTls;
 class RpcTransportTipcAndroid;
 class RpcTransportTipcTrusty;
+class RpcTransportShm;
 class RpcTransportCtxRaw;
 class RpcTransportCtxTls;
 class RpcTransportCtxTipcAndroid;
@@ -104,6 +105,24 @@ public:
      */
     [[nodiscard]] virtual bool isWaiting() = 0;
 
+    /**
+     * The file descriptor which becomes readable when more data arrives, so
+     * that many transports can be waited on at once (e.g. with epoll). Data
+     * may already be buffered in the transport while this isn't readable, so
+     * check pollRead before waiting on it.
+     *
+     * Return: the file descriptor, or an invalid one if this transport can't
+     * be waited on this way.
+     */
+    [[nodiscard]] virtual binder::borrowed_fd pollableFd() { return binder::borrowed_fd(-1); }
+
+    /**
+     * Whether data may bypass this transport, and go through memory shared
+     * with the peer instead (see RpcSession::setUseSharedMemory). This is only
+     * allowed for transports which don't protect the data in any way.
+     */
+    [[nodiscard]] virtual bool allowsSharedMemory() { return false; }
+
 private:
     // limit the classes which can implement RpcTransport. Being able to change this
     // interface is important to allow development of RPC binder. In the past, we
@@ -118,6 +137,7 @@ private:
     friend class ::android::RpcTransportTls;
     friend class ::android::RpcTransportTipcAndroid;
     friend class ::android::RpcTransportTipcTrusty;
+    friend class ::android::RpcTransportShm;
 
     RpcTransport() = default;
 };
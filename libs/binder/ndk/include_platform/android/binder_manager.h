@@ -81,6 +81,29 @@ __attribute__((warn_unused_result)) binder_exception_t AServiceManager_addServic
 __attribute__((warn_unused_result)) AIBinder* AServiceManager_checkService(const char* instance)
         __INTRODUCED_IN(29);
 
+/**
+ * Gets binder objects for several instance names at once, in a single call into the service
+ * manager. This is much faster than calling AServiceManager_checkService for each instance, e.g.
+ * for processes which need many services when they start. Unlike AServiceManager_checkService,
+ * this starts lazy services which aren't running, but it doesn't wait for them, so their entries
+ * are nullptr until they have registered.
+ *
+ * Every binder object in outBinders also implicitly has AIBinder_incStrong called on it (so the
+ * caller is responsible for calling AIBinder_decStrong on each of them). Entries for services
+ * which are not available are set to nullptr.
+ *
+ * WARNING: when using this API across an APEX boundary, do not use with unstable
+ * AIDL services. TODO(b/139325195)
+ *
+ * \param instances identifiers of the services to lookup.
+ * \param count the number of instances.
+ * \param outBinders array of count elements, which receives the binder for each instance.
+ *
+ * \return STATUS_OK on success, or STATUS_UNEXPECTED_NULL if an argument is null.
+ */
+binder_status_t AServiceManager_getServicesNoWait(const char* const* instances, size_t count,
+                                                  AIBinder** outBinders) __INTRODUCED_IN(36);
+
 /**
  * Gets a binder object with this specific instance name. Blocks for a couple of seconds waiting on
  * it. This also implicitly calls AIBinder_incStrong (so the caller of this function is responsible
@@ -84,6 +84,33 @@ AIBinder* AServiceManager_checkService(const char* instance) {
     AIBinder_incStrong(ret.get());
     return ret.get();
 }
+binder_status_t AServiceManager_getServicesNoWait(const char* const* instances, size_t count,
+                                                  AIBinder** outBinders) {
+    if (count == 0) {
+        return STATUS_OK;
+    }
+    if (instances == nullptr || outBinders == nullptr) {
+        return STATUS_UNEXPECTED_NULL;
+    }
+    std::vector<String16> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (instances[i] == nullptr) {
+            return STATUS_UNEXPECTED_NULL;
+        }
+        names.push_back(String16(instances[i]));
+    }
+
+    sp<IServiceManager> sm = defaultServiceManager();
+    std::vector<sp<IBinder>> binders = sm->getServicesNoWait(names);
+
+    for (size_t i = 0; i < count; i++) {
+        sp<AIBinder> ret = ABpBinder::lookupOrCreateFromBinder(binders[i]);
+        AIBinder_incStrong(ret.get());
+        outBinders[i] = ret.get();
+    }
+    return STATUS_OK;
+}
 AIBinder* AServiceManager_getService(const char* instance) {
     if (instance == nullptr) {
         return nullptr;
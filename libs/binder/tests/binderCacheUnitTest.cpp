@@ -15,6 +15,7 @@
  */
 #include <gtest/gtest.h>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android/os/IServiceManager.h>
 #include <binder/IBinder.h>
@@ -80,8 +81,8 @@ public:
 class LibbinderCacheTest : public ::testing::Test {
 protected:
     void SetUp() override {
-        sp<MockAidlServiceManager> sm = sp<MockAidlServiceManager>::make();
-        mServiceManager = getServiceManagerShimFromAidlServiceManagerForTests(sm);
+        mAidlServiceManager = sp<MockAidlServiceManager>::make();
+        mServiceManager = getServiceManagerShimFromAidlServiceManagerForTests(mAidlServiceManager);
     }
 
     void TearDown() override {}
@@ -108,6 +109,15 @@ public:
         }
     }
 
+    std::string dumpCache() {
+        TemporaryFile tmp;
+        EXPECT_EQ(OK, IInterface::asBinder(mServiceManager)->dump(tmp.fd, {}));
+        std::string out;
+        EXPECT_TRUE(base::ReadFileToString(tmp.path, &out));
+        return out;
+    }
+
+    sp<MockAidlServiceManager> mAidlServiceManager;
     sp<android::IServiceManager> mServiceManager;
 };
 
@@ -159,11 +169,13 @@ TEST_F(LibbinderCacheTest, NullBinderNotCached) {
 
     // Check for a cacheble service which isn't registered.
     // FakeServiceManager should return nullptr.
-    // This shouldn't be cached.
+    // This is cached as not found for a short while (see
+    // NullBinderCachedBriefly).
     sp<IBinder> result = mServiceManager->checkService(kCachedServiceName);
     ASSERT_EQ(binder1, result);
 
-    // Add the same service
+    // Add the same service. Adding it through this process forgets that it
+    // wasn't found.
     EXPECT_EQ(OK, mServiceManager->addService(kCachedServiceName, binder2));
 
     // This should return the newly added service.
@@ -171,6 +183,38 @@ TEST_F(LibbinderCacheTest, NullBinderNotCached) {
     EXPECT_EQ(binder2, result);
 }
 
+TEST_F(LibbinderCacheTest, NullBinderCachedBriefly) {
+    sp<IBinder> binder = sp<BBinder>::make();
+
+    // Not registered, so this is cached as not found.
+    EXPECT_EQ(nullptr, mServiceManager->checkService(kCachedServiceName));
+
+    // Registered behind the cache's back, like by another process.
+    EXPECT_EQ(OK, mAidlServiceManager->innerSm.addService(kCachedServiceName, binder));
+
+    if (kUseLibbinderCache) {
+        EXPECT_EQ(nullptr, mServiceManager->checkService(kCachedServiceName));
+        EXPECT_NE(std::string::npos, dumpCache().find("hits for services not found: 1\n"));
+
+        // longer than services which weren't found are cached for
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(binder, mServiceManager->checkService(kCachedServiceName));
+}
+
+TEST_F(LibbinderCacheTest, ExpiredNullBinderNotCounted) {
+    // Not registered, so this is cached as not found.
+    EXPECT_EQ(nullptr, mServiceManager->checkService(kCachedServiceName));
+    if (!kUseLibbinderCache) {
+        return;
+    }
+    EXPECT_NE(std::string::npos, dumpCache().find("cached services not found: 1\n"));
+
+    // longer than services which weren't found are cached for
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_NE(std::string::npos, dumpCache().find("cached services not found: 0\n"));
+}
+
 TEST_F(LibbinderCacheTest, DoNotCacheServiceNotInList) {
     sp<IBinder> binder1 = sp<BBinder>::make();
     sp<IBinder> binder2 = sp<BBinder>::make();
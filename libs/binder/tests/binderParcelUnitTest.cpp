@@ -165,6 +165,53 @@ TEST(Parcel, AppendPlainDataPartial) {
     ASSERT_EQ(2, p2.readInt32());
 }
 
+TEST(Parcel, SegmentedStorageGrowsInWholeSegments) {
+    constexpr size_t kSegmentSize = 64 * 1024;
+    Parcel p;
+    ASSERT_EQ(OK, p.setDataSegmentSize(kSegmentSize));
+    ASSERT_EQ(kSegmentSize, p.dataSegmentSize());
+
+    std::vector<uint8_t> in(3 * kSegmentSize + 17);
+    for (size_t i = 0; i < in.size(); i++) in[i] = static_cast<uint8_t>(i);
+    ASSERT_EQ(OK, p.writeInt32(42));
+    ASSERT_EQ(OK, p.writeByteVector(in));
+    EXPECT_EQ(0u, p.dataCapacity() % kSegmentSize);
+    EXPECT_LT(p.dataCapacity() - p.dataSize(), kSegmentSize);
+
+    std::vector<uint8_t> out;
+    p.setDataPosition(0);
+    EXPECT_EQ(42, p.readInt32());
+    ASSERT_EQ(OK, p.readByteVector(&out));
+    EXPECT_EQ(in, out);
+
+    // the segment size sticks across freeData()/restartWrite()
+    p.freeData();
+    EXPECT_EQ(kSegmentSize, p.dataSegmentSize());
+    ASSERT_EQ(OK, p.writeInt32(1));
+    EXPECT_EQ(kSegmentSize, p.dataCapacity());
+}
+
+TEST(Parcel, SegmentedStorageAppendFrom) {
+    Parcel p1;
+    ASSERT_EQ(OK, p1.setDataSegmentSize(4096));
+    p1.writeInt32(1);
+    Parcel p2;
+    p2.writeInt32(2);
+
+    ASSERT_EQ(OK, p1.appendFrom(&p2, 0, p2.dataSize()));
+
+    p1.setDataPosition(0);
+    ASSERT_EQ(1, p1.readInt32());
+    ASSERT_EQ(2, p1.readInt32());
+}
+
+TEST(Parcel, SegmentSizeMustBeSetBeforeWriting) {
+    Parcel p;
+    p.writeInt32(1);
+    EXPECT_EQ(android::INVALID_OPERATION, p.setDataSegmentSize(4096));
+    EXPECT_EQ(0u, p.dataSegmentSize());
+}
+
 TEST(Parcel, HasBinders) {
     sp<IBinder> b1 = sp<BBinder>::make();
 
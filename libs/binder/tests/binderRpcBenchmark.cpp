@@ -31,6 +31,7 @@
 #include <binder/RpcTransportTls.h>
 #include <openssl/ssl.h>
 
+#include <algorithm>
 #include <thread>
 
 #include <signal.h>
@@ -250,6 +251,39 @@ BENCHMARK(BM_throughputForTransportAndBytes)
         ->ArgsProduct({kTransportList,
                        {64, 1024, 2048, 4096, 8182, 16364, 32728, 65535, 65536, 65537}});
 
+// Large payload sweep for RPC transports. Transaction and reply bodies are received into
+// buffers recycled by RpcState, so steady-state large transactions shouldn't allocate.
+// Bodies are capped at 100KB per transaction by RpcState, so larger payloads are sent as
+// several transactions of kLargeBytesChunkSize each.
+constexpr size_t kLargeBytesChunkSize = 64 * 1024;
+
+void BM_repeatLargeBytes(benchmark::State& state) {
+    sp<IBinder> binder = getBinderForOptions(state);
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
+    CHECK(iface != nullptr);
+
+    const size_t totalSize = state.range(1);
+    std::vector<uint8_t> chunk = std::vector<uint8_t>(std::min(totalSize, kLargeBytesChunkSize));
+    CHECK_EQ(totalSize % chunk.size(), 0u);
+    for (size_t i = 0; i < chunk.size(); i++) {
+        chunk[i] = i % 256;
+    }
+
+    while (state.KeepRunning()) {
+        for (size_t sent = 0; sent < totalSize; sent += chunk.size()) {
+            std::vector<uint8_t> out;
+            Status ret = iface->repeatBytes(chunk, &out);
+            CHECK(ret.isOk()) << ret;
+        }
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * 2 * totalSize);
+    SetLabel(state);
+}
+BENCHMARK(BM_repeatLargeBytes)
+        ->ArgsProduct({{Transport::RPC, Transport::RPC_TLS},
+                       {4096, 16384, 65536, 131072, 262144, 524288, 1048576}});
+
 void BM_collectProxies(benchmark::State& state) {
     sp<IBinder> binder = getBinderForOptions(state);
     sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
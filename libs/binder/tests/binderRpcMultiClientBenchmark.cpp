@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures an RpcServer with many connected clients, serving connections
+// either with a thread each, or from a shared thread pool.
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+#include <binder/RpcServer.h>
+#include <binder/RpcSession.h>
+
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using android::BBinder;
+using android::IBinder;
+using android::OK;
+using android::RpcServer;
+using android::RpcSession;
+using android::sp;
+using android::status_t;
+using android::statusToString;
+
+enum ServerMode {
+    THREAD_PER_CONNECTION,
+    SHARED_POOL,
+};
+
+struct Server {
+    std::string addr;
+    pid_t pid = 0;
+    // clients connected so far, reused by later benchmarks
+    std::vector<sp<IBinder>> roots;
+    std::vector<sp<RpcSession>> sessions;
+};
+
+static Server gServers[2];
+
+static void forkRpcServer(Server* server, ServerMode mode) {
+    pid_t pid = fork();
+    CHECK_GE(pid, 0);
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
+        sp<RpcServer> rpcServer = RpcServer::make();
+        rpcServer->setRootObject(sp<BBinder>::make());
+        if (mode == SHARED_POOL) {
+            rpcServer->setSharedThreadPoolSize(std::thread::hardware_concurrency());
+        }
+        CHECK_EQ(OK, rpcServer->setupUnixDomainServer(server->addr.c_str()));
+        rpcServer->join();
+        exit(1);
+    }
+    server->pid = pid;
+}
+
+static void connectClients(Server* server, size_t numClients) {
+    while (server->roots.size() < numClients) {
+        sp<RpcSession> session = RpcSession::make();
+        status_t status;
+        for (size_t tries = 0; tries < 5; tries++) {
+            status = session->setupUnixDomainClient(server->addr.c_str());
+            if (status == OK) break;
+            usleep(10000);
+        }
+        CHECK_EQ(status, OK) << "Could not connect: " << server->addr << ": "
+                             << statusToString(status).c_str();
+        sp<IBinder> root = session->getRootObject();
+        CHECK_NE(nullptr, root.get());
+        server->roots.push_back(root);
+        server->sessions.push_back(session);
+    }
+}
+
+static size_t countThreads(pid_t pid) {
+    std::string status;
+    CHECK(android::base::ReadFileToString("/proc/" + std::to_string(pid) + "/status", &status));
+    for (const auto& line : android::base::Split(status, "\n")) {
+        if (android::base::StartsWith(line, "Threads:")) {
+            return std::stoul(android::base::Trim(line.substr(strlen("Threads:"))));
+        }
+    }
+    LOG(FATAL) << "No thread count for " << pid;
+    return 0;
+}
+
+// Every iteration makes one call from each client, from a few client threads,
+// so that the server has to find the few busy connections among many idle
+// ones.
+void BM_pingManyClients(benchmark::State& state) {
+    ServerMode mode = static_cast<ServerMode>(state.range(0));
+    size_t numClients = state.range(1);
+    constexpr size_t kClientThreads = 4;
+
+    Server* server = &gServers[mode];
+    connectClients(server, numClients);
+
+    while (state.KeepRunning()) {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < kClientThreads; t++) {
+            threads.push_back(std::thread([=] {
+                for (size_t i = t; i < numClients; i += kClientThreads) {
+                    CHECK_EQ(OK, server->roots[i]->pingBinder());
+                }
+            }));
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    state.SetItemsProcessed(state.iterations() * numClients);
+    state.counters["server_threads"] = countThreads(server->pid);
+    state.SetLabel(mode == SHARED_POOL ? "shared_pool" : "thread_per_connection");
+}
+BENCHMARK(BM_pingManyClients)
+        ->ArgsProduct({{THREAD_PER_CONNECTION, SHARED_POOL}, {16, 128, 512}})
+        ->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    // each client is a socket here, and in the server
+    rlimit limit;
+    CHECK_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+    limit.rlim_cur = limit.rlim_max;
+    CHECK_EQ(0, setrlimit(RLIMIT_NOFILE, &limit));
+
+    std::string tmp = getenv("TMPDIR") ?: "/tmp";
+    for (ServerMode mode : {THREAD_PER_CONNECTION, SHARED_POOL}) {
+        Server* server = &gServers[mode];
+        server->addr = tmp + "/binderRpcMultiClientBenchmark" + std::to_string(mode);
+        (void)unlink(server->addr.c_str());
+        forkRpcServer(server, mode);
+    }
+
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
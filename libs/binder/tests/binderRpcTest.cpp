@@ -42,6 +42,7 @@
 #include <trusty/tipc.h>
 #endif // BINDER_RPC_TO_TRUSTY_TEST
 
+#include "../RpcWireFormat.h"
 #include "../Utils.h"
 #include "binderRpcTestCommon.h"
 #include "binderRpcTestFixture.h"
@@ -658,6 +659,44 @@ TEST_P(BinderRpc, OnewayCallQueueing) {
     saturateThreadPool(1 + kNumExtraServerThreads, proc.rootIface);
 }
 
+TEST_P(BinderRpc, OnewayCallQueueingBatched) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr size_t kNumQueued = 100;
+    constexpr size_t kNumExtraServerThreads = 4;
+
+    auto proc = createRpcTestSocketServerProcess({.numThreads = 1 + kNumExtraServerThreads});
+
+    // small enough that some batches fill up, and long enough that the rest
+    // are only written ahead of the blocking calls below
+    proc.proc->sessions.at(0).session->setOnewayBatching(512, std::chrono::seconds(10));
+
+    for (size_t i = 0; i < kNumQueued; i++) {
+        proc.rootIface->blockingSendIntOneway(i);
+    }
+    for (size_t i = 0; i < kNumQueued; i++) {
+        int n;
+        proc.rootIface->blockingRecvInt(&n);
+        EXPECT_EQ(n, static_cast<ssize_t>(i));
+    }
+
+    // once the other thread is blocked, nothing else is sent on this session,
+    // so this is only written when it times out
+    proc.proc->sessions.at(0).session->setOnewayBatching(512, std::chrono::milliseconds(1));
+    std::thread receiver([&] {
+        int n;
+        EXPECT_OK(proc.rootIface->blockingRecvInt(&n));
+        EXPECT_EQ(n, 42);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    proc.rootIface->blockingSendIntOneway(42);
+    receiver.join();
+
+    saturateThreadPool(1 + kNumExtraServerThreads, proc.rootIface);
+}
+
 TEST_P(BinderRpc, OnewayCallExhaustion) {
     if (clientOrServerSingleThreaded()) {
         GTEST_SKIP() << "This test requires multiple threads";
@@ -1639,6 +1678,177 @@ TEST_P(BinderRpcServerOnly, Shutdown) {
             << "After server->shutdown() returns true, join() did not stop after 2s";
 }
 
+TEST_P(BinderRpcServerOnly, SharedThreadPool) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+    if (std::get<0>(GetParam()) == RpcSecurity::TLS) {
+        GTEST_SKIP() << "Clients would need to be trusted by the server";
+    }
+
+    constexpr size_t kNumSessions = 20;
+    constexpr size_t kNumConnectionsPerSession = 2;
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make(newTlsFactory(std::get<0>(GetParam())));
+    ASSERT_TRUE(server->setProtocolVersion(std::get<1>(GetParam())));
+    server->setMaxThreads(kNumConnectionsPerSession);
+    server->setSharedThreadPoolSize(2);
+    server->setRootObject(sp<BBinder>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    std::vector<sp<RpcSession>> sessions;
+    for (size_t i = 0; i < kNumSessions; i++) {
+        auto session = RpcSession::make(newTlsFactory(std::get<0>(GetParam())));
+        session->setMaxOutgoingConnections(kNumConnectionsPerSession);
+        ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+        sessions.push_back(session);
+    }
+
+    // more connections than threads, all of them still served
+    std::vector<std::thread> threads;
+    for (const auto& session : sessions) {
+        for (size_t i = 0; i < kNumConnectionsPerSession; i++) {
+            threads.push_back(std::thread([=] {
+                sp<IBinder> root = session->getRootObject();
+                ASSERT_NE(nullptr, root);
+                for (size_t j = 0; j < 10; j++) EXPECT_EQ(OK, root->pingBinder());
+            }));
+        }
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(kNumSessions, server->listSessions().size());
+
+    for (const auto& session : sessions) {
+        EXPECT_TRUE(session->shutdownAndWait(true));
+    }
+    EXPECT_TRUE(server->shutdown());
+}
+
+class EchoBinder : public BBinder {
+public:
+    status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                        uint32_t flags) override {
+        if (code != IBinder::FIRST_CALL_TRANSACTION) {
+            return BBinder::onTransact(code, data, reply, flags);
+        }
+        std::vector<uint8_t> bytes;
+        if (status_t status = data.readByteVector(&bytes); status != OK) return status;
+        return reply->writeByteVector(bytes);
+    }
+};
+
+TEST_P(BinderRpcServerOnly, SharedMemory) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+    if (std::get<0>(GetParam()) == RpcSecurity::TLS) {
+        GTEST_SKIP() << "Clients would need to be trusted by the server";
+    }
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make(newTlsFactory(std::get<0>(GetParam())));
+    ASSERT_TRUE(server->setProtocolVersion(std::get<1>(GetParam())));
+    server->setMaxThreads(3);
+    server->setRootObject(sp<EchoBinder>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    // falls back to the socket where shared memory isn't supported, so this
+    // works either way
+    auto session = RpcSession::make(newTlsFactory(std::get<0>(GetParam())));
+    session->setUseSharedMemory(true);
+    ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+    sp<IBinder> root = session->getRootObject();
+    ASSERT_NE(nullptr, root);
+
+    // including transactions which don't fit into the ring all at once
+    std::vector<std::thread> threads;
+    for (size_t size : {1, 1000, 512 * 1024}) {
+        threads.push_back(std::thread([=] {
+            std::vector<uint8_t> bytes(size);
+            for (size_t i = 0; i < size; i++) bytes[i] = i % 251;
+
+            for (size_t i = 0; i < 10; i++) {
+                Parcel data;
+                data.markForBinder(root);
+                ASSERT_EQ(OK, data.writeByteVector(bytes));
+                Parcel reply;
+                ASSERT_EQ(OK, root->transact(IBinder::FIRST_CALL_TRANSACTION, data, &reply));
+                std::vector<uint8_t> echoed;
+                ASSERT_EQ(OK, reply.readByteVector(&echoed));
+                EXPECT_EQ(bytes, echoed);
+            }
+        }));
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
+TEST_P(BinderRpcServerOnly, SharedThreadPoolStalledClient) {
+    if constexpr (!kEnableRpcThreads) {
+        GTEST_SKIP() << "Test skipped because threads were disabled at build time";
+    }
+    if (std::get<0>(GetParam()) == RpcSecurity::TLS) {
+        GTEST_SKIP() << "The stalled client speaks the wire protocol without TLS";
+    }
+
+    auto addr = allocateSocketAddress();
+    auto server = RpcServer::make(newTlsFactory(std::get<0>(GetParam())));
+    ASSERT_TRUE(server->setProtocolVersion(std::get<1>(GetParam())));
+    server->setSharedThreadPoolSize(1);
+    server->setRootObject(sp<BBinder>::make());
+    ASSERT_EQ(OK, server->setupUnixDomainServer(addr.c_str()));
+    server->start();
+
+    // a client which stops halfway through the header of its first command
+    unique_fd stalled = connectTo(UnixSocketAddress(addr.c_str()));
+    RpcConnectionHeader header{
+            .version = std::get<1>(GetParam()),
+            .options = 0,
+            .fileDescriptorTransportMode = 0,
+            .reservered = {},
+            .sessionIdSize = 0,
+    };
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(header)),
+              TEMP_FAILURE_RETRY(write(stalled.get(), &header, sizeof(header))));
+    RpcNewSessionResponse response;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(response)),
+              TEMP_FAILURE_RETRY(read(stalled.get(), &response, sizeof(response))));
+    RpcOutgoingConnectionInit init{
+            .msg = RPC_CONNECTION_INIT_OKAY,
+            .reserved = {},
+    };
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(init)),
+              TEMP_FAILURE_RETRY(write(stalled.get(), &init, sizeof(init))));
+    RpcWireHeader command{
+            .command = RPC_COMMAND_TRANSACT,
+            .bodySize = 0,
+            .reserved = {},
+    };
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(command) / 2),
+              TEMP_FAILURE_RETRY(write(stalled.get(), &command, sizeof(command) / 2)));
+
+    // the only thread of the pool isn't held up for good
+    auto session = RpcSession::make(newTlsFactory(std::get<0>(GetParam())));
+    ASSERT_EQ(OK, session->setupUnixDomainClient(addr.c_str()));
+    sp<IBinder> root = session->getRootObject();
+    ASSERT_NE(nullptr, root);
+    EXPECT_EQ(OK, root->pingBinder());
+
+    // and the stalled client is disconnected
+    pollfd pfd{.fd = stalled.get(), .events = POLLIN, .revents = 0};
+    ASSERT_EQ(1, TEMP_FAILURE_RETRY(poll(&pfd, 1, 5000)));
+    char byte;
+    EXPECT_EQ(0, TEMP_FAILURE_RETRY(read(stalled.get(), &byte, sizeof(byte))));
+
+    EXPECT_TRUE(session->shutdownAndWait(true));
+    EXPECT_TRUE(server->shutdown());
+}
+
 INSTANTIATE_TEST_SUITE_P(BinderRpc, BinderRpcServerOnly,
                          ::testing::Combine(::testing::ValuesIn(RpcSecurityValues()),
                                             ::testing::ValuesIn(testVersions())),
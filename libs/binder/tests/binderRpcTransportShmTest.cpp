@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/RpcTransportRaw.h>
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../FdTrigger.h"
+#include "../FdUtils.h"
+#include "../RpcTransportShm.h"
+
+namespace android {
+
+using android::binder::unique_fd;
+
+// must match RpcTransportShm.cpp
+constexpr size_t kRingSize = 128 * 1024;
+
+class RpcTransportShmTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mTrigger = FdTrigger::make();
+        ASSERT_NE(nullptr, mTrigger);
+
+        unique_fd clientFd, serverFd;
+        ASSERT_TRUE(binder::Socketpair(SOCK_STREAM, &clientFd, &serverFd));
+        mServerSocket = serverFd.get();
+
+        std::unique_ptr<RpcShmRegion> region = RpcShmRegion::create(clientFd);
+        if (region == nullptr) GTEST_SKIP() << "Shared memory isn't supported here";
+        mRegionFd.reset(fcntl(region->fd().get(), F_DUPFD_CLOEXEC, 0));
+        ASSERT_TRUE(mRegionFd.ok());
+
+        std::unique_ptr<RpcShmRegion> peerRegion =
+                RpcShmRegion::fromPeer(unique_fd(fcntl(mRegionFd.get(), F_DUPFD_CLOEXEC, 0)));
+        ASSERT_NE(nullptr, peerRegion);
+
+        auto ctx = RpcTransportCtxFactoryRaw::make()->newClientCtx();
+        mClient = newRpcTransportShm(ctx->newTransport(RpcTransportFd(std::move(clientFd)),
+                                                       mTrigger.get()),
+                                     std::move(region), true /*isClient*/);
+        mServer = newRpcTransportShm(ctx->newTransport(RpcTransportFd(std::move(serverFd)),
+                                                       mTrigger.get()),
+                                     std::move(peerRegion), false /*isClient*/);
+        ASSERT_NE(nullptr, mClient);
+        ASSERT_NE(nullptr, mServer);
+    }
+
+    status_t write(RpcTransport* transport, const std::vector<uint8_t>& data) {
+        iovec iov{const_cast<uint8_t*>(data.data()), data.size()};
+        return transport->interruptableWriteFully(mTrigger.get(), &iov, 1, std::nullopt, nullptr);
+    }
+
+    status_t read(RpcTransport* transport, std::vector<uint8_t>* data) {
+        iovec iov{data->data(), data->size()};
+        return transport->interruptableReadFully(mTrigger.get(), &iov, 1, std::nullopt, nullptr);
+    }
+
+    static std::vector<uint8_t> pattern(size_t size) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; i++) data[i] = i % 251;
+        return data;
+    }
+
+    std::unique_ptr<FdTrigger> mTrigger;
+    int mServerSocket = -1;
+    unique_fd mRegionFd;
+    std::unique_ptr<RpcTransport> mClient;
+    std::unique_ptr<RpcTransport> mServer;
+};
+
+TEST_F(RpcTransportShmTest, BothDirections) {
+    std::vector<uint8_t> request = pattern(100);
+    ASSERT_EQ(OK, write(mClient.get(), request));
+    std::vector<uint8_t> received(request.size());
+    ASSERT_EQ(OK, read(mServer.get(), &received));
+    EXPECT_EQ(request, received);
+
+    std::vector<uint8_t> reply = pattern(37);
+    ASSERT_EQ(OK, write(mServer.get(), reply));
+    received.resize(reply.size());
+    ASSERT_EQ(OK, read(mClient.get(), &received));
+    EXPECT_EQ(reply, received);
+}
+
+TEST_F(RpcTransportShmTest, DataBypassesSocket) {
+    // nobody is waiting, so nothing needs to be woken up
+    ASSERT_EQ(OK, write(mClient.get(), pattern(1000)));
+
+    uint8_t byte;
+    EXPECT_EQ(-1, recv(mServerSocket, &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT));
+    EXPECT_EQ(EAGAIN, errno);
+}
+
+TEST_F(RpcTransportShmTest, PollRead) {
+    EXPECT_EQ(WOULD_BLOCK, mServer->pollRead());
+    ASSERT_EQ(OK, write(mClient.get(), pattern(1)));
+    EXPECT_EQ(OK, mServer->pollRead());
+
+    std::vector<uint8_t> received(1);
+    ASSERT_EQ(OK, read(mServer.get(), &received));
+    EXPECT_EQ(WOULD_BLOCK, mServer->pollRead());
+}
+
+TEST_F(RpcTransportShmTest, LargerThanRing) {
+    // wraps around the ring several times, with both sides waiting on each other
+    std::vector<uint8_t> data = pattern(5 * kRingSize + 12345);
+    std::thread writer([&] { EXPECT_EQ(OK, write(mClient.get(), data)); });
+
+    std::vector<uint8_t> received(data.size());
+    EXPECT_EQ(OK, read(mServer.get(), &received));
+    writer.join();
+    EXPECT_EQ(data, received);
+}
+
+TEST_F(RpcTransportShmTest, ManySmallWritesAcrossTheEnd) {
+    std::thread writer([&] {
+        for (size_t i = 0; i < 3 * kRingSize / 997; i++) {
+            EXPECT_EQ(OK, write(mClient.get(), pattern(997)));
+        }
+    });
+
+    for (size_t i = 0; i < 3 * kRingSize / 997; i++) {
+        std::vector<uint8_t> received(997);
+        ASSERT_EQ(OK, read(mServer.get(), &received));
+        EXPECT_EQ(pattern(997), received);
+    }
+    writer.join();
+}
+
+TEST_F(RpcTransportShmTest, CorruptedIndexIsRejected) {
+    void* base = mmap(nullptr, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED, mRegionFd.get(),
+                      0);
+    ASSERT_NE(MAP_FAILED, base);
+
+    // the client's head index is at the start of the region, claim more than
+    // the ring holds
+    static_cast<std::atomic<uint32_t>*>(base)->store(kRingSize + 1);
+
+    std::vector<uint8_t> received(1);
+    EXPECT_EQ(BAD_VALUE, read(mServer.get(), &received));
+    munmap(base, getpagesize());
+}
+
+TEST_F(RpcTransportShmTest, TriggerInterruptsRead) {
+    std::thread reader([&] {
+        std::vector<uint8_t> received(1);
+        EXPECT_EQ(DEAD_OBJECT, read(mServer.get(), &received));
+    });
+    mTrigger->trigger();
+    reader.join();
+}
+
+// A server on the shared thread pool reads with an altPoll which waits for the
+// socket to become readable, with a timeout (see RpcState::rpcRec). A peer which
+// stops halfway through a command must time out, even when a wakeup it sent
+// earlier was still on the socket.
+TEST_F(RpcTransportShmTest, StalledPeerTimesOutWithAltPoll) {
+    // ask for a wakeup, which the next write sends
+    ASSERT_EQ(WOULD_BLOCK, mServer->pollRead());
+    ASSERT_EQ(OK, write(mClient.get(), pattern(4)));
+
+    size_t polls = 0;
+    std::optional<binder::impl::SmallFunction<status_t()>> altPoll = [&]() -> status_t {
+        // more than a few polls means the wait doesn't block
+        if (++polls > 10) return UNKNOWN_ERROR;
+        return mTrigger->triggerablePoll(mServer->pollableFd(), POLLIN,
+                                         std::chrono::milliseconds(100));
+    };
+    std::vector<uint8_t> received(8);
+    iovec iov{received.data(), received.size()};
+    EXPECT_EQ(TIMED_OUT,
+              mServer->interruptableReadFully(mTrigger.get(), &iov, 1, altPoll, nullptr));
+    EXPECT_LE(polls, 2u);
+}
+
+TEST(RpcShmRegion, RejectsRegionWhichCanShrink) {
+    unique_fd fd(memfd_create("RpcShmRegionTest", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!fd.ok()) GTEST_SKIP() << "memfd_create isn't supported here";
+    ASSERT_EQ(0, ftruncate(fd.get(), 4096 + 2 * kRingSize));
+
+    EXPECT_EQ(nullptr, RpcShmRegion::fromPeer(std::move(fd)));
+}
+
+TEST(RpcShmRegion, RejectsRegionOfWrongSize) {
+    unique_fd fd(memfd_create("RpcShmRegionTest", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!fd.ok()) GTEST_SKIP() << "memfd_create isn't supported here";
+    ASSERT_EQ(0, ftruncate(fd.get(), 4096));
+    ASSERT_EQ(0, fcntl(fd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+
+    EXPECT_EQ(nullptr, RpcShmRegion::fromPeer(std::move(fd)));
+}
+
+} // namespace android
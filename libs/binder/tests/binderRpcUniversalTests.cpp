@@ -62,6 +62,20 @@ TEST_P(BinderRpc, Ping) {
     EXPECT_EQ(OK, proc.rootBinder->pingBinder());
 }
 
+TEST_P(BinderRpc, EmptyReply) {
+    auto proc = createRpcTestSocketServerProcess({});
+    ASSERT_NE(proc.rootBinder, nullptr);
+    // A ping reply has no body, so the reply Parcel has no receive buffer to give back when it
+    // is destroyed.
+    for (size_t i = 0; i < 3; i++) {
+        Parcel data;
+        data.markForBinder(proc.rootBinder);
+        Parcel reply;
+        EXPECT_EQ(OK, proc.rootBinder->transact(IBinder::PING_TRANSACTION, data, &reply));
+        EXPECT_EQ(0u, reply.dataSize());
+    }
+}
+
 TEST_P(BinderRpc, GetInterfaceDescriptor) {
     auto proc = createRpcTestSocketServerProcess({});
     ASSERT_NE(proc.rootBinder, nullptr);
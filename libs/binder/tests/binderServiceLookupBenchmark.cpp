@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures looking up the services a process needs when it starts, one at a
+// time or with a single batched call.
+
+#include <android-base/logging.h>
+#include <android/os/IServiceLookup.h>
+#include <android/os/IServiceManager.h>
+#include <benchmark/benchmark.h>
+#include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+
+#include <string>
+#include <vector>
+
+using android::defaultServiceManager;
+using android::IBinder;
+using android::interface_cast;
+using android::ProcessState;
+using android::sp;
+using android::String16;
+using android::binder::Status;
+using android::os::IServiceLookup;
+using android::os::IServiceManager;
+using android::os::Service;
+
+// services which are running on the device, looked up by every benchmark
+static std::vector<std::string> gNames;
+
+// Talks to servicemanager directly, rather than through the client side cache,
+// so that every lookup is cold.
+static sp<IServiceManager> rawServiceManager() {
+    sp<IBinder> binder = ProcessState::self()->getContextObject(nullptr);
+    CHECK_NE(nullptr, binder.get());
+    return interface_cast<IServiceManager>(binder);
+}
+
+// The batched lookup, which servicemanager serves as its extension.
+static sp<IServiceLookup> rawServiceLookup() {
+    sp<IBinder> extension;
+    CHECK_EQ(android::OK,
+             ProcessState::self()->getContextObject(nullptr)->getExtension(&extension));
+    CHECK_NE(nullptr, extension.get()) << "servicemanager doesn't support batched lookups";
+    return interface_cast<IServiceLookup>(extension);
+}
+
+static std::vector<std::string> namesFor(const benchmark::State& state) {
+    size_t n = state.range(0);
+    CHECK_LE(n, gNames.size()) << "Not enough services on this device";
+    return std::vector<std::string>(gNames.begin(), gNames.begin() + n);
+}
+
+void BM_coldLookupEach(benchmark::State& state) {
+    sp<IServiceManager> sm = rawServiceManager();
+    std::vector<std::string> names = namesFor(state);
+
+    while (state.KeepRunning()) {
+        for (const auto& name : names) {
+            Service service;
+            Status status = sm->checkService(name, &service);
+            CHECK(status.isOk()) << status;
+            benchmark::DoNotOptimize(service);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_coldLookupEach)->Arg(1)->Arg(10)->Arg(30)->Arg(50)->Unit(benchmark::kMicrosecond);
+
+void BM_coldLookupBatched(benchmark::State& state) {
+    sp<IServiceLookup> lookup = rawServiceLookup();
+    std::vector<std::string> names = namesFor(state);
+
+    while (state.KeepRunning()) {
+        std::vector<Service> services;
+        Status status = lookup->getServicesNoWait(names, &services);
+        CHECK(status.isOk()) << status;
+        benchmark::DoNotOptimize(services);
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_coldLookupBatched)->Arg(1)->Arg(10)->Arg(30)->Arg(50)->Unit(benchmark::kMicrosecond);
+
+// Through libbinder, which may answer from its cache after the first time.
+void BM_getServicesNoWait(benchmark::State& state) {
+    std::vector<String16> names;
+    for (const auto& name : namesFor(state)) names.push_back(String16(name.c_str()));
+
+    while (state.KeepRunning()) {
+        std::vector<sp<IBinder>> binders = defaultServiceManager()->getServicesNoWait(names);
+        benchmark::DoNotOptimize(binders);
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_getServicesNoWait)->Arg(1)->Arg(10)->Arg(30)->Arg(50)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    ProcessState::self()->startThreadPool();
+
+    std::vector<std::string> names;
+    Status status =
+            rawServiceManager()->listServices(IServiceManager::DUMP_FLAG_PRIORITY_ALL, &names);
+    CHECK(status.isOk()) << status;
+    gNames = std::move(names);
+
+    ::benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
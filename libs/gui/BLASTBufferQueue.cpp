@@ -81,6 +81,10 @@ namespace android {
 static ReleaseBufferCallback EMPTY_RELEASE_CALLBACK =
         [](const ReleaseCallbackId&, const sp<Fence>& /*releaseFence*/,
            std::optional<uint32_t> /*currentMaxAcquiredBufferCount*/) {};
+
+// Upper bound on the number of releases the release thread handles per acquisition of mMutex, so
+// a flood of releases can't hold off dequeueBuffer for long.
+static constexpr size_t kMaxBufferReleaseBatchSize = 16;
 #endif
 
 void BLASTBufferItemConsumer::onDisconnect() {
@@ -1323,6 +1327,13 @@ BLASTBufferQueue::BufferReleaseReader& BLASTBufferQueue::BufferReleaseReader::op
 status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(ReleaseCallbackId& outId,
                                                              sp<Fence>& outFence,
                                                              uint32_t& outMaxAcquiredBufferCount) {
+    // Releases written to the channel's shared ring may be waiting without the socket being
+    // readable, so drain before going to sleep.
+    if (status_t status = readNonBlocking(outId, outFence, outMaxAcquiredBufferCount);
+        status != WOULD_BLOCK) {
+        return status;
+    }
+
     epoll_event event{};
     while (true) {
         int eventCount = epoll_wait(mEpollFd.get(), &event, 1 /* maxevents */, -1 /* timeout */);
@@ -1344,6 +1355,11 @@ status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(ReleaseCallbackId&
         return WOULD_BLOCK;
     }
 
+    return readNonBlocking(outId, outFence, outMaxAcquiredBufferCount);
+}
+
+status_t BLASTBufferQueue::BufferReleaseReader::readNonBlocking(
+        ReleaseCallbackId& outId, sp<Fence>& outFence, uint32_t& outMaxAcquiredBufferCount) {
     std::lock_guard lock{mMutex};
     return mEndpoint->readReleaseFence(outId, outFence, outMaxAcquiredBufferCount);
 }
@@ -1360,23 +1376,40 @@ void BLASTBufferQueue::BufferReleaseThread::start(const sp<BLASTBufferQueue>& bb
     mReader = bbq->mBufferReleaseReader;
     std::thread([running = mRunning, reader = mReader, weakBbq = wp<BLASTBufferQueue>(bbq)]() {
         pthread_setname_np(pthread_self(), "BufferReleaseThread");
+        std::vector<BufferRelease> releases;
         while (*running) {
-            ReleaseCallbackId id;
-            sp<Fence> fence;
-            uint32_t maxAcquiredBufferCount;
-            if (status_t status = reader->readBlocking(id, fence, maxAcquiredBufferCount);
+            releases.clear();
+            BufferRelease release;
+            if (status_t status = reader->readBlocking(release.callbackId, release.releaseFence,
+                                                       release.maxAcquiredBufferCount);
                 status != OK) {
                 continue;
             }
+            // Drain whatever else is already available so the batch is released under a single
+            // acquisition of the BBQ mutex instead of contending with dequeueBuffer per release.
+            do {
+                releases.push_back(std::move(release));
+            } while (releases.size() < kMaxBufferReleaseBatchSize &&
+                     reader->readNonBlocking(release.callbackId, release.releaseFence,
+                                             release.maxAcquiredBufferCount) == OK);
             sp<BLASTBufferQueue> bbq = weakBbq.promote();
             if (!bbq) {
                 return;
             }
-            bbq->releaseBufferCallback(id, fence, maxAcquiredBufferCount);
+            bbq->releaseBufferCallbacks(releases);
         }
     }).detach();
 }
 
+void BLASTBufferQueue::releaseBufferCallbacks(const std::vector<BufferRelease>& releases) {
+    std::lock_guard _lock{mMutex};
+    BBQ_TRACE("count=%zu", releases.size());
+    for (const auto& release : releases) {
+        releaseBufferCallbackLocked(release.callbackId, release.releaseFence,
+                                    release.maxAcquiredBufferCount, false /* fakeRelease */);
+    }
+}
+
 BLASTBufferQueue::BufferReleaseThread::~BufferReleaseThread() {
     *mRunning = false;
     mReader->interruptBlockingRead();
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BufferCache"
+
+#include <pthread.h>
+
+#include <private/gui/BufferCache.h>
+#include <utils/Log.h>
+
+namespace android {
+
+BufferCache::BufferCache(TokenFunction getToken, UncacheFunction doUncache)
+      : mGetToken(std::move(getToken)), mDoUncache(std::move(doUncache)) {}
+
+BufferCache::~BufferCache() {
+    std::thread flushThread;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        flushThread = std::move(mFlushThread);
+    }
+    mUncachePending.notify_all();
+    if (flushThread.joinable()) {
+        flushThread.join();
+    }
+}
+
+status_t BufferCache::getCacheId(const sp<GraphicBuffer>& buffer, uint64_t* cacheId) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto itr = mBuffers.find(buffer->getId());
+    if (itr == mBuffers.end()) {
+        return BAD_VALUE;
+    }
+    mLru.splice(mLru.begin(), mLru, itr->second);
+    *cacheId = buffer->getId();
+    return NO_ERROR;
+}
+
+uint64_t BufferCache::cache(const sp<GraphicBuffer>& buffer,
+                            std::optional<client_cache_t>& outUncacheBuffer) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mBuffers.size() >= mMaxSize) {
+        const uint64_t leastRecentlyUsed = mLru.back();
+        mLru.pop_back();
+        mBuffers.erase(leastRecentlyUsed);
+        outUncacheBuffer = client_cache_t{.token = getToken(), .id = leastRecentlyUsed};
+        mMaxSize = std::min(mMaxSize + 1, MAX_CACHE_SIZE);
+    }
+
+    buffer->addDeathCallback(onBufferDestroyed, this);
+
+    mLru.push_front(buffer->getId());
+    mBuffers[buffer->getId()] = mLru.begin();
+    return buffer->getId();
+}
+
+void BufferCache::uncache(uint64_t cacheId) {
+    std::vector<client_cache_t> uncacheBuffers;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itr = mBuffers.find(cacheId);
+        if (itr == mBuffers.end()) {
+            return;
+        }
+        mLru.erase(itr->second);
+        mBuffers.erase(itr);
+        mPendingUncacheBuffers.push_back({.token = getToken(), .id = cacheId});
+        if (mPendingUncacheBuffers.size() < MAX_PENDING_UNCACHE_BUFFERS) {
+            startFlushThreadLocked();
+            mUncachePending.notify_one();
+            return;
+        }
+        uncacheBuffers = std::move(mPendingUncacheBuffers);
+        mPendingUncacheBuffers.clear();
+    }
+    mDoUncache(uncacheBuffers);
+}
+
+void BufferCache::takePendingUncacheBuffers(std::vector<client_cache_t>& outUncacheBuffers) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    outUncacheBuffers.insert(outUncacheBuffers.end(), mPendingUncacheBuffers.begin(),
+                             mPendingUncacheBuffers.end());
+    mPendingUncacheBuffers.clear();
+}
+
+void BufferCache::onServerCacheFull() {
+    std::vector<client_cache_t> uncacheBuffers;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMaxSize = std::max(MIN_CACHE_SIZE, std::min(mMaxSize, mBuffers.size()) * 3 / 4);
+        ALOGW("Server buffer cache is full, shrinking client buffer cache to %zu", mMaxSize);
+        while (mBuffers.size() > mMaxSize) {
+            const uint64_t leastRecentlyUsed = mLru.back();
+            mLru.pop_back();
+            mBuffers.erase(leastRecentlyUsed);
+            mPendingUncacheBuffers.push_back({.token = getToken(), .id = leastRecentlyUsed});
+        }
+        uncacheBuffers = std::move(mPendingUncacheBuffers);
+        mPendingUncacheBuffers.clear();
+    }
+    if (!uncacheBuffers.empty()) {
+        mDoUncache(uncacheBuffers);
+    }
+}
+
+size_t BufferCache::getMaxSize() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMaxSize;
+}
+
+void BufferCache::onBufferDestroyed(void* context, uint64_t graphicBufferId) {
+    // GraphicBuffer id's are used as the cache ids.
+    static_cast<BufferCache*>(context)->uncache(graphicBufferId);
+}
+
+void BufferCache::startFlushThreadLocked() {
+    if (mFlushThread.joinable()) {
+        return;
+    }
+    mFlushThread = std::thread([this]() {
+        pthread_setname_np(pthread_self(), "BufferCacheFlush");
+        flushThreadMain();
+    });
+}
+
+// Sends deferred uncaches that no transaction picked up within UNCACHE_FLUSH_DELAY, so
+// the server drops its references to destroyed buffers even if this process goes idle.
+void BufferCache::flushThreadMain() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    base::ScopedLockAssertion assumeLocked(mMutex);
+    while (true) {
+        while (mPendingUncacheBuffers.empty() && !mStopping) {
+            mUncachePending.wait(lock);
+        }
+        if (mStopping) {
+            return;
+        }
+
+        // Wait out the delay even if more uncaches arrive, but not past destruction.
+        const auto deadline = std::chrono::steady_clock::now() + UNCACHE_FLUSH_DELAY;
+        while (!mStopping &&
+               mUncachePending.wait_until(lock, deadline) != std::cv_status::timeout) {
+        }
+        if (mStopping) {
+            return;
+        }
+
+        std::vector<client_cache_t> uncacheBuffers = std::move(mPendingUncacheBuffers);
+        mPendingUncacheBuffers.clear();
+        if (!uncacheBuffers.empty()) {
+            lock.unlock();
+            mDoUncache(uncacheBuffers);
+            lock.lock();
+        }
+    }
+}
+
+} // namespace android
@@ -97,7 +97,24 @@ status_t BufferQueueProducer::requestBuffer(int slot, sp<GraphicBuffer>* buf) {
     ATRACE_CALL();
     BQ_LOGV("requestBuffer: slot %d", slot);
     std::lock_guard<std::mutex> lock(mCore->mMutex);
+    return requestBufferLocked(slot, buf);
+}
+
+status_t BufferQueueProducer::requestBuffers(const std::vector<int32_t>& slots,
+                                             std::vector<RequestBufferOutput>* outputs) {
+    ATRACE_CALL();
+    outputs->clear();
+    outputs->resize(slots.size());
+
+    std::lock_guard<std::mutex> lock(mCore->mMutex);
+    for (size_t i = 0; i < slots.size(); i++) {
+        RequestBufferOutput& output = (*outputs)[i];
+        output.result = requestBufferLocked(static_cast<int>(slots[i]), &output.buffer);
+    }
+    return NO_ERROR;
+}
 
+status_t BufferQueueProducer::requestBufferLocked(int slot, sp<GraphicBuffer>* buf) {
     if (mCore->mIsAbandoned) {
         BQ_LOGE("requestBuffer: BufferQueue has been abandoned");
         return NO_INIT;
@@ -392,301 +409,416 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
     return NO_ERROR;
 }
 
+// One buffer of a dequeueBuffer or dequeueBuffers call.
+struct BufferQueueProducer::DequeueRequest {
+    uint32_t width;
+    uint32_t height;
+    PixelFormat format;
+    uint64_t usage;
+    FrameEventHistoryDelta* outTimestamps;
+
+    // What dequeueBuffer would return for this buffer, and its outputs
+    status_t result = NO_ERROR;
+    int slot = BufferQueueCore::INVALID_BUFFER_SLOT;
+    sp<Fence> fence = Fence::NO_FENCE;
+    uint64_t bufferAge = 0;
+
+    // Carried from dequeueBufferLocked to the rest of the dequeue
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
+    bool attachedByConsumer = false;
+    bool callOnFrameDequeued = false;
+    uint64_t bufferId = 0; // Only used if callOnFrameDequeued == true
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+    std::vector<gui::AdditionalOptions> allocOptions;
+    uint32_t allocOptionsGenId = 0;
+#endif
+};
+
 status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* outFence,
                                             uint32_t width, uint32_t height, PixelFormat format,
                                             uint64_t usage, uint64_t* outBufferAge,
                                             FrameEventHistoryDelta* outTimestamps) {
     ATRACE_CALL();
+    DequeueRequest request{
+            .width = width,
+            .height = height,
+            .format = format,
+            .usage = usage,
+            .outTimestamps = outTimestamps,
+    };
+    dequeueRequests(&request, 1);
+
+    if (request.result >= 0) {
+        *outSlot = request.slot;
+        *outFence = request.fence;
+        if (outBufferAge) {
+            *outBufferAge = request.bufferAge;
+        }
+    }
+    return request.result;
+}
+
+status_t BufferQueueProducer::dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                             std::vector<DequeueBufferOutput>* outputs) {
+    ATRACE_CALL();
+    outputs->clear();
+    outputs->resize(inputs.size());
+
+    std::vector<DequeueRequest> requests;
+    requests.reserve(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const DequeueBufferInput& input = inputs[i];
+        requests.push_back({
+                .width = input.width,
+                .height = input.height,
+                .format = input.format,
+                .usage = input.usage,
+                .outTimestamps =
+                        input.getTimestamps ? &(*outputs)[i].timestamps.emplace() : nullptr,
+        });
+    }
+    dequeueRequests(requests.data(), requests.size());
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        DequeueBufferOutput& output = (*outputs)[i];
+        output.result = requests[i].result;
+        output.bufferAge = requests[i].bufferAge;
+        if (output.result >= 0) {
+            output.slot = requests[i].slot;
+            output.fence = std::move(requests[i].fence);
+        }
+    }
+    return NO_ERROR;
+}
+
+void BufferQueueProducer::dequeueRequests(DequeueRequest* requests, size_t count) {
     { // Autolock scope
         std::lock_guard<std::mutex> lock(mCore->mMutex);
         mConsumerName = mCore->mConsumerName;
 
+        status_t status = NO_ERROR;
         if (mCore->mIsAbandoned) {
             BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
-        }
-
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+            status = NO_INIT;
+        } else if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
             BQ_LOGE("dequeueBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
+            status = NO_INIT;
+        }
+        if (status != NO_ERROR) {
+            for (size_t i = 0; i < count; i++) {
+                requests[i].result = status;
+            }
+            return;
         }
     } // Autolock scope
 
-    BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, width, height, format, usage);
+    for (size_t i = 0; i < count; i++) {
+        DequeueRequest& request = requests[i];
+        BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, request.width,
+                request.height, request.format, request.usage);
 
-    if ((width && !height) || (!width && height)) {
-        BQ_LOGE("dequeueBuffer: invalid size: w=%u h=%u", width, height);
-        return BAD_VALUE;
+        if ((request.width && !request.height) || (!request.width && request.height)) {
+            BQ_LOGE("dequeueBuffer: invalid size: w=%u h=%u", request.width, request.height);
+            request.result = BAD_VALUE;
+        }
     }
 
-    status_t returnFlags = NO_ERROR;
-    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
-    EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
-    bool attachedByConsumer = false;
-
+    // Buffers are dequeued under a single lock, until one of them has to be
+    // allocated. That happens without the lock held, and must be finished
+    // before dequeueing more, since other operations wait for it.
     sp<IConsumerListener> listener;
-    bool callOnFrameDequeued = false;
-    uint64_t bufferId = 0; // Only used if callOnFrameDequeued == true
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-    std::vector<gui::AdditionalOptions> allocOptions;
-    uint32_t allocOptionsGenId = 0;
-#endif
-
-    { // Autolock scope
-        std::unique_lock<std::mutex> lock(mCore->mMutex);
+    size_t next = 0;
+    while (next < count) {
+        DequeueRequest* allocating = nullptr;
+        { // Autolock scope
+            std::unique_lock<std::mutex> lock(mCore->mMutex);
+            for (; next < count && allocating == nullptr; next++) {
+                DequeueRequest& request = requests[next];
+                if (request.result != NO_ERROR) {
+                    continue;
+                }
+                request.result = dequeueBufferLocked(lock, &request);
+                if (request.result >= 0 && (request.result & BUFFER_NEEDS_REALLOCATION)) {
+                    allocating = &request;
+                }
+            }
+            listener = mCore->mConsumerListener;
+        } // Autolock scope
 
-        // If we don't have a free buffer, but we are currently allocating, we wait until allocation
-        // is finished such that we don't allocate in parallel.
-        if (mCore->mFreeBuffers.empty() && mCore->mIsAllocating) {
-            mDequeueWaitingForAllocation = true;
-            mCore->waitWhileAllocatingLocked(lock);
-            mDequeueWaitingForAllocation = false;
-            mDequeueWaitingForAllocationCondition.notify_all();
+        if (allocating != nullptr) {
+            status_t error = allocateDequeuedBuffer(allocating);
+            if (error != NO_ERROR) {
+                allocating->result = error;
+            }
         }
+    }
 
-        if (format == 0) {
-            format = mCore->mDefaultBufferFormat;
+    for (size_t i = 0; i < count; i++) {
+        DequeueRequest& request = requests[i];
+        if (request.result < 0) {
+            continue;
         }
 
-        // Enable the usage bits the consumer requested
-        usage |= mCore->mConsumerUsageBits;
-
-        const bool useDefaultSize = !width && !height;
-        if (useDefaultSize) {
-            width = mCore->mDefaultWidth;
-            height = mCore->mDefaultHeight;
-            if (mCore->mAutoPrerotation &&
-                (mCore->mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
-                std::swap(width, height);
-            }
+        if (listener != nullptr && request.callOnFrameDequeued) {
+            listener->onFrameDequeued(request.bufferId);
         }
 
-        int found = BufferItem::INVALID_BUFFER_SLOT;
-        while (found == BufferItem::INVALID_BUFFER_SLOT) {
-            status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
-            if (status != NO_ERROR) {
-                return status;
-            }
+        if (request.attachedByConsumer) {
+            request.result |= BUFFER_NEEDS_REALLOCATION;
+        }
 
-            // This should not happen
-            if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
-                BQ_LOGE("dequeueBuffer: no available buffer slots");
-                return -EBUSY;
+        if (request.eglFence != EGL_NO_SYNC_KHR) {
+            EGLint result = eglClientWaitSyncKHR(request.eglDisplay, request.eglFence, 0,
+                    1000000000);
+            // If something goes wrong, log the error, but return the buffer without
+            // synchronizing access to it. It's too late at this point to abort the
+            // dequeue operation.
+            if (result == EGL_FALSE) {
+                BQ_LOGE("dequeueBuffer: error %#x waiting for fence",
+                        eglGetError());
+            } else if (result == EGL_TIMEOUT_EXPIRED_KHR) {
+                BQ_LOGE("dequeueBuffer: timeout waiting for fence");
             }
+            eglDestroySyncKHR(request.eglDisplay, request.eglFence);
+        }
 
-            const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+        BQ_LOGV("dequeueBuffer: returning slot=%d/%" PRIu64 " buf=%p flags=%#x",
+                request.slot,
+                mSlots[request.slot].mFrameNumber,
+                mSlots[request.slot].mGraphicBuffer != nullptr ?
+                mSlots[request.slot].mGraphicBuffer->handle : nullptr, request.result);
 
-            // If we are not allowed to allocate new buffers,
-            // waitForFreeSlotThenRelock must have returned a slot containing a
-            // buffer. If this buffer would require reallocation to meet the
-            // requested attributes, we free it and attempt to get another one.
-            if (!mCore->mAllowAllocation) {
-                if (buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage)) {
-                    if (mCore->mSharedBufferSlot == found) {
-                        BQ_LOGE("dequeueBuffer: cannot re-allocate a sharedbuffer");
-                        return BAD_VALUE;
-                    }
-                    mCore->mFreeSlots.insert(found);
-                    mCore->clearBufferSlotLocked(found);
-                    found = BufferItem::INVALID_BUFFER_SLOT;
-                    continue;
-                }
-            }
+        if (listener != nullptr && request.outTimestamps != nullptr) {
+            listener->addAndGetFrameTimestamps(nullptr, request.outTimestamps);
         }
+    }
+}
 
-        const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+status_t BufferQueueProducer::dequeueBufferLocked(std::unique_lock<std::mutex>& lock,
+                                                  DequeueRequest* request) {
+    status_t returnFlags = NO_ERROR;
 
-        bool needsReallocation = buffer == nullptr ||
-                buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage);
+    // If we don't have a free buffer, but we are currently allocating, we wait until allocation
+    // is finished such that we don't allocate in parallel.
+    if (mCore->mFreeBuffers.empty() && mCore->mIsAllocating) {
+        mDequeueWaitingForAllocation = true;
+        mCore->waitWhileAllocatingLocked(lock);
+        mDequeueWaitingForAllocation = false;
+        mDequeueWaitingForAllocationCondition.notify_all();
+    }
 
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-        needsReallocation |= mSlots[found].mAdditionalOptionsGenerationId !=
-                mCore->mAdditionalOptionsGenerationId;
-#endif
+    if (request->format == 0) {
+        request->format = mCore->mDefaultBufferFormat;
+    }
 
-        if (mCore->mSharedBufferSlot == found && needsReallocation) {
-            BQ_LOGE("dequeueBuffer: cannot re-allocate a shared buffer");
-            return BAD_VALUE;
+    // Enable the usage bits the consumer requested
+    request->usage |= mCore->mConsumerUsageBits;
+
+    const bool useDefaultSize = !request->width && !request->height;
+    if (useDefaultSize) {
+        request->width = mCore->mDefaultWidth;
+        request->height = mCore->mDefaultHeight;
+        if (mCore->mAutoPrerotation &&
+            (mCore->mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
+            std::swap(request->width, request->height);
         }
+    }
 
-        if (mCore->mSharedBufferSlot != found) {
-            mCore->mActiveBuffers.insert(found);
+    const uint32_t width = request->width;
+    const uint32_t height = request->height;
+    const PixelFormat format = request->format;
+    const uint64_t usage = request->usage;
+
+    int found = BufferItem::INVALID_BUFFER_SLOT;
+    while (found == BufferItem::INVALID_BUFFER_SLOT) {
+        status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
+        if (status != NO_ERROR) {
+            return status;
         }
-        *outSlot = found;
-        ATRACE_BUFFER_INDEX(found);
 
-        attachedByConsumer = mSlots[found].mNeedsReallocation;
-        mSlots[found].mNeedsReallocation = false;
+        // This should not happen
+        if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
+            BQ_LOGE("dequeueBuffer: no available buffer slots");
+            return -EBUSY;
+        }
 
-        mSlots[found].mBufferState.dequeue();
+        const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
 
-        if (needsReallocation) {
-            if (CC_UNLIKELY(ATRACE_ENABLED())) {
-                if (buffer == nullptr) {
-                    ATRACE_FORMAT_INSTANT("%s buffer reallocation: null", mConsumerName.c_str());
-                } else {
-                    ATRACE_FORMAT_INSTANT("%s buffer reallocation actual %dx%d format:%d "
-                                          "layerCount:%d "
-                                          "usage:%d requested: %dx%d format:%d layerCount:%d "
-                                          "usage:%d ",
-                                          mConsumerName.c_str(), width, height, format,
-                                          BQ_LAYER_COUNT, usage, buffer->getWidth(),
-                                          buffer->getHeight(), buffer->getPixelFormat(),
-                                          buffer->getLayerCount(), buffer->getUsage());
+        // If we are not allowed to allocate new buffers,
+        // waitForFreeSlotThenRelock must have returned a slot containing a
+        // buffer. If this buffer would require reallocation to meet the
+        // requested attributes, we free it and attempt to get another one.
+        if (!mCore->mAllowAllocation) {
+            if (buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage)) {
+                if (mCore->mSharedBufferSlot == found) {
+                    BQ_LOGE("dequeueBuffer: cannot re-allocate a sharedbuffer");
+                    return BAD_VALUE;
                 }
+                mCore->mFreeSlots.insert(found);
+                mCore->clearBufferSlotLocked(found);
+                found = BufferItem::INVALID_BUFFER_SLOT;
+                continue;
             }
-            mSlots[found].mAcquireCalled = false;
-            mSlots[found].mGraphicBuffer = nullptr;
-            mSlots[found].mRequestBufferCalled = false;
-            mSlots[found].mEglDisplay = EGL_NO_DISPLAY;
-            mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
-            mSlots[found].mFence = Fence::NO_FENCE;
-            mCore->mBufferAge = 0;
-            mCore->mIsAllocating = true;
+        }
+    }
+
+    const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+
+    bool needsReallocation = buffer == nullptr ||
+            buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage);
+
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-            allocOptions = mCore->mAdditionalOptions;
-            allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
+    needsReallocation |= mSlots[found].mAdditionalOptionsGenerationId !=
+            mCore->mAdditionalOptionsGenerationId;
 #endif
 
-            returnFlags |= BUFFER_NEEDS_REALLOCATION;
-        } else {
-            // We add 1 because that will be the frame number when this buffer
-            // is queued
-            mCore->mBufferAge = mCore->mFrameCounter + 1 - mSlots[found].mFrameNumber;
-        }
+    if (mCore->mSharedBufferSlot == found && needsReallocation) {
+        BQ_LOGE("dequeueBuffer: cannot re-allocate a shared buffer");
+        return BAD_VALUE;
+    }
 
-        BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
-                mCore->mBufferAge);
+    if (mCore->mSharedBufferSlot != found) {
+        mCore->mActiveBuffers.insert(found);
+    }
+    request->slot = found;
+    ATRACE_BUFFER_INDEX(found);
 
-        if (CC_UNLIKELY(mSlots[found].mFence == nullptr)) {
-            BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
-                    "slot=%d w=%d h=%d format=%u",
-                    found, buffer->width, buffer->height, buffer->format);
-        }
+    request->attachedByConsumer = mSlots[found].mNeedsReallocation;
+    mSlots[found].mNeedsReallocation = false;
 
-        eglDisplay = mSlots[found].mEglDisplay;
-        eglFence = mSlots[found].mEglFence;
-        // Don't return a fence in shared buffer mode, except for the first
-        // frame.
-        *outFence = (mCore->mSharedBufferMode &&
-                mCore->mSharedBufferSlot == found) ?
-                Fence::NO_FENCE : mSlots[found].mFence;
+    mSlots[found].mBufferState.dequeue();
+
+    if (needsReallocation) {
+        if (CC_UNLIKELY(ATRACE_ENABLED())) {
+            if (buffer == nullptr) {
+                ATRACE_FORMAT_INSTANT("%s buffer reallocation: null", mConsumerName.c_str());
+            } else {
+                ATRACE_FORMAT_INSTANT("%s buffer reallocation actual %dx%d format:%d "
+                                      "layerCount:%d "
+                                      "usage:%d requested: %dx%d format:%d layerCount:%d "
+                                      "usage:%d ",
+                                      mConsumerName.c_str(), width, height, format,
+                                      BQ_LAYER_COUNT, usage, buffer->getWidth(),
+                                      buffer->getHeight(), buffer->getPixelFormat(),
+                                      buffer->getLayerCount(), buffer->getUsage());
+            }
+        }
+        mSlots[found].mAcquireCalled = false;
+        mSlots[found].mGraphicBuffer = nullptr;
+        mSlots[found].mRequestBufferCalled = false;
+        mSlots[found].mEglDisplay = EGL_NO_DISPLAY;
         mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
         mSlots[found].mFence = Fence::NO_FENCE;
+        mCore->mBufferAge = 0;
+        mCore->mIsAllocating = true;
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+        request->allocOptions = mCore->mAdditionalOptions;
+        request->allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
+#endif
 
-        // If shared buffer mode has just been enabled, cache the slot of the
-        // first buffer that is dequeued and mark it as the shared buffer.
-        if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
-                BufferQueueCore::INVALID_BUFFER_SLOT) {
-            mCore->mSharedBufferSlot = found;
-            mSlots[found].mBufferState.mShared = true;
-        }
+        returnFlags |= BUFFER_NEEDS_REALLOCATION;
+    } else {
+        // We add 1 because that will be the frame number when this buffer
+        // is queued
+        mCore->mBufferAge = mCore->mFrameCounter + 1 - mSlots[found].mFrameNumber;
+    }
 
-        if (!(returnFlags & BUFFER_NEEDS_REALLOCATION)) {
-            callOnFrameDequeued = true;
-            bufferId = mSlots[*outSlot].mGraphicBuffer->getId();
-        }
+    BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
+            mCore->mBufferAge);
+    request->bufferAge = mCore->mBufferAge;
 
-        listener = mCore->mConsumerListener;
-    } // Autolock scope
+    if (CC_UNLIKELY(mSlots[found].mFence == nullptr)) {
+        BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
+                "slot=%d w=%d h=%d format=%u",
+                found, buffer->width, buffer->height, buffer->format);
+    }
 
-    if (returnFlags & BUFFER_NEEDS_REALLOCATION) {
-        BQ_LOGV("dequeueBuffer: allocating a new buffer for slot %d", *outSlot);
+    request->eglDisplay = mSlots[found].mEglDisplay;
+    request->eglFence = mSlots[found].mEglFence;
+    // Don't return a fence in shared buffer mode, except for the first
+    // frame.
+    request->fence = (mCore->mSharedBufferMode &&
+            mCore->mSharedBufferSlot == found) ?
+            Fence::NO_FENCE : mSlots[found].mFence;
+    mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
+    mSlots[found].mFence = Fence::NO_FENCE;
+
+    // If shared buffer mode has just been enabled, cache the slot of the
+    // first buffer that is dequeued and mark it as the shared buffer.
+    if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
+            BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mSharedBufferSlot = found;
+        mSlots[found].mBufferState.mShared = true;
+    }
 
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-        std::vector<GraphicBufferAllocator::AdditionalOptions> tempOptions;
-        tempOptions.reserve(allocOptions.size());
-        for (const auto& it : allocOptions) {
-            tempOptions.emplace_back(it.name.c_str(), it.value);
-        }
-        const GraphicBufferAllocator::AllocationRequest allocRequest = {
-                .importBuffer = true,
-                .width = width,
-                .height = height,
-                .format = format,
-                .layerCount = BQ_LAYER_COUNT,
-                .usage = usage,
-                .requestorName = {mConsumerName.c_str(), mConsumerName.size()},
-                .extras = std::move(tempOptions),
-        };
-        sp<GraphicBuffer> graphicBuffer = new GraphicBuffer(allocRequest);
-#else
-        sp<GraphicBuffer> graphicBuffer =
-                new GraphicBuffer(width, height, format, BQ_LAYER_COUNT, usage,
-                                  {mConsumerName.c_str(), mConsumerName.size()});
-#endif
+    if (!(returnFlags & BUFFER_NEEDS_REALLOCATION)) {
+        request->callOnFrameDequeued = true;
+        request->bufferId = mSlots[found].mGraphicBuffer->getId();
+    }
 
-        status_t error = graphicBuffer->initCheck();
+    return returnFlags;
+}
 
-        { // Autolock scope
-            std::lock_guard<std::mutex> lock(mCore->mMutex);
+status_t BufferQueueProducer::allocateDequeuedBuffer(DequeueRequest* request) {
+    BQ_LOGV("dequeueBuffer: allocating a new buffer for slot %d", request->slot);
 
-            if (error == NO_ERROR && !mCore->mIsAbandoned) {
-                graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
-                mSlots[*outSlot].mGraphicBuffer = graphicBuffer;
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-                mSlots[*outSlot].mAdditionalOptionsGenerationId = allocOptionsGenId;
+    std::vector<GraphicBufferAllocator::AdditionalOptions> tempOptions;
+    tempOptions.reserve(request->allocOptions.size());
+    for (const auto& it : request->allocOptions) {
+        tempOptions.emplace_back(it.name.c_str(), it.value);
+    }
+    const GraphicBufferAllocator::AllocationRequest allocRequest = {
+            .importBuffer = true,
+            .width = request->width,
+            .height = request->height,
+            .format = request->format,
+            .layerCount = BQ_LAYER_COUNT,
+            .usage = request->usage,
+            .requestorName = {mConsumerName.c_str(), mConsumerName.size()},
+            .extras = std::move(tempOptions),
+    };
+    sp<GraphicBuffer> graphicBuffer = new GraphicBuffer(allocRequest);
+#else
+    sp<GraphicBuffer> graphicBuffer =
+            new GraphicBuffer(request->width, request->height, request->format, BQ_LAYER_COUNT,
+                              request->usage, {mConsumerName.c_str(), mConsumerName.size()});
 #endif
-                callOnFrameDequeued = true;
-                bufferId = mSlots[*outSlot].mGraphicBuffer->getId();
-            }
 
-            mCore->mIsAllocating = false;
-            mCore->mIsAllocatingCondition.notify_all();
+    status_t error = graphicBuffer->initCheck();
 
-            if (error != NO_ERROR) {
-                mCore->mFreeSlots.insert(*outSlot);
-                mCore->clearBufferSlotLocked(*outSlot);
-                BQ_LOGE("dequeueBuffer: createGraphicBuffer failed");
-                return error;
-            }
-
-            if (mCore->mIsAbandoned) {
-                mCore->mFreeSlots.insert(*outSlot);
-                mCore->clearBufferSlotLocked(*outSlot);
-                BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
-                return NO_INIT;
-            }
-
-            VALIDATE_CONSISTENCY();
-        } // Autolock scope
-    }
+    std::lock_guard<std::mutex> lock(mCore->mMutex);
 
-    if (listener != nullptr && callOnFrameDequeued) {
-        listener->onFrameDequeued(bufferId);
+    if (error == NO_ERROR && !mCore->mIsAbandoned) {
+        graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
+        mSlots[request->slot].mGraphicBuffer = graphicBuffer;
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+        mSlots[request->slot].mAdditionalOptionsGenerationId = request->allocOptionsGenId;
+#endif
+        request->callOnFrameDequeued = true;
+        request->bufferId = graphicBuffer->getId();
     }
 
-    if (attachedByConsumer) {
-        returnFlags |= BUFFER_NEEDS_REALLOCATION;
-    }
+    mCore->mIsAllocating = false;
+    mCore->mIsAllocatingCondition.notify_all();
 
-    if (eglFence != EGL_NO_SYNC_KHR) {
-        EGLint result = eglClientWaitSyncKHR(eglDisplay, eglFence, 0,
-                1000000000);
-        // If something goes wrong, log the error, but return the buffer without
-        // synchronizing access to it. It's too late at this point to abort the
-        // dequeue operation.
-        if (result == EGL_FALSE) {
-            BQ_LOGE("dequeueBuffer: error %#x waiting for fence",
-                    eglGetError());
-        } else if (result == EGL_TIMEOUT_EXPIRED_KHR) {
-            BQ_LOGE("dequeueBuffer: timeout waiting for fence");
-        }
-        eglDestroySyncKHR(eglDisplay, eglFence);
+    if (error != NO_ERROR) {
+        mCore->mFreeSlots.insert(request->slot);
+        mCore->clearBufferSlotLocked(request->slot);
+        BQ_LOGE("dequeueBuffer: createGraphicBuffer failed");
+        return error;
     }
 
-    BQ_LOGV("dequeueBuffer: returning slot=%d/%" PRIu64 " buf=%p flags=%#x",
-            *outSlot,
-            mSlots[*outSlot].mFrameNumber,
-            mSlots[*outSlot].mGraphicBuffer != nullptr ?
-            mSlots[*outSlot].mGraphicBuffer->handle : nullptr, returnFlags);
-
-    if (outBufferAge) {
-        *outBufferAge = mCore->mBufferAge;
+    if (mCore->mIsAbandoned) {
+        mCore->mFreeSlots.insert(request->slot);
+        mCore->clearBufferSlotLocked(request->slot);
+        BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
     }
-    addAndGetFrameTimestamps(nullptr, outTimestamps);
 
-    return returnFlags;
+    VALIDATE_CONSISTENCY();
+    return NO_ERROR;
 }
 
 status_t BufferQueueProducer::detachBuffer(int slot) {
@@ -884,251 +1016,155 @@ status_t BufferQueueProducer::attachBuffer(int* outSlot,
     return returnFlags;
 }
 
-status_t BufferQueueProducer::queueBuffer(int slot,
-        const QueueBufferInput &input, QueueBufferOutput *output) {
-    ATRACE_CALL();
-    ATRACE_BUFFER_INDEX(slot);
+// One buffer of a queueBuffer or queueBuffers call.
+struct BufferQueueProducer::QueueRequest {
+    int slot;
+    const QueueBufferInput* input;
+    QueueBufferOutput* output;
+
+    // What queueBuffer would return for this buffer
+    status_t result = NO_ERROR;
 
+    // Deflated from input
     int64_t requestedPresentTimestamp;
     bool isAutoTimestamp;
     android_dataspace dataSpace;
-    Rect crop(Rect::EMPTY_RECT);
+    Rect crop{Rect::EMPTY_RECT};
     int scalingMode;
     uint32_t transform;
     uint32_t stickyTransform;
     sp<Fence> acquireFence;
     bool getFrameTimestamps = false;
-    input.deflate(&requestedPresentTimestamp, &isAutoTimestamp, &dataSpace,
-            &crop, &scalingMode, &transform, &acquireFence, &stickyTransform,
-            &getFrameTimestamps);
-    const Region& surfaceDamage = input.getSurfaceDamage();
-    const HdrMetadata& hdrMetadata = input.getHdrMetadata();
-
-    if (acquireFence == nullptr) {
-        BQ_LOGE("queueBuffer: fence is NULL");
-        return BAD_VALUE;
-    }
-
-    auto acquireFenceTime = std::make_shared<FenceTime>(acquireFence);
-
-    switch (scalingMode) {
-        case NATIVE_WINDOW_SCALING_MODE_FREEZE:
-        case NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW:
-        case NATIVE_WINDOW_SCALING_MODE_SCALE_CROP:
-        case NATIVE_WINDOW_SCALING_MODE_NO_SCALE_CROP:
-            break;
-        default:
-            BQ_LOGE("queueBuffer: unknown scaling mode %d", scalingMode);
-            return BAD_VALUE;
-    }
+    std::shared_ptr<FenceTime> acquireFenceTime;
 
+    // Carried from queueBufferLocked to the callbacks
+    BufferItem item;
     sp<IConsumerListener> frameAvailableListener;
     sp<IConsumerListener> frameReplacedListener;
-    int callbackTicket = 0;
-    uint64_t currentFrameNumber = 0;
-    BufferItem item;
-    int connectedApi;
-    bool enableEglCpuThrottling = true;
     sp<Fence> lastQueuedFence;
+};
 
-    { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+status_t BufferQueueProducer::queueBuffer(int slot,
+        const QueueBufferInput &input, QueueBufferOutput *output) {
+    ATRACE_CALL();
+    QueueRequest request{.slot = slot, .input = &input, .output = output};
+    queueRequests(&request, 1);
+    return request.result;
+}
 
-        if (mCore->mIsAbandoned) {
-            BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
-        }
+status_t BufferQueueProducer::queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                                           std::vector<QueueBufferOutput>* outputs) {
+    ATRACE_CALL();
+    outputs->clear();
+    outputs->resize(inputs.size());
 
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
-            BQ_LOGE("queueBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
-        }
+    std::vector<QueueRequest> requests;
+    requests.reserve(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        requests.push_back({.slot = inputs[i].slot, .input = &inputs[i], .output = &(*outputs)[i]});
+    }
+    queueRequests(requests.data(), requests.size());
 
-        if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
-            BQ_LOGE("queueBuffer: slot index %d out of range [0, %d)",
-                    slot, BufferQueueDefs::NUM_BUFFER_SLOTS);
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mBufferState.isDequeued()) {
-            BQ_LOGE("queueBuffer: slot %d is not owned by the producer "
-                    "(state = %s)", slot, mSlots[slot].mBufferState.string());
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mRequestBufferCalled) {
-            BQ_LOGE("queueBuffer: slot %d was queued without requesting "
-                    "a buffer", slot);
-            return BAD_VALUE;
-        }
+    for (size_t i = 0; i < requests.size(); i++) {
+        (*outputs)[i].result = requests[i].result;
+    }
+    return NO_ERROR;
+}
 
-        // If shared buffer mode has just been enabled, cache the slot of the
-        // first buffer that is queued and mark it as the shared buffer.
-        if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
-                BufferQueueCore::INVALID_BUFFER_SLOT) {
-            mCore->mSharedBufferSlot = slot;
-            mSlots[slot].mBufferState.mShared = true;
-        }
-
-        BQ_LOGV("queueBuffer: slot=%d/%" PRIu64 " time=%" PRIu64 " dataSpace=%d"
-                " validHdrMetadataTypes=0x%x crop=[%d,%d,%d,%d] transform=%#x scale=%s",
-                slot, mCore->mFrameCounter + 1, requestedPresentTimestamp, dataSpace,
-                hdrMetadata.validTypes, crop.left, crop.top, crop.right, crop.bottom,
-                transform,
-                BufferItem::scalingModeName(static_cast<uint32_t>(scalingMode)));
-
-        const sp<GraphicBuffer>& graphicBuffer(mSlots[slot].mGraphicBuffer);
-        Rect bufferRect(graphicBuffer->getWidth(), graphicBuffer->getHeight());
-        Rect croppedRect(Rect::EMPTY_RECT);
-        crop.intersect(bufferRect, &croppedRect);
-        if (croppedRect != crop) {
-            BQ_LOGE("queueBuffer: crop rect is not contained within the "
-                    "buffer in slot %d", slot);
-            return BAD_VALUE;
+void BufferQueueProducer::queueRequests(QueueRequest* requests, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        QueueRequest& request = requests[i];
+        ATRACE_BUFFER_INDEX(request.slot);
+
+        request.input->deflate(&request.requestedPresentTimestamp, &request.isAutoTimestamp,
+                               &request.dataSpace, &request.crop, &request.scalingMode,
+                               &request.transform, &request.acquireFence,
+                               &request.stickyTransform, &request.getFrameTimestamps);
+
+        if (request.acquireFence == nullptr) {
+            BQ_LOGE("queueBuffer: fence is NULL");
+            request.result = BAD_VALUE;
+            continue;
         }
 
-        // Override UNKNOWN dataspace with consumer default
-        if (dataSpace == HAL_DATASPACE_UNKNOWN) {
-            dataSpace = mCore->mDefaultBufferDataSpace;
-        }
-
-        mSlots[slot].mFence = acquireFence;
-        mSlots[slot].mBufferState.queue();
-
-        // Increment the frame counter and store a local version of it
-        // for use outside the lock on mCore->mMutex.
-        ++mCore->mFrameCounter;
-        currentFrameNumber = mCore->mFrameCounter;
-        mSlots[slot].mFrameNumber = currentFrameNumber;
-
-        item.mAcquireCalled = mSlots[slot].mAcquireCalled;
-        item.mGraphicBuffer = mSlots[slot].mGraphicBuffer;
-        item.mCrop = crop;
-        item.mTransform = transform &
-                ~static_cast<uint32_t>(NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
-        item.mTransformToDisplayInverse =
-                (transform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
-        item.mScalingMode = static_cast<uint32_t>(scalingMode);
-        item.mTimestamp = requestedPresentTimestamp;
-        item.mIsAutoTimestamp = isAutoTimestamp;
-        item.mDataSpace = dataSpace;
-        item.mHdrMetadata = hdrMetadata;
-        item.mFrameNumber = currentFrameNumber;
-        item.mSlot = slot;
-        item.mFence = acquireFence;
-        item.mFenceTime = acquireFenceTime;
-        item.mIsDroppable = mCore->mAsyncMode ||
-                (mConsumerIsSurfaceFlinger && mCore->mQueueBufferCanDrop) ||
-                (mCore->mLegacyBufferDrop && mCore->mQueueBufferCanDrop) ||
-                (mCore->mSharedBufferMode && mCore->mSharedBufferSlot == slot);
-        item.mSurfaceDamage = surfaceDamage;
-        item.mQueuedBuffer = true;
-        item.mAutoRefresh = mCore->mSharedBufferMode && mCore->mAutoRefresh;
-        item.mApi = mCore->mConnectedApi;
-
-        mStickyTransform = stickyTransform;
-
-        // Cache the shared buffer data so that the BufferItem can be recreated.
-        if (mCore->mSharedBufferMode) {
-            mCore->mSharedBufferCache.crop = crop;
-            mCore->mSharedBufferCache.transform = transform;
-            mCore->mSharedBufferCache.scalingMode = static_cast<uint32_t>(
-                    scalingMode);
-            mCore->mSharedBufferCache.dataspace = dataSpace;
+        request.acquireFenceTime = std::make_shared<FenceTime>(request.acquireFence);
+
+        switch (request.scalingMode) {
+            case NATIVE_WINDOW_SCALING_MODE_FREEZE:
+            case NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW:
+            case NATIVE_WINDOW_SCALING_MODE_SCALE_CROP:
+            case NATIVE_WINDOW_SCALING_MODE_NO_SCALE_CROP:
+                break;
+            default:
+                BQ_LOGE("queueBuffer: unknown scaling mode %d", request.scalingMode);
+                request.result = BAD_VALUE;
+                break;
         }
+    }
 
-        output->bufferReplaced = false;
-        if (mCore->mQueue.empty()) {
-            // When the queue is empty, we can ignore mDequeueBufferCannotBlock
-            // and simply queue this buffer
-            mCore->mQueue.push_back(item);
-            frameAvailableListener = mCore->mConsumerListener;
-        } else {
-            // When the queue is not empty, we need to look at the last buffer
-            // in the queue to see if we need to replace it
-            const BufferItem& last = mCore->mQueue.itemAt(
-                    mCore->mQueue.size() - 1);
-            if (last.mIsDroppable) {
-
-                if (!last.mIsStale) {
-                    mSlots[last.mSlot].mBufferState.freeQueued();
-
-                    // After leaving shared buffer mode, the shared buffer will
-                    // still be around. Mark it as no longer shared if this
-                    // operation causes it to be free.
-                    if (!mCore->mSharedBufferMode &&
-                            mSlots[last.mSlot].mBufferState.isFree()) {
-                        mSlots[last.mSlot].mBufferState.mShared = false;
-                    }
-                    // Don't put the shared buffer on the free list.
-                    if (!mSlots[last.mSlot].mBufferState.isShared()) {
-                        mCore->mActiveBuffers.erase(last.mSlot);
-                        mCore->mFreeBuffers.push_back(last.mSlot);
-                        output->bufferReplaced = true;
-                    }
-                }
+    // All buffers are queued under a single lock, and their callbacks are made
+    // with a single ticket, in the order that they were queued.
+    sp<IConsumerListener> listener;
+    bool queuedAny = false;
+    int callbackTicket = 0;
+    int connectedApi;
+    bool enableEglCpuThrottling = true;
 
-                // Make sure to merge the damage rect from the frame we're about
-                // to drop into the new frame's damage rect.
-                if (last.mSurfaceDamage.bounds() == Rect::INVALID_RECT ||
-                    item.mSurfaceDamage.bounds() == Rect::INVALID_RECT) {
-                    item.mSurfaceDamage = Region::INVALID_REGION;
-                } else {
-                    item.mSurfaceDamage |= last.mSurfaceDamage;
-                }
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
 
-                // Overwrite the droppable buffer with the incoming one
-                mCore->mQueue.editItemAt(mCore->mQueue.size() - 1) = item;
-                frameReplacedListener = mCore->mConsumerListener;
-            } else {
-                mCore->mQueue.push_back(item);
-                frameAvailableListener = mCore->mConsumerListener;
+        for (size_t i = 0; i < count; i++) {
+            QueueRequest& request = requests[i];
+            if (request.result != NO_ERROR) {
+                continue;
             }
+            request.result = queueBufferLocked(&request);
+            queuedAny |= request.result == NO_ERROR;
+        }
+        if (!queuedAny) {
+            return;
         }
 
-        mCore->mBufferHasBeenQueued = true;
         mCore->mDequeueCondition.notify_all();
-        mCore->mLastQueuedSlot = slot;
 
-        output->width = mCore->mDefaultWidth;
-        output->height = mCore->mDefaultHeight;
-        output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
-        output->numPendingBuffers = static_cast<uint32_t>(mCore->mQueue.size());
-        output->nextFrameNumber = mCore->mFrameCounter + 1;
-
-        ATRACE_INT(mCore->mConsumerName.c_str(), static_cast<int32_t>(mCore->mQueue.size()));
-#ifndef NO_BINDER
-        mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
-#endif
         // Take a ticket for the callback functions
         callbackTicket = mNextCallbackTicket++;
 
         VALIDATE_CONSISTENCY();
 
+        listener = mCore->mConsumerListener;
         connectedApi = mCore->mConnectedApi;
         if (flags::bq_producer_throttles_only_async_mode()) {
             enableEglCpuThrottling = mCore->mAsyncMode || mCore->mDequeueBufferCannotBlock;
         }
-        lastQueuedFence = std::move(mLastQueueBufferFence);
-
-        mLastQueueBufferFence = std::move(acquireFence);
-        mLastQueuedCrop = item.mCrop;
-        mLastQueuedTransform = item.mTransform;
     } // Autolock scope
 
-    // It is okay not to clear the GraphicBuffer when the consumer is SurfaceFlinger because
-    // it is guaranteed that the BufferQueue is inside SurfaceFlinger's process and
-    // there will be no Binder call
-    if (!mConsumerIsSurfaceFlinger) {
-        item.mGraphicBuffer.clear();
-    }
+    for (size_t i = 0; i < count; i++) {
+        QueueRequest& request = requests[i];
+        if (request.result != NO_ERROR) {
+            continue;
+        }
 
-    // Update and get FrameEventHistory.
-    nsecs_t postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
-    NewFrameEventsEntry newFrameEventsEntry = {
-        currentFrameNumber,
-        postedTime,
-        requestedPresentTimestamp,
-        std::move(acquireFenceTime)
-    };
-    addAndGetFrameTimestamps(&newFrameEventsEntry,
-            getFrameTimestamps ? &output->frameTimestamps : nullptr);
+        // It is okay not to clear the GraphicBuffer when the consumer is SurfaceFlinger because
+        // it is guaranteed that the BufferQueue is inside SurfaceFlinger's process and
+        // there will be no Binder call
+        if (!mConsumerIsSurfaceFlinger) {
+            request.item.mGraphicBuffer.clear();
+        }
+
+        // Update and get FrameEventHistory.
+        nsecs_t postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        NewFrameEventsEntry newFrameEventsEntry = {
+            request.item.mFrameNumber,
+            postedTime,
+            request.requestedPresentTimestamp,
+            std::move(request.acquireFenceTime)
+        };
+        if (listener != nullptr) {
+            listener->addAndGetFrameTimestamps(&newFrameEventsEntry,
+                    request.getFrameTimestamps ? &request.output->frameTimestamps : nullptr);
+        }
+    }
 
     // Call back without the main BufferQueue lock held, but with the callback
     // lock held so we can ensure that callbacks occur in order
@@ -1139,10 +1175,13 @@ status_t BufferQueueProducer::queueBuffer(int slot,
             mCallbackCondition.wait(lock);
         }
 
-        if (frameAvailableListener != nullptr) {
-            frameAvailableListener->onFrameAvailable(item);
-        } else if (frameReplacedListener != nullptr) {
-            frameReplacedListener->onFrameReplaced(item);
+        for (size_t i = 0; i < count; i++) {
+            QueueRequest& request = requests[i];
+            if (request.frameAvailableListener != nullptr) {
+                request.frameAvailableListener->onFrameAvailable(request.item);
+            } else if (request.frameReplacedListener != nullptr) {
+                request.frameReplacedListener->onFrameReplaced(request.item);
+            }
         }
 
         ++mCurrentCallbackTicket;
@@ -1154,9 +1193,190 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         // Waiting here allows for two full buffers to be queued but not a
         // third. In the event that frames take varying time, this makes a
         // small trade-off in favor of latency rather than throughput.
-        lastQueuedFence->waitForever("Throttling EGL Production");
+        for (size_t i = 0; i < count; i++) {
+            if (requests[i].result == NO_ERROR) {
+                requests[i].lastQueuedFence->waitForever("Throttling EGL Production");
+            }
+        }
+    }
+}
+
+status_t BufferQueueProducer::queueBufferLocked(QueueRequest* request) {
+    const int slot = request->slot;
+    const Region& surfaceDamage = request->input->getSurfaceDamage();
+    const HdrMetadata& hdrMetadata = request->input->getHdrMetadata();
+    QueueBufferOutput* output = request->output;
+    Rect& crop = request->crop;
+    BufferItem& item = request->item;
+
+    if (mCore->mIsAbandoned) {
+        BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
+    }
+
+    if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+        BQ_LOGE("queueBuffer: BufferQueue has no connected producer");
+        return NO_INIT;
+    }
+
+    if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        BQ_LOGE("queueBuffer: slot index %d out of range [0, %d)",
+                slot, BufferQueueDefs::NUM_BUFFER_SLOTS);
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mBufferState.isDequeued()) {
+        BQ_LOGE("queueBuffer: slot %d is not owned by the producer "
+                "(state = %s)", slot, mSlots[slot].mBufferState.string());
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mRequestBufferCalled) {
+        BQ_LOGE("queueBuffer: slot %d was queued without requesting "
+                "a buffer", slot);
+        return BAD_VALUE;
+    }
+
+    // If shared buffer mode has just been enabled, cache the slot of the
+    // first buffer that is queued and mark it as the shared buffer.
+    if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
+            BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mSharedBufferSlot = slot;
+        mSlots[slot].mBufferState.mShared = true;
     }
 
+    BQ_LOGV("queueBuffer: slot=%d/%" PRIu64 " time=%" PRIu64 " dataSpace=%d"
+            " validHdrMetadataTypes=0x%x crop=[%d,%d,%d,%d] transform=%#x scale=%s",
+            slot, mCore->mFrameCounter + 1, request->requestedPresentTimestamp,
+            request->dataSpace, hdrMetadata.validTypes, crop.left, crop.top, crop.right,
+            crop.bottom, request->transform,
+            BufferItem::scalingModeName(static_cast<uint32_t>(request->scalingMode)));
+
+    const sp<GraphicBuffer>& graphicBuffer(mSlots[slot].mGraphicBuffer);
+    Rect bufferRect(graphicBuffer->getWidth(), graphicBuffer->getHeight());
+    Rect croppedRect(Rect::EMPTY_RECT);
+    crop.intersect(bufferRect, &croppedRect);
+    if (croppedRect != crop) {
+        BQ_LOGE("queueBuffer: crop rect is not contained within the "
+                "buffer in slot %d", slot);
+        return BAD_VALUE;
+    }
+
+    // Override UNKNOWN dataspace with consumer default
+    if (request->dataSpace == HAL_DATASPACE_UNKNOWN) {
+        request->dataSpace = mCore->mDefaultBufferDataSpace;
+    }
+
+    mSlots[slot].mFence = request->acquireFence;
+    mSlots[slot].mBufferState.queue();
+
+    // Increment the frame counter and store a local version of it
+    // for use outside the lock on mCore->mMutex.
+    ++mCore->mFrameCounter;
+    uint64_t currentFrameNumber = mCore->mFrameCounter;
+    mSlots[slot].mFrameNumber = currentFrameNumber;
+
+    item.mAcquireCalled = mSlots[slot].mAcquireCalled;
+    item.mGraphicBuffer = mSlots[slot].mGraphicBuffer;
+    item.mCrop = crop;
+    item.mTransform = request->transform &
+            ~static_cast<uint32_t>(NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
+    item.mTransformToDisplayInverse =
+            (request->transform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
+    item.mScalingMode = static_cast<uint32_t>(request->scalingMode);
+    item.mTimestamp = request->requestedPresentTimestamp;
+    item.mIsAutoTimestamp = request->isAutoTimestamp;
+    item.mDataSpace = request->dataSpace;
+    item.mHdrMetadata = hdrMetadata;
+    item.mFrameNumber = currentFrameNumber;
+    item.mSlot = slot;
+    item.mFence = request->acquireFence;
+    item.mFenceTime = request->acquireFenceTime;
+    item.mIsDroppable = mCore->mAsyncMode ||
+            (mConsumerIsSurfaceFlinger && mCore->mQueueBufferCanDrop) ||
+            (mCore->mLegacyBufferDrop && mCore->mQueueBufferCanDrop) ||
+            (mCore->mSharedBufferMode && mCore->mSharedBufferSlot == slot);
+    item.mSurfaceDamage = surfaceDamage;
+    item.mQueuedBuffer = true;
+    item.mAutoRefresh = mCore->mSharedBufferMode && mCore->mAutoRefresh;
+    item.mApi = mCore->mConnectedApi;
+
+    mStickyTransform = request->stickyTransform;
+
+    // Cache the shared buffer data so that the BufferItem can be recreated.
+    if (mCore->mSharedBufferMode) {
+        mCore->mSharedBufferCache.crop = crop;
+        mCore->mSharedBufferCache.transform = request->transform;
+        mCore->mSharedBufferCache.scalingMode = static_cast<uint32_t>(
+                request->scalingMode);
+        mCore->mSharedBufferCache.dataspace = request->dataSpace;
+    }
+
+    output->bufferReplaced = false;
+    if (mCore->mQueue.empty()) {
+        // When the queue is empty, we can ignore mDequeueBufferCannotBlock
+        // and simply queue this buffer
+        mCore->mQueue.push_back(item);
+        request->frameAvailableListener = mCore->mConsumerListener;
+    } else {
+        // When the queue is not empty, we need to look at the last buffer
+        // in the queue to see if we need to replace it
+        const BufferItem& last = mCore->mQueue.itemAt(
+                mCore->mQueue.size() - 1);
+        if (last.mIsDroppable) {
+
+            if (!last.mIsStale) {
+                mSlots[last.mSlot].mBufferState.freeQueued();
+
+                // After leaving shared buffer mode, the shared buffer will
+                // still be around. Mark it as no longer shared if this
+                // operation causes it to be free.
+                if (!mCore->mSharedBufferMode &&
+                        mSlots[last.mSlot].mBufferState.isFree()) {
+                    mSlots[last.mSlot].mBufferState.mShared = false;
+                }
+                // Don't put the shared buffer on the free list.
+                if (!mSlots[last.mSlot].mBufferState.isShared()) {
+                    mCore->mActiveBuffers.erase(last.mSlot);
+                    mCore->mFreeBuffers.push_back(last.mSlot);
+                    output->bufferReplaced = true;
+                }
+            }
+
+            // Make sure to merge the damage rect from the frame we're about
+            // to drop into the new frame's damage rect.
+            if (last.mSurfaceDamage.bounds() == Rect::INVALID_RECT ||
+                item.mSurfaceDamage.bounds() == Rect::INVALID_RECT) {
+                item.mSurfaceDamage = Region::INVALID_REGION;
+            } else {
+                item.mSurfaceDamage |= last.mSurfaceDamage;
+            }
+
+            // Overwrite the droppable buffer with the incoming one
+            mCore->mQueue.editItemAt(mCore->mQueue.size() - 1) = item;
+            request->frameReplacedListener = mCore->mConsumerListener;
+        } else {
+            mCore->mQueue.push_back(item);
+            request->frameAvailableListener = mCore->mConsumerListener;
+        }
+    }
+
+    mCore->mBufferHasBeenQueued = true;
+    mCore->mLastQueuedSlot = slot;
+
+    output->width = mCore->mDefaultWidth;
+    output->height = mCore->mDefaultHeight;
+    output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
+    output->numPendingBuffers = static_cast<uint32_t>(mCore->mQueue.size());
+    output->nextFrameNumber = mCore->mFrameCounter + 1;
+
+    ATRACE_INT(mCore->mConsumerName.c_str(), static_cast<int32_t>(mCore->mQueue.size()));
+#ifndef NO_BINDER
+    mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+#endif
+
+    request->lastQueuedFence = std::move(mLastQueueBufferFence);
+
+    mLastQueueBufferFence = request->acquireFence;
+    mLastQueuedCrop = item.mCrop;
+    mLastQueuedTransform = item.mTransform;
+
     return NO_ERROR;
 }
 
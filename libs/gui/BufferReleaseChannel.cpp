@@ -17,9 +17,13 @@
 #define LOG_TAG "BufferReleaseChannel"
 
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/uio.h>
 
+#include <atomic>
+
 #include <android-base/result.h>
 #include <android/binder_status.h>
 #include <binder/Parcel.h>
@@ -67,6 +71,75 @@ static inline constexpr T to64(const uint32_t lo, const uint32_t hi) {
     return static_cast<T>(static_cast<uint64_t>(hi) << 32 | lo);
 }
 
+// Single byte datagram sent to wake up a consumer waiting on the socket after a release was
+// written to the ring. Real messages are always larger than this.
+constexpr uint8_t kWakeupMessage = 0xff;
+
+// A producer gives up on the ring and falls back to the socket after this many failed attempts to
+// claim a slot. Slots are normally only contended if several producers share the ring.
+constexpr int kMaxRingPushAttempts = 8;
+
+} // namespace
+
+// Bounded ring of release messages that carry no fence. Each slot has a sequence number that tells
+// producers and the consumer whose turn it is to use the slot, so the ring stays correct even if a
+// client parcels its producer endpoint to more than one writer. The memory is shared between
+// processes, so only lock-free atomics are used.
+struct BufferReleaseChannel::Ring {
+    static constexpr uint32_t kCapacity = 64;
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        uint32_t maxAcquiredBufferCount;
+        uint64_t bufferId;
+        uint64_t framenumber;
+    };
+
+    alignas(64) std::atomic<uint32_t> enqueuePosition;
+    // Set by the consumer before it goes to sleep on the socket. The producer clears it and sends
+    // kWakeupMessage after publishing a slot.
+    alignas(64) std::atomic<uint32_t> consumerWaiting;
+    alignas(64) Slot slots[kCapacity];
+
+    Ring() : enqueuePosition(0), consumerWaiting(1) {
+        for (uint32_t i = 0; i < kCapacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+void BufferReleaseChannel::RingDeleter::operator()(Ring* ring) const {
+    munmap(ring, sizeof(Ring));
+}
+
+namespace {
+
+// Maps a release ring. The producer maps memory created by another process, so it only accepts
+// file descriptors that are large enough and sealed against shrinking; otherwise a client could
+// truncate the file and fault the producer.
+void* mapRing(int fd, size_t size, bool verify) {
+    if (verify) {
+        struct stat stat;
+        if (fstat(fd, &stat) != 0 || stat.st_size < static_cast<off_t>(size)) {
+            ALOGE("Release ring has an invalid size, ignoring it");
+            return nullptr;
+        }
+        int seals = fcntl(fd, F_GET_SEALS);
+        if (seals == -1 || (seals & F_SEAL_SHRINK) == 0) {
+            ALOGE("Release ring is not sealed, ignoring it");
+            return nullptr;
+        }
+    }
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ALOGE("Failed to map release ring. errno=%d message='%s'", errno, strerror(errno));
+        return nullptr;
+    }
+    return addr;
+}
+
 } // namespace
 
 size_t BufferReleaseChannel::Message::getPodSize() const {
@@ -136,6 +209,54 @@ status_t BufferReleaseChannel::Message::unflatten(void const*& buffer, size_t& s
 status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
         ReleaseCallbackId& outReleaseCallbackId, sp<Fence>& outReleaseFence,
         uint32_t& outMaxAcquiredBufferCount) {
+    while (true) {
+        if (popFromRing(outReleaseCallbackId, outMaxAcquiredBufferCount)) {
+            outReleaseFence = Fence::NO_FENCE;
+            return OK;
+        }
+
+        bool wakeup = false;
+        status_t status = readFromSocket(outReleaseCallbackId, outReleaseFence,
+                                         outMaxAcquiredBufferCount, wakeup);
+        if (status == OK && wakeup) {
+            continue;
+        }
+        if (status != WOULD_BLOCK || !mRing) {
+            return status;
+        }
+
+        // Ask the producer for a wakeup before going to sleep, then check the ring again in case
+        // a release was published before the producer could see the request.
+        mRing->consumerWaiting.store(1, std::memory_order_seq_cst);
+        if (popFromRing(outReleaseCallbackId, outMaxAcquiredBufferCount)) {
+            outReleaseFence = Fence::NO_FENCE;
+            return OK;
+        }
+        return WOULD_BLOCK;
+    }
+}
+
+bool BufferReleaseChannel::ConsumerEndpoint::popFromRing(ReleaseCallbackId& outReleaseCallbackId,
+                                                         uint32_t& outMaxAcquiredBufferCount) {
+    if (!mRing) {
+        return false;
+    }
+    Ring::Slot& slot = mRing->slots[mDequeuePosition & (Ring::kCapacity - 1)];
+    const uint32_t sequence = slot.sequence.load(std::memory_order_seq_cst);
+    if (sequence != mDequeuePosition + 1) {
+        return false;
+    }
+    outReleaseCallbackId.bufferId = static_cast<int64_t>(slot.bufferId);
+    outReleaseCallbackId.framenumber = slot.framenumber;
+    outMaxAcquiredBufferCount = slot.maxAcquiredBufferCount;
+    slot.sequence.store(mDequeuePosition + Ring::kCapacity, std::memory_order_release);
+    mDequeuePosition++;
+    return true;
+}
+
+status_t BufferReleaseChannel::ConsumerEndpoint::readFromSocket(
+        ReleaseCallbackId& outReleaseCallbackId, sp<Fence>& outReleaseFence,
+        uint32_t& outMaxAcquiredBufferCount, bool& outWakeup) {
     Message message;
     mFlattenedBuffer.resize(message.getFlattenedSize());
     std::array<uint8_t, CMSG_SPACE(sizeof(int))> controlMessageBuffer;
@@ -164,6 +285,11 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
         return UNKNOWN_ERROR;
     }
 
+    if (result == sizeof(kWakeupMessage)) {
+        outWakeup = true;
+        return OK;
+    }
+
     if (msg.msg_iovlen != 1) {
         ALOGE("Error reading release fence from socket: bad data length");
         return UNKNOWN_ERROR;
@@ -199,9 +325,60 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
     return OK;
 }
 
-int BufferReleaseChannel::ProducerEndpoint::writeReleaseFence(const ReleaseCallbackId& callbackId,
-                                                              const sp<Fence>& fence,
-                                                              uint32_t maxAcquiredBufferCount) {
+status_t BufferReleaseChannel::ProducerEndpoint::writeReleaseFence(
+        const ReleaseCallbackId& callbackId, const sp<Fence>& fence,
+        uint32_t maxAcquiredBufferCount) {
+    // Fence file descriptors can only be passed over the socket.
+    if (!(fence && fence->isValid()) && pushToRing(callbackId, maxAcquiredBufferCount)) {
+        if (mRing->consumerWaiting.exchange(0, std::memory_order_seq_cst)) {
+            wakeConsumer();
+        }
+        return OK;
+    }
+    return writeToSocket(callbackId, fence, maxAcquiredBufferCount);
+}
+
+bool BufferReleaseChannel::ProducerEndpoint::pushToRing(const ReleaseCallbackId& callbackId,
+                                                        uint32_t maxAcquiredBufferCount) {
+    if (!mRing) {
+        return false;
+    }
+    for (int attempt = 0; attempt < kMaxRingPushAttempts; attempt++) {
+        uint32_t position = mRing->enqueuePosition.load(std::memory_order_relaxed);
+        Ring::Slot& slot = mRing->slots[position & (Ring::kCapacity - 1)];
+        const int32_t diff =
+                static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - position);
+        if (diff < 0) {
+            // The consumer hasn't drained this slot yet, so the ring is full.
+            return false;
+        }
+        if (diff > 0 ||
+            !mRing->enqueuePosition.compare_exchange_weak(position, position + 1,
+                                                          std::memory_order_relaxed)) {
+            continue;
+        }
+        slot.bufferId = static_cast<uint64_t>(callbackId.bufferId);
+        slot.framenumber = callbackId.framenumber;
+        slot.maxAcquiredBufferCount = maxAcquiredBufferCount;
+        slot.sequence.store(position + 1, std::memory_order_seq_cst);
+        return true;
+    }
+    return false;
+}
+
+void BufferReleaseChannel::ProducerEndpoint::wakeConsumer() {
+    int result;
+    do {
+        result = send(mFd, &kWakeupMessage, sizeof(kWakeupMessage), 0);
+    } while (result == -1 && errno == EINTR);
+    if (result == -1) {
+        ALOGD("Error writing wakeup to socket: error %#x (%s)", errno, strerror(errno));
+    }
+}
+
+status_t BufferReleaseChannel::ProducerEndpoint::writeToSocket(const ReleaseCallbackId& callbackId,
+                                                               const sp<Fence>& fence,
+                                                               uint32_t maxAcquiredBufferCount) {
     Message message{callbackId, fence ? fence : Fence::NO_FENCE, maxAcquiredBufferCount};
     mFlattenedBuffer.resize(message.getFlattenedSize());
     int flattenedFd;
@@ -258,6 +435,18 @@ status_t BufferReleaseChannel::ProducerEndpoint::readFromParcel(const android::P
     if (!parcel) return STATUS_BAD_VALUE;
     SAFE_PARCEL(parcel->readUtf8FromUtf16, &mName);
     SAFE_PARCEL(parcel->readUniqueFileDescriptor, &mFd);
+    bool hasRing;
+    SAFE_PARCEL(parcel->readBool, &hasRing);
+    mRing.reset();
+    mRingFd.reset();
+    if (hasRing) {
+        // Only the mapping is kept, so that each endpoint costs the receiver a single fd. An
+        // endpoint parcelled again from here sends no ring, and its releases use the socket.
+        android::base::unique_fd ringFd;
+        SAFE_PARCEL(parcel->readUniqueFileDescriptor, &ringFd);
+        // A ring that can't be used safely is not fatal, releases just go over the socket.
+        mRing.reset(static_cast<Ring*>(mapRing(ringFd.get(), sizeof(Ring), true /* verify */)));
+    }
     return STATUS_OK;
 }
 
@@ -265,6 +454,41 @@ status_t BufferReleaseChannel::ProducerEndpoint::writeToParcel(android::Parcel*
     if (!parcel) return STATUS_BAD_VALUE;
     SAFE_PARCEL(parcel->writeUtf8AsUtf16, mName);
     SAFE_PARCEL(parcel->writeUniqueFileDescriptor, mFd);
+    SAFE_PARCEL(parcel->writeBool, mRingFd.ok());
+    if (mRingFd.ok()) {
+        SAFE_PARCEL(parcel->writeUniqueFileDescriptor, mRingFd);
+    }
+    return STATUS_OK;
+}
+
+status_t BufferReleaseChannel::createRing(const std::string& name,
+                                          android::base::unique_fd& outFd,
+                                          RingPtr& outConsumerRing, RingPtr& outProducerRing) {
+    // The file is sealed so the producer can map it without trusting us not to shrink it.
+    outFd.reset(memfd_create(("BufferReleaseChannel " + name).c_str(),
+                             MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!outFd.ok()) {
+        ALOGW("[%s] Failed to create release ring, using the socket only. errno=%d message='%s'",
+              name.c_str(), errno, strerror(errno));
+        return -errno;
+    }
+    if (ftruncate(outFd.get(), sizeof(Ring)) == -1 ||
+        fcntl(outFd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1) {
+        ALOGW("[%s] Failed to size and seal release ring, using the socket only. errno=%d "
+              "message='%s'",
+              name.c_str(), errno, strerror(errno));
+        return -errno;
+    }
+    void* consumerRingAddr = mapRing(outFd.get(), sizeof(Ring), false /* verify */);
+    if (!consumerRingAddr) {
+        return NO_MEMORY;
+    }
+    outConsumerRing.reset(new (consumerRingAddr) Ring());
+    outProducerRing.reset(
+            static_cast<Ring*>(mapRing(outFd.get(), sizeof(Ring), false /* verify */)));
+    if (!outProducerRing) {
+        return NO_MEMORY;
+    }
     return STATUS_OK;
 }
 
@@ -350,8 +574,21 @@ status_t BufferReleaseChannel::open(std::string name,
         return -errno;
     }
 
-    outConsumer = std::make_unique<ConsumerEndpoint>(name, std::move(consumerFd));
-    outProducer = std::make_shared<ProducerEndpoint>(std::move(name), std::move(producerFd));
+    // Create the release ring. The ring only saves socket writes, so if it can't be created the
+    // channel works without it and every release goes over the socket.
+    android::base::unique_fd ringFd;
+    RingPtr consumerRing;
+    RingPtr producerRing;
+    if (createRing(name, ringFd, consumerRing, producerRing) != STATUS_OK) {
+        ringFd.reset();
+        consumerRing.reset();
+        producerRing.reset();
+    }
+
+    outConsumer = std::make_unique<ConsumerEndpoint>(name, std::move(consumerFd),
+                                                     std::move(consumerRing));
+    outProducer = std::make_shared<ProducerEndpoint>(std::move(name), std::move(producerFd),
+                                                     std::move(ringFd), std::move(producerRing));
     return STATUS_OK;
 }
 
@@ -104,7 +104,8 @@ Choreographer* Choreographer::getForThread() {
 }
 
 Choreographer::Choreographer(const sp<Looper>& looper, const sp<IBinder>& layerHandle)
-      : DisplayEventDispatcher(looper, gui::ISurfaceComposer::VsyncSource::eVsyncSourceApp, {},
+      : DisplayEventDispatcher(looper, gui::ISurfaceComposer::VsyncSource::eVsyncSourceApp,
+                               gui::ISurfaceComposer::EventRegistration::sharedVsyncChannel,
                                layerHandle),
         mLooper(looper),
         mThreadId(std::this_thread::get_id()) {
@@ -63,6 +63,15 @@ status_t DisplayEventDispatcher::initialize() {
         if (rc < 0) {
             return UNKNOWN_ERROR;
         }
+        // Vsync events may arrive through a shared memory channel with its own wakeup fd. Both
+        // fds drain through the same processPendingEvents().
+        if (mReceiver.getVsyncFd() >= 0) {
+            rc = mLooper->addFd(mReceiver.getVsyncFd(), 0, Looper::EVENT_INPUT, this, NULL);
+            if (rc < 0) {
+                mLooper->removeFd(mReceiver.getFd());
+                return UNKNOWN_ERROR;
+            }
+        }
     }
 
     return OK;
@@ -73,6 +82,9 @@ void DisplayEventDispatcher::dispose() {
 
     if (!mReceiver.initCheck() && mLooper != nullptr) {
         mLooper->removeFd(mReceiver.getFd());
+        if (mReceiver.getVsyncFd() >= 0) {
+            mLooper->removeFd(mReceiver.getVsyncFd());
+        }
     }
 }
 
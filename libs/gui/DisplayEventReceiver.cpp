@@ -18,6 +18,8 @@
 
 #include <string.h>
 
+#include <algorithm>
+
 #include <utils/Errors.h>
 
 #include <gui/DisplayEventReceiver.h>
@@ -26,6 +28,7 @@
 #include <private/gui/ComposerServiceAIDL.h>
 
 #include <private/gui/BitTube.h>
+#include <private/gui/VsyncEventChannel.h>
 
 // ---------------------------------------------------------------------------
 
@@ -53,6 +56,9 @@ DisplayEventReceiver::DisplayEventReceiver(gui::ISurfaceComposer::VsyncSource vs
                 mInitError = std::make_optional<status_t>(status.transactionError());
                 mDataChannel.reset();
                 mEventConnection.clear();
+            } else if (eventRegistration.test(
+                               gui::ISurfaceComposer::EventRegistration::sharedVsyncChannel)) {
+                initVsyncChannel();
             }
         } else {
             ALOGE("DisplayEventConnection creation failed: status=%s", status.toString8().c_str());
@@ -63,6 +69,25 @@ DisplayEventReceiver::DisplayEventReceiver(gui::ISurfaceComposer::VsyncSource vs
 DisplayEventReceiver::~DisplayEventReceiver() {
 }
 
+void DisplayEventReceiver::initVsyncChannel() {
+    auto vsyncChannel = std::make_unique<gui::VsyncEventChannel>();
+    binder::Status status = mEventConnection->getVsyncEventChannel(vsyncChannel.get());
+    if (!status.isOk()) {
+        // SurfaceFlinger may already be publishing vsync events to a channel we failed to
+        // receive, so the connection can't be trusted to deliver them anymore.
+        ALOGE("getVsyncEventChannel failed: %s", status.toString8().c_str());
+        mInitError = std::make_optional<status_t>(status.transactionError());
+        mDataChannel.reset();
+        mEventConnection.clear();
+        return;
+    }
+    if (vsyncChannel->initCheck() == NO_ERROR) {
+        mVsyncChannel = std::move(vsyncChannel);
+    } else {
+        ALOGW("Shared vsync channel unavailable, vsync events will use the event channel");
+    }
+}
+
 status_t DisplayEventReceiver::initCheck() const {
     if (mDataChannel != nullptr)
         return NO_ERROR;
@@ -75,6 +100,10 @@ int DisplayEventReceiver::getFd() const {
     return mDataChannel->getFd();
 }
 
+int DisplayEventReceiver::getVsyncFd() const {
+    return mVsyncChannel != nullptr ? mVsyncChannel->getFd() : -1;
+}
+
 status_t DisplayEventReceiver::setVsyncRate(uint32_t count) {
     if (int32_t(count) < 0)
         return BAD_VALUE;
@@ -109,7 +138,23 @@ status_t DisplayEventReceiver::getLatestVsyncEventData(
 
 ssize_t DisplayEventReceiver::getEvents(DisplayEventReceiver::Event* events,
         size_t count) {
-    return DisplayEventReceiver::getEvents(mDataChannel.get(), events, count);
+    ssize_t size = DisplayEventReceiver::getEvents(mDataChannel.get(), events, count);
+    if (size < 0 || mVsyncChannel == nullptr) {
+        return size;
+    }
+    mEventsReceived += static_cast<uint64_t>(size);
+
+    uint64_t eventsBefore;
+    if (static_cast<size_t>(size) < count &&
+        mVsyncChannel->consume(&events[size], mEventsReceived, &eventsBefore)) {
+        // Move the vsync event behind the events that were sent before it, and ahead of the ones
+        // that were sent after it.
+        const uint64_t firstEvent = mEventsReceived - static_cast<uint64_t>(size);
+        const size_t position = eventsBefore > firstEvent ? eventsBefore - firstEvent : 0;
+        std::rotate(events + position, events + size, events + size + 1);
+        size++;
+    }
+    return size;
 }
 
 ssize_t DisplayEventReceiver::getEvents(gui::BitTube* dataChannel,
@@ -38,7 +38,8 @@ enum class Tag : uint32_t {
     ON_RELEASE_BUFFER,
     ON_TRANSACTION_QUEUE_STALLED,
     ON_TRUSTED_PRESENTATION_CHANGED,
-    LAST = ON_TRUSTED_PRESENTATION_CHANGED,
+    ON_BUFFER_CACHE_FULL,
+    LAST = ON_BUFFER_CACHE_FULL,
 };
 
 } // Anonymous namespace
@@ -296,6 +297,11 @@ public:
         callRemoteAsync<decltype(&ITransactionCompletedListener::onTrustedPresentationChanged)>(
                 Tag::ON_TRUSTED_PRESENTATION_CHANGED, id, inTrustedPresentationState);
     }
+
+    void onBufferCacheFull() override {
+        callRemoteAsync<decltype(&ITransactionCompletedListener::onBufferCacheFull)>(
+                Tag::ON_BUFFER_CACHE_FULL);
+    }
 };
 
 // Out-of-line virtual method definitions to trigger vtable emission in this translation unit (see
@@ -322,6 +328,8 @@ status_t BnTransactionCompletedListener::onTransact(uint32_t code, const Parcel&
         case Tag::ON_TRUSTED_PRESENTATION_CHANGED:
             return callLocalAsync(data, reply,
                                   &ITransactionCompletedListener::onTrustedPresentationChanged);
+        case Tag::ON_BUFFER_CACHE_FULL:
+            return callLocalAsync(data, reply, &ITransactionCompletedListener::onBufferCacheFull);
     }
 }
 
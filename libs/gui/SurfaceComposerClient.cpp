@@ -60,12 +60,10 @@
 #include <android-base/thread_annotations.h>
 #include <gui/LayerStatePermissions.h>
 #include <gui/ScreenCaptureResults.h>
+#include <private/gui/BufferCache.h>
 #include <private/gui/ComposerService.h>
 #include <private/gui/ComposerServiceAIDL.h>
 
-// This server size should always be smaller than the server cache size
-#define BUFFER_CACHE_MAX_SIZE 4096
-
 namespace android {
 
 using aidl::android::hardware::graphics::common::DisplayDecorationSupport;
@@ -713,109 +711,23 @@ void TransactionCompletedListener::onTrustedPresentationChanged(int id,
 
 // ---------------------------------------------------------------------------
 
-void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId);
-
-/**
- * We use the BufferCache to reduce the overhead of exchanging GraphicBuffers with
- * the server. If we were to simply parcel the GraphicBuffer we would pay two overheads
- *     1. Cost of sending the FD
- *     2. Cost of importing the GraphicBuffer with the mapper in the receiving process.
- * To ease this cost we implement the following scheme of caching buffers to integers,
- * or said-otherwise, naming them with integers. This is the scheme known as slots in
- * the legacy BufferQueue system.
- *     1. When sending Buffers to SurfaceFlinger we look up the Buffer in the cache.
- *     2. If there is a cache-hit we remove the Buffer from the Transaction and instead
- *        send the cached integer.
- *     3. If there is a cache miss, we cache the new buffer and send the integer
- *        along with the Buffer, SurfaceFlinger on it's side creates a new cache
- *        entry, and we use the integer for further communication.
- * A few details about lifetime:
- *     1. The cache evicts by LRU. The server side cache is keyed by BufferCache::getToken
- *        which is per process Unique. The server side cache is larger than the client side
- *        cache so that the server will never evict entries before the client.
- *     2. When the client evicts an entry it notifies the server via an uncacheBuffer
- *        transaction.
- *     3. The client only references the Buffers by ID, and uses buffer->addDeathCallback
- *        to auto-evict destroyed buffers.
- */
-class BufferCache : public Singleton<BufferCache> {
-public:
-    BufferCache() : token(new BBinder()) {}
-
-    sp<IBinder> getToken() {
-        return IInterface::asBinder(TransactionCompletedListener::getIInstance());
-    }
-
-    status_t getCacheId(const sp<GraphicBuffer>& buffer, uint64_t* cacheId) {
-        std::lock_guard<std::mutex> lock(mMutex);
-
-        auto itr = mBuffers.find(buffer->getId());
-        if (itr == mBuffers.end()) {
-            return BAD_VALUE;
-        }
-        itr->second = getCounter();
-        *cacheId = buffer->getId();
-        return NO_ERROR;
-    }
-
-    uint64_t cache(const sp<GraphicBuffer>& buffer,
-                   std::optional<client_cache_t>& outUncacheBuffer) {
-        std::lock_guard<std::mutex> lock(mMutex);
-
-        if (mBuffers.size() >= BUFFER_CACHE_MAX_SIZE) {
-            outUncacheBuffer = findLeastRecentlyUsedBuffer();
-            mBuffers.erase(outUncacheBuffer->id);
-        }
-
-        buffer->addDeathCallback(removeDeadBufferCallback, nullptr);
-
-        mBuffers[buffer->getId()] = getCounter();
-        return buffer->getId();
-    }
-
-    void uncache(uint64_t cacheId) {
-        std::lock_guard<std::mutex> lock(mMutex);
-        if (mBuffers.erase(cacheId)) {
-            SurfaceComposerClient::doUncacheBufferTransaction(cacheId);
-        }
-    }
-
-private:
-    client_cache_t findLeastRecentlyUsedBuffer() REQUIRES(mMutex) {
-        auto itr = mBuffers.begin();
-        uint64_t minCounter = itr->second;
-        auto minBuffer = itr;
-        itr++;
-
-        while (itr != mBuffers.end()) {
-            uint64_t counter = itr->second;
-            if (counter < minCounter) {
-                minCounter = counter;
-                minBuffer = itr;
-            }
-            itr++;
-        }
-
-        return {.token = getToken(), .id = minBuffer->first};
-    }
-
-    uint64_t getCounter() REQUIRES(mMutex) {
-        static uint64_t counter = 0;
-        return counter++;
-    }
-
-    std::mutex mMutex;
-    std::map<uint64_t /*Cache id*/, uint64_t /*counter*/> mBuffers GUARDED_BY(mMutex);
+namespace {
 
-    // Used by ISurfaceComposer to identify which process is sending the cached buffer.
-    sp<IBinder> token;
-};
+// The BufferCache of this process, see BufferCache.h. It is never destroyed, since buffers can
+// outlive any object that owns it.
+BufferCache& getBufferCache() {
+    static BufferCache* bufferCache = new BufferCache(
+            []() { return IInterface::asBinder(TransactionCompletedListener::getIInstance()); },
+            [](const std::vector<client_cache_t>& uncacheBuffers) {
+                SurfaceComposerClient::doUncacheBufferTransaction(uncacheBuffers);
+            });
+    return *bufferCache;
+}
 
-ANDROID_SINGLETON_STATIC_INSTANCE(BufferCache);
+} // namespace
 
-void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId) {
-    // GraphicBuffer id's are used as the cache ids.
-    BufferCache::getInstance().uncache(graphicBufferId);
+void TransactionCompletedListener::onBufferCacheFull() {
+    getBufferCache().onServerCacheFull();
 }
 
 // ---------------------------------------------------------------------------
@@ -1162,18 +1074,16 @@ std::vector<uint64_t> SurfaceComposerClient::Transaction::getMergedTransactionId
     return mMergedTransactionIds;
 }
 
-void SurfaceComposerClient::doUncacheBufferTransaction(uint64_t cacheId) {
+void SurfaceComposerClient::doUncacheBufferTransaction(
+        const std::vector<client_cache_t>& uncacheBuffers) {
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
 
-    client_cache_t uncacheBuffer;
-    uncacheBuffer.token = BufferCache::getInstance().getToken();
-    uncacheBuffer.id = cacheId;
     Vector<ComposerState> composerStates;
     Vector<DisplayState> displayStates;
     status_t status = sf->setTransactionState(FrameTimelineInfo{}, composerStates, displayStates,
                                               ISurfaceComposer::eOneWay,
                                               Transaction::getDefaultApplyToken(), {}, systemTime(),
-                                              true, {uncacheBuffer}, false, {}, generateId(), {});
+                                              true, uncacheBuffers, false, {}, generateId(), {});
     if (status != NO_ERROR) {
         ALOGE_AND_TRACE("SurfaceComposerClient::doUncacheBufferTransaction - %s",
                         strerror(-status));
@@ -1186,6 +1096,7 @@ void SurfaceComposerClient::Transaction::cacheBuffers() {
     }
 
     size_t count = 0;
+    const size_t maxCacheSize = getBufferCache().getMaxSize();
     for (auto& [handle, cs] : mComposerStates) {
         layer_state_t* s = &(mComposerStates[handle].state);
         if (!(s->what & layer_state_t::eBufferChanged)) {
@@ -1205,26 +1116,26 @@ void SurfaceComposerClient::Transaction::cacheBuffers() {
         }
 
         uint64_t cacheId = 0;
-        status_t ret = BufferCache::getInstance().getCacheId(s->bufferData->buffer, &cacheId);
+        status_t ret = getBufferCache().getCacheId(s->bufferData->buffer, &cacheId);
         if (ret == NO_ERROR) {
             // Cache-hit. Strip the buffer and send only the id.
             s->bufferData->buffer = nullptr;
         } else {
             // Cache-miss. Include the buffer and send the new cacheId.
             std::optional<client_cache_t> uncacheBuffer;
-            cacheId = BufferCache::getInstance().cache(s->bufferData->buffer, uncacheBuffer);
+            cacheId = getBufferCache().cache(s->bufferData->buffer, uncacheBuffer);
             if (uncacheBuffer) {
                 mUncacheBuffers.push_back(*uncacheBuffer);
             }
         }
         s->bufferData->flags |= BufferData::BufferDataChange::cachedBufferChanged;
-        s->bufferData->cachedBuffer.token = BufferCache::getInstance().getToken();
+        s->bufferData->cachedBuffer.token = getBufferCache().getToken();
         s->bufferData->cachedBuffer.id = cacheId;
 
         // If we have more buffers than the size of the cache, we should stop caching so we don't
         // evict other buffers in this transaction
         count++;
-        if (count >= BUFFER_CACHE_MAX_SIZE) {
+        if (count >= maxCacheSize) {
             break;
         }
     }
@@ -1311,6 +1222,9 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
     }
 
     cacheBuffers();
+    // Piggyback uncaches for destroyed buffers on this transaction rather than sending them on
+    // their own. This is only done on apply, since a parceled transaction may never be applied.
+    getBufferCache().takePendingUncacheBuffers(mUncacheBuffers);
 
     Vector<ComposerState> composerStates;
     Vector<DisplayState> displayStates;
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VsyncEventChannel"
+
+#include <private/gui/VsyncEventChannel.h>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+
+#include <binder/Parcel.h>
+#include <gui/DisplayEventReceiver.h>
+#include <log/log.h>
+#include <private/gui/ParcelUtils.h>
+
+namespace android::gui {
+
+struct VsyncEventChannel::SharedState {
+    static constexpr size_t kEventWords = kEventSize / sizeof(uint64_t);
+
+    // Odd while the publisher is writing the event.
+    std::atomic<uint32_t> sequence;
+    // Number of events sent over the BitTube before this one.
+    std::atomic<uint64_t> eventsBefore;
+    // The event is copied word by word so that a reader racing with the publisher only ever sees
+    // whole words, which it then discards because the sequence changed.
+    std::atomic<uint64_t> event[kEventWords];
+};
+
+static_assert(sizeof(DisplayEventReceiver::Event) == VsyncEventChannel::kEventSize);
+static_assert(VsyncEventChannel::kEventSize % sizeof(uint64_t) == 0);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+VsyncEventChannel::~VsyncEventChannel() {
+    unmap();
+}
+
+std::unique_ptr<VsyncEventChannel> VsyncEventChannel::create() {
+    auto channel = std::make_unique<VsyncEventChannel>();
+    channel->mMemoryFd.reset(memfd_create("VsyncEventChannel", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!channel->mMemoryFd.ok()) {
+        ALOGE("Failed to create vsync event page. errno=%d message='%s'", errno, strerror(errno));
+        return nullptr;
+    }
+    if (ftruncate(channel->mMemoryFd.get(), sizeof(SharedState)) == -1 ||
+        fcntl(channel->mMemoryFd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) == -1) {
+        ALOGE("Failed to size and seal vsync event page. errno=%d message='%s'", errno,
+              strerror(errno));
+        return nullptr;
+    }
+    if (channel->map(true /* writable */) != NO_ERROR) {
+        return nullptr;
+    }
+    // Receivers can only map the page read-only from here on. Older kernels don't support this
+    // seal; a receiver that writes to the page then only corrupts its own events.
+    fcntl(channel->mMemoryFd.get(), F_ADD_SEALS, F_SEAL_FUTURE_WRITE);
+    fcntl(channel->mMemoryFd.get(), F_ADD_SEALS, F_SEAL_SEAL);
+
+    channel->mEventFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (!channel->mEventFd.ok()) {
+        ALOGE("Failed to create vsync eventfd. errno=%d message='%s'", errno, strerror(errno));
+        return nullptr;
+    }
+    return channel;
+}
+
+status_t VsyncEventChannel::initCheck() const {
+    return mState != nullptr && mEventFd.ok() ? NO_ERROR : NO_INIT;
+}
+
+int VsyncEventChannel::getFd() const {
+    return mEventFd.get();
+}
+
+status_t VsyncEventChannel::publishEvent(const void* event, uint64_t eventsBefore) {
+    if (mState == nullptr || !mWritable) {
+        return NO_INIT;
+    }
+
+    uint64_t words[SharedState::kEventWords];
+    std::memcpy(words, event, sizeof(words));
+
+    mState->sequence.store(++mSequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mState->eventsBefore.store(eventsBefore, std::memory_order_relaxed);
+    for (size_t i = 0; i < SharedState::kEventWords; i++) {
+        mState->event[i].store(words[i], std::memory_order_relaxed);
+    }
+    mState->sequence.store(++mSequence, std::memory_order_release);
+
+    if (eventfd_write(mEventFd.get(), 1) == -1) {
+        return -errno;
+    }
+    return NO_ERROR;
+}
+
+bool VsyncEventChannel::consumeEvent(void* outEvent, uint64_t eventsReceived,
+                                     uint64_t* outEventsBefore) {
+    if (mState == nullptr) {
+        return false;
+    }
+
+    // Drain the wakeup before reading the page, so a publish that lands after the read below
+    // signals the eventfd again.
+    eventfd_t count;
+    eventfd_read(mEventFd.get(), &count);
+
+    const uint32_t sequence = mState->sequence.load(std::memory_order_acquire);
+    if (sequence == mSequence || (sequence & 1) != 0) {
+        return false;
+    }
+    const uint64_t eventsBefore = mState->eventsBefore.load(std::memory_order_relaxed);
+    uint64_t words[SharedState::kEventWords];
+    for (size_t i = 0; i < SharedState::kEventWords; i++) {
+        words[i] = mState->event[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (mState->sequence.load(std::memory_order_relaxed) != sequence) {
+        return false;
+    }
+    // The BitTube events sent first are still queued, and wake up the receiver on their own. No
+    // need to signal the eventfd again.
+    if (eventsBefore > eventsReceived) {
+        return false;
+    }
+
+    std::memcpy(outEvent, words, sizeof(words));
+    *outEventsBefore = eventsBefore;
+    mSequence = sequence;
+    return true;
+}
+
+status_t VsyncEventChannel::duplicateFds(VsyncEventChannel* outChannel) const {
+    if (initCheck() != NO_ERROR) {
+        return NO_INIT;
+    }
+    base::unique_fd memoryFd(fcntl(mMemoryFd.get(), F_DUPFD_CLOEXEC, 0));
+    base::unique_fd eventFd(fcntl(mEventFd.get(), F_DUPFD_CLOEXEC, 0));
+    if (!memoryFd.ok() || !eventFd.ok()) {
+        ALOGE("Failed to duplicate vsync event channel. errno=%d message='%s'", errno,
+              strerror(errno));
+        return -errno;
+    }
+    outChannel->unmap();
+    outChannel->mMemoryFd = std::move(memoryFd);
+    outChannel->mEventFd = std::move(eventFd);
+    return NO_ERROR;
+}
+
+status_t VsyncEventChannel::writeToParcel(Parcel* parcel) const {
+    if (!parcel) return STATUS_BAD_VALUE;
+    const bool valid = mMemoryFd.ok() && mEventFd.ok();
+    SAFE_PARCEL(parcel->writeBool, valid);
+    if (valid) {
+        SAFE_PARCEL(parcel->writeUniqueFileDescriptor, mMemoryFd);
+        SAFE_PARCEL(parcel->writeUniqueFileDescriptor, mEventFd);
+    }
+    return STATUS_OK;
+}
+
+status_t VsyncEventChannel::readFromParcel(const Parcel* parcel) {
+    if (!parcel) return STATUS_BAD_VALUE;
+    unmap();
+    mMemoryFd.reset();
+    mEventFd.reset();
+    mSequence = 0;
+
+    bool valid;
+    SAFE_PARCEL(parcel->readBool, &valid);
+    if (!valid) {
+        return STATUS_OK;
+    }
+    SAFE_PARCEL(parcel->readUniqueFileDescriptor, &mMemoryFd);
+    SAFE_PARCEL(parcel->readUniqueFileDescriptor, &mEventFd);
+    return map(false /* writable */);
+}
+
+status_t VsyncEventChannel::map(bool writable) {
+    if (!writable) {
+        // The receiver maps memory created by another process, so it only accepts a page that is
+        // large enough and sealed against shrinking.
+        struct stat stat;
+        if (fstat(mMemoryFd.get(), &stat) != 0 ||
+            stat.st_size < static_cast<off_t>(sizeof(SharedState))) {
+            ALOGE("Vsync event page has an invalid size");
+            return BAD_VALUE;
+        }
+        const int seals = fcntl(mMemoryFd.get(), F_GET_SEALS);
+        if (seals == -1 || (seals & F_SEAL_SHRINK) == 0) {
+            ALOGE("Vsync event page is not sealed");
+            return BAD_VALUE;
+        }
+    }
+    const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* addr = mmap(nullptr, sizeof(SharedState), prot, MAP_SHARED, mMemoryFd.get(), 0);
+    if (addr == MAP_FAILED) {
+        ALOGE("Failed to map vsync event page. errno=%d message='%s'", errno, strerror(errno));
+        return NO_MEMORY;
+    }
+    mState = writable ? new (addr) SharedState() : static_cast<SharedState*>(addr);
+    mWritable = writable;
+    return NO_ERROR;
+}
+
+void VsyncEventChannel::unmap() {
+    if (mState != nullptr) {
+        munmap(mState, sizeof(SharedState));
+        mState = nullptr;
+        mWritable = false;
+    }
+}
+
+} // namespace android::gui
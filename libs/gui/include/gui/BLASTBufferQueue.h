@@ -323,7 +323,8 @@ private:
         BufferReleaseReader(std::unique_ptr<gui::BufferReleaseChannel::ConsumerEndpoint>);
         BufferReleaseReader& operator=(BufferReleaseReader&&);
 
-        // Block until we can read a buffer release message.
+        // Block until we can read a buffer release message. Returns immediately if a message is
+        // already available.
         //
         // Returns:
         // * OK if a ReleaseCallbackId and Fence were successfully read.
@@ -332,6 +333,10 @@ private:
         status_t readBlocking(ReleaseCallbackId& outId, sp<Fence>& outReleaseFence,
                               uint32_t& outMaxAcquiredBufferCount);
 
+        // Read a buffer release message if one is available. Returns WOULD_BLOCK otherwise.
+        status_t readNonBlocking(ReleaseCallbackId& outId, sp<Fence>& outReleaseFence,
+                                 uint32_t& outMaxAcquiredBufferCount);
+
         // Signals the reader's eventfd to wake up any threads waiting on readBlocking.
         void interruptBlockingRead();
 
@@ -347,6 +352,16 @@ private:
     std::shared_ptr<BufferReleaseReader> mBufferReleaseReader;
     std::shared_ptr<gui::BufferReleaseChannel::ProducerEndpoint> mBufferReleaseProducer;
 
+    struct BufferRelease {
+        ReleaseCallbackId callbackId;
+        sp<Fence> releaseFence;
+        uint32_t maxAcquiredBufferCount;
+    };
+
+    // Processes a batch of releases read from the BufferReleaseChannel under a single acquisition
+    // of mMutex.
+    void releaseBufferCallbacks(const std::vector<BufferRelease>& releases);
+
     class BufferReleaseThread {
     public:
         BufferReleaseThread() = default;
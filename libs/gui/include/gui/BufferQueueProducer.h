@@ -47,6 +47,11 @@ public:
     // flags indicating that previously-returned buffers are no longer valid.
     virtual status_t requestBuffer(int slot, sp<GraphicBuffer>* buf);
 
+    // See IGraphicBufferProducer::requestBuffers. Unlike the default implementation, all slots
+    // are looked up under a single lock.
+    virtual status_t requestBuffers(const std::vector<int32_t>& slots,
+                                    std::vector<RequestBufferOutput>* outputs) override;
+
     // see IGraphicsBufferProducer::setMaxDequeuedBufferCount
     virtual status_t setMaxDequeuedBufferCount(int maxDequeuedBuffers);
 
@@ -93,6 +98,11 @@ public:
                                    uint64_t* outBufferAge,
                                    FrameEventHistoryDelta* outTimestamps) override;
 
+    // See IGraphicBufferProducer::dequeueBuffers. Unlike the default implementation, buffers
+    // which don't have to be allocated are dequeued under a single lock.
+    virtual status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                    std::vector<DequeueBufferOutput>* outputs) override;
+
     // See IGraphicBufferProducer::detachBuffer
     virtual status_t detachBuffer(int slot);
 
@@ -121,6 +131,11 @@ public:
     virtual status_t queueBuffer(int slot,
             const QueueBufferInput& input, QueueBufferOutput* output);
 
+    // See IGraphicBufferProducer::queueBuffers. Unlike the default implementation, all buffers
+    // are queued under a single lock, and the consumer is called back for all of them at once.
+    virtual status_t queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                                  std::vector<QueueBufferOutput>* outputs) override;
+
     // cancelBuffer returns a dequeued buffer to the BufferQueue, but doesn't
     // queue it for use by the consumer.
     //
@@ -245,6 +260,17 @@ private:
     status_t waitForFreeSlotThenRelock(FreeSlotCaller caller, std::unique_lock<std::mutex>& lock,
             int* found) const;
 
+    // Shared by the single and batched versions of requestBuffer, dequeueBuffer
+    // and queueBuffer, see BufferQueueProducer.cpp.
+    status_t requestBufferLocked(int slot, sp<GraphicBuffer>* buf);
+    struct DequeueRequest;
+    struct QueueRequest;
+    void dequeueRequests(DequeueRequest* requests, size_t count);
+    status_t dequeueBufferLocked(std::unique_lock<std::mutex>& lock, DequeueRequest* request);
+    status_t allocateDequeuedBuffer(DequeueRequest* request);
+    void queueRequests(QueueRequest* requests, size_t count);
+    status_t queueBufferLocked(QueueRequest* request);
+
     sp<BufferQueueCore> mCore;
 
     // This references mCore->mSlots. Lock mCore->mMutex while accessing.
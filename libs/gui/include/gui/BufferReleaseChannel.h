@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -30,9 +31,26 @@ namespace android::gui {
 
 /**
  * IPC wrapper to pass release fences from SurfaceFlinger to apps via a local unix domain socket.
+ *
+ * Releases that don't carry a fence are written to a small ring buffer in shared memory instead of
+ * being sent over the socket. The socket is then only used to pass fence file descriptors, to
+ * overflow a full ring, and to wake up a consumer that is waiting for a release. If the ring can't
+ * be created, e.g. without memfd_create, every release goes over the socket.
  */
 class BufferReleaseChannel {
 private:
+    // Shared memory layout of the release ring. Defined in BufferReleaseChannel.cpp.
+    struct Ring;
+    struct RingDeleter {
+        void operator()(Ring* ring) const;
+    };
+    using RingPtr = std::unique_ptr<Ring, RingDeleter>;
+
+    // Creates the release ring and maps it for both endpoints. On failure, open() makes a channel
+    // without a ring.
+    static status_t createRing(const std::string& name, android::base::unique_fd& outFd,
+                               RingPtr& outConsumerRing, RingPtr& outProducerRing);
+
     class Endpoint {
     public:
         Endpoint(std::string name, android::base::unique_fd fd)
@@ -50,41 +68,66 @@ private:
     protected:
         std::string mName;
         android::base::unique_fd mFd;
+        RingPtr mRing;
     };
 
 public:
     class ConsumerEndpoint : public Endpoint {
     public:
-        ConsumerEndpoint(std::string name, android::base::unique_fd fd)
-              : Endpoint(std::move(name), std::move(fd)) {}
+        ConsumerEndpoint(std::string name, android::base::unique_fd fd, RingPtr ring = nullptr)
+              : Endpoint(std::move(name), std::move(fd)) {
+            mRing = std::move(ring);
+        }
 
         /**
-         * Reads a release fence from the BufferReleaseChannel.
+         * Reads a release fence from the BufferReleaseChannel. Releases in the shared ring are
+         * returned before messages waiting on the socket.
          *
          * Returns OK on success.
-         * Returns WOULD_BLOCK if there is no fence present.
+         * Returns WOULD_BLOCK if there is no fence present. The producer will then make the
+         * socket readable when the next release is written.
          * Other errors probably indicate that the channel is broken.
          */
         status_t readReleaseFence(ReleaseCallbackId& outReleaseCallbackId,
                                   sp<Fence>& outReleaseFence, uint32_t& maxAcquiredBufferCount);
 
     private:
+        bool popFromRing(ReleaseCallbackId& outReleaseCallbackId,
+                         uint32_t& outMaxAcquiredBufferCount);
+        status_t readFromSocket(ReleaseCallbackId& outReleaseCallbackId,
+                                sp<Fence>& outReleaseFence, uint32_t& outMaxAcquiredBufferCount,
+                                bool& outWakeup);
+
         std::vector<uint8_t> mFlattenedBuffer;
+        uint32_t mDequeuePosition = 0;
     };
 
     class ProducerEndpoint : public Endpoint, public Parcelable {
     public:
-        ProducerEndpoint(std::string name, android::base::unique_fd fd)
-              : Endpoint(std::move(name), std::move(fd)) {}
+        ProducerEndpoint(std::string name, android::base::unique_fd fd,
+                         android::base::unique_fd ringFd = {}, RingPtr ring = nullptr)
+              : Endpoint(std::move(name), std::move(fd)), mRingFd(std::move(ringFd)) {
+            mRing = std::move(ring);
+        }
         ProducerEndpoint() {}
 
         status_t readFromParcel(const android::Parcel* parcel) override;
         status_t writeToParcel(android::Parcel* parcel) const override;
 
+        /**
+         * Writes a release to the BufferReleaseChannel. Releases without a valid fence go through
+         * the shared ring when it has room; everything else is sent over the socket.
+         */
         status_t writeReleaseFence(const ReleaseCallbackId&, const sp<Fence>& releaseFence,
                                    uint32_t maxAcquiredBufferCount);
 
     private:
+        bool pushToRing(const ReleaseCallbackId&, uint32_t maxAcquiredBufferCount);
+        status_t writeToSocket(const ReleaseCallbackId&, const sp<Fence>& releaseFence,
+                               uint32_t maxAcquiredBufferCount);
+        void wakeConsumer();
+
+        android::base::unique_fd mRingFd;
         std::vector<uint8_t> mFlattenedBuffer;
     };
 
@@ -46,6 +46,7 @@ using gui::VsyncEventData;
 
 namespace gui {
 class BitTube;
+class VsyncEventChannel;
 } // namespace gui
 
 static inline constexpr uint32_t fourcc(char c1, char c2, char c3, char c4) {
@@ -153,9 +154,22 @@ public:
      */
     int getFd() const;
 
+    /*
+     * getVsyncFd returns the file descriptor that becomes readable when a vsync
+     * event arrives through the shared memory channel, or -1 if vsync events
+     * are delivered on getFd(). The channel is used when the receiver was
+     * created with EventRegistration::sharedVsyncChannel.
+     * OWNERSHIP IS RETAINED by DisplayEventReceiver. DO NOT CLOSE this
+     * file-descriptor.
+     */
+    int getVsyncFd() const;
+
     /*
      * getEvents reads events from the queue and returns how many events were
      * read. Returns 0 if there are no more events or a negative error code.
+     * The latest vsync event from the shared memory channel, if any, is
+     * returned in the order it was sent in relative to the events read from
+     * the queue.
      * If NOT_ENOUGH_DATA is returned, the object has become invalid forever, it
      * should be destroyed and getEvents() shouldn't be called again.
      */
@@ -189,8 +203,13 @@ public:
     status_t getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) const;
 
 private:
+    void initVsyncChannel();
+
     sp<IDisplayEventConnection> mEventConnection;
     std::unique_ptr<gui::BitTube> mDataChannel;
+    std::unique_ptr<gui::VsyncEventChannel> mVsyncChannel;
+    // Events read from mDataChannel, used to order the events of mVsyncChannel.
+    uint64_t mEventsReceived = 0;
     std::optional<status_t> mInitError;
 };
 
@@ -177,6 +177,10 @@ public:
     virtual void onTransactionQueueStalled(const String8& name) = 0;
 
     virtual void onTrustedPresentationChanged(int id, bool inTrustedPresentationState) = 0;
+
+    // Called when SurfaceFlinger could not cache a buffer because its buffer cache for the
+    // client process is full.
+    virtual void onBufferCacheFull() = 0;
 };
 
 class BnTransactionCompletedListener : public SafeBnInterface<ITransactionCompletedListener> {
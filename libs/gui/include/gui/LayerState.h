@@ -227,6 +227,8 @@ struct layer_state_t {
     layer_state_t();
 
     void merge(const layer_state_t& other);
+    // Only the fields of the changes in `what` are parceled. read() leaves the other fields
+    // untouched, so it should be called on a default constructed layer_state_t.
     status_t write(Parcel& output) const;
     status_t read(const Parcel& input);
     // Compares two layer_state_t structs and returns a set of change flags describing all the
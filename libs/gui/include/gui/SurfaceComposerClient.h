@@ -257,10 +257,10 @@ public:
     static int getGpuContextPriority();
 
     /**
-     * Uncaches a buffer in ISurfaceComposer. It must be uncached via a transaction so that it is
+     * Uncaches buffers in ISurfaceComposer. They must be uncached via a transaction so that it is
      * in order with other transactions that use buffers.
      */
-    static void doUncacheBufferTransaction(uint64_t cacheId);
+    static void doUncacheBufferTransaction(const std::vector<client_cache_t>& uncacheBuffers);
 
     // Queries whether a given display is wide color display.
     static status_t isWideColorDisplay(const sp<IBinder>& display, bool* outIsWideColorDisplay);
@@ -1047,6 +1047,8 @@ public:
 
     void onTrustedPresentationChanged(int id, bool presentedWithinThresholds) override;
 
+    void onBufferCacheFull() override;
+
 private:
     ReleaseBufferCallback popReleaseBufferCallbackLocked(const ReleaseCallbackId&) REQUIRES(mMutex);
     static sp<TransactionCompletedListener> sInstance;
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <gui/LayerState.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+/**
+ * We use the BufferCache to reduce the overhead of exchanging GraphicBuffers with
+ * the server. If we were to simply parcel the GraphicBuffer we would pay two overheads
+ *     1. Cost of sending the FD
+ *     2. Cost of importing the GraphicBuffer with the mapper in the receiving process.
+ * To ease this cost we implement the following scheme of caching buffers to integers,
+ * or said-otherwise, naming them with integers. This is the scheme known as slots in
+ * the legacy BufferQueue system.
+ *     1. When sending Buffers to SurfaceFlinger we look up the Buffer in the cache.
+ *     2. If there is a cache-hit we remove the Buffer from the Transaction and instead
+ *        send the cached integer.
+ *     3. If there is a cache miss, we cache the new buffer and send the integer
+ *        along with the Buffer, SurfaceFlinger on it's side creates a new cache
+ *        entry, and we use the integer for further communication.
+ * A few details about lifetime:
+ *     1. The cache evicts by LRU. The server side cache is keyed by the token, which is per
+ *        process Unique. The server side cache is larger than the client side cache so that
+ *        the server will never evict entries before the client.
+ *     2. When the client evicts an entry it notifies the server via the uncacheBuffers of the
+ *        transaction that caused the eviction.
+ *     3. The client only references the Buffers by ID, and uses buffer->addDeathCallback
+ *        to auto-evict destroyed buffers. Uncaching destroyed buffers is deferred to the next
+ *        applied transaction, or to a standalone uncache transaction if none is applied within
+ *        UNCACHE_FLUSH_DELAY or more than MAX_PENDING_UNCACHE_BUFFERS are waiting. The cache
+ *        never holds more than SERVER_CACHE_SIZE - MAX_PENDING_UNCACHE_BUFFERS buffers so
+ *        pending uncaches can't overflow the server side cache.
+ *     4. If the server reports that its cache for this process is full anyway, for example
+ *        because a transaction carrying uncaches was never applied, the client flushes its
+ *        pending uncaches and shrinks its capacity. The capacity then grows back by one entry for
+ *        every eviction.
+ *
+ * SurfaceComposerClient keeps one BufferCache per process.
+ */
+class BufferCache {
+public:
+    // This size should always be smaller than the server cache size
+    static constexpr size_t SERVER_CACHE_SIZE = 4096;
+    // Number of uncaches for destroyed buffers that may be deferred to a later transaction.
+    static constexpr size_t MAX_PENDING_UNCACHE_BUFFERS = 32;
+    static constexpr size_t MAX_CACHE_SIZE = SERVER_CACHE_SIZE - MAX_PENDING_UNCACHE_BUFFERS;
+    static constexpr size_t MIN_CACHE_SIZE = 64;
+    // How long to wait for a transaction to carry deferred uncaches before sending them on their
+    // own.
+    static constexpr std::chrono::milliseconds UNCACHE_FLUSH_DELAY{100};
+
+    // Returns the token that identifies this process to the server.
+    using TokenFunction = std::function<sp<IBinder>()>;
+    // Sends uncaches to the server in a transaction of their own.
+    using UncacheFunction = std::function<void(const std::vector<client_cache_t>&)>;
+
+    BufferCache(TokenFunction getToken, UncacheFunction doUncache);
+    ~BufferCache();
+
+    sp<IBinder> getToken() const { return mGetToken(); }
+
+    // Looks up a cached buffer and marks it as the most recently used.
+    status_t getCacheId(const sp<GraphicBuffer>& buffer, uint64_t* cacheId);
+
+    // Caches a buffer, evicting the least recently used one into outUncacheBuffer if the cache is
+    // full.
+    uint64_t cache(const sp<GraphicBuffer>& buffer,
+                   std::optional<client_cache_t>& outUncacheBuffer);
+
+    // Removes a destroyed buffer, deferring the uncache.
+    void uncache(uint64_t cacheId);
+
+    // Moves the deferred uncaches into a transaction that is about to be applied.
+    void takePendingUncacheBuffers(std::vector<client_cache_t>& outUncacheBuffers);
+
+    // Called when the server rejected a buffer because its cache for this process is full.
+    void onServerCacheFull();
+
+    size_t getMaxSize();
+
+private:
+    static void onBufferDestroyed(void* context, uint64_t graphicBufferId);
+
+    void startFlushThreadLocked() REQUIRES(mMutex);
+    void flushThreadMain();
+
+    const TokenFunction mGetToken;
+    const UncacheFunction mDoUncache;
+
+    std::mutex mMutex;
+    // Most recently used buffer ids at the front.
+    std::list<uint64_t> mLru GUARDED_BY(mMutex);
+    std::unordered_map<uint64_t /*Cache id*/, std::list<uint64_t>::iterator> mBuffers
+            GUARDED_BY(mMutex);
+    size_t mMaxSize GUARDED_BY(mMutex) = MAX_CACHE_SIZE;
+
+    std::vector<client_cache_t> mPendingUncacheBuffers GUARDED_BY(mMutex);
+    std::condition_variable mUncachePending;
+    std::thread mFlushThread GUARDED_BY(mMutex);
+    bool mStopping GUARDED_BY(mMutex) = false;
+};
+
+} // namespace android
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+#include <android-base/unique_fd.h>
+#include <binder/Parcelable.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+class Parcel;
+
+namespace gui {
+
+/*
+ * Delivers vsync events to a DisplayEventReceiver through shared memory instead of a BitTube.
+ *
+ * The publisher stores the latest vsync event in a small shared page guarded by a sequence
+ * counter and signals an eventfd. The receiver polls the eventfd and copies the event out of the
+ * page. Only the most recent event is kept, which is all DisplayEventDispatcher looks at anyway.
+ *
+ * Other events keep going over the BitTube. Each vsync event records how many of those were sent
+ * ahead of it, so the receiver can put it back in the order it was sent in.
+ *
+ * Events are DisplayEventReceiver::Event. Like BitTube, this class only sees them as fixed-size
+ * blobs, since the AIDL code DisplayEventReceiver.h depends on includes this header.
+ */
+class VsyncEventChannel : public Parcelable {
+public:
+    // sizeof(DisplayEventReceiver::Event)
+    static constexpr size_t kEventSize = 216;
+
+    // creates an uninitialized VsyncEventChannel (to unparcel into)
+    VsyncEventChannel() = default;
+    ~VsyncEventChannel() override;
+
+    VsyncEventChannel(const VsyncEventChannel&) = delete;
+    VsyncEventChannel& operator=(const VsyncEventChannel&) = delete;
+
+    // creates the publishing end of a channel, or nullptr if it could not be allocated
+    static std::unique_ptr<VsyncEventChannel> create();
+
+    // check state after construction or unparceling
+    status_t initCheck() const;
+
+    // get the eventfd that becomes readable when a new event is published
+    int getFd() const;
+
+    // Stores event as the latest vsync event and wakes up the receiver. eventsBefore is the number
+    // of events sent over the BitTube before this one. Only valid on the publishing end, and only
+    // from one thread at a time.
+    template <typename T>
+    status_t publish(const T& event, uint64_t eventsBefore) {
+        static_assert(sizeof(T) == kEventSize && std::is_trivially_copyable_v<T>);
+        return publishEvent(&event, eventsBefore);
+    }
+
+    // Copies the latest event into outEvent if one was published since the last call, and sets
+    // outEventsBefore to the number of BitTube events sent before it. Returns false if there is
+    // nothing new, or if a publish is in flight; the publisher signals the eventfd again once it
+    // is done. Also returns false, and keeps the event for a later call, while fewer than
+    // eventsBefore events were received from the BitTube; those are already queued there.
+    template <typename T>
+    bool consume(T* outEvent, uint64_t eventsReceived, uint64_t* outEventsBefore) {
+        static_assert(sizeof(T) == kEventSize && std::is_trivially_copyable_v<T>);
+        return consumeEvent(outEvent, eventsReceived, outEventsBefore);
+    }
+
+    // Gives outChannel copies of the file descriptors a receiver needs. outChannel is only meant
+    // to be parcelled; the receiver maps the page when it reads the parcel.
+    status_t duplicateFds(VsyncEventChannel* outChannel) const;
+
+    // implement the Parcelable protocol. An uninitialized channel is parcelled as empty.
+    status_t writeToParcel(Parcel* parcel) const override;
+    status_t readFromParcel(const Parcel* parcel) override;
+
+private:
+    // Shared memory layout. Defined in VsyncEventChannel.cpp.
+    struct SharedState;
+
+    status_t publishEvent(const void* event, uint64_t eventsBefore);
+    bool consumeEvent(void* outEvent, uint64_t eventsReceived, uint64_t* outEventsBefore);
+
+    status_t map(bool writable);
+    void unmap();
+
+    base::unique_fd mMemoryFd;
+    base::unique_fd mEventFd;
+    SharedState* mState = nullptr;
+    bool mWritable = false;
+    // On the publishing end, the sequence of the last publish. On the receiving end, the sequence
+    // of the last consumed event. Never read back from shared memory by the publisher.
+    uint32_t mSequence = 0;
+};
+
+} // namespace gui
+} // namespace android
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <binder/Binder.h>
+#include <gtest/gtest.h>
+#include <private/gui/BufferCache.h>
+
+namespace android {
+
+using namespace std::chrono_literals;
+
+class BufferCacheTest : public testing::Test {
+protected:
+    // Buffers are never allocated, the cache only looks at their ids.
+    static std::vector<sp<GraphicBuffer>> makeBuffers(size_t count) {
+        std::vector<sp<GraphicBuffer>> buffers;
+        for (size_t i = 0; i < count; i++) {
+            buffers.push_back(sp<GraphicBuffer>::make());
+        }
+        return buffers;
+    }
+
+    // Caches every buffer, none of which may evict another.
+    void cacheAll(const std::vector<sp<GraphicBuffer>>& buffers) {
+        for (const sp<GraphicBuffer>& buffer : buffers) {
+            std::optional<client_cache_t> uncacheBuffer;
+            ASSERT_EQ(buffer->getId(), mCache.cache(buffer, uncacheBuffer));
+            ASSERT_FALSE(uncacheBuffer);
+        }
+    }
+
+    static std::vector<uint64_t> idsOf(const std::vector<client_cache_t>& uncacheBuffers) {
+        std::vector<uint64_t> ids;
+        for (const client_cache_t& uncacheBuffer : uncacheBuffers) {
+            ids.push_back(uncacheBuffer.id);
+        }
+        return ids;
+    }
+
+    // Waits for the cache to send uncaches on its own, and returns them.
+    std::optional<std::vector<uint64_t>> waitForUncacheTransaction(
+            std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mUncached.wait_for(lock, timeout, [this] { return !mUncacheTransactions.empty(); })) {
+            return std::nullopt;
+        }
+        std::vector<uint64_t> ids = idsOf(mUncacheTransactions.front());
+        mUncacheTransactions.erase(mUncacheTransactions.begin());
+        return ids;
+    }
+
+    void onUncacheTransaction(const std::vector<client_cache_t>& uncacheBuffers) {
+        for (const client_cache_t& uncacheBuffer : uncacheBuffers) {
+            EXPECT_EQ(mToken, uncacheBuffer.token.promote());
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUncacheTransactions.push_back(uncacheBuffers);
+        mUncached.notify_all();
+    }
+
+    const sp<IBinder> mToken = sp<BBinder>::make();
+    std::mutex mMutex;
+    std::condition_variable mUncached;
+    std::vector<std::vector<client_cache_t>> mUncacheTransactions;
+
+    // Destroyed first, so that the flush thread is gone before the members it uses.
+    BufferCache mCache{[this] { return mToken; },
+                       [this](const std::vector<client_cache_t>& uncacheBuffers) {
+                           onUncacheTransaction(uncacheBuffers);
+                       }};
+};
+
+TEST_F(BufferCacheTest, EvictsLeastRecentlyUsed) {
+    std::vector<sp<GraphicBuffer>> buffers = makeBuffers(BufferCache::MAX_CACHE_SIZE);
+    ASSERT_NO_FATAL_FAILURE(cacheAll(buffers));
+
+    // a hit makes the oldest buffer the most recently used
+    uint64_t cacheId;
+    ASSERT_EQ(NO_ERROR, mCache.getCacheId(buffers[0], &cacheId));
+    EXPECT_EQ(buffers[0]->getId(), cacheId);
+
+    for (size_t evicted : {1, 2, 3}) {
+        std::optional<client_cache_t> uncacheBuffer;
+        sp<GraphicBuffer> buffer = sp<GraphicBuffer>::make();
+        mCache.cache(buffer, uncacheBuffer);
+        buffers.push_back(buffer);
+
+        ASSERT_TRUE(uncacheBuffer);
+        EXPECT_EQ(buffers[evicted]->getId(), uncacheBuffer->id);
+        EXPECT_EQ(mToken, uncacheBuffer->token.promote());
+        EXPECT_EQ(BAD_VALUE, mCache.getCacheId(buffers[evicted], &cacheId));
+    }
+    EXPECT_EQ(NO_ERROR, mCache.getCacheId(buffers[0], &cacheId));
+    EXPECT_EQ(BufferCache::MAX_CACHE_SIZE, mCache.getMaxSize());
+}
+
+TEST_F(BufferCacheTest, TransactionCarriesUncachesOfDestroyedBuffers) {
+    std::vector<sp<GraphicBuffer>> buffers = makeBuffers(2);
+    ASSERT_NO_FATAL_FAILURE(cacheAll(buffers));
+    const uint64_t destroyedId = buffers[1]->getId();
+    buffers.pop_back();
+
+    std::vector<client_cache_t> uncacheBuffers;
+    mCache.takePendingUncacheBuffers(uncacheBuffers);
+    EXPECT_EQ(std::vector<uint64_t>{destroyedId}, idsOf(uncacheBuffers));
+
+    // nothing is left for the flush thread
+    EXPECT_FALSE(waitForUncacheTransaction(2 * BufferCache::UNCACHE_FLUSH_DELAY));
+}
+
+TEST_F(BufferCacheTest, FlushesUncachesByCount) {
+    std::vector<sp<GraphicBuffer>> buffers =
+            makeBuffers(BufferCache::MAX_PENDING_UNCACHE_BUFFERS + 1);
+    ASSERT_NO_FATAL_FAILURE(cacheAll(buffers));
+
+    std::vector<uint64_t> destroyedIds;
+    for (size_t i = 0; i < BufferCache::MAX_PENDING_UNCACHE_BUFFERS; i++) {
+        destroyedIds.push_back(buffers.back()->getId());
+        buffers.pop_back();
+    }
+
+    // the last one is sent right away, by the thread that destroyed the buffer
+    std::lock_guard<std::mutex> lock(mMutex);
+    ASSERT_EQ(1u, mUncacheTransactions.size());
+    EXPECT_EQ(destroyedIds, idsOf(mUncacheTransactions[0]));
+}
+
+TEST_F(BufferCacheTest, FlushesUncachesAfterDelay) {
+    std::vector<sp<GraphicBuffer>> buffers = makeBuffers(2);
+    ASSERT_NO_FATAL_FAILURE(cacheAll(buffers));
+    const uint64_t destroyedId = buffers[1]->getId();
+    const auto destroyTime = std::chrono::steady_clock::now();
+    buffers.pop_back();
+
+    std::optional<std::vector<uint64_t>> uncached = waitForUncacheTransaction(5s);
+    ASSERT_TRUE(uncached);
+    EXPECT_GE(std::chrono::steady_clock::now() - destroyTime, BufferCache::UNCACHE_FLUSH_DELAY);
+    EXPECT_EQ(std::vector<uint64_t>{destroyedId}, *uncached);
+
+    std::vector<client_cache_t> uncacheBuffers;
+    mCache.takePendingUncacheBuffers(uncacheBuffers);
+    EXPECT_TRUE(uncacheBuffers.empty());
+}
+
+TEST_F(BufferCacheTest, ShrinksWhenServerCacheIsFull) {
+    std::vector<sp<GraphicBuffer>> buffers = makeBuffers(200);
+    ASSERT_NO_FATAL_FAILURE(cacheAll(buffers));
+
+    const std::vector<uint64_t> destroyedIds = {buffers[20]->getId(), buffers[10]->getId()};
+    buffers.erase(buffers.begin() + 20);
+    buffers.erase(buffers.begin() + 10);
+
+    // the pending uncaches go out first, followed by the least recently used buffers
+    const size_t expectedMaxSize = buffers.size() * 3 / 4;
+    std::vector<uint64_t> expectedIds = destroyedIds;
+    for (size_t i = 0; i < buffers.size() - expectedMaxSize; i++) {
+        expectedIds.push_back(buffers[i]->getId());
+    }
+
+    mCache.onServerCacheFull();
+    EXPECT_EQ(expectedMaxSize, mCache.getMaxSize());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ASSERT_EQ(1u, mUncacheTransactions.size());
+        EXPECT_EQ(expectedIds, idsOf(mUncacheTransactions[0]));
+    }
+
+    uint64_t cacheId;
+    EXPECT_EQ(BAD_VALUE, mCache.getCacheId(buffers[0], &cacheId));
+    EXPECT_EQ(NO_ERROR, mCache.getCacheId(buffers.back(), &cacheId));
+
+    // the capacity grows back by one for every eviction
+    std::optional<client_cache_t> uncacheBuffer;
+    mCache.cache(sp<GraphicBuffer>::make(), uncacheBuffer);
+    ASSERT_TRUE(uncacheBuffer);
+    EXPECT_EQ(buffers[buffers.size() - expectedMaxSize]->getId(), uncacheBuffer->id);
+    EXPECT_EQ(expectedMaxSize + 1, mCache.getMaxSize());
+}
+
+TEST_F(BufferCacheTest, DoesNotShrinkBelowMinimum) {
+    std::vector<sp<GraphicBuffer>> buffers = makeBuffers(BufferCache::MIN_CACHE_SIZE / 2);
+    ASSERT_NO_FATAL_FAILURE(cacheAll(buffers));
+
+    mCache.onServerCacheFull();
+    EXPECT_EQ(BufferCache::MIN_CACHE_SIZE, mCache.getMaxSize());
+
+    // nothing had to be evicted, so nothing is sent
+    std::lock_guard<std::mutex> lock(mMutex);
+    EXPECT_TRUE(mUncacheTransactions.empty());
+}
+
+} // namespace android
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the time per buffer to dequeue and queue batches of buffers, either
+// with one call per buffer, or with the batched calls.
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IProducerListener.h>
+#include <system/window.h>
+
+#include <vector>
+
+using namespace android;
+
+namespace {
+
+struct StubConsumerListener : public BnConsumerListener {
+    void onFrameAvailable(const BufferItem&) override {}
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+};
+
+enum Mode {
+    SINGLE,
+    BATCHED,
+};
+
+struct Queue {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+};
+
+Queue makeQueue(int batchSize) {
+    Queue queue;
+    BufferQueue::createBufferQueue(&queue.producer, &queue.consumer);
+    CHECK_EQ(OK, queue.consumer->consumerConnect(sp<StubConsumerListener>::make(), false));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    CHECK_EQ(OK,
+             queue.producer->connect(sp<StubProducerListener>::make(), NATIVE_WINDOW_API_CPU,
+                                     false, &output));
+    CHECK_EQ(OK, queue.producer->setMaxDequeuedBufferCount(batchSize));
+    return queue;
+}
+
+void BM_dequeueQueue(benchmark::State& state) {
+    const Mode mode = static_cast<Mode>(state.range(0));
+    const int batchSize = static_cast<int>(state.range(1));
+    Queue queue = makeQueue(batchSize);
+
+    IGraphicBufferProducer::DequeueBufferInput dequeueInput;
+    dequeueInput.width = 64;
+    dequeueInput.height = 64;
+    dequeueInput.format = PIXEL_FORMAT_RGBA_8888;
+    dequeueInput.usage = GRALLOC_USAGE_SW_READ_OFTEN;
+    dequeueInput.getTimestamps = false;
+    const std::vector<IGraphicBufferProducer::DequeueBufferInput> dequeueInputs(batchSize,
+                                                                                dequeueInput);
+
+    std::vector<IGraphicBufferProducer::DequeueBufferOutput> dequeueOutputs;
+    std::vector<IGraphicBufferProducer::QueueBufferInput> queueInputs;
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutputs;
+    std::vector<int32_t> allocatedSlots;
+
+    auto runBatch = [&] {
+        if (mode == BATCHED) {
+            queue.producer->dequeueBuffers(dequeueInputs, &dequeueOutputs);
+        } else {
+            dequeueOutputs.resize(batchSize);
+            for (auto& output : dequeueOutputs) {
+                output.result = queue.producer->dequeueBuffer(&output.slot, &output.fence,
+                                                              dequeueInput.width,
+                                                              dequeueInput.height,
+                                                              dequeueInput.format,
+                                                              dequeueInput.usage, nullptr,
+                                                              nullptr);
+            }
+        }
+
+        queueInputs.clear();
+        allocatedSlots.clear();
+        for (const auto& output : dequeueOutputs) {
+            CHECK_GE(output.result, 0);
+            if (output.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+                allocatedSlots.push_back(output.slot);
+            }
+            auto& input = queueInputs.emplace_back(0, false, HAL_DATASPACE_UNKNOWN,
+                                                   Rect(0, 0, 64, 64),
+                                                   NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                   Fence::NO_FENCE);
+            input.slot = output.slot;
+        }
+        if (!allocatedSlots.empty()) {
+            std::vector<IGraphicBufferProducer::RequestBufferOutput> requestOutputs;
+            queue.producer->requestBuffers(allocatedSlots, &requestOutputs);
+        }
+
+        if (mode == BATCHED) {
+            queue.producer->queueBuffers(queueInputs, &queueOutputs);
+        } else {
+            queueOutputs.resize(batchSize);
+            for (int i = 0; i < batchSize; i++) {
+                queueOutputs[i].result =
+                        queue.producer->queueBuffer(queueInputs[i].slot, queueInputs[i],
+                                                    &queueOutputs[i]);
+            }
+        }
+        for (const auto& output : queueOutputs) {
+            CHECK_EQ(OK, output.result);
+        }
+
+        for (int i = 0; i < batchSize; i++) {
+            BufferItem item;
+            CHECK_EQ(OK, queue.consumer->acquireBuffer(&item, 0));
+            CHECK_EQ(OK,
+                     queue.consumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY,
+                                                   EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+        }
+    };
+
+    // allocate all buffers up front, only the steady state is measured
+    runBatch();
+
+    for (auto _ : state) {
+        runBatch();
+    }
+
+    state.SetItemsProcessed(state.iterations() * batchSize);
+    state.SetLabel(mode == BATCHED ? "batched" : "single");
+}
+BENCHMARK(BM_dequeueQueue)->ArgsProduct({{SINGLE, BATCHED}, {1, 2, 4, 8}});
+
+} // namespace
+
+BENCHMARK_MAIN();
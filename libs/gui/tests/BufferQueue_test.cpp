@@ -1569,4 +1569,135 @@ TEST_F(BufferQueueTest, TestAdditionalOptions) {
     EXPECT_EQ(ADATASPACE_UNKNOWN, dataSpace);
 }
 
+TEST_F(BufferQueueTest, BatchedDequeueAndQueue) {
+    createBufferQueue();
+    sp<MockConsumer> mc(new MockConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(mc, false));
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    ASSERT_EQ(OK, mProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false, &qbo));
+    ASSERT_EQ(OK, mProducer->setMaxDequeuedBufferCount(3));
+
+    std::vector<IGraphicBufferProducer::DequeueBufferInput> dequeueInputs(3);
+    for (auto& input : dequeueInputs) {
+        input.width = 1;
+        input.height = 1;
+        input.format = 0;
+        input.usage = GRALLOC_USAGE_SW_READ_OFTEN;
+        input.getTimestamps = false;
+    }
+
+    for (int round = 0; round < 2; round++) {
+        // only the first round allocates
+        const status_t expectedResult = round == 0
+                ? static_cast<status_t>(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION)
+                : OK;
+        std::vector<IGraphicBufferProducer::DequeueBufferOutput> dequeueOutputs;
+        ASSERT_EQ(OK, mProducer->dequeueBuffers(dequeueInputs, &dequeueOutputs));
+        ASSERT_EQ(3u, dequeueOutputs.size());
+
+        std::vector<int32_t> slots;
+        std::vector<IGraphicBufferProducer::QueueBufferInput> queueInputs;
+        for (const auto& output : dequeueOutputs) {
+            ASSERT_EQ(expectedResult, output.result);
+            slots.push_back(output.slot);
+            auto& input = queueInputs.emplace_back(0, false, HAL_DATASPACE_UNKNOWN,
+                                                   Rect(0, 0, 1, 1),
+                                                   NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                   Fence::NO_FENCE);
+            input.slot = output.slot;
+        }
+        if (round == 0) {
+            std::vector<IGraphicBufferProducer::RequestBufferOutput> requestOutputs;
+            ASSERT_EQ(OK, mProducer->requestBuffers(slots, &requestOutputs));
+            ASSERT_EQ(3u, requestOutputs.size());
+            for (const auto& output : requestOutputs) {
+                EXPECT_EQ(OK, output.result);
+                EXPECT_NE(nullptr, output.buffer);
+            }
+        }
+
+        std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutputs;
+        ASSERT_EQ(OK, mProducer->queueBuffers(queueInputs, &queueOutputs));
+        ASSERT_EQ(3u, queueOutputs.size());
+        for (size_t i = 0; i < queueOutputs.size(); i++) {
+            EXPECT_EQ(OK, queueOutputs[i].result);
+            EXPECT_EQ(i + 1, queueOutputs[i].numPendingBuffers);
+        }
+
+        // in the order that they were queued
+        for (int32_t slot : slots) {
+            BufferItem item;
+            ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+            EXPECT_EQ(slot, item.mSlot);
+            ASSERT_EQ(OK,
+                      mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY,
+                                               EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+        }
+    }
+}
+
+TEST_F(BufferQueueTest, BatchedQueue_FailsOnlyInvalidBuffers) {
+    createBufferQueue();
+    sp<MockConsumer> mc(new MockConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(mc, false));
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    ASSERT_EQ(OK, mProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false, &qbo));
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+              mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                       nullptr, nullptr));
+    ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buf));
+
+    std::vector<IGraphicBufferProducer::QueueBufferInput> queueInputs;
+    for (int32_t s : {BufferQueueDefs::NUM_BUFFER_SLOTS, slot}) {
+        auto& input = queueInputs.emplace_back(0, false, HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+                                               NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                               Fence::NO_FENCE);
+        input.slot = s;
+    }
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutputs;
+    ASSERT_EQ(OK, mProducer->queueBuffers(queueInputs, &queueOutputs));
+    EXPECT_EQ(BAD_VALUE, queueOutputs[0].result);
+    EXPECT_EQ(OK, queueOutputs[1].result);
+
+    BufferItem item;
+    ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+    EXPECT_EQ(slot, item.mSlot);
+}
+
+TEST_F(BufferQueueTest, BatchedRequest_FailsOnlyInvalidSlots) {
+    createBufferQueue();
+    sp<MockConsumer> mc(new MockConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(mc, false));
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    ASSERT_EQ(OK, mProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false, &qbo));
+
+    int slot;
+    sp<Fence> fence;
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+              mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                       nullptr, nullptr));
+    const int32_t freeSlot = (slot + 1) % BufferQueueDefs::NUM_BUFFER_SLOTS;
+
+    std::vector<IGraphicBufferProducer::RequestBufferOutput> requestOutputs;
+    ASSERT_EQ(OK,
+              mProducer->requestBuffers({-1, slot, freeSlot, BufferQueueDefs::NUM_BUFFER_SLOTS},
+                                        &requestOutputs));
+    ASSERT_EQ(4u, requestOutputs.size());
+    EXPECT_EQ(BAD_VALUE, requestOutputs[0].result);
+    EXPECT_EQ(OK, requestOutputs[1].result);
+    EXPECT_NE(nullptr, requestOutputs[1].buffer);
+    // not dequeued
+    EXPECT_EQ(BAD_VALUE, requestOutputs[2].result);
+    EXPECT_EQ(BAD_VALUE, requestOutputs[3].result);
+
+    // the same buffer as the single call returns
+    sp<GraphicBuffer> buf;
+    ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buf));
+    EXPECT_EQ(buf, requestOutputs[1].buffer);
+}
+
 } // namespace android
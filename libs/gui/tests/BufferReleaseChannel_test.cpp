@@ -14,9 +14,14 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
 #include <string>
 #include <vector>
 
+#include <binder/Parcel.h>
 #include <gtest/gtest.h>
 #include <gui/BufferReleaseChannel.h>
 
@@ -40,6 +45,11 @@ bool is_same_file(int fd1, int fd2) {
     return (stat1.st_dev == stat2.st_dev) && (stat1.st_ino == stat2.st_ino);
 }
 
+bool is_readable(int fd) {
+    pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+    return poll(&pfd, 1, 0 /* timeout */) == 1;
+}
+
 } // namespace
 
 TEST(BufferReleaseChannelTest, MessageFlattenable) {
@@ -135,4 +145,150 @@ TEST(BufferReleaseChannelTest, ProduceAndConsume) {
     }
 }
 
-} // namespace android
\ No newline at end of file
+// Verify that releases without a fence are read back in order when they overflow the shared ring
+// and fall back to the socket.
+TEST(BufferReleaseChannelTest, ProduceAndConsumeWithoutFence) {
+    std::unique_ptr<BufferReleaseChannel::ConsumerEndpoint> consumer;
+    std::shared_ptr<BufferReleaseChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, BufferReleaseChannel::open("test-channel"s, consumer, producer));
+
+    for (uint64_t i = 0; i < 128; i++) {
+        ASSERT_EQ(OK, producer->writeReleaseFence(ReleaseCallbackId{i, i + 1}, Fence::NO_FENCE, 3));
+    }
+
+    for (uint64_t i = 0; i < 128; i++) {
+        ReleaseCallbackId consumerId;
+        sp<Fence> consumerFence;
+        uint32_t maxAcquiredBufferCount;
+        ASSERT_EQ(OK,
+                  consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+        ASSERT_EQ((ReleaseCallbackId{i, i + 1}), consumerId);
+        ASSERT_FALSE(consumerFence->isValid());
+        ASSERT_EQ(3u, maxAcquiredBufferCount);
+    }
+
+    ReleaseCallbackId consumerId;
+    sp<Fence> consumerFence;
+    uint32_t maxAcquiredBufferCount;
+    ASSERT_EQ(WOULD_BLOCK,
+              consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+}
+
+// Verify that a consumer that ran out of releases is woken up through the socket when a release
+// is written to the ring.
+TEST(BufferReleaseChannelTest, RingWritesWakeWaitingConsumer) {
+    std::unique_ptr<BufferReleaseChannel::ConsumerEndpoint> consumer;
+    std::shared_ptr<BufferReleaseChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, BufferReleaseChannel::open("test-channel"s, consumer, producer));
+
+    ReleaseCallbackId consumerId;
+    sp<Fence> consumerFence;
+    uint32_t maxAcquiredBufferCount;
+    for (uint64_t i = 0; i < 4; i++) {
+        ASSERT_EQ(WOULD_BLOCK,
+                  consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+        ASSERT_FALSE(is_readable(consumer->getFd().get()));
+
+        ASSERT_EQ(OK, producer->writeReleaseFence(ReleaseCallbackId{i, i}, nullptr, 1));
+        ASSERT_TRUE(is_readable(consumer->getFd().get()));
+
+        ASSERT_EQ(OK,
+                  consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+        ASSERT_EQ((ReleaseCallbackId{i, i}), consumerId);
+    }
+}
+
+// Verify that a parceled producer endpoint still writes to the same ring and socket.
+TEST(BufferReleaseChannelTest, ParceledProducerEndpoint) {
+    std::unique_ptr<BufferReleaseChannel::ConsumerEndpoint> consumer;
+    std::shared_ptr<BufferReleaseChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, BufferReleaseChannel::open("test-channel"s, consumer, producer));
+
+    Parcel parcel;
+    ASSERT_EQ(OK, producer->writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+    BufferReleaseChannel::ProducerEndpoint parceledProducer;
+    ASSERT_EQ(OK, parceledProducer.readFromParcel(&parcel));
+
+    sp<Fence> fence = sp<Fence>::make(memfd_create("fake-fence-fd", 0));
+    ASSERT_EQ(OK, parceledProducer.writeReleaseFence(ReleaseCallbackId{1, 1}, Fence::NO_FENCE, 2));
+    ASSERT_EQ(OK, parceledProducer.writeReleaseFence(ReleaseCallbackId{2, 2}, fence, 2));
+
+    ReleaseCallbackId consumerId;
+    sp<Fence> consumerFence;
+    uint32_t maxAcquiredBufferCount;
+    ASSERT_EQ(OK, consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+    ASSERT_EQ((ReleaseCallbackId{1, 1}), consumerId);
+    ASSERT_FALSE(consumerFence->isValid());
+    ASSERT_EQ(OK, consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+    ASSERT_EQ((ReleaseCallbackId{2, 2}), consumerId);
+    ASSERT_TRUE(is_same_file(fence->get(), consumerFence->get()));
+}
+
+// Verify that an endpoint parceled a second time, which no longer holds the ring fd, falls back to
+// the socket.
+TEST(BufferReleaseChannelTest, ReparceledProducerEndpoint) {
+    std::unique_ptr<BufferReleaseChannel::ConsumerEndpoint> consumer;
+    std::shared_ptr<BufferReleaseChannel::ProducerEndpoint> producer;
+    ASSERT_EQ(OK, BufferReleaseChannel::open("test-channel"s, consumer, producer));
+
+    Parcel parcel;
+    ASSERT_EQ(OK, producer->writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+    BufferReleaseChannel::ProducerEndpoint parceledProducer;
+    ASSERT_EQ(OK, parceledProducer.readFromParcel(&parcel));
+
+    Parcel reparcel;
+    ASSERT_EQ(OK, parceledProducer.writeToParcel(&reparcel));
+    reparcel.setDataPosition(0);
+    BufferReleaseChannel::ProducerEndpoint reparceledProducer;
+    ASSERT_EQ(OK, reparceledProducer.readFromParcel(&reparcel));
+
+    ASSERT_EQ(OK,
+              reparceledProducer.writeReleaseFence(ReleaseCallbackId{1, 1}, Fence::NO_FENCE, 2));
+    ASSERT_TRUE(is_readable(consumer->getFd().get()));
+
+    ReleaseCallbackId consumerId;
+    sp<Fence> consumerFence;
+    uint32_t maxAcquiredBufferCount;
+    ASSERT_EQ(OK, consumer->readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+    ASSERT_EQ((ReleaseCallbackId{1, 1}), consumerId);
+    ASSERT_FALSE(consumerFence->isValid());
+}
+
+// Verify that endpoints without a ring, as open() makes when shared memory isn't available, send
+// every release over the socket, including after being parceled.
+TEST(BufferReleaseChannelTest, SocketOnlyEndpoints) {
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets));
+    ASSERT_EQ(0, fcntl(sockets[0], F_SETFL, O_NONBLOCK));
+    BufferReleaseChannel::ConsumerEndpoint consumer("test-channel"s,
+                                                    android::base::unique_fd(sockets[0]));
+    auto producer =
+            std::make_shared<BufferReleaseChannel::ProducerEndpoint>("test-channel"s,
+                                                                     android::base::unique_fd(
+                                                                             sockets[1]));
+
+    Parcel parcel;
+    ASSERT_EQ(OK, producer->writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+    BufferReleaseChannel::ProducerEndpoint parceledProducer;
+    ASSERT_EQ(OK, parceledProducer.readFromParcel(&parcel));
+
+    ASSERT_EQ(OK, producer->writeReleaseFence(ReleaseCallbackId{1, 1}, Fence::NO_FENCE, 2));
+    ASSERT_TRUE(is_readable(consumer.getFd().get()));
+    ASSERT_EQ(OK, parceledProducer.writeReleaseFence(ReleaseCallbackId{2, 2}, nullptr, 2));
+
+    ReleaseCallbackId consumerId;
+    sp<Fence> consumerFence;
+    uint32_t maxAcquiredBufferCount;
+    for (uint64_t i = 1; i <= 2; i++) {
+        ASSERT_EQ(OK, consumer.readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+        ASSERT_EQ((ReleaseCallbackId{i, i}), consumerId);
+        ASSERT_FALSE(consumerFence->isValid());
+    }
+    ASSERT_EQ(WOULD_BLOCK,
+              consumer.readReleaseFence(consumerId, consumerFence, maxAcquiredBufferCount));
+}
+
+} // namespace android
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures parceling the layer states of typical transactions, the way
+// SurfaceComposerClient::Transaction writes them and SurfaceFlinger reads them.
+
+#include <benchmark/benchmark.h>
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+#include <vector>
+
+using namespace android;
+
+enum TransactionMix {
+    // an animation moving and fading a few layers every frame
+    ANIMATION,
+    // a BLAST buffer update with a cached buffer
+    BUFFER_UPDATE,
+    // a window being shown for the first time
+    WINDOW_SETUP,
+};
+
+static std::vector<ComposerState> makeStates(TransactionMix mix) {
+    std::vector<ComposerState> states;
+    switch (mix) {
+        case ANIMATION:
+            for (int i = 0; i < 8; i++) {
+                ComposerState s;
+                s.state.layerId = i;
+                s.state.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+                        layer_state_t::eMatrixChanged;
+                s.state.x = 10.0f * i;
+                s.state.y = 20.0f * i;
+                s.state.color.a = 0.5f;
+                s.state.matrix = {0.9f, 0.0f, 0.0f, 0.9f};
+                states.push_back(s);
+            }
+            break;
+        case BUFFER_UPDATE: {
+            ComposerState s;
+            s.state.what = layer_state_t::eBufferChanged | layer_state_t::eDataspaceChanged |
+                    layer_state_t::eSurfaceDamageRegionChanged | layer_state_t::eApiChanged |
+                    layer_state_t::eHasListenerCallbacksChanged;
+            s.state.bufferData = std::make_shared<BufferData>();
+            s.state.bufferData->cachedBuffer.id = 7;
+            s.state.bufferData->frameNumber = 100;
+            s.state.dataspace = ui::Dataspace::V0_SRGB;
+            s.state.surfaceDamageRegion = Region(Rect(0, 0, 1080, 2400));
+            s.state.api = NATIVE_WINDOW_API_EGL;
+            s.state.listeners.emplace_back(nullptr,
+                                           std::vector<CallbackId>{
+                                                   CallbackId(1, CallbackId::Type::ON_COMPLETE)});
+            states.push_back(s);
+            break;
+        }
+        case WINDOW_SETUP: {
+            ComposerState s;
+            s.state.what = layer_state_t::ePositionChanged | layer_state_t::eLayerChanged |
+                    layer_state_t::eLayerStackChanged | layer_state_t::eFlagsChanged |
+                    layer_state_t::eCropChanged | layer_state_t::eCornerRadiusChanged |
+                    layer_state_t::eInputInfoChanged | layer_state_t::eMetadataChanged |
+                    layer_state_t::eShadowRadiusChanged | layer_state_t::eTrustedOverlayChanged;
+            s.state.z = 3;
+            s.state.flags = layer_state_t::eLayerOpaque;
+            s.state.mask = layer_state_t::eLayerOpaque;
+            s.state.crop = Rect(0, 0, 1080, 2400);
+            s.state.cornerRadius = 24.0f;
+            s.state.shadowRadius = 8.0f;
+            s.state.metadata.setInt32(gui::METADATA_OWNER_UID, 10123);
+            s.state.windowInfoHandle->editInfo()->name = "com.example/.MainActivity";
+            s.state.trustedOverlay = gui::TrustedOverlay::DISABLED;
+            states.push_back(s);
+            break;
+        }
+    }
+    return states;
+}
+
+static void BM_writeLayerStates(benchmark::State& state) {
+    std::vector<ComposerState> states = makeStates(static_cast<TransactionMix>(state.range(0)));
+    Parcel p;
+    for (auto _ : state) {
+        p.setDataSize(0);
+        for (const auto& s : states) s.write(p);
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.counters["bytes"] = p.dataSize();
+}
+BENCHMARK(BM_writeLayerStates)->DenseRange(ANIMATION, WINDOW_SETUP);
+
+static void BM_readLayerStates(benchmark::State& state) {
+    std::vector<ComposerState> states = makeStates(static_cast<TransactionMix>(state.range(0)));
+    Parcel p;
+    for (const auto& s : states) s.write(p);
+    for (auto _ : state) {
+        p.setDataPosition(0);
+        for (size_t i = 0; i < states.size(); i++) {
+            ComposerState s;
+            s.read(p);
+            benchmark::DoNotOptimize(s);
+        }
+    }
+    state.counters["bytes"] = p.dataSize();
+}
+BENCHMARK(BM_readLayerStates)->DenseRange(ANIMATION, WINDOW_SETUP);
+
+BENCHMARK_MAIN();
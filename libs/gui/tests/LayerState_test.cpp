@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+namespace android {
+
+namespace {
+
+layer_state_t roundTrip(const layer_state_t& state, size_t* size = nullptr) {
+    Parcel p;
+    EXPECT_EQ(NO_ERROR, state.write(p));
+    if (size) *size = p.dataSize();
+    p.setDataPosition(0);
+
+    layer_state_t result;
+    EXPECT_EQ(NO_ERROR, result.read(p));
+    EXPECT_EQ(p.dataSize(), p.dataPosition());
+    return result;
+}
+
+} // namespace
+
+TEST(LayerStateTest, ParcelsChangedFields) {
+    layer_state_t state;
+    state.layerId = 42;
+    state.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eCropChanged | layer_state_t::eFrameRateChanged |
+            layer_state_t::eDesiredHdrHeadroomChanged;
+    state.x = 10.5f;
+    state.y = 20.5f;
+    state.color.a = 0.5f;
+    state.crop = Rect(1, 2, 3, 4);
+    state.frameRate = 60.0f;
+    state.frameRateCompatibility = ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_FIXED_SOURCE;
+    state.changeFrameRateStrategy = ANATIVEWINDOW_CHANGE_FRAME_RATE_ALWAYS;
+    state.desiredHdrSdrRatio = 2.0f;
+
+    layer_state_t result = roundTrip(state);
+    EXPECT_EQ(42, result.layerId);
+    EXPECT_EQ(state.what, result.what);
+    EXPECT_EQ(10.5f, result.x);
+    EXPECT_EQ(20.5f, result.y);
+    EXPECT_EQ(0.5f, result.color.a);
+    EXPECT_EQ(Rect(1, 2, 3, 4), result.crop);
+    EXPECT_EQ(60.0f, result.frameRate);
+    EXPECT_EQ(ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_FIXED_SOURCE, result.frameRateCompatibility);
+    EXPECT_EQ(ANATIVEWINDOW_CHANGE_FRAME_RATE_ALWAYS, result.changeFrameRateStrategy);
+    EXPECT_EQ(2.0f, result.desiredHdrSdrRatio);
+}
+
+TEST(LayerStateTest, SkipsUnchangedFields) {
+    layer_state_t state;
+    state.what = layer_state_t::ePositionChanged;
+    state.x = 1.0f;
+    state.z = 7;
+    state.cornerRadius = 3.0f;
+    state.crop = Rect(1, 2, 3, 4);
+
+    size_t positionSize;
+    layer_state_t result = roundTrip(state, &positionSize);
+    EXPECT_EQ(1.0f, result.x);
+    EXPECT_EQ(0, result.z);
+    EXPECT_EQ(0.0f, result.cornerRadius);
+    EXPECT_EQ(Rect::INVALID_RECT, result.crop);
+
+    state.what |= layer_state_t::eLayerChanged | layer_state_t::eCornerRadiusChanged |
+            layer_state_t::eCropChanged;
+    size_t moreSize;
+    result = roundTrip(state, &moreSize);
+    EXPECT_EQ(7, result.z);
+    EXPECT_EQ(3.0f, result.cornerRadius);
+    EXPECT_EQ(Rect(1, 2, 3, 4), result.crop);
+    EXPECT_LT(positionSize, moreSize);
+}
+
+TEST(LayerStateTest, ParcelsListenersWithoutChanges) {
+    layer_state_t state;
+    state.listeners.emplace_back(nullptr,
+                                 std::vector<CallbackId>{
+                                         CallbackId(1, CallbackId::Type::ON_COMPLETE)});
+
+    layer_state_t result = roundTrip(state);
+    ASSERT_EQ(1u, result.listeners.size());
+    EXPECT_EQ(1u, result.listeners[0].callbackIds.size());
+}
+
+TEST(LayerStateTest, UnknownChangesParcelAllFields) {
+    layer_state_t state;
+    // not a change this version knows the fields of
+    state.what = layer_state_t::ePositionChanged | (1ull << 63);
+    state.x = 1.0f;
+    state.z = 7;
+    state.cornerRadius = 3.0f;
+
+    layer_state_t result = roundTrip(state);
+    EXPECT_EQ(state.what, result.what);
+    EXPECT_EQ(1.0f, result.x);
+    EXPECT_EQ(7, result.z);
+    EXPECT_EQ(3.0f, result.cornerRadius);
+}
+
+} // namespace android
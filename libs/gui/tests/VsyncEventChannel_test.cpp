@@ -0,0 +1,174 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+
+#include <atomic>
+#include <thread>
+
+#include <binder/Parcel.h>
+#include <gtest/gtest.h>
+#include <gui/DisplayEventReceiver.h>
+#include <private/gui/VsyncEventChannel.h>
+
+using android::gui::VsyncEventChannel;
+
+namespace android {
+
+namespace {
+
+bool is_readable(int fd) {
+    pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+    return poll(&pfd, 1, 0 /* timeout */) == 1;
+}
+
+DisplayEventReceiver::Event makeVsyncEvent(nsecs_t timestamp, uint32_t count) {
+    DisplayEventReceiver::Event event{};
+    event.header.type = DisplayEventReceiver::DISPLAY_EVENT_VSYNC;
+    event.header.timestamp = timestamp;
+    event.vsync.count = count;
+    event.vsync.vsyncData.frameTimelinesLength = 1;
+    event.vsync.vsyncData.frameTimelines[0].vsyncId = count;
+    return event;
+}
+
+// Sends the publisher's receive end through a parcel, as SurfaceFlinger does.
+std::unique_ptr<VsyncEventChannel> receiveEnd(const VsyncEventChannel& publisher) {
+    VsyncEventChannel copy;
+    if (publisher.duplicateFds(&copy) != OK) {
+        return nullptr;
+    }
+    Parcel parcel;
+    if (copy.writeToParcel(&parcel) != OK) {
+        return nullptr;
+    }
+    parcel.setDataPosition(0);
+    auto receiver = std::make_unique<VsyncEventChannel>();
+    if (receiver->readFromParcel(&parcel) != OK) {
+        return nullptr;
+    }
+    return receiver;
+}
+
+} // namespace
+
+TEST(VsyncEventChannelTest, ConsumeReturnsLatestEvent) {
+    auto publisher = VsyncEventChannel::create();
+    ASSERT_NE(nullptr, publisher);
+    auto receiver = receiveEnd(*publisher);
+    ASSERT_NE(nullptr, receiver);
+    ASSERT_EQ(OK, receiver->initCheck());
+
+    DisplayEventReceiver::Event event;
+    uint64_t eventsBefore;
+    ASSERT_FALSE(is_readable(receiver->getFd()));
+    ASSERT_FALSE(receiver->consume(&event, 0 /* eventsReceived */, &eventsBefore));
+
+    ASSERT_EQ(OK, publisher->publish(makeVsyncEvent(100, 1), 0 /* eventsBefore */));
+    ASSERT_EQ(OK, publisher->publish(makeVsyncEvent(200, 2), 0 /* eventsBefore */));
+    ASSERT_TRUE(is_readable(receiver->getFd()));
+
+    ASSERT_TRUE(receiver->consume(&event, 0 /* eventsReceived */, &eventsBefore));
+    EXPECT_EQ(DisplayEventReceiver::DISPLAY_EVENT_VSYNC, event.header.type);
+    EXPECT_EQ(200, event.header.timestamp);
+    EXPECT_EQ(2u, event.vsync.count);
+    EXPECT_EQ(2, event.vsync.vsyncData.preferredVsyncId());
+    EXPECT_EQ(0u, eventsBefore);
+
+    // The wakeup is drained and the event is only returned once.
+    EXPECT_FALSE(is_readable(receiver->getFd()));
+    EXPECT_FALSE(receiver->consume(&event, 0 /* eventsReceived */, &eventsBefore));
+}
+
+TEST(VsyncEventChannelTest, ConsumeWaitsForEventsSentBefore) {
+    auto publisher = VsyncEventChannel::create();
+    ASSERT_NE(nullptr, publisher);
+    auto receiver = receiveEnd(*publisher);
+    ASSERT_NE(nullptr, receiver);
+
+    // Two events went over the BitTube before the vsync event.
+    ASSERT_EQ(OK, publisher->publish(makeVsyncEvent(100, 1), 2 /* eventsBefore */));
+
+    DisplayEventReceiver::Event event;
+    uint64_t eventsBefore;
+    EXPECT_FALSE(receiver->consume(&event, 1 /* eventsReceived */, &eventsBefore));
+
+    // The event is kept until the receiver has caught up.
+    ASSERT_TRUE(receiver->consume(&event, 3 /* eventsReceived */, &eventsBefore));
+    EXPECT_EQ(100, event.header.timestamp);
+    EXPECT_EQ(2u, eventsBefore);
+}
+
+TEST(VsyncEventChannelTest, ConcurrentPublishAndConsume) {
+    auto publisher = VsyncEventChannel::create();
+    ASSERT_NE(nullptr, publisher);
+    auto receiver = receiveEnd(*publisher);
+    ASSERT_NE(nullptr, receiver);
+
+    constexpr uint32_t kEventCount = 200000;
+    std::atomic<bool> done = false;
+    std::thread publishThread([&] {
+        for (uint32_t count = 1; count <= kEventCount; count++) {
+            EXPECT_EQ(OK, publisher->publish(makeVsyncEvent(count * 10, count), count));
+        }
+        done = true;
+    });
+
+    // Every event read is whole, and they only ever move forward.
+    uint32_t lastCount = 0;
+    while (lastCount < kEventCount) {
+        // Once everything is published, the next read must return the last event.
+        const bool published = done;
+        if (!published) {
+            pollfd pfd{.fd = receiver->getFd(), .events = POLLIN, .revents = 0};
+            poll(&pfd, 1, 100 /* timeout */);
+        }
+        DisplayEventReceiver::Event event;
+        uint64_t eventsBefore;
+        if (!receiver->consume(&event, kEventCount, &eventsBefore)) {
+            ASSERT_FALSE(published) << "the last event was lost";
+            continue;
+        }
+        ASSERT_GT(event.vsync.count, lastCount);
+        ASSERT_EQ(event.vsync.count * 10, event.header.timestamp);
+        ASSERT_EQ(event.vsync.count, event.vsync.vsyncData.preferredVsyncId());
+        ASSERT_EQ(event.vsync.count, eventsBefore);
+        lastCount = event.vsync.count;
+    }
+    publishThread.join();
+}
+
+TEST(VsyncEventChannelTest, ReceiverCannotPublish) {
+    auto publisher = VsyncEventChannel::create();
+    ASSERT_NE(nullptr, publisher);
+    auto receiver = receiveEnd(*publisher);
+    ASSERT_NE(nullptr, receiver);
+
+    EXPECT_EQ(NO_INIT, receiver->publish(makeVsyncEvent(100, 1), 0 /* eventsBefore */));
+}
+
+TEST(VsyncEventChannelTest, UninitializedChannelParcelsAsEmpty) {
+    VsyncEventChannel channel;
+    Parcel parcel;
+    ASSERT_EQ(OK, channel.writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+
+    VsyncEventChannel receiver;
+    ASSERT_EQ(OK, receiver.readFromParcel(&parcel));
+    EXPECT_EQ(NO_INIT, receiver.initCheck());
+}
+
+} // namespace android
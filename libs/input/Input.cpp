@@ -644,8 +644,13 @@ void MotionEvent::addSample(int64_t eventTime, const PointerCoords* pointerCoord
                             int32_t eventId) {
     mId = eventId;
     mSampleEventTimes.push_back(eventTime);
-    mSamplePointerCoords.insert(mSamplePointerCoords.end(), &pointerCoords[0],
-                                &pointerCoords[getPointerCount()]);
+    // Only the present axes are copied. Callers build pointerCoords with copyFrom, which leaves
+    // the unused values uninitialized, so the new samples start out zeroed.
+    const size_t firstCoords = mSamplePointerCoords.size();
+    mSamplePointerCoords.resize(firstCoords + getPointerCount());
+    for (size_t i = 0; i < getPointerCount(); i++) {
+        mSamplePointerCoords[firstCoords + i].copyFrom(pointerCoords[i]);
+    }
 }
 
 std::optional<ui::Rotation> MotionEvent::getSurfaceRotation() const {
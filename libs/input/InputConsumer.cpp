@@ -106,7 +106,7 @@ void initializeMotionEvent(MotionEvent& event, const InputMessage& msg) {
     PointerCoords pointerCoords[pointerCount];
     for (uint32_t i = 0; i < pointerCount; i++) {
         pointerProperties[i] = msg.body.motion.pointers[i].properties;
-        pointerCoords[i] = msg.body.motion.pointers[i].coords;
+        pointerCoords[i].copyFrom(msg.body.motion.pointers[i].coords);
     }
 
     ui::Transform transform;
@@ -131,7 +131,7 @@ void addSample(MotionEvent& event, const InputMessage& msg) {
     uint32_t pointerCount = msg.body.motion.pointerCount;
     PointerCoords pointerCoords[pointerCount];
     for (uint32_t i = 0; i < pointerCount; i++) {
-        pointerCoords[i] = msg.body.motion.pointers[i].coords;
+        pointerCoords[i].copyFrom(msg.body.motion.pointers[i].coords);
     }
 
     event.setMetaState(event.getMetaState() | msg.body.motion.metaState);
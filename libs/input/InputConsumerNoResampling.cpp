@@ -17,7 +17,9 @@
 #define LOG_TAG "InputConsumerNoResampling"
 #define ATRACE_TAG ATRACE_TAG_INPUT
 
+#include <array>
 #include <chrono>
+#include <span>
 
 #include <inttypes.h>
 
@@ -46,6 +48,12 @@ using std::chrono::nanoseconds;
 const bool DEBUG_TRANSPORT_CONSUMER =
         __android_log_is_loggable(ANDROID_LOG_DEBUG, LOG_TAG "Consumer", ANDROID_LOG_INFO);
 
+/**
+ * Number of messages to hand to the channel at once. The channel moves them with a single
+ * sendmmsg / recvmmsg call.
+ */
+constexpr size_t MESSAGE_BATCH_SIZE = 8;
+
 std::unique_ptr<KeyEvent> createKeyEvent(const InputMessage& msg) {
     std::unique_ptr<KeyEvent> event = std::make_unique<KeyEvent>();
     event->initialize(msg.body.key.eventId, msg.body.key.deviceId, msg.body.key.source,
@@ -80,11 +88,10 @@ std::unique_ptr<MotionEvent> createMotionEvent(const InputMessage& msg) {
     const uint32_t pointerCount = msg.body.motion.pointerCount;
     std::vector<PointerProperties> pointerProperties;
     pointerProperties.reserve(pointerCount);
-    std::vector<PointerCoords> pointerCoords;
-    pointerCoords.reserve(pointerCount);
+    std::array<PointerCoords, MAX_POINTERS> pointerCoords;
     for (uint32_t i = 0; i < pointerCount; i++) {
         pointerProperties.push_back(msg.body.motion.pointers[i].properties);
-        pointerCoords.push_back(msg.body.motion.pointers[i].coords);
+        pointerCoords[i].copyFrom(msg.body.motion.pointers[i].coords);
     }
 
     ui::Transform transform;
@@ -108,10 +115,9 @@ std::unique_ptr<MotionEvent> createMotionEvent(const InputMessage& msg) {
 
 void addSample(MotionEvent& event, const InputMessage& msg) {
     uint32_t pointerCount = msg.body.motion.pointerCount;
-    std::vector<PointerCoords> pointerCoords;
-    pointerCoords.reserve(pointerCount);
+    std::array<PointerCoords, MAX_POINTERS> pointerCoords;
     for (uint32_t i = 0; i < pointerCount; i++) {
-        pointerCoords.push_back(msg.body.motion.pointers[i].coords);
+        pointerCoords[i].copyFrom(msg.body.motion.pointers[i].coords);
     }
 
     // TODO(b/329770983): figure out if it's safe to combine events with mismatching metaState
@@ -241,27 +247,38 @@ int InputConsumerNoResampling::handleReceiveCallback(int events) {
 
 void InputConsumerNoResampling::processOutboundEvents() {
     while (!mOutboundQueue.empty()) {
-        const InputMessage& outboundMsg = mOutboundQueue.front();
+        // Send the front of the queue in one go; a frame usually finishes a burst of events.
+        std::array<const InputMessage*, MESSAGE_BATCH_SIZE> outboundMsgs;
+        const size_t count = std::min(mOutboundQueue.size(), outboundMsgs.size());
+        for (size_t i = 0; i < count; i++) {
+            outboundMsgs[i] = &mOutboundQueue[i];
+        }
 
-        const status_t result = mChannel->sendMessage(&outboundMsg);
-        if (result == OK) {
-            if (outboundMsg.header.type == InputMessage::Type::FINISHED) {
-                ATRACE_ASYNC_END("InputConsumer processing", /*cookie=*/outboundMsg.header.seq);
+        const android::base::Result<size_t> result =
+                mChannel->sendMessages(std::span(outboundMsgs.data(), count));
+        if (result.ok()) {
+            for (size_t i = 0; i < *result; i++) {
+                const InputMessage& outboundMsg = mOutboundQueue.front();
+                if (outboundMsg.header.type == InputMessage::Type::FINISHED) {
+                    ATRACE_ASYNC_END("InputConsumer processing",
+                                     /*cookie=*/outboundMsg.header.seq);
+                }
+                // Successful send. Erase the entry and keep trying to send more
+                mOutboundQueue.pop_front();
             }
-            // Successful send. Erase the entry and keep trying to send more
-            mOutboundQueue.pop();
             continue;
         }
 
-        // Publisher is busy, try again later. Keep this entry (do not erase)
-        if (result == WOULD_BLOCK) {
+        // Publisher is busy, try again later. Keep the entries (do not erase)
+        const status_t status = result.error().code();
+        if (status == WOULD_BLOCK) {
             setFdEvents(ALOOPER_EVENT_INPUT | ALOOPER_EVENT_OUTPUT);
             return; // try again later
         }
 
         // Some other error. Give up
         LOG(FATAL) << "Failed to send outbound event on channel '" << mChannel->getName()
-                   << "'.  status=" << statusToString(result) << "(" << result << ")";
+                   << "'.  status=" << statusToString(status) << "(" << status << ")";
     }
 
     // The queue is now empty. Tell looper there's no more output to expect.
@@ -270,12 +287,13 @@ void InputConsumerNoResampling::processOutboundEvents() {
 
 void InputConsumerNoResampling::finishInputEvent(uint32_t seq, bool handled) {
     ensureCalledOnLooperThread(__func__);
-    mOutboundQueue.push(createFinishedMessage(seq, handled, popConsumeTime(seq)));
+    mOutboundQueue.push_back(createFinishedMessage(seq, handled, popConsumeTime(seq)));
     // also produce finish events for all batches for this seq (if any)
     const auto it = mBatchedSequenceNumbers.find(seq);
     if (it != mBatchedSequenceNumbers.end()) {
         for (uint32_t subSeq : it->second) {
-            mOutboundQueue.push(createFinishedMessage(subSeq, handled, popConsumeTime(subSeq)));
+            mOutboundQueue.push_back(
+                    createFinishedMessage(subSeq, handled, popConsumeTime(subSeq)));
         }
         mBatchedSequenceNumbers.erase(it);
     }
@@ -292,7 +310,7 @@ bool InputConsumerNoResampling::probablyHasInput() const {
 void InputConsumerNoResampling::reportTimeline(int32_t inputEventId, nsecs_t gpuCompletedTime,
                                                nsecs_t presentTime) {
     ensureCalledOnLooperThread(__func__);
-    mOutboundQueue.push(createTimelineMessage(inputEventId, gpuCompletedTime, presentTime));
+    mOutboundQueue.push_back(createTimelineMessage(inputEventId, gpuCompletedTime, presentTime));
     processOutboundEvents();
 }
 
@@ -368,20 +386,27 @@ void InputConsumerNoResampling::handleMessages(std::vector<InputMessage>&& messa
 std::vector<InputMessage> InputConsumerNoResampling::readAllMessages() {
     std::vector<InputMessage> messages;
     while (true) {
-        android::base::Result<InputMessage> result = mChannel->receiveMessage();
+        // Receive straight into the tail of messages, several messages per syscall.
+        const size_t received = messages.size();
+        messages.resize(received + MESSAGE_BATCH_SIZE);
+        android::base::Result<size_t> result =
+                mChannel->receiveMessages(std::span(messages).subspan(received));
         if (result.ok()) {
-            const InputMessage& msg = *result;
-            const auto [_, inserted] =
-                    mConsumeTimes.emplace(msg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
-            LOG_ALWAYS_FATAL_IF(!inserted, "Already have a consume time for seq=%" PRIu32,
-                                msg.header.seq);
-
-            // Trace the event processing timeline - event was just read from the socket
-            // TODO(b/329777420): distinguish between multiple instances of InputConsumer
-            // in the same process.
-            ATRACE_ASYNC_BEGIN("InputConsumer processing", /*cookie=*/msg.header.seq);
-            messages.push_back(msg);
+            messages.resize(received + *result);
+            const nsecs_t consumeTime = systemTime(SYSTEM_TIME_MONOTONIC);
+            for (size_t i = received; i < messages.size(); i++) {
+                const InputMessage& msg = messages[i];
+                const auto [_, inserted] = mConsumeTimes.emplace(msg.header.seq, consumeTime);
+                LOG_ALWAYS_FATAL_IF(!inserted, "Already have a consume time for seq=%" PRIu32,
+                                    msg.header.seq);
+
+                // Trace the event processing timeline - event was just read from the socket
+                // TODO(b/329777420): distinguish between multiple instances of InputConsumer
+                // in the same process.
+                ATRACE_ASYNC_BEGIN("InputConsumer processing", /*cookie=*/msg.header.seq);
+            }
         } else { // !result.ok()
+            messages.resize(received);
             switch (result.error().code()) {
                 case WOULD_BLOCK: {
                     return messages;
@@ -540,12 +565,8 @@ std::string InputConsumerNoResampling::dump() const {
         out += "mOutboundQueue: <empty>\n";
     } else {
         out += "mOutboundQueue:\n";
-        // Make a copy of mOutboundQueue for printing destructively. Unfortunately std::queue
-        // doesn't provide a good way to iterate over the entire container.
-        std::queue<InputMessage> tmpQueue = mOutboundQueue;
-        while (!tmpQueue.empty()) {
-            out += std::string("  ") + outboundMessageToString(tmpQueue.front()) + "\n";
-            tmpQueue.pop();
+        for (const InputMessage& outboundMsg : mOutboundQueue) {
+            out += std::string("  ") + outboundMessageToString(outboundMsg) + "\n";
         }
     }
 
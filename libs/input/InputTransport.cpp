@@ -15,6 +15,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
@@ -73,6 +78,35 @@ bool debugTransportPublisher() {
     return __android_log_is_loggable(ANDROID_LOG_DEBUG, LOG_TAG "Publisher", ANDROID_LOG_INFO);
 }
 
+// Upper bound on the messages moved by one sendmmsg/recvmmsg call.
+constexpr size_t MAX_MESSAGES_PER_SYSCALL = 8;
+
+// Upper bound on the bytes moved by one sendmmsg call. sendMessages packs the sanitized messages
+// into a buffer of this size on the stack, rather than keeping MAX_MESSAGES_PER_SYSCALL full
+// InputMessages there. Small messages, like the FINISHED ones consumers send, still go out
+// MAX_MESSAGES_PER_SYSCALL at a time.
+constexpr size_t MAX_BYTES_PER_SEND_SYSCALL = 2 * sizeof(InputMessage);
+
+status_t sendErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
+status_t receiveErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
 android::base::unique_fd dupChannelFd(int fd) {
     android::base::unique_fd newFd(::dup(fd));
     if (!newFd.ok()) {
@@ -277,13 +311,7 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
                 msg->body.motion.pointers[i].properties.toolType =
                         body.motion.pointers[i].properties.toolType,
                 // PointerCoords coords
-                msg->body.motion.pointers[i].coords.bits = body.motion.pointers[i].coords.bits;
-                const uint32_t count = BitSet64::count(body.motion.pointers[i].coords.bits);
-                memcpy(&msg->body.motion.pointers[i].coords.values[0],
-                        &body.motion.pointers[i].coords.values[0],
-                        count * (sizeof(body.motion.pointers[i].coords.values[0])));
-                msg->body.motion.pointers[i].coords.isResampled =
-                        body.motion.pointers[i].coords.isResampled;
+                msg->body.motion.pointers[i].coords.copyFrom(body.motion.pointers[i].coords);
             }
             break;
         }
@@ -400,13 +428,7 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
                  name.c_str(), ftl::enum_string(msg->header.type).c_str(), strerror(error));
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return WOULD_BLOCK;
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
-            return DEAD_OBJECT;
-        }
-        return -error;
+        return sendErrorToStatus(error);
     }
 
     if (size_t(nWrite) != msgLength) {
@@ -423,6 +445,11 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
 }
 
 android::base::Result<InputMessage> InputChannel::receiveMessage() {
+    if (mPendingReceiveError) {
+        const status_t error = *std::exchange(mPendingReceiveError, std::nullopt);
+        return android::base::Error(error);
+    }
+
     ssize_t nRead;
     InputMessage msg;
     do {
@@ -433,13 +460,7 @@ android::base::Result<InputMessage> InputChannel::receiveMessage() {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ receive message failed, errno=%d",
                  name.c_str(), errno);
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return android::base::Error(WOULD_BLOCK);
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
-            return android::base::Error(DEAD_OBJECT);
-        }
-        return android::base::Error(-error);
+        return android::base::Error(receiveErrorToStatus(error));
     }
 
     if (nRead == 0) { // check for EOF
@@ -466,6 +487,146 @@ android::base::Result<InputMessage> InputChannel::receiveMessage() {
     return msg;
 }
 
+android::base::Result<size_t> InputChannel::sendMessages(
+        std::span<const InputMessage* const> msgs) {
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("sendMessages(inputChannel=%s, count=%zu)", name.c_str(),
+                                msgs.size()));
+    size_t sent = 0;
+    while (sent < msgs.size()) {
+        InputMessage cleanMsg;
+        std::array<uint8_t, MAX_BYTES_PER_SEND_SYSCALL> cleanBytes;
+        std::array<iovec, MAX_MESSAGES_PER_SYSCALL> iovecs;
+        std::array<mmsghdr, MAX_MESSAGES_PER_SYSCALL> headers{};
+        size_t count = 0;
+        size_t usedBytes = 0;
+        while (count < MAX_MESSAGES_PER_SYSCALL && sent + count < msgs.size()) {
+            const InputMessage* msg = msgs[sent + count];
+            const size_t msgLength = msg->size();
+            if (usedBytes + msgLength > cleanBytes.size()) {
+                // Send the rest in the next syscall. The first message always fits.
+                break;
+            }
+            msg->getSanitizedCopy(&cleanMsg);
+            std::memcpy(cleanBytes.data() + usedBytes, &cleanMsg, msgLength);
+            iovecs[count] = {.iov_base = cleanBytes.data() + usedBytes, .iov_len = msgLength};
+            headers[count].msg_hdr.msg_iov = &iovecs[count];
+            headers[count].msg_hdr.msg_iovlen = 1;
+            usedBytes += msgLength;
+            count++;
+        }
+
+        int nSent;
+        do {
+            nSent = ::sendmmsg(getFd(), headers.data(), count, MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nSent == -1 && errno == EINTR);
+
+        if (nSent < 0) {
+            const int error = errno;
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending %zu messages, %s",
+                     name.c_str(), count, strerror(error));
+            if (sent > 0) {
+                // Report what made it out; the caller sees the error on its next send.
+                break;
+            }
+            return android::base::Error(sendErrorToStatus(error));
+        }
+
+        // SOCK_SEQPACKET sends each message whole, so a short write can't happen within one.
+        for (int i = 0; i < nSent; i++) {
+            if (headers[i].msg_len != iovecs[i].iov_len) {
+                ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                         "channel '%s' ~ error sending message type %s, send was incomplete",
+                         name.c_str(), ftl::enum_string(msgs[sent + i]->header.type).c_str());
+                return android::base::Error(DEAD_OBJECT);
+            }
+        }
+        sent += nSent;
+        if (static_cast<size_t>(nSent) < count) {
+            // The channel is full.
+            break;
+        }
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent %zu of %zu messages", name.c_str(),
+             sent, msgs.size());
+    return sent;
+}
+
+android::base::Result<size_t> InputChannel::receiveMessages(std::span<InputMessage> outMessages) {
+    if (mPendingReceiveError) {
+        const status_t error = *std::exchange(mPendingReceiveError, std::nullopt);
+        return android::base::Error(error);
+    }
+
+    size_t received = 0;
+    while (received < outMessages.size()) {
+        const size_t count = std::min(outMessages.size() - received, MAX_MESSAGES_PER_SYSCALL);
+        std::array<iovec, MAX_MESSAGES_PER_SYSCALL> iovecs;
+        std::array<mmsghdr, MAX_MESSAGES_PER_SYSCALL> headers{};
+        for (size_t i = 0; i < count; i++) {
+            iovecs[i] = {.iov_base = &outMessages[received + i], .iov_len = sizeof(InputMessage)};
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int nRead;
+        do {
+            nRead = ::recvmmsg(getFd(), headers.data(), count, MSG_DONTWAIT, /*timeout=*/nullptr);
+        } while (nRead == -1 && errno == EINTR);
+
+        if (nRead < 0) {
+            const int error = errno;
+            if (received > 0) {
+                // Hand out what was read; the error comes back on the next receive.
+                break;
+            }
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ receive messages failed, errno=%d",
+                     name.c_str(), error);
+            return android::base::Error(receiveErrorToStatus(error));
+        }
+
+        for (int i = 0; i < nRead; i++) {
+            const size_t length = headers[i].msg_len;
+            if (length == 0) { // check for EOF
+                if (received > 0) {
+                    // The EOF is seen again by the next receive.
+                    return received;
+                }
+                ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                         "channel '%s' ~ receive message failed because peer was closed",
+                         name.c_str());
+                return android::base::Error(DEAD_OBJECT);
+            }
+            const InputMessage& msg = outMessages[received];
+            if (!msg.isValid(length)) {
+                ALOGE("channel '%s' ~ received invalid message of size %zu", name.c_str(), length);
+                if (received > 0) {
+                    // Hand out the messages ahead of it first. Whatever was read after the
+                    // invalid message is dropped; the channel can't be trusted anymore.
+                    mPendingReceiveError = BAD_VALUE;
+                    return received;
+                }
+                return android::base::Error(BAD_VALUE);
+            }
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received message of type %s",
+                     name.c_str(), ftl::enum_string(msg.header.type).c_str());
+            received++;
+        }
+        if (static_cast<size_t>(nRead) < count) {
+            // The channel is drained.
+            break;
+        }
+    }
+
+    if (ATRACE_ENABLED()) {
+        std::string message = StringPrintf("receiveMessages(inputChannel=%s, count=%zu)",
+                                           name.c_str(), received);
+        ATRACE_NAME(message.c_str());
+    }
+    return received;
+}
+
 bool InputChannel::probablyHasInput() const {
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     if (::poll(&pfds, /*nfds=*/1, /*timeout=*/0) <= 0) {
@@ -567,7 +728,7 @@ status_t InputPublisher::publishKeyEvent(uint32_t seq, int32_t eventId, int32_t
     msg.body.key.repeatCount = repeatCount;
     msg.body.key.downTime = downTime;
     msg.body.key.eventTime = eventTime;
-    return mChannel->sendMessage(&msg);
+    return sendOrBatch(msg);
 }
 
 status_t InputPublisher::publishMotionEvent(
@@ -655,10 +816,10 @@ status_t InputPublisher::publishMotionEvent(
     msg.body.motion.pointerCount = pointerCount;
     for (uint32_t i = 0; i < pointerCount; i++) {
         msg.body.motion.pointers[i].properties = pointerProperties[i];
-        msg.body.motion.pointers[i].coords = pointerCoords[i];
+        msg.body.motion.pointers[i].coords.copyFrom(pointerCoords[i]);
     }
 
-    return mChannel->sendMessage(&msg);
+    return sendOrBatch(msg);
 }
 
 status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool hasFocus) {
@@ -673,7 +834,7 @@ status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool h
     msg.header.seq = seq;
     msg.body.focus.eventId = eventId;
     msg.body.focus.hasFocus = hasFocus;
-    return mChannel->sendMessage(&msg);
+    return sendOrBatch(msg);
 }
 
 status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
@@ -690,7 +851,7 @@ status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
     msg.header.seq = seq;
     msg.body.capture.eventId = eventId;
     msg.body.capture.pointerCaptureEnabled = pointerCaptureEnabled;
-    return mChannel->sendMessage(&msg);
+    return sendOrBatch(msg);
 }
 
 status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x, float y,
@@ -709,7 +870,7 @@ status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x
     msg.body.drag.isExiting = isExiting;
     msg.body.drag.x = x;
     msg.body.drag.y = y;
-    return mChannel->sendMessage(&msg);
+    return sendOrBatch(msg);
 }
 
 status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode) {
@@ -725,6 +886,40 @@ status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bo
     msg.header.seq = seq;
     msg.body.touchMode.eventId = eventId;
     msg.body.touchMode.isInTouchMode = isInTouchMode;
+    return sendOrBatch(msg);
+}
+
+void InputPublisher::beginBatch() {
+    LOG_ALWAYS_FATAL_IF(mBatching, "channel '%s' publisher ~ A batch was already started",
+                        mChannel->getName().c_str());
+    mBatching = true;
+}
+
+android::base::Result<size_t> InputPublisher::sendBatch() {
+    LOG_ALWAYS_FATAL_IF(!mBatching, "channel '%s' publisher ~ No batch was started",
+                        mChannel->getName().c_str());
+    mBatching = false;
+    if (mBatch.empty()) {
+        return 0;
+    }
+
+    mBatchMessages.clear();
+    for (const InputMessage& msg : mBatch) {
+        mBatchMessages.push_back(&msg);
+    }
+    android::base::Result<size_t> result = mChannel->sendMessages(mBatchMessages);
+    ALOGD_IF(debugTransportPublisher() && result.ok() && *result < mBatch.size(),
+             "channel '%s' publisher ~ %s: sent %zu of %zu events", mChannel->getName().c_str(),
+             __func__, *result, mBatch.size());
+    mBatch.clear();
+    return result;
+}
+
+status_t InputPublisher::sendOrBatch(const InputMessage& msg) {
+    if (mBatching) {
+        mBatch.push_back(msg);
+        return OK;
+    }
     return mChannel->sendMessage(&msg);
 }
 
@@ -21,8 +21,10 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <math.h>
+#include <algorithm>
 #include <array>
 #include <optional>
+#include <span>
 
 #include <input/PrintTools.h>
 #include <input/VelocityTracker.h>
@@ -119,7 +121,7 @@ static std::string vectorToString(const float* a, uint32_t m) {
     return str;
 }
 
-static std::string vectorToString(const std::vector<float>& v) {
+static std::string vectorToString(std::span<const float> v) {
     return vectorToString(v.data(), v.size());
 }
 
@@ -391,13 +393,28 @@ void AccumulatingVelocityTrackerStrategy::clearPointer(int32_t pointerId) {
     mMovements.erase(pointerId);
 }
 
+void AccumulatingVelocityTrackerStrategy::MovementHistory::pushBack(nsecs_t eventTime,
+                                                                   float position) {
+    if (mSize == HISTORY_SIZE) {
+        popFront();
+    }
+    if (mStart + mSize == mEventTimes.size()) {
+        std::copy_n(mEventTimes.begin() + mStart, mSize, mEventTimes.begin());
+        std::copy_n(mPositions.begin() + mStart, mSize, mPositions.begin());
+        mStart = 0;
+    }
+    mEventTimes[mStart + mSize] = eventTime;
+    mPositions[mStart + mSize] = position;
+    mSize++;
+}
+
 void AccumulatingVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t pointerId,
                                                       float position) {
-    auto [ringBufferIt, _] = mMovements.try_emplace(pointerId, HISTORY_SIZE);
-    RingBuffer<Movement>& movements = ringBufferIt->second;
+    auto [movementsIt, _] = mMovements.try_emplace(pointerId);
+    MovementHistory& movements = movementsIt->second;
     const size_t size = movements.size();
 
-    if (size != 0 && movements[size - 1].eventTime == eventTime) {
+    if (size != 0 && movements.eventTime(size - 1) == eventTime) {
         // When ACTION_POINTER_DOWN happens, we will first receive ACTION_MOVE with the coordinates
         // of the existing pointers, and then ACTION_POINTER_DOWN with the coordinates that include
         // the new pointer. If the eventtimes for both events are identical, just update the data
@@ -407,13 +424,13 @@ void AccumulatingVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t
         movements.popBack();
     }
 
-    movements.pushBack({eventTime, position});
+    movements.pushBack(eventTime, position);
 
     // Clear movements that do not fall within `mHorizonNanos` of the latest movement.
     // Note that, if in the future we decide to use more movements (i.e. increase HISTORY_SIZE),
     // we can consider making this step binary-search based, which will give us some improvement.
     if (mMaintainHorizonDuringAdd) {
-        while (eventTime - movements[0].eventTime > mHorizonNanos) {
+        while (eventTime - movements.eventTime(0) > mHorizonNanos) {
             movements.popFront();
         }
     }
@@ -479,9 +496,8 @@ LeastSquaresVelocityTrackerStrategy::~LeastSquaresVelocityTrackerStrategy() {}
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static std::optional<float> solveLeastSquares(const std::vector<float>& x,
-                                              const std::vector<float>& y,
-                                              const std::vector<float>& w, uint32_t n) {
+static std::optional<float> solveLeastSquares(std::span<const float> x, std::span<const float> y,
+                                              std::span<const float> w, uint32_t n) {
     const size_t m = x.size();
 
     ALOGD_IF(DEBUG_STRATEGY, "solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
@@ -601,19 +617,21 @@ static std::optional<float> solveLeastSquares(const std::vector<float>& x,
  * the default implementation
  */
 std::optional<float> LeastSquaresVelocityTrackerStrategy::solveUnweightedLeastSquaresDeg2(
-        const RingBuffer<Movement>& movements) const {
+        const MovementHistory& movements) const {
     // Solving y = a*x^2 + b*x + c, where
     //      - "x" is age (i.e. duration since latest movement) of the movemnets
     //      - "y" is positions of the movements.
+    const size_t count = movements.size();
+    const std::span<const nsecs_t> eventTimes = movements.eventTimes();
+    const std::span<const float> positions = movements.positions();
+
     float sxi = 0, sxiyi = 0, syi = 0, sxi2 = 0, sxi3 = 0, sxi2yi = 0, sxi4 = 0;
 
-    const size_t count = movements.size();
-    const Movement& newestMovement = movements[count - 1];
+    const nsecs_t newestEventTime = eventTimes[count - 1];
     for (size_t i = 0; i < count; i++) {
-        const Movement& movement = movements[i];
-        nsecs_t age = newestMovement.eventTime - movement.eventTime;
+        nsecs_t age = newestEventTime - eventTimes[i];
         float xi = -age * SECONDS_PER_NANO;
-        float yi = movement.position;
+        float yi = positions[i];
 
         float xi2 = xi*xi;
         float xi3 = xi2*xi;
@@ -651,7 +669,7 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
+    const MovementHistory& movements = movementIt->second;
     const size_t size = movements.size();
     if (size == 0) {
         return std::nullopt; // no data
@@ -672,25 +690,26 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
     }
 
     // Iterate over movement samples in reverse time order and collect samples.
-    std::vector<float> positions;
-    std::vector<float> w;
-    std::vector<float> time;
-
-    const Movement& newestMovement = movements[size - 1];
-    for (ssize_t i = size - 1; i >= 0; i--) {
-        const Movement& movement = movements[i];
-        nsecs_t age = newestMovement.eventTime - movement.eventTime;
-        positions.push_back(movement.position);
-        w.push_back(chooseWeight(pointerId, i));
-        time.push_back(-age * 0.000000001f);
+    std::array<float, HISTORY_SIZE> positions;
+    std::array<float, HISTORY_SIZE> w;
+    std::array<float, HISTORY_SIZE> time;
+
+    const nsecs_t newestEventTime = movements.eventTime(size - 1);
+    for (size_t i = 0; i < size; i++) {
+        const size_t index = size - 1 - i;
+        nsecs_t age = newestEventTime - movements.eventTime(index);
+        positions[i] = movements.position(index);
+        w[i] = chooseWeight(movements, index);
+        time[i] = -age * 0.000000001f;
     }
 
     // General case for an Nth degree polynomial fit
-    return solveLeastSquares(time, positions, w, degree + 1);
+    return solveLeastSquares({time.data(), size}, {positions.data(), size}, {w.data(), size},
+                             degree + 1);
 }
 
-float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint32_t index) const {
-    const RingBuffer<Movement>& movements = mMovements.at(pointerId);
+float LeastSquaresVelocityTrackerStrategy::chooseWeight(const MovementHistory& movements,
+                                                        uint32_t index) const {
     const size_t size = movements.size();
     switch (mWeighting) {
         case Weighting::DELTA: {
@@ -702,7 +721,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
                 return 1.0f;
             }
             float deltaMillis =
-                    (movements[index + 1].eventTime - movements[index].eventTime) * 0.000001f;
+                    (movements.eventTime(index + 1) - movements.eventTime(index)) * 0.000001f;
             if (deltaMillis < 0) {
                 return 0.5f;
             }
@@ -719,7 +738,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
             //   age 50ms: 1.0
             //   age 60ms: 0.5
             float ageMillis =
-                    (movements[size - 1].eventTime - movements[index].eventTime) * 0.000001f;
+                    (movements.eventTime(size - 1) - movements.eventTime(index)) * 0.000001f;
             if (ageMillis < 0) {
                 return 0.5f;
             }
@@ -741,7 +760,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
             //   age  50ms: 1.0
             //   age 100ms: 0.5
             float ageMillis =
-                    (movements[size - 1].eventTime - movements[index].eventTime) * 0.000001f;
+                    (movements.eventTime(size - 1) - movements.eventTime(index)) * 0.000001f;
             if (ageMillis < 50) {
                 return 1.0f;
             }
@@ -848,20 +867,17 @@ std::optional<float> LegacyVelocityTrackerStrategy::getVelocity(int32_t pointerI
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
+    const MovementHistory& movements = movementIt->second;
     const size_t size = movements.size();
     if (size == 0) {
         return std::nullopt; // no data
     }
 
-    const Movement& newestMovement = movements[size - 1];
-
     // Find the oldest sample that contains the pointer and that is not older than HORIZON.
-    nsecs_t minTime = newestMovement.eventTime - HORIZON;
+    nsecs_t minTime = movements.eventTime(size - 1) - HORIZON;
     uint32_t oldestIndex = size - 1;
     for (ssize_t i = size - 1; i >= 0; i--) {
-        const Movement& nextOldestMovement = movements[i];
-        if (nextOldestMovement.eventTime < minTime) {
+        if (movements.eventTime(i) < minTime) {
             break;
         }
         oldestIndex = i;
@@ -880,19 +896,18 @@ std::optional<float> LegacyVelocityTrackerStrategy::getVelocity(int32_t pointerI
     // the hardware or driver reports them irregularly or in bursts.
     float accumV = 0;
     uint32_t samplesUsed = 0;
-    const Movement& oldestMovement = movements[oldestIndex];
-    float oldestPosition = oldestMovement.position;
+    const nsecs_t oldestEventTime = movements.eventTime(oldestIndex);
+    float oldestPosition = movements.position(oldestIndex);
     nsecs_t lastDuration = 0;
 
     for (size_t i = oldestIndex; i < size; i++) {
-        const Movement& movement = movements[i];
-        nsecs_t duration = movement.eventTime - oldestMovement.eventTime;
+        nsecs_t duration = movements.eventTime(i) - oldestEventTime;
 
         // If the duration between samples is small, we may significantly overestimate
         // the velocity.  Consequently, we impose a minimum duration constraint on the
         // samples that we include in the calculation.
         if (duration >= MIN_DURATION) {
-            float position = movement.position;
+            float position = movements.position(i);
             float scale = 1000000000.0f / duration; // one over time delta in seconds
             float v = (position - oldestPosition) * scale;
             accumV = (accumV * lastDuration + v * duration) / (duration + lastDuration);
@@ -997,20 +1012,19 @@ std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointer
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
+    const MovementHistory& movements = movementIt->second;
     const size_t size = movements.size();
     if (size == 0) {
         return std::nullopt; // no data
     }
 
+    const std::span<const nsecs_t> eventTimes = movements.eventTimes();
+    const std::span<const float> positions = movements.positions();
     float work = 0;
     for (size_t i = 0; i < size - 1; i++) {
-        const Movement& mvt = movements[i];
-        const Movement& nextMvt = movements[i + 1];
-
         float vprev = kineticEnergyToVelocity(work);
-        float delta = mDeltaValues ? nextMvt.position : nextMvt.position - mvt.position;
-        float vcurr = delta / (SECONDS_PER_NANO * (nextMvt.eventTime - mvt.eventTime));
+        float delta = mDeltaValues ? positions[i + 1] : positions[i + 1] - positions[i];
+        float vcurr = delta / (SECONDS_PER_NANO * (eventTimes[i + 1] - eventTimes[i]));
         work += (vcurr - vprev) * fabsf(vcurr);
 
         if (i == 0) {
@@ -1027,8 +1041,7 @@ std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointer
         // X axis chosen arbitrarily for velocity comparisons.
         VelocityTracker lsq2(VelocityTracker::Strategy::LSQ2);
         for (size_t i = 0; i < size; i++) {
-            const Movement& mvt = movements[i];
-            lsq2.addMovement(mvt.eventTime, pointerId, AMOTION_EVENT_AXIS_X, mvt.position);
+            lsq2.addMovement(eventTimes[i], pointerId, AMOTION_EVENT_AXIS_X, positions[i]);
         }
         std::optional<float> v = lsq2.getVelocity(AMOTION_EVENT_AXIS_X, pointerId);
         if (v) {
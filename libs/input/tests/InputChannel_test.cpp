@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <sys/socket.h>
 
 #include <binder/Binder.h>
 #include <binder/Parcel.h>
@@ -227,6 +228,132 @@ TEST_F(InputChannelTest, SendAndReceive_MotionClassification) {
     }
 }
 
+TEST_F(InputChannelTest, SendMessagesAndReceiveMessages_PreservesOrder) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    // More than one syscall's worth of messages, of two different sizes.
+    constexpr size_t kMessageCount = 13;
+    std::array<InputMessage, kMessageCount> serverMsgs = {};
+    std::array<const InputMessage*, kMessageCount> serverMsgPtrs;
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        InputMessage& msg = serverMsgs[i];
+        msg.header.seq = i + 1;
+        if (i % 2 == 0) {
+            msg.header.type = InputMessage::Type::MOTION;
+            msg.body.motion.pointerCount = 1;
+        } else {
+            msg.header.type = InputMessage::Type::KEY;
+        }
+        serverMsgPtrs[i] = &msg;
+    }
+    android::base::Result<size_t> sendResult = serverChannel->sendMessages(serverMsgPtrs);
+    ASSERT_TRUE(sendResult.ok());
+    EXPECT_EQ(serverMsgs.size(), *sendResult);
+
+    std::array<InputMessage, 20> clientMsgs;
+    android::base::Result<size_t> receiveResult = clientChannel->receiveMessages(clientMsgs);
+    ASSERT_TRUE(receiveResult.ok());
+    ASSERT_EQ(serverMsgs.size(), *receiveResult);
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        EXPECT_EQ(serverMsgs[i].header.type, clientMsgs[i].header.type);
+        EXPECT_EQ(serverMsgs[i].header.seq, clientMsgs[i].header.seq);
+    }
+
+    receiveResult = clientChannel->receiveMessages(clientMsgs);
+    ASSERT_FALSE(receiveResult.ok());
+    EXPECT_EQ(WOULD_BLOCK, receiveResult.error().code());
+}
+
+TEST_F(InputChannelTest, SendMessages_WhenChannelFull_ReturnsNumberSent) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::MOTION;
+    msg.body.motion.pointerCount = MAX_POINTERS;
+    std::array<const InputMessage*, 64> msgPtrs;
+    msgPtrs.fill(&msg);
+
+    size_t totalSent = 0;
+    android::base::Result<size_t> sendResult = serverChannel->sendMessages(msgPtrs);
+    while (sendResult.ok()) {
+        ASSERT_GT(*sendResult, 0u);
+        totalSent += *sendResult;
+        sendResult = serverChannel->sendMessages(msgPtrs);
+    }
+    EXPECT_EQ(WOULD_BLOCK, sendResult.error().code());
+
+    // Everything reported as sent arrives.
+    size_t totalReceived = 0;
+    std::array<InputMessage, 16> clientMsgs;
+    android::base::Result<size_t> receiveResult = clientChannel->receiveMessages(clientMsgs);
+    while (receiveResult.ok()) {
+        totalReceived += *receiveResult;
+        receiveResult = clientChannel->receiveMessages(clientMsgs);
+    }
+    EXPECT_EQ(WOULD_BLOCK, receiveResult.error().code());
+    EXPECT_EQ(totalSent, totalReceived);
+}
+
+TEST_F(InputChannelTest, ReceiveMessages_WhenPeerClosed_ReturnsPendingMessagesFirst) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::KEY;
+    std::array<const InputMessage*, 2> msgPtrs = {&msg, &msg};
+    ASSERT_EQ(2u, serverChannel->sendMessages(msgPtrs).value_or(0));
+    serverChannel.reset(); // close server channel
+
+    std::array<InputMessage, 4> clientMsgs;
+    android::base::Result<size_t> receiveResult = clientChannel->receiveMessages(clientMsgs);
+    ASSERT_TRUE(receiveResult.ok());
+    EXPECT_EQ(2u, *receiveResult);
+
+    receiveResult = clientChannel->receiveMessages(clientMsgs);
+    ASSERT_FALSE(receiveResult.ok());
+    EXPECT_EQ(DEAD_OBJECT, receiveResult.error().code())
+            << "receiveMessages should have returned DEAD_OBJECT";
+}
+
+TEST_F(InputChannelTest, ReceiveMessages_WhenInvalidMessageFollows_ReturnsValidMessagesFirst) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name",
+            serverChannel, clientChannel);
+    ASSERT_EQ(OK, result)
+            << "should have successfully opened a channel pair";
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::KEY;
+    msg.header.seq = 1;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    // Too short for any message type.
+    const uint32_t garbage = 0;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(garbage)),
+              ::send(serverChannel->getFd(), &garbage, sizeof(garbage), MSG_DONTWAIT));
+
+    std::array<InputMessage, 4> clientMsgs;
+    android::base::Result<size_t> receiveResult = clientChannel->receiveMessages(clientMsgs);
+    ASSERT_TRUE(receiveResult.ok());
+    ASSERT_EQ(1u, *receiveResult);
+    EXPECT_EQ(1u, clientMsgs[0].header.seq);
+
+    receiveResult = clientChannel->receiveMessages(clientMsgs);
+    ASSERT_FALSE(receiveResult.ok());
+    EXPECT_EQ(BAD_VALUE, receiveResult.error().code())
+            << "receiveMessages should have returned BAD_VALUE";
+}
+
 TEST_F(InputChannelTest, DuplicateChannelAndAssertEqual) {
     std::unique_ptr<InputChannel> serverChannel, clientChannel;
 
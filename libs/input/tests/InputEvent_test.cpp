@@ -209,6 +209,43 @@ TEST_F(PointerCoordsTest, Parcel) {
     ASSERT_TRUE(outCoords.isResampled);
 }
 
+TEST_F(PointerCoordsTest, CopyFromOverwritesPresentAxes) {
+    PointerCoords inCoords;
+    inCoords.clear();
+    inCoords.setAxisValue(AMOTION_EVENT_AXIS_X, 5);
+    inCoords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5);
+    inCoords.isResampled = true;
+
+    // Start from coords that have more axes than the source.
+    PointerCoords outCoords;
+    outCoords.clear();
+    for (int32_t axis = 0; axis < PointerCoords::MAX_AXES; axis++) {
+        outCoords.setAxisValue(axis, axis + 100);
+    }
+
+    outCoords.copyFrom(inCoords);
+
+    ASSERT_EQ(inCoords, outCoords);
+    ASSERT_EQ(5, outCoords.getAxisValue(AMOTION_EVENT_AXIS_X));
+    ASSERT_EQ(0, outCoords.getAxisValue(AMOTION_EVENT_AXIS_Y));
+    ASSERT_EQ(0.5, outCoords.getAxisValue(AMOTION_EVENT_AXIS_PRESSURE));
+    ASSERT_TRUE(outCoords.isResampled);
+}
+
+TEST_F(PointerCoordsTest, CopyFromIgnoresExcessAxisBits) {
+    PointerCoords inCoords;
+    inCoords.clear();
+    inCoords.bits = ~0ULL;
+    inCoords.values.fill(1);
+
+    PointerCoords outCoords;
+    outCoords.clear();
+    outCoords.copyFrom(inCoords);
+
+    ASSERT_EQ(~0ULL, outCoords.bits);
+    ASSERT_EQ(1, outCoords.values[PointerCoords::MAX_AXES - 1]);
+}
+
 
 // --- KeyEventTest ---
 
@@ -607,6 +644,29 @@ TEST_F(MotionEventTest, CheckEventIdWithHistoryIsIncremented) {
     ASSERT_EQ(event.getId(), ARBITRARY_ID + 2);
 }
 
+TEST_F(MotionEventTest, AddSampleCopiesOnlyPresentAxes) {
+    // Coords staged with copyFrom leave the values past the present axes uninitialized.
+    PointerCoords stagedCoords[2];
+    for (size_t i = 0; i < 2; i++) {
+        stagedCoords[i].values.fill(-1);
+        stagedCoords[i].copyFrom(mSamples[1].pointerCoords[i]);
+    }
+
+    MotionEvent event;
+    initializeEventWithHistory(&event);
+    event.addSample(ARBITRARY_EVENT_TIME + 3, stagedCoords, event.getId());
+
+    ASSERT_EQ(3U, event.getHistorySize());
+    for (size_t i = 0; i < 2; i++) {
+        const PointerCoords& coords = event.getSamplePointerCoords()[3 * 2 + i];
+        ASSERT_EQ(mSamples[1].pointerCoords[i], coords);
+        const size_t count = BitSet64::count(coords.bits);
+        for (size_t axis = count; axis < PointerCoords::MAX_AXES; axis++) {
+            ASSERT_EQ(0, coords.values[axis]) << "value " << axis << " of pointer " << i;
+        }
+    }
+}
+
 TEST_F(MotionEventTest, SplitPointerDown) {
     MotionEvent event = MotionEventBuilder(POINTER_1_DOWN, AINPUT_SOURCE_TOUCHSCREEN)
                                 .downTime(ARBITRARY_DOWN_TIME)
@@ -698,4 +698,85 @@ TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(publishAndConsumeTouchModeEvent());
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_SendsEventsInOrder) {
+    const int32_t focusEventId = InputEvent::nextId();
+    const int32_t captureEventId = InputEvent::nextId();
+    const int32_t touchModeEventId = InputEvent::nextId();
+
+    mPublisher->beginBatch();
+    ASSERT_EQ(OK, mPublisher->publishFocusEvent(/*seq=*/1, focusEventId, /*hasFocus=*/true));
+    ASSERT_EQ(OK,
+              mPublisher->publishCaptureEvent(/*seq=*/2, captureEventId,
+                                              /*pointerCaptureEnabled=*/true));
+    ASSERT_EQ(OK,
+              mPublisher->publishTouchModeEvent(/*seq=*/3, touchModeEventId,
+                                                /*isInTouchMode=*/false));
+
+    // Nothing is sent until the batch is.
+    uint32_t consumeSeq;
+    InputEvent* event;
+    ASSERT_EQ(WOULD_BLOCK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                 &event));
+
+    Result<size_t> result = mPublisher->sendBatch();
+    ASSERT_TRUE(result.ok()) << "sendBatch should return OK";
+    EXPECT_EQ(3u, *result);
+
+    ASSERT_EQ(OK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                 &event));
+    ASSERT_EQ(InputEventType::FOCUS, event->getType());
+    EXPECT_EQ(1u, consumeSeq);
+    EXPECT_EQ(focusEventId, event->getId());
+
+    ASSERT_EQ(OK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                 &event));
+    ASSERT_EQ(InputEventType::CAPTURE, event->getType());
+    EXPECT_EQ(2u, consumeSeq);
+    EXPECT_EQ(captureEventId, event->getId());
+
+    ASSERT_EQ(OK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                 &event));
+    ASSERT_EQ(InputEventType::TOUCH_MODE, event->getType());
+    EXPECT_EQ(3u, consumeSeq);
+    EXPECT_EQ(touchModeEventId, event->getId());
+
+    // Publishing after the batch is sent goes out right away.
+    ASSERT_NO_FATAL_FAILURE(publishAndConsumeKeyEvent());
+}
+
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_WhenEmpty_SendsNothing) {
+    mPublisher->beginBatch();
+    Result<size_t> result = mPublisher->sendBatch();
+    ASSERT_TRUE(result.ok()) << "sendBatch should return OK";
+    EXPECT_EQ(0u, *result);
+}
+
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_WhenSequenceNumberIsZero_ReturnsError) {
+    PointerProperties pointerProperties;
+    PointerCoords pointerCoords;
+    pointerProperties.clear();
+    pointerCoords.clear();
+
+    ui::Transform identityTransform;
+    mPublisher->beginBatch();
+    status_t status =
+            mPublisher->publishMotionEvent(0, InputEvent::nextId(), 0, 0,
+                                           ui::LogicalDisplayId::DEFAULT, INVALID_HMAC, 0, 0, 0, 0,
+                                           0, 0, MotionClassification::NONE, identityTransform, 0,
+                                           0, AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                           AMOTION_EVENT_INVALID_CURSOR_POSITION, identityTransform,
+                                           0, 0, /*pointerCount=*/1, &pointerProperties,
+                                           &pointerCoords);
+    ASSERT_EQ(BAD_VALUE, status) << "publisher publishMotionEvent should return BAD_VALUE";
+
+    // The rejected event isn't part of the batch.
+    Result<size_t> result = mPublisher->sendBatch();
+    ASSERT_TRUE(result.ok()) << "sendBatch should return OK";
+    EXPECT_EQ(0u, *result);
+}
+
 } // namespace android
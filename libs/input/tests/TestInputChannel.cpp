@@ -73,6 +73,29 @@ base::Result<InputMessage> TestInputChannel::receiveMessage() {
     return message;
 }
 
+base::Result<size_t> TestInputChannel::sendMessages(
+        std::span<const InputMessage* const> messages) {
+    for (const InputMessage* message : messages) {
+        sendMessage(message);
+    }
+    return messages.size();
+}
+
+base::Result<size_t> TestInputChannel::receiveMessages(std::span<InputMessage> outMessages) {
+    size_t received = 0;
+    while (received < outMessages.size()) {
+        base::Result<InputMessage> message = receiveMessage();
+        if (!message.ok()) {
+            if (received > 0) {
+                break;
+            }
+            return base::Error(message.error().code());
+        }
+        outMessages[received++] = *message;
+    }
+    return received;
+}
+
 bool TestInputChannel::probablyHasInput() const {
     return !mReceivedMessages.empty();
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <queue>
+#include <span>
 #include <string>
 
 #include <android-base/result.h>
@@ -48,6 +49,17 @@ public:
      */
     base::Result<InputMessage> receiveMessage() override;
 
+    /**
+     * Sends the messages one by one with sendMessage.
+     */
+    base::Result<size_t> sendMessages(std::span<const InputMessage* const> messages) override;
+
+    /**
+     * Receives messages one by one with receiveMessage, until outMessages is full or
+     * mReceivedMessages is empty.
+     */
+    base::Result<size_t> receiveMessages(std::span<InputMessage> outMessages) override;
+
     /**
      * Returns if mReceivedMessages is not empty.
      */
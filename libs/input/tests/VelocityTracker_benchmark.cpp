@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <input/VelocityTracker.h>
+
+#include <chrono>
+
+namespace android {
+namespace {
+
+using namespace std::chrono_literals;
+
+// A 240 Hz touchscreen, so that a full history of samples fits in the strategies' horizon.
+constexpr nsecs_t SAMPLE_INTERVAL = std::chrono::nanoseconds(4ms).count();
+constexpr int32_t SAMPLE_COUNT = 20;
+
+// Adds one sample for every pointer, each moving along its own line.
+void addSample(VelocityTracker& tracker, nsecs_t eventTime, int32_t pointerCount) {
+    for (int32_t pointerId = 0; pointerId < pointerCount; pointerId++) {
+        const float progress = eventTime * 1E-6f;
+        tracker.addMovement(eventTime, pointerId, AMOTION_EVENT_AXIS_X,
+                            100 + pointerId * 50 + progress * 2.5f);
+        tracker.addMovement(eventTime, pointerId, AMOTION_EVENT_AXIS_Y,
+                            800 - progress * (1 + pointerId * 0.25f));
+    }
+}
+
+// A fling: the planar velocity of every pointer is queried once per frame, with a full history.
+void BM_GetPlanarVelocity(benchmark::State& state) {
+    const auto strategy = static_cast<VelocityTracker::Strategy>(state.range(0));
+    const int32_t pointerCount = state.range(1);
+    VelocityTracker tracker(strategy);
+    for (int32_t i = 0; i < SAMPLE_COUNT; i++) {
+        addSample(tracker, i * SAMPLE_INTERVAL, pointerCount);
+    }
+
+    for (auto _ : state) {
+        for (int32_t pointerId = 0; pointerId < pointerCount; pointerId++) {
+            benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_X, pointerId));
+            benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_Y, pointerId));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * pointerCount * 2);
+}
+BENCHMARK(BM_GetPlanarVelocity)
+        ->ArgsProduct({{static_cast<int64_t>(VelocityTracker::Strategy::LSQ2),
+                        static_cast<int64_t>(VelocityTracker::Strategy::LSQ1),
+                        static_cast<int64_t>(VelocityTracker::Strategy::LSQ3),
+                        static_cast<int64_t>(VelocityTracker::Strategy::WLSQ2_DELTA),
+                        static_cast<int64_t>(VelocityTracker::Strategy::IMPULSE),
+                        static_cast<int64_t>(VelocityTracker::Strategy::LEGACY)},
+                       {1, 2, 5, 10}});
+
+// Adding the samples of a frame and querying the velocities, as a view tracking a drag does.
+void BM_AddMovementAndGetPlanarVelocity(benchmark::State& state) {
+    const auto strategy = static_cast<VelocityTracker::Strategy>(state.range(0));
+    const int32_t pointerCount = state.range(1);
+    VelocityTracker tracker(strategy);
+    nsecs_t eventTime = 0;
+    for (int32_t i = 0; i < SAMPLE_COUNT; i++) {
+        addSample(tracker, eventTime, pointerCount);
+        eventTime += SAMPLE_INTERVAL;
+    }
+
+    for (auto _ : state) {
+        addSample(tracker, eventTime, pointerCount);
+        eventTime += SAMPLE_INTERVAL;
+        for (int32_t pointerId = 0; pointerId < pointerCount; pointerId++) {
+            benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_X, pointerId));
+            benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_Y, pointerId));
+        }
+    }
+}
+BENCHMARK(BM_AddMovementAndGetPlanarVelocity)
+        ->ArgsProduct({{static_cast<int64_t>(VelocityTracker::Strategy::LSQ2),
+                        static_cast<int64_t>(VelocityTracker::Strategy::IMPULSE)},
+                       {1, 5}});
+
+// A rotary encoder or scroll wheel, whose deltas always go to the impulse strategy.
+void BM_GetScrollVelocity(benchmark::State& state) {
+    VelocityTracker tracker;
+    for (int32_t i = 0; i < SAMPLE_COUNT; i++) {
+        tracker.addMovement(i * SAMPLE_INTERVAL, /*pointerId=*/0, AMOTION_EVENT_AXIS_SCROLL,
+                            i % 3 == 0 ? 0.5f : 1.0f);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_SCROLL, /*pointerId=*/0));
+    }
+}
+BENCHMARK(BM_GetScrollVelocity);
+
+// getComputedVelocity, which computes every axis of every pointer at once.
+void BM_GetComputedVelocity(benchmark::State& state) {
+    const int32_t pointerCount = state.range(0);
+    VelocityTracker tracker;
+    for (int32_t i = 0; i < SAMPLE_COUNT; i++) {
+        addSample(tracker, i * SAMPLE_INTERVAL, pointerCount);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tracker.getComputedVelocity(/*units=*/1000,
+                                                             /*maxVelocity=*/8000));
+    }
+}
+BENCHMARK(BM_GetComputedVelocity)->Arg(1)->Arg(5)->Arg(10);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -19,6 +19,8 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#include <algorithm>
+
 #include <android-base/stringprintf.h>
 
 #include <utils/Log.h>
@@ -329,6 +331,10 @@ Region& Region::subtractSelf(const Rect& r) {
     return operationSelf(r, op_nand);
 }
 Region& Region::operationSelf(const Rect& r, uint32_t op) {
+    // the fast paths update this in place, without copying it first
+    if (fast_boolean_operation(op, *this, *this, &r, 1, r, 0, 0)) {
+        return *this;
+    }
     Region lhs(*this);
     boolean_operation(op, *this, lhs, r);
     return *this;
@@ -353,9 +359,7 @@ Region& Region::subtractSelf(const Region& rhs) {
     return operationSelf(rhs, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, uint32_t op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, rhs);
-    return *this;
+    return operationSelf(rhs, 0, 0, op);
 }
 
 Region& Region::translateSelf(int x, int y) {
@@ -438,6 +442,15 @@ Region& Region::subtractSelf(const Region& rhs, int dx, int dy) {
     return operationSelf(rhs, dx, dy, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, int dx, int dy, uint32_t op) {
+    // the fast paths update this in place, without copying it first
+    if (&rhs != this) {
+        size_t rhs_count;
+        Rect const* const rhs_rects = rhs.getArray(&rhs_count);
+        if (fast_boolean_operation(op, *this, *this, rhs_rects, rhs_count, rhs.getBounds(), dx,
+                                   dy)) {
+            return *this;
+        }
+    }
     Region lhs(*this);
     boolean_operation(op, *this, lhs, rhs, dx, dy);
     return *this;
@@ -467,7 +480,7 @@ const Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) c
 
 // This is our region rasterizer, which merges rects and spans together
 // to obtain an optimal region.
-class Region::rasterizer : public region_operator<Rect>::region_rasterizer
+class Region::rasterizer final : public region_operator<Rect>::region_rasterizer
 {
     Rect bounds;
     FatVector<Rect>& storage;
@@ -563,6 +576,203 @@ void Region::rasterizer::flushSpan()
     span.clear();
 }
 
+// ----------------------------------------------------------------------------
+
+static inline bool rectContains(const Rect& outer, const Rect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top && outer.right >= inner.right &&
+            outer.bottom >= inner.bottom;
+}
+
+// Appends the spans of a valid region to storage, which holds the spans of a
+// region above it, without its bounds. Like the rasterizer, the first span is
+// merged into the last one in storage if they touch and have the same rects.
+static void appendSpans(FatVector<Rect>& storage, Rect const* rects, size_t count, int dx,
+                        int dy) {
+    Rect const* const end = rects + count;
+    if (!storage.empty() && storage.back().bottom == rects->top + dy) {
+        const int32_t lastTop = storage.back().top;
+        size_t lastBegin = storage.size() - 1;
+        while (lastBegin > 0 && storage[lastBegin - 1].top == lastTop) {
+            lastBegin--;
+        }
+        Rect const* firstEnd = rects;
+        while (firstEnd != end && firstEnd->top == rects->top) {
+            firstEnd++;
+        }
+        bool merge = size_t(firstEnd - rects) == storage.size() - lastBegin;
+        for (size_t i = lastBegin; merge && i < storage.size(); i++) {
+            const Rect& r = rects[i - lastBegin];
+            merge = storage[i].left == r.left + dx && storage[i].right == r.right + dx;
+        }
+        if (merge) {
+            for (size_t i = lastBegin; i < storage.size(); i++) {
+                storage[i].bottom = rects->bottom + dy;
+            }
+            rects = firstEnd;
+        }
+    }
+    for (; rects != end; rects++) {
+        storage.push_back(Rect(rects->left + dx, rects->top + dy, rects->right + dx,
+                               rects->bottom + dy));
+    }
+}
+
+// Terminates storage holding a region's spans with its bounds, unless it only
+// has one rect.
+static void finishStorage(FatVector<Rect>& storage, const Rect& bounds) {
+    if (storage.size() > 1) {
+        storage.push_back(bounds);
+    }
+}
+
+bool Region::fast_boolean_operation(uint32_t op, Region& dst, const Region& lhs,
+        Rect const* rhs, size_t rhs_count, const Rect& rhs_bounds, int dx, int dy)
+{
+    const Rect lb = lhs.getBounds();
+    Rect rb = rhs_bounds;
+    rb.offsetBy(dx, dy);
+    // leave signal values such as INVALID_RECT to the spanner
+    if (!lb.isValid() || !rb.isValid()) {
+        return false;
+    }
+
+    // a lone rect may be an element of dst
+    Rect rhsRect;
+    if (rhs_count == 1) {
+        rhsRect = *rhs;
+        rhs = &rhsRect;
+    }
+
+    const bool lhsEmpty = lb.isEmpty();
+    const bool rhsEmpty = rb.isEmpty();
+    const bool overlap = !lhsEmpty && !rhsEmpty && lb.left < rb.right && rb.left < lb.right &&
+            lb.top < rb.bottom && rb.top < lb.bottom;
+    const bool lhsIsRect = lhs.isRect();
+    const bool rhsIsRect = rhs_count == 1;
+
+    // the spans of rhs, moved to dst
+    auto setToRhs = [&]() {
+        dst.mStorage.clear();
+        appendSpans(dst.mStorage, rhs, rhs_count, dx, dy);
+        finishStorage(dst.mStorage, rb);
+    };
+
+    switch (op) {
+        case op_and:
+            if (!overlap) {
+                dst.clear();
+                return true;
+            }
+            if (rhsIsRect && rectContains(rb, lb)) {
+                dst = lhs;
+                return true;
+            }
+            if (lhsIsRect && rectContains(lb, rb)) {
+                setToRhs();
+                return true;
+            }
+            if (lhsIsRect && rhsIsRect) {
+                Rect r;
+                lb.intersect(rb, &r);
+                dst.set(r);
+                return true;
+            }
+            return false;
+
+        case op_nand:
+            if (lhsEmpty) {
+                dst.clear();
+                return true;
+            }
+            if (!overlap) {
+                dst = lhs;
+                return true;
+            }
+            if (rhsIsRect && rectContains(rb, lb)) {
+                dst.clear();
+                return true;
+            }
+            if (lhsIsRect && rhsIsRect) {
+                // rhs cuts a hole into lhs, or a piece off of it, leaving at
+                // most one span above, one in the middle and one below it
+                const int32_t top = std::max(lb.top, rb.top);
+                const int32_t bottom = std::min(lb.bottom, rb.bottom);
+                FatVector<Rect>& storage = dst.mStorage;
+                storage.clear();
+                if (lb.top < rb.top) {
+                    storage.push_back(Rect(lb.left, lb.top, lb.right, rb.top));
+                }
+                if (lb.left < rb.left) {
+                    storage.push_back(Rect(lb.left, top, rb.left, bottom));
+                }
+                if (rb.right < lb.right) {
+                    storage.push_back(Rect(rb.right, top, lb.right, bottom));
+                }
+                if (rb.bottom < lb.bottom) {
+                    storage.push_back(Rect(lb.left, rb.bottom, lb.right, lb.bottom));
+                }
+                Rect bounds(INT_MAX, storage.front().top, INT_MIN, storage.back().bottom);
+                for (const Rect& r : storage) {
+                    bounds.left = std::min(bounds.left, r.left);
+                    bounds.right = std::max(bounds.right, r.right);
+                }
+                finishStorage(storage, bounds);
+                return true;
+            }
+            return false;
+
+        case op_or:
+        case op_xor:
+            if (lhsEmpty && rhsEmpty) {
+                dst.clear();
+                return true;
+            }
+            if (rhsEmpty) {
+                dst = lhs;
+                return true;
+            }
+            if (lhsEmpty) {
+                setToRhs();
+                return true;
+            }
+            if (op == op_or && rhsIsRect && rectContains(rb, lb)) {
+                dst.set(rb);
+                return true;
+            }
+            if (op == op_or && lhsIsRect && rectContains(lb, rb)) {
+                dst = lhs;
+                return true;
+            }
+            // regions in separate bands are simply stacked
+            if (lb.bottom <= rb.top || rb.bottom <= lb.top) {
+                const Rect bounds(std::min(lb.left, rb.left), std::min(lb.top, rb.top),
+                                  std::max(lb.right, rb.right), std::max(lb.bottom, rb.bottom));
+                size_t lhs_count;
+                Rect const* const lhs_rects = lhs.getArray(&lhs_count);
+                FatVector<Rect>& storage = dst.mStorage;
+                if (lb.bottom <= rb.top) {
+                    if (&dst != &lhs) {
+                        storage.assign(lhs_rects, lhs_rects + lhs_count);
+                    } else if (!lhsIsRect) {
+                        storage.pop_back(); // the bounds
+                    }
+                    appendSpans(storage, rhs, rhs_count, dx, dy);
+                } else {
+                    if (&dst == &lhs) {
+                        return false;
+                    }
+                    storage.clear();
+                    appendSpans(storage, rhs, rhs_count, dx, dy);
+                    appendSpans(storage, lhs_rects, lhs_count, 0, 0);
+                }
+                finishStorage(storage, bounds);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
 bool Region::validate(const Region& reg, const char* name, bool silent)
 {
     if (reg.mStorage.empty()) {
@@ -659,12 +869,14 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     size_t rhs_count;
     Rect const * const rhs_rects = rhs.getArray(&rhs_count);
 
-    region_operator<Rect>::region lhs_region(lhs_rects, lhs_count);
-    region_operator<Rect>::region rhs_region(rhs_rects, rhs_count, dx, dy);
-    region_operator<Rect> operation(op, lhs_region, rhs_region);
-    { // scope for rasterizer (dtor has side effects)
-        rasterizer r(dst);
-        operation(r);
+    if (!fast_boolean_operation(op, dst, lhs, rhs_rects, rhs_count, rhs.getBounds(), dx, dy)) {
+        region_operator<Rect>::region lhs_region(lhs_rects, lhs_count);
+        region_operator<Rect>::region rhs_region(rhs_rects, rhs_count, dx, dy);
+        region_operator<Rect> operation(op, lhs_region, rhs_region);
+        { // scope for rasterizer (dtor has side effects)
+            rasterizer r(dst);
+            operation(r);
+        }
     }
 
 #if defined(VALIDATE_REGIONS)
@@ -770,6 +982,10 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
+    if (fast_boolean_operation(op, dst, lhs, &rhs, 1, rhs, dx, dy)) {
+        return;
+    }
+
     region_operator<Rect>::region lhs_region(lhs_rects, lhs_count);
     region_operator<Rect>::region rhs_region(&rhs, 1, dx, dy);
     region_operator<Rect> operation(op, lhs_region, rhs_region);
@@ -163,6 +163,12 @@ private:
 
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Region& rhs, int dx, int dy);
+    // Computes operations whose result can be built directly from the
+    // operands, without running the spanner: empty, disjoint or containing
+    // operands, and operations between two rects. dst may be lhs, but must
+    // not hold rhs. Returns false if the operation wasn't handled.
+    static bool fast_boolean_operation(uint32_t op, Region& dst, const Region& lhs,
+            Rect const* rhs, size_t rhs_count, const Rect& rhs_bounds, int dx, int dy);
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Rect& rhs, int dx, int dy);
 
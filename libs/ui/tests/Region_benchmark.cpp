@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace android {
+namespace {
+
+const Rect kDisplay(0, 0, 1080, 2400);
+const Rect kStatusBar(0, 0, 1080, 100);
+const Rect kNavigationBar(0, 2270, 1080, 2400);
+
+// A window with rounded corners of the given radius, approximated with a
+// band for each row of the corners, like a layer's transparent region.
+Region roundedRect(const Rect& bounds, int radius) {
+    Region region(Rect(bounds.left, bounds.top + radius, bounds.right, bounds.bottom - radius));
+    for (int i = 0; i < radius; i++) {
+        const int inset = radius - static_cast<int>(std::sqrt(radius * radius - (radius - i) *
+                                                                                      (radius - i)));
+        region.orSelf(Rect(bounds.left + inset, bounds.top + i, bounds.right - inset,
+                           bounds.top + i + 1));
+        region.orSelf(Rect(bounds.left + inset, bounds.bottom - i - 1, bounds.right - inset,
+                           bounds.bottom - i));
+    }
+    return region;
+}
+
+Region randomRegion(std::mt19937& rng, size_t rects) {
+    std::uniform_int_distribution<int> x(0, kDisplay.right);
+    std::uniform_int_distribution<int> y(0, kDisplay.bottom);
+    Region region;
+    for (size_t i = 0; i < rects; i++) {
+        const int l = x(rng);
+        const int t = y(rng);
+        region.orSelf(Rect(l, t, l + x(rng) / 4, t + y(rng) / 4));
+    }
+    return region;
+}
+
+// The visible region of a fullscreen app under the system bars.
+void BM_RectMinusRect(benchmark::State& state) {
+    for (auto _ : state) {
+        Region visible(kDisplay);
+        visible.subtractSelf(kStatusBar);
+        visible.subtractSelf(kNavigationBar);
+        benchmark::DoNotOptimize(visible);
+    }
+}
+BENCHMARK(BM_RectMinusRect);
+
+// A dialog covering the middle of an app.
+void BM_RectWithHole(benchmark::State& state) {
+    const Rect dialog(100, 800, 980, 1600);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Region(kDisplay).subtract(dialog));
+    }
+}
+BENCHMARK(BM_RectWithHole);
+
+void BM_IntersectContained(benchmark::State& state) {
+    const Region window = roundedRect(Rect(100, 400, 980, 2000), 32);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(window.intersect(kDisplay));
+    }
+}
+BENCHMARK(BM_IntersectContained);
+
+// Dirty regions of a few layers, accumulated from top to bottom.
+void BM_UnionOfBands(benchmark::State& state) {
+    const size_t bands = state.range(0);
+    std::vector<Region> dirty;
+    for (size_t i = 0; i < bands; i++) {
+        const int top = static_cast<int>(i * kDisplay.bottom / bands);
+        dirty.push_back(Region(Rect(0, top, kDisplay.right / 2, top + 10)));
+    }
+    for (auto _ : state) {
+        Region region;
+        for (const Region& r : dirty) {
+            region.orSelf(r);
+        }
+        benchmark::DoNotOptimize(region);
+    }
+}
+BENCHMARK(BM_UnionOfBands)->Arg(2)->Arg(8)->Arg(32);
+
+// The opaque region of a rounded window removed from what is below it.
+void BM_SubtractRoundedWindow(benchmark::State& state) {
+    const Region window = roundedRect(Rect(100, 400, 980, 2000), state.range(0));
+    for (auto _ : state) {
+        Region covered(kDisplay);
+        covered.subtractSelf(window);
+        benchmark::DoNotOptimize(covered);
+    }
+}
+BENCHMARK(BM_SubtractRoundedWindow)->Arg(8)->Arg(32)->Arg(64);
+
+void BM_RandomRegions(benchmark::State& state) {
+    const size_t rects = state.range(1);
+    std::mt19937 rng(42);
+    std::vector<Region> regions;
+    for (size_t i = 0; i < 64; i++) {
+        regions.push_back(randomRegion(rng, rects));
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const Region& lhs = regions[i % regions.size()];
+        const Region& rhs = regions[(i + 1) % regions.size()];
+        switch (state.range(0)) {
+            case 0:
+                benchmark::DoNotOptimize(lhs.merge(rhs));
+                break;
+            case 1:
+                benchmark::DoNotOptimize(lhs.intersect(rhs));
+                break;
+            case 2:
+                benchmark::DoNotOptimize(lhs.subtract(rhs));
+                break;
+            case 3:
+                benchmark::DoNotOptimize(lhs.mergeExclusive(rhs));
+                break;
+        }
+        i++;
+    }
+}
+// the first argument is merge, intersect, subtract or mergeExclusive
+BENCHMARK(BM_RandomRegions)->ArgsProduct({{0, 1, 2, 3}, {1, 4, 16}});
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -179,5 +179,117 @@ TEST_F(RegionTest, RegionHash) {
     EXPECT_NE(std::hash<Region>{}(region1), std::hash<Region>{}(region2));
 }
 
+// Checks the result of an operation on lhs and rhs pixel by pixel.
+static void expectPixels(const Region& lhs, const Region& rhs, const Region& result,
+                         bool (*op)(bool, bool)) {
+    for (int y = -2; y < 44; y++) {
+        for (int x = -2; x < 44; x++) {
+            ASSERT_EQ(op(lhs.contains(x, y), rhs.contains(x, y)), result.contains(x, y))
+                    << "at " << x << "," << y;
+        }
+    }
+}
+
+TEST_F(RegionTest, RectMinusRect) {
+    const Rect screen(0, 0, 100, 200);
+    Region r(screen);
+
+    // hole in the middle
+    r.subtractSelf(Rect(10, 20, 30, 40));
+    ASSERT_EQ(4, r.end() - r.begin());
+    EXPECT_EQ(Rect(0, 0, 100, 20), r.begin()[0]);
+    EXPECT_EQ(Rect(0, 20, 10, 40), r.begin()[1]);
+    EXPECT_EQ(Rect(30, 20, 100, 40), r.begin()[2]);
+    EXPECT_EQ(Rect(0, 40, 100, 200), r.begin()[3]);
+    EXPECT_EQ(screen, r.getBounds());
+
+    // cut off the top, leaving a rect
+    r.set(screen);
+    r.subtractSelf(Rect(-10, -10, 200, 50));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(0, 50, 100, 200), r.getBounds());
+
+    // cut off a corner
+    r.set(screen);
+    r.subtractSelf(Rect(50, 150, 100, 200));
+    ASSERT_EQ(2, r.end() - r.begin());
+    EXPECT_EQ(Rect(0, 0, 100, 150), r.begin()[0]);
+    EXPECT_EQ(Rect(0, 150, 50, 200), r.begin()[1]);
+    EXPECT_EQ(screen, r.getBounds());
+
+    // cut out a column
+    r.set(screen);
+    r.subtractSelf(Rect(40, -5, 60, 205));
+    ASSERT_EQ(2, r.end() - r.begin());
+    EXPECT_EQ(Rect(0, 0, 40, 200), r.begin()[0]);
+    EXPECT_EQ(Rect(60, 0, 100, 200), r.begin()[1]);
+
+    // everything, or nothing
+    r.set(screen);
+    r.subtractSelf(Rect(-1, -1, 101, 201));
+    EXPECT_TRUE(r.isEmpty());
+    r.set(screen);
+    r.subtractSelf(Rect(100, 0, 200, 200));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(screen, r.getBounds());
+}
+
+TEST_F(RegionTest, StackedRegionsMerge) {
+    Region r(Rect(0, 0, 100, 10));
+    r.orSelf(Rect(0, 10, 100, 20));
+    EXPECT_TRUE(r.isRect());
+    EXPECT_EQ(Rect(0, 0, 100, 20), r.getBounds());
+
+    r.orSelf(Rect(0, 30, 50, 40));
+    r.orSelf(Rect(0, 40, 50, 50));
+    ASSERT_EQ(2, r.end() - r.begin());
+    EXPECT_EQ(Rect(0, 0, 100, 20), r.begin()[0]);
+    EXPECT_EQ(Rect(0, 30, 50, 50), r.begin()[1]);
+    EXPECT_EQ(Rect(0, 0, 100, 50), r.getBounds());
+
+    // stacked above, and translated into place
+    Region above(Rect(0, 0, 50, 10));
+    Region merged = r.merge(above, 0, -10);
+    ASSERT_EQ(3, merged.end() - merged.begin());
+    EXPECT_EQ(Rect(0, -10, 50, 0), merged.begin()[0]);
+    EXPECT_EQ(Rect(0, -10, 100, 50), merged.getBounds());
+}
+
+TEST_F(RegionTest, RandomRegionsAndRects) {
+    auto randomRect = []() {
+        const int l = static_cast<int>(random() % 30);
+        const int t = static_cast<int>(random() % 30);
+        return Rect(l, t, l + static_cast<int>(random() % 12),
+                    t + static_cast<int>(random() % 12));
+    };
+    srandom(4321);
+    for (int iter = 0; iter < ITER_MAX / 10; iter++) {
+        Region lhs;
+        for (int i = static_cast<int>(random() % 4); i > 0; i--) {
+            lhs.orSelf(randomRect());
+        }
+        Region rhs;
+        for (int i = static_cast<int>(random() % 3); i > 0; i--) {
+            rhs.orSelf(randomRect());
+        }
+        if (random() % 2) rhs.set(randomRect());
+
+        expectPixels(lhs, rhs, lhs.merge(rhs), [](bool l, bool r) { return l || r; });
+        expectPixels(lhs, rhs, lhs.mergeExclusive(rhs), [](bool l, bool r) { return l != r; });
+        expectPixels(lhs, rhs, lhs.intersect(rhs), [](bool l, bool r) { return l && r; });
+        expectPixels(lhs, rhs, lhs.subtract(rhs), [](bool l, bool r) { return l && !r; });
+
+        // updating in place gives the same rects
+        Region self = lhs;
+        self.subtractSelf(rhs);
+        EXPECT_TRUE(self.hasSameRects(lhs.subtract(rhs)));
+        EXPECT_EQ(self.getBounds(), lhs.subtract(rhs).getBounds());
+        self = lhs;
+        self.andSelf(rhs);
+        EXPECT_TRUE(self.hasSameRects(lhs.intersect(rhs)));
+        EXPECT_EQ(self.getBounds(), lhs.intersect(rhs).getBounds());
+    }
+}
+
 }; // namespace android
 
@@ -16,6 +16,8 @@
 
 #include <benchmark/benchmark.h>
 
+#include <cmath>
+
 #include <android/os/IInputConstants.h>
 #include <binder/Binder.h>
 #include "../dispatcher/InputDispatcher.h"
@@ -195,11 +197,70 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
     dispatcher->stop();
 }
 
+static void benchmarkHitTest(benchmark::State& state) {
+    const size_t windowCount = state.range(0);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    auto dispatcher = std::make_unique<InputDispatcher>(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    // Tile the display with windows, and touch the one at the bottom of the z-order, so that
+    // every window in front of it has to be ruled out.
+    constexpr int32_t DISPLAY_WIDTH = 1080;
+    constexpr int32_t DISPLAY_HEIGHT = 2400;
+    const int32_t columns = std::ceil(std::sqrt(windowCount));
+    const int32_t rows = (windowCount + columns - 1) / columns;
+    const int32_t tileWidth = DISPLAY_WIDTH / columns;
+    const int32_t tileHeight = DISPLAY_HEIGHT / rows;
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> windows;
+    std::vector<gui::WindowInfo> windowInfos;
+    for (size_t i = 0; i < windowCount; i++) {
+        sp<FakeWindowHandle> window =
+                sp<FakeWindowHandle>::make(application, dispatcher,
+                                           "Fake Window " + std::to_string(i), DISPLAY_ID);
+        const int32_t left = (i % columns) * tileWidth;
+        const int32_t top = (i / columns) * tileHeight;
+        window->setFrame(Rect(left, top, left + tileWidth, top + tileHeight));
+        windows.push_back(window);
+        windowInfos.push_back(*window->getInfo());
+    }
+    dispatcher->onWindowInfosChanged({windowInfos, {}, 0, 0});
+
+    const sp<FakeWindowHandle>& touchedWindow = windows.back();
+    const Rect& frame = touchedWindow->getInfo()->frame;
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    motionArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, (frame.left + frame.right) / 2);
+    motionArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, (frame.top + frame.bottom) / 2);
+
+    for (auto _ : state) {
+        // Send ACTION_DOWN
+        motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+        motionArgs.downTime = now();
+        motionArgs.eventTime = motionArgs.downTime;
+        dispatcher->notifyMotion(motionArgs);
+
+        // Send ACTION_UP
+        motionArgs.action = AMOTION_EVENT_ACTION_UP;
+        motionArgs.eventTime = now();
+        dispatcher->notifyMotion(motionArgs);
+
+        touchedWindow->consumeMotionEvent();
+        touchedWindow->consumeMotionEvent();
+    }
+
+    dispatcher->stop();
+}
+
 } // namespace
 
 BENCHMARK(benchmarkNotifyMotion);
 BENCHMARK(benchmarkInjectMotion);
 BENCHMARK(benchmarkOnWindowInfosChanged);
+BENCHMARK(benchmarkHitTest)->RangeMultiplier(4)->Range(1, 256);
 
 } // namespace android::inputdispatcher
 
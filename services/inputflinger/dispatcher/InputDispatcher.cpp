@@ -155,6 +155,9 @@ constexpr std::chrono::milliseconds SLOW_INTERCEPTION_THRESHOLD = 50ms;
 // Number of recent events to keep for debugging purposes.
 constexpr size_t RECENT_QUEUE_MAX_SIZE = 10;
 
+// Number of events from the outbound queue that are sent to a connection together.
+constexpr size_t MAX_DISPATCH_ENTRIES_PER_BATCH = 8;
+
 // Event log tags. See EventLogTags.logtags for reference.
 constexpr int LOGTAG_INPUT_INTERACTION = 62000;
 constexpr int LOGTAG_INPUT_FOCUS = 62001;
@@ -572,9 +575,9 @@ bool isUserActivityEvent(const EventEntry& eventEntry) {
     }
 }
 
-// Returns true if the given window can accept pointer events at the given display location.
-bool windowAcceptsTouchAt(const WindowInfo& windowInfo, ui::LogicalDisplayId displayId, float x,
-                          float y, bool isStylus, const ui::Transform& displayTransform) {
+// Returns true if the given window can accept pointer events, wherever they are on the display.
+bool windowAcceptsTouch(const WindowInfo& windowInfo, ui::LogicalDisplayId displayId,
+                        bool isStylus) {
     const auto inputConfig = windowInfo.inputConfig;
     if (windowInfo.displayId != displayId ||
         inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
@@ -584,6 +587,15 @@ bool windowAcceptsTouchAt(const WindowInfo& windowInfo, ui::LogicalDisplayId dis
     if (inputConfig.test(WindowInfo::InputConfig::NOT_TOUCHABLE) && !windowCanInterceptTouch) {
         return false;
     }
+    return true;
+}
+
+// Returns true if the given window can accept pointer events at the given display location.
+bool windowAcceptsTouchAt(const WindowInfo& windowInfo, ui::LogicalDisplayId displayId, float x,
+                          float y, bool isStylus, const ui::Transform& displayTransform) {
+    if (!windowAcceptsTouch(windowInfo, displayId, isStylus)) {
+        return false;
+    }
 
     // Window Manager works in the logical display coordinate space. When it specifies bounds for a
     // window as (l, t, r, b), the range of x in [l, r) and y in [t, b) are considered to be inside
@@ -1432,22 +1444,35 @@ void InputDispatcher::addRecentEventLocked(std::shared_ptr<const EventEntry> ent
 sp<WindowInfoHandle> InputDispatcher::findTouchedWindowAtLocked(ui::LogicalDisplayId displayId,
                                                                 float x, float y, bool isStylus,
                                                                 bool ignoreDragWindow) const {
-    // Traverse windows from front to back to find touched window.
+    // Traverse the windows under the location from front to back to find touched window.
     const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    for (const size_t index : getTouchableRegionIndexLocked(displayId).findWindowsAt(x, y)) {
+        const sp<WindowInfoHandle>& windowHandle = windowHandles[index];
         if (ignoreDragWindow && haveSameToken(windowHandle, mDragState->dragWindow)) {
             continue;
         }
 
         const WindowInfo& info = *windowHandle->getInfo();
-        if (!info.isSpy() &&
-            windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
+        if (!info.isSpy() && windowAcceptsTouch(info, displayId, isStylus)) {
             return windowHandle;
         }
     }
     return nullptr;
 }
 
+const TouchableRegionIndex& InputDispatcher::getTouchableRegionIndexLocked(
+        ui::LogicalDisplayId displayId) const {
+    auto it = mTouchableRegionIndexByDisplay.find(displayId);
+    if (it == mTouchableRegionIndexByDisplay.end()) {
+        it = mTouchableRegionIndexByDisplay
+                     .emplace(displayId,
+                              TouchableRegionIndex(getWindowHandlesLocked(displayId),
+                                                   getTransformLocked(displayId)))
+                     .first;
+    }
+    return it->second;
+}
+
 std::vector<InputTarget> InputDispatcher::findOutsideTargetsLocked(
         ui::LogicalDisplayId displayId, const sp<WindowInfoHandle>& touchedWindow,
         int32_t pointerId) const {
@@ -3784,6 +3809,100 @@ status_t InputDispatcher::publishMotionEvent(Connection& connection,
                                 motionEntry.pointerProperties.data(), usingCoords);
 }
 
+status_t InputDispatcher::publishDispatchEntryLocked(Connection& connection,
+                                                     DispatchEntry& dispatchEntry) {
+    const EventEntry& eventEntry = *(dispatchEntry.eventEntry);
+    status_t status;
+    switch (eventEntry.type) {
+        case EventEntry::Type::KEY: {
+            const KeyEntry& keyEntry = static_cast<const KeyEntry&>(eventEntry);
+            std::array<uint8_t, 32> hmac = getSignature(keyEntry, dispatchEntry);
+            if (DEBUG_OUTBOUND_EVENT_DETAILS) {
+                LOG(INFO) << "Publishing " << dispatchEntry << " to "
+                          << connection.getInputChannelName();
+            }
+
+            // Publish the key event.
+            status = connection.inputPublisher
+                             .publishKeyEvent(dispatchEntry.seq, keyEntry.id,
+                                              keyEntry.deviceId, keyEntry.source,
+                                              keyEntry.displayId, std::move(hmac),
+                                              keyEntry.action, dispatchEntry.resolvedFlags,
+                                              keyEntry.keyCode, keyEntry.scanCode,
+                                              keyEntry.metaState, keyEntry.repeatCount,
+                                              keyEntry.downTime, keyEntry.eventTime);
+            if (mTracer) {
+                ensureEventTraced(keyEntry);
+                mTracer->traceEventDispatch(dispatchEntry, *keyEntry.traceTracker);
+            }
+            break;
+        }
+
+        case EventEntry::Type::MOTION: {
+            if (DEBUG_OUTBOUND_EVENT_DETAILS) {
+                LOG(INFO) << "Publishing " << dispatchEntry << " to "
+                          << connection.getInputChannelName();
+            }
+            const MotionEntry& motionEntry = static_cast<const MotionEntry&>(eventEntry);
+            status = publishMotionEvent(connection, dispatchEntry);
+            if (status == BAD_VALUE) {
+                logDispatchStateLocked();
+                LOG(FATAL) << "Publisher failed for " << motionEntry;
+            }
+            if (mTracer) {
+                ensureEventTraced(motionEntry);
+                mTracer->traceEventDispatch(dispatchEntry, *motionEntry.traceTracker);
+            }
+            break;
+        }
+
+        case EventEntry::Type::FOCUS: {
+            const FocusEntry& focusEntry = static_cast<const FocusEntry&>(eventEntry);
+            status = connection.inputPublisher.publishFocusEvent(dispatchEntry.seq,
+                                                                  focusEntry.id,
+                                                                  focusEntry.hasFocus);
+            break;
+        }
+
+        case EventEntry::Type::TOUCH_MODE_CHANGED: {
+            const TouchModeEntry& touchModeEntry =
+                    static_cast<const TouchModeEntry&>(eventEntry);
+            status = connection.inputPublisher
+                             .publishTouchModeEvent(dispatchEntry.seq, touchModeEntry.id,
+                                                    touchModeEntry.inTouchMode);
+
+            break;
+        }
+
+        case EventEntry::Type::POINTER_CAPTURE_CHANGED: {
+            const auto& captureEntry =
+                    static_cast<const PointerCaptureChangedEntry&>(eventEntry);
+            status =
+                    connection.inputPublisher
+                            .publishCaptureEvent(dispatchEntry.seq, captureEntry.id,
+                                                 captureEntry.pointerCaptureRequest.isEnable());
+            break;
+        }
+
+        case EventEntry::Type::DRAG: {
+            const DragEntry& dragEntry = static_cast<const DragEntry&>(eventEntry);
+            status = connection.inputPublisher.publishDragEvent(dispatchEntry.seq,
+                                                                 dragEntry.id, dragEntry.x,
+                                                                 dragEntry.y,
+                                                                 dragEntry.isExiting);
+            break;
+        }
+
+        case EventEntry::Type::DEVICE_RESET:
+        case EventEntry::Type::SENSOR: {
+            LOG_ALWAYS_FATAL("Should never start dispatch cycles for %s events",
+                             ftl::enum_string(eventEntry.type).c_str());
+            return BAD_VALUE;
+        }
+    }
+    return status;
+}
+
 void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                                                const std::shared_ptr<Connection>& connection) {
     ATRACE_NAME_IF(ATRACE_ENABLED(),
@@ -3794,104 +3913,44 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
     }
 
     while (connection->status == Connection::Status::NORMAL && !connection->outboundQueue.empty()) {
-        std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
-        dispatchEntry->deliveryTime = currentTime;
+        // Publish the front of the outbound queue as one batch, so that a burst of events reaches
+        // the application with a single syscall rather than one per event.
         const std::chrono::nanoseconds timeout = getDispatchingTimeoutLocked(connection);
-        dispatchEntry->timeoutTime = currentTime + timeout.count();
-
-        // Publish the event.
-        status_t status;
-        const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
-        switch (eventEntry.type) {
-            case EventEntry::Type::KEY: {
-                const KeyEntry& keyEntry = static_cast<const KeyEntry&>(eventEntry);
-                std::array<uint8_t, 32> hmac = getSignature(keyEntry, *dispatchEntry);
-                if (DEBUG_OUTBOUND_EVENT_DETAILS) {
-                    LOG(INFO) << "Publishing " << *dispatchEntry << " to "
-                              << connection->getInputChannelName();
-                }
-
-                // Publish the key event.
-                status = connection->inputPublisher
-                                 .publishKeyEvent(dispatchEntry->seq, keyEntry.id,
-                                                  keyEntry.deviceId, keyEntry.source,
-                                                  keyEntry.displayId, std::move(hmac),
-                                                  keyEntry.action, dispatchEntry->resolvedFlags,
-                                                  keyEntry.keyCode, keyEntry.scanCode,
-                                                  keyEntry.metaState, keyEntry.repeatCount,
-                                                  keyEntry.downTime, keyEntry.eventTime);
-                if (mTracer) {
-                    ensureEventTraced(keyEntry);
-                    mTracer->traceEventDispatch(*dispatchEntry, *keyEntry.traceTracker);
-                }
-                break;
-            }
-
-            case EventEntry::Type::MOTION: {
-                if (DEBUG_OUTBOUND_EVENT_DETAILS) {
-                    LOG(INFO) << "Publishing " << *dispatchEntry << " to "
-                              << connection->getInputChannelName();
-                }
-                const MotionEntry& motionEntry = static_cast<const MotionEntry&>(eventEntry);
-                status = publishMotionEvent(*connection, *dispatchEntry);
-                if (status == BAD_VALUE) {
-                    logDispatchStateLocked();
-                    LOG(FATAL) << "Publisher failed for " << motionEntry;
-                }
-                if (mTracer) {
-                    ensureEventTraced(motionEntry);
-                    mTracer->traceEventDispatch(*dispatchEntry, *motionEntry.traceTracker);
-                }
-                break;
-            }
-
-            case EventEntry::Type::FOCUS: {
-                const FocusEntry& focusEntry = static_cast<const FocusEntry&>(eventEntry);
-                status = connection->inputPublisher.publishFocusEvent(dispatchEntry->seq,
-                                                                      focusEntry.id,
-                                                                      focusEntry.hasFocus);
-                break;
-            }
-
-            case EventEntry::Type::TOUCH_MODE_CHANGED: {
-                const TouchModeEntry& touchModeEntry =
-                        static_cast<const TouchModeEntry&>(eventEntry);
-                status = connection->inputPublisher
-                                 .publishTouchModeEvent(dispatchEntry->seq, touchModeEntry.id,
-                                                        touchModeEntry.inTouchMode);
-
-                break;
-            }
-
-            case EventEntry::Type::POINTER_CAPTURE_CHANGED: {
-                const auto& captureEntry =
-                        static_cast<const PointerCaptureChangedEntry&>(eventEntry);
-                status =
-                        connection->inputPublisher
-                                .publishCaptureEvent(dispatchEntry->seq, captureEntry.id,
-                                                     captureEntry.pointerCaptureRequest.isEnable());
-                break;
-            }
-
-            case EventEntry::Type::DRAG: {
-                const DragEntry& dragEntry = static_cast<const DragEntry&>(eventEntry);
-                status = connection->inputPublisher.publishDragEvent(dispatchEntry->seq,
-                                                                     dragEntry.id, dragEntry.x,
-                                                                     dragEntry.y,
-                                                                     dragEntry.isExiting);
+        connection->inputPublisher.beginBatch();
+        size_t batched = 0;
+        status_t publishStatus = OK;
+        while (batched < MAX_DISPATCH_ENTRIES_PER_BATCH &&
+               batched < connection->outboundQueue.size()) {
+            DispatchEntry& dispatchEntry = *connection->outboundQueue[batched];
+            dispatchEntry.deliveryTime = currentTime;
+            dispatchEntry.timeoutTime = currentTime + timeout.count();
+            publishStatus = publishDispatchEntryLocked(*connection, dispatchEntry);
+            if (publishStatus != OK) {
                 break;
             }
+            batched++;
+        }
+        const Result<size_t> result = connection->inputPublisher.sendBatch();
+        const size_t sent = result.ok() ? *result : 0;
 
-            case EventEntry::Type::DEVICE_RESET:
-            case EventEntry::Type::SENSOR: {
-                LOG_ALWAYS_FATAL("Should never start dispatch cycles for %s events",
-                                 ftl::enum_string(eventEntry.type).c_str());
-                return;
+        // Re-enqueue the events that were sent on the wait queue.
+        for (size_t i = 0; i < sent; i++) {
+            std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
+            const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
+            connection->waitQueue.emplace_back(std::move(dispatchEntry));
+            connection->outboundQueue.pop_front();
+            if (connection->responsive) {
+                mAnrTracker.insert(timeoutTime, connection->getToken());
             }
         }
+        if (sent > 0) {
+            traceOutboundQueueLength(*connection);
+            traceWaitQueueLength(*connection);
+        }
 
         // Check the result.
-        if (status) {
+        if (!result.ok()) {
+            const status_t status = result.error().code();
             if (status == WOULD_BLOCK) {
                 if (connection->waitQueue.empty()) {
                     ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
@@ -3919,16 +3978,24 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
             }
             return;
         }
-
-        // Re-enqueue the event on the wait queue.
-        const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
-        connection->waitQueue.emplace_back(std::move(dispatchEntry));
-        connection->outboundQueue.erase(connection->outboundQueue.begin());
-        traceOutboundQueueLength(*connection);
-        if (connection->responsive) {
-            mAnrTracker.insert(timeoutTime, connection->getToken());
+        if (publishStatus != OK) {
+            ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
+                  "status=%s(%d)",
+                  connection->getInputChannelName().c_str(), statusToString(publishStatus).c_str(),
+                  publishStatus);
+            abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
+            return;
+        }
+        if (sent < batched) {
+            // The pipe filled up part way through the batch. Wait for the application to catch
+            // up before sending the rest.
+            if (DEBUG_DISPATCH_CYCLE) {
+                ALOGD("channel '%s' ~ Sent %zu of %zu events because the pipe is full, "
+                      "waiting for the application to catch up",
+                      connection->getInputChannelName().c_str(), sent, batched);
+            }
+            return;
         }
-        traceWaitQueueLength(*connection);
     }
 }
 
@@ -5279,6 +5346,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (windowInfoHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mTouchableRegionIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -5323,6 +5391,14 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
         }
     }
 
+    // Drop the hit-testing index if the geometry of the display changed. Window handles are
+    // updated every frame, but the touchable regions rarely move.
+    if (const auto it = mTouchableRegionIndexByDisplay.find(displayId);
+        it != mTouchableRegionIndexByDisplay.end() &&
+        !it->second.isUpToDate(newHandles, getTransformLocked(displayId))) {
+        mTouchableRegionIndexByDisplay.erase(it);
+    }
+
     // Insert or replace
     mWindowHandlesByDisplay[displayId] = newHandles;
 }
@@ -7068,6 +7144,11 @@ void InputDispatcher::onWindowInfosChanged(const gui::WindowInfosUpdate& update)
         }
     }
 
+    std::unordered_map<ui::LogicalDisplayId, gui::DisplayInfo> displayInfos;
+    for (const auto& displayInfo : update.displayInfos) {
+        displayInfos.emplace(displayInfo.displayId, displayInfo);
+    }
+
     { // acquire lock
         std::scoped_lock _l(mLock);
 
@@ -7077,10 +7158,7 @@ void InputDispatcher::onWindowInfosChanged(const gui::WindowInfosUpdate& update)
             handlesPerDisplay[displayId];
         }
 
-        mDisplayInfos.clear();
-        for (const auto& displayInfo : update.displayInfos) {
-            mDisplayInfos.emplace(displayInfo.displayId, displayInfo);
-        }
+        mDisplayInfos = std::move(displayInfos);
 
         for (const auto& [displayId, handles] : handlesPerDisplay) {
             setInputWindowsLocked(handles, displayId);
@@ -31,6 +31,7 @@
 #include "LatencyTracker.h"
 #include "Monitor.h"
 #include "TouchState.h"
+#include "TouchableRegionIndex.h"
 #include "TouchedWindow.h"
 #include "trace/InputTracerInterface.h"
 #include "trace/InputTracingBackendInterface.h"
@@ -365,6 +366,12 @@ private:
             mWindowHandlesByDisplay GUARDED_BY(mLock);
     std::unordered_map<ui::LogicalDisplayId /*displayId*/, android::gui::DisplayInfo> mDisplayInfos
             GUARDED_BY(mLock);
+    // Hit-testing index over the windows in mWindowHandlesByDisplay. Built on the first lookup
+    // after the geometry of a display changes.
+    mutable std::unordered_map<ui::LogicalDisplayId /*displayId*/, TouchableRegionIndex>
+            mTouchableRegionIndexByDisplay GUARDED_BY(mLock);
+    const TouchableRegionIndex& getTouchableRegionIndexLocked(ui::LogicalDisplayId displayId) const
+            REQUIRES(mLock);
     void setInputWindowsLocked(
             const std::vector<sp<android::gui::WindowInfoHandle>>& inputWindowHandles,
             ui::LogicalDisplayId displayId) REQUIRES(mLock);
@@ -605,6 +612,8 @@ private:
                                     std::shared_ptr<const EventEntry>,
                                     const InputTarget& inputTarget) REQUIRES(mLock);
     status_t publishMotionEvent(Connection& connection, DispatchEntry& dispatchEntry) const;
+    status_t publishDispatchEntryLocked(Connection& connection, DispatchEntry& dispatchEntry)
+            REQUIRES(mLock);
     void startDispatchCycleLocked(nsecs_t currentTime,
                                   const std::shared_ptr<Connection>& connection) REQUIRES(mLock);
     void finishDispatchCycleLocked(nsecs_t currentTime,
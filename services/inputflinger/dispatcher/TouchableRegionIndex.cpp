@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TouchableRegionIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace android::inputdispatcher {
+
+namespace {
+
+int32_t divideRoundingUp(int64_t value, int32_t divisor) {
+    return static_cast<int32_t>((value + divisor - 1) / divisor);
+}
+
+} // namespace
+
+TouchableRegionIndex::TouchableRegionIndex(
+        const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+        const ui::Transform& displayTransform)
+      : mDisplayTransform(displayTransform) {
+    mTouchableRegions.reserve(windowHandles.size());
+    mTransformedRegions.reserve(windowHandles.size());
+    bool hasBounds = false;
+    for (const sp<gui::WindowInfoHandle>& windowHandle : windowHandles) {
+        const Region& touchableRegion = windowHandle->getInfo()->touchableRegion;
+        mTouchableRegions.push_back(touchableRegion);
+        // Window Manager works in the logical display coordinate space, so that is where the
+        // right and bottom edges of the region are excluded from the window. See
+        // windowAcceptsTouchAt in InputDispatcher.cpp.
+        mTransformedRegions.push_back(displayTransform.transform(touchableRegion));
+        const Region& region = mTransformedRegions.back();
+        if (region.isEmpty()) {
+            continue;
+        }
+        const Rect bounds = region.getBounds();
+        if (!hasBounds) {
+            mBounds = bounds;
+            hasBounds = true;
+        } else {
+            mBounds.left = std::min(mBounds.left, bounds.left);
+            mBounds.top = std::min(mBounds.top, bounds.top);
+            mBounds.right = std::max(mBounds.right, bounds.right);
+            mBounds.bottom = std::max(mBounds.bottom, bounds.bottom);
+        }
+    }
+    if (!hasBounds) {
+        return;
+    }
+
+    mCellWidth = divideRoundingUp(int64_t(mBounds.right) - mBounds.left, GRID_SIZE);
+    mCellHeight = divideRoundingUp(int64_t(mBounds.bottom) - mBounds.top, GRID_SIZE);
+    mCells.resize(GRID_SIZE * GRID_SIZE);
+    for (size_t i = 0; i < mTransformedRegions.size(); i++) {
+        const Region& region = mTransformedRegions[i];
+        if (region.isEmpty()) {
+            continue;
+        }
+        const Rect bounds = region.getBounds();
+        const int32_t firstColumn = (int64_t(bounds.left) - mBounds.left) / mCellWidth;
+        const int32_t lastColumn = (int64_t(bounds.right) - 1 - mBounds.left) / mCellWidth;
+        const int32_t firstRow = (int64_t(bounds.top) - mBounds.top) / mCellHeight;
+        const int32_t lastRow = (int64_t(bounds.bottom) - 1 - mBounds.top) / mCellHeight;
+        for (int32_t row = firstRow; row <= lastRow; row++) {
+            for (int32_t column = firstColumn; column <= lastColumn; column++) {
+                mCells[row * GRID_SIZE + column].push_back(i);
+            }
+        }
+    }
+}
+
+bool TouchableRegionIndex::isUpToDate(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                                      const ui::Transform& displayTransform) const {
+    if (windowHandles.size() != mTouchableRegions.size() ||
+        !(displayTransform == mDisplayTransform)) {
+        return false;
+    }
+    for (size_t i = 0; i < windowHandles.size(); i++) {
+        if (!windowHandles[i]->getInfo()->touchableRegion.hasSameRects(mTouchableRegions[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<size_t> TouchableRegionIndex::findWindowsAt(float x, float y) const {
+    std::vector<size_t> windows;
+    if (mCells.empty()) {
+        return windows;
+    }
+    const vec2 p = mDisplayTransform.transform(x, y);
+    const double px = std::floor(p.x);
+    const double py = std::floor(p.y);
+    // Compare before converting, so that locations far off the display can't overflow below.
+    if (!(px >= mBounds.left && px < mBounds.right && py >= mBounds.top && py < mBounds.bottom)) {
+        return windows;
+    }
+    const int32_t ix = static_cast<int32_t>(px);
+    const int32_t iy = static_cast<int32_t>(py);
+    const int32_t column = (int64_t(ix) - mBounds.left) / mCellWidth;
+    const int32_t row = (int64_t(iy) - mBounds.top) / mCellHeight;
+    for (const uint32_t i : mCells[row * GRID_SIZE + column]) {
+        if (mTransformedRegions[i].contains(ix, iy)) {
+            windows.push_back(i);
+        }
+    }
+    return windows;
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <gui/WindowInfo.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android::inputdispatcher {
+
+// Spatial index over the touchable regions of the windows on one display, used to hit-test a touch
+// without transforming and testing the touchable region of every window on the display.
+//
+// The touchable regions are transformed into the logical display space once, when the index is
+// built, and bucketed into a coarse grid over their combined bounds. A lookup only tests the
+// windows in the grid cell that contains the touch.
+//
+// The index only knows about geometry. Windows are identified by their position in the list of
+// window handles the index was built from, and callers are expected to check the window flags
+// themselves.
+class TouchableRegionIndex {
+public:
+    TouchableRegionIndex(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                         const ui::Transform& displayTransform);
+
+    // Returns true if the index was built from the same touchable regions, in the same order, and
+    // the same display transform. Window handles are often updated without their geometry
+    // changing, in which case the index can be kept.
+    bool isUpToDate(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                    const ui::Transform& displayTransform) const;
+
+    // Returns the positions of the windows whose touchable region contains the given display
+    // location, front to back.
+    std::vector<size_t> findWindowsAt(float x, float y) const;
+
+private:
+    // Number of grid cells along each axis.
+    static constexpr int32_t GRID_SIZE = 8;
+
+    ui::Transform mDisplayTransform;
+    // Touchable regions as given in the window infos, to detect changes.
+    std::vector<Region> mTouchableRegions;
+    // Touchable regions in the logical display space.
+    std::vector<Region> mTransformedRegions;
+
+    // Combined bounds of all the transformed regions, and the size of one grid cell.
+    Rect mBounds;
+    int32_t mCellWidth = 1;
+    int32_t mCellHeight = 1;
+    // Window positions, front to back, of the regions that overlap each cell. Row major.
+    std::vector<std::vector<uint32_t>> mCells;
+};
+
+} // namespace android::inputdispatcher
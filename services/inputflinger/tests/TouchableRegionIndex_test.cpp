@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "../dispatcher/TouchableRegionIndex.h"
+
+// atest inputflinger_tests:TouchableRegionIndexTest
+
+using android::gui::WindowInfoHandle;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+class FakeWindowHandle : public WindowInfoHandle {
+public:
+    explicit FakeWindowHandle(const Rect& touchableRegion) {
+        mInfo.touchableRegion = Region(touchableRegion);
+    }
+
+    void setTouchableRegion(const Region& region) { mInfo.touchableRegion = region; }
+};
+
+std::vector<sp<WindowInfoHandle>> makeWindows(const std::vector<Rect>& touchableRegions) {
+    std::vector<sp<WindowInfoHandle>> windows;
+    for (const Rect& touchableRegion : touchableRegions) {
+        windows.push_back(sp<FakeWindowHandle>::make(touchableRegion));
+    }
+    return windows;
+}
+
+} // namespace
+
+TEST(TouchableRegionIndexTest, FindsOverlappingWindowsFrontToBack) {
+    const auto windows = makeWindows({
+            Rect(100, 100, 200, 200),
+            Rect(0, 0, 1000, 2000),
+            Rect(150, 150, 300, 300),
+    });
+    TouchableRegionIndex index(windows, ui::Transform());
+
+    EXPECT_THAT(index.findWindowsAt(175, 175), ElementsAre(0, 1, 2));
+    EXPECT_THAT(index.findWindowsAt(120, 120), ElementsAre(0, 1));
+    EXPECT_THAT(index.findWindowsAt(250, 250), ElementsAre(1, 2));
+    EXPECT_THAT(index.findWindowsAt(900, 1900), ElementsAre(1));
+    EXPECT_THAT(index.findWindowsAt(1000, 1000), IsEmpty());
+    EXPECT_THAT(index.findWindowsAt(-1, 10), IsEmpty());
+}
+
+TEST(TouchableRegionIndexTest, RightAndBottomEdgesAreExcluded) {
+    const auto windows = makeWindows({Rect(10, 10, 20, 20)});
+    TouchableRegionIndex index(windows, ui::Transform());
+
+    EXPECT_THAT(index.findWindowsAt(10, 10), ElementsAre(0));
+    EXPECT_THAT(index.findWindowsAt(19.9, 19.9), ElementsAre(0));
+    EXPECT_THAT(index.findWindowsAt(20, 15), IsEmpty());
+    EXPECT_THAT(index.findWindowsAt(15, 20), IsEmpty());
+}
+
+TEST(TouchableRegionIndexTest, HonorsNonRectangularRegions) {
+    const auto windows = makeWindows({Rect(0, 0, 100, 100)});
+    Region region(Rect(0, 0, 100, 100));
+    region.subtractSelf(Rect(40, 40, 60, 60));
+    static_cast<FakeWindowHandle*>(windows[0].get())->setTouchableRegion(region);
+    TouchableRegionIndex index(windows, ui::Transform());
+
+    EXPECT_THAT(index.findWindowsAt(10, 10), ElementsAre(0));
+    EXPECT_THAT(index.findWindowsAt(50, 50), IsEmpty());
+}
+
+TEST(TouchableRegionIndexTest, HitTestsInTheLogicalDisplaySpace) {
+    // The display is rotated by 90 degrees. The logical display is 100x200.
+    ui::Transform displayTransform(ui::Transform::ROT_90, /*logicalDisplayWidth=*/100,
+                                   /*logicalDisplayHeight=*/200);
+    const auto windows = makeWindows({Rect(0, 0, 50, 50)});
+    TouchableRegionIndex index(windows, displayTransform);
+
+    for (const auto [x, y] : {std::pair<float, float>{10, 10}, {49, 49}, {60, 10}, {10, 60}}) {
+        const vec2 p = displayTransform.transform(x, y);
+        const bool inside = p.x >= 0 && p.x < 50 && p.y >= 0 && p.y < 50;
+        EXPECT_EQ(inside, !index.findWindowsAt(x, y).empty()) << "at " << x << ", " << y;
+    }
+}
+
+TEST(TouchableRegionIndexTest, IsUpToDateOnlyForSameGeometry) {
+    const auto windows = makeWindows({Rect(0, 0, 100, 100), Rect(50, 50, 150, 150)});
+    TouchableRegionIndex index(windows, ui::Transform());
+
+    EXPECT_TRUE(index.isUpToDate(makeWindows({Rect(0, 0, 100, 100), Rect(50, 50, 150, 150)}),
+                                 ui::Transform()));
+    EXPECT_FALSE(index.isUpToDate(makeWindows({Rect(0, 0, 100, 100), Rect(50, 50, 150, 151)}),
+                                  ui::Transform()));
+    EXPECT_FALSE(index.isUpToDate(makeWindows({Rect(0, 0, 100, 100)}), ui::Transform()));
+    EXPECT_FALSE(index.isUpToDate(windows,
+                                  ui::Transform(ui::Transform::ROT_90, /*logicalDisplayWidth=*/100,
+                                                /*logicalDisplayHeight=*/200)));
+}
+
+TEST(TouchableRegionIndexTest, EmptyIndexFindsNothing) {
+    TouchableRegionIndex index({}, ui::Transform());
+    EXPECT_THAT(index.findWindowsAt(0, 0), IsEmpty());
+
+    TouchableRegionIndex emptyRegions(makeWindows({Rect::EMPTY_RECT}), ui::Transform());
+    EXPECT_THAT(emptyRegions.findWindowsAt(0, 0), IsEmpty());
+}
+
+} // namespace android::inputdispatcher
@@ -887,22 +887,35 @@ namespace impl {
 
 int64_t TokenManager::generateTokenForPredictions(TimelineItem&& predictions) {
     SFTRACE_CALL();
-    std::scoped_lock lock(mMutex);
-    while (mPredictions.size() >= kMaxTokens) {
-        mPredictions.erase(mPredictions.begin());
-    }
-    const int64_t assignedToken = mCurrentToken++;
-    mPredictions[assignedToken] = predictions;
+    const int64_t assignedToken = mCurrentToken.fetch_add(1, std::memory_order_relaxed);
+    PredictionSlot& slot = mPredictions[static_cast<size_t>(assignedToken) % kMaxTokens];
+    // Invalidate the slot before touching the predictions so that a concurrent reader of the
+    // expiring token notices the overwrite.
+    slot.token.store(FrameTimelineInfo::INVALID_VSYNC_ID, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.startTime.store(predictions.startTime, std::memory_order_relaxed);
+    slot.endTime.store(predictions.endTime, std::memory_order_relaxed);
+    slot.presentTime.store(predictions.presentTime, std::memory_order_relaxed);
+    slot.token.store(assignedToken, std::memory_order_release);
     return assignedToken;
 }
 
 std::optional<TimelineItem> TokenManager::getPredictionsForToken(int64_t token) const {
-    std::scoped_lock lock(mMutex);
-    auto predictionsIterator = mPredictions.find(token);
-    if (predictionsIterator != mPredictions.end()) {
-        return predictionsIterator->second;
+    if (token <= FrameTimelineInfo::INVALID_VSYNC_ID) {
+        return {};
     }
-    return {};
+    const PredictionSlot& slot = mPredictions[static_cast<size_t>(token) % kMaxTokens];
+    if (slot.token.load(std::memory_order_acquire) != token) {
+        return {};
+    }
+    TimelineItem predictions(slot.startTime.load(std::memory_order_relaxed),
+                             slot.endTime.load(std::memory_order_relaxed),
+                             slot.presentTime.load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.token.load(std::memory_order_relaxed) != token) {
+        return {};
+    }
+    return predictions;
 }
 
 FrameTimeline::FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surfaceFlingerPid,
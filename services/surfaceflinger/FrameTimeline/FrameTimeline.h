@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -347,6 +348,11 @@ public:
 
 namespace impl {
 
+/*
+ * Keeps the predictions for the last kMaxTokens tokens in a ring indexed by token % kMaxTokens.
+ * Tokens only ever grow, so a slot that no longer holds the requested token means the predictions
+ * have expired. Generating and looking up tokens never takes a lock.
+ */
 class TokenManager : public android::frametimeline::TokenManager {
 public:
     TokenManager() : mCurrentToken(FrameTimelineInfo::INVALID_VSYNC_ID + 1) {}
@@ -359,12 +365,20 @@ private:
     // Friend class for testing
     friend class android::frametimeline::FrameTimelineTest;
 
-    void flushTokens(nsecs_t flushTime) REQUIRES(mMutex);
+    // The token is stored last with release semantics and checked again after the predictions
+    // are read, so readers never return predictions that belong to a different token. The ring is
+    // large enough that two writers never race on the same slot.
+    struct PredictionSlot {
+        std::atomic<int64_t> token = FrameTimelineInfo::INVALID_VSYNC_ID;
+        std::atomic<nsecs_t> startTime = 0;
+        std::atomic<nsecs_t> endTime = 0;
+        std::atomic<nsecs_t> presentTime = 0;
+    };
 
-    std::map<int64_t, TimelineItem> mPredictions GUARDED_BY(mMutex);
-    int64_t mCurrentToken GUARDED_BY(mMutex);
-    mutable std::mutex mMutex;
     static constexpr size_t kMaxTokens = 500;
+
+    std::array<PredictionSlot, kMaxTokens> mPredictions;
+    std::atomic<int64_t> mCurrentToken;
 };
 
 class FrameTimeline : public android::frametimeline::FrameTimeline {
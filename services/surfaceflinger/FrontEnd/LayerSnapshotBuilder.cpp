@@ -582,7 +582,7 @@ LayerSnapshot* LayerSnapshotBuilder::createSnapshot(const LayerHierarchy::Traver
     }
     snapshot->ignoreLocalTransform =
             path.isClone() && path.variant == LayerHierarchy::Variant::Detached_Mirror;
-    mPathToSnapshot[path] = snapshot;
+    mPathToSnapshot[snapshot->path] = snapshot;
 
     mIdToSnapshots.emplace(path.id, snapshot);
     return snapshot;
@@ -625,6 +625,12 @@ bool LayerSnapshotBuilder::sortSnapshotsByZ(const Args& args) {
                 return true;
             });
     mNumInterestingSnapshots = (int)globalZ;
+    mVisibleSnapshotIndices.clear();
+    for (size_t i = 0; i < globalZ; i++) {
+        if (mSnapshots[i]->isVisible) {
+            mVisibleSnapshotIndices.push_back(i);
+        }
+    }
     bool hasUnreachableSnapshots = false;
     while (globalZ < mSnapshots.size()) {
         mSnapshots[globalZ]->globalZ = globalZ;
@@ -1209,10 +1215,8 @@ std::vector<std::unique_ptr<LayerSnapshot>>& LayerSnapshotBuilder::getSnapshots(
 }
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor) const {
-    for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        LayerSnapshot& snapshot = *mSnapshots[(size_t)i];
-        if (!snapshot.isVisible) continue;
-        visitor(snapshot);
+    for (size_t i : mVisibleSnapshotIndices) {
+        visitor(*mSnapshots[i]);
     }
 }
 
@@ -1231,10 +1235,8 @@ void LayerSnapshotBuilder::forEachVisibleSnapshot(const ConstVisitor& visitor,
 }
 
 void LayerSnapshotBuilder::forEachVisibleSnapshot(const Visitor& visitor) {
-    for (int i = 0; i < mNumInterestingSnapshots; i++) {
-        std::unique_ptr<LayerSnapshot>& snapshot = mSnapshots.at((size_t)i);
-        if (!snapshot->isVisible) continue;
-        visitor(snapshot);
+    for (size_t i : mVisibleSnapshotIndices) {
+        visitor(mSnapshots.at(i));
     }
 }
 
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerLifecycleManager.h"
 #include "LayerHierarchy.h"
@@ -138,10 +140,13 @@ private:
                                           const Args& args, bool* outChildHasValidFrameRate);
     void updateTouchableRegionCrop(const Args& args);
 
-    std::unordered_map<LayerHierarchy::TraversalPath, LayerSnapshot*,
-                       LayerHierarchy::TraversalPathHash>
+    // Keyed by the path owned by each snapshot, so the map does not hold a second copy of every
+    // path. Snapshots never move once created, even while LayerFE borrows them.
+    std::unordered_map<std::reference_wrapper<const LayerHierarchy::TraversalPath>, LayerSnapshot*,
+                       LayerHierarchy::TraversalPathHash,
+                       std::equal_to<LayerHierarchy::TraversalPath>>
             mPathToSnapshot;
-    std::multimap<uint32_t, LayerSnapshot*> mIdToSnapshots;
+    std::unordered_multimap<uint32_t, LayerSnapshot*> mIdToSnapshots;
 
     // Track snapshots that needs touchable region crop from other snapshots
     std::unordered_set<LayerHierarchy::TraversalPath, LayerHierarchy::TraversalPathHash>
@@ -149,6 +154,10 @@ private:
     std::vector<std::unique_ptr<LayerSnapshot>> mSnapshots;
     bool mResortSnapshots = false;
     int mNumInterestingSnapshots = 0;
+    // Indices into mSnapshots of the visible snapshots in z-order. Visibility only changes while
+    // sorting, so this is rebuilt there and lets visible sweeps skip invisible snapshots without
+    // dereferencing them.
+    std::vector<size_t> mVisibleSnapshotIndices;
 };
 
 } // namespace android::surfaceflinger::frontend
@@ -40,14 +40,15 @@ void TransactionHandler::collectTransactions() {
         if (!maybeTransaction.has_value()) {
             break;
         }
-        auto transaction = maybeTransaction.value();
+        auto& transaction = *maybeTransaction;
         mPendingTransactionQueues[transaction.applyToken].emplace(std::move(transaction));
     }
 }
 
 std::vector<TransactionState> TransactionHandler::flushTransactions() {
     // Collect transaction that are ready to be applied.
-    std::vector<TransactionState> transactions;
+    std::vector<TransactionState> transactions = std::move(mRecycledTransactions);
+    mRecycledTransactions.clear();
     TransactionFlushState flushState;
     flushState.queueProcessTime = systemTime();
     // Transactions with a buffer pending on a barrier may be on a different applyToken
@@ -75,6 +76,39 @@ std::vector<TransactionState> TransactionHandler::flushTransactions() {
     return transactions;
 }
 
+void TransactionHandler::recycleTransactions(std::vector<TransactionState>&& transactions) {
+    SFTRACE_CALL();
+    // Destroy the states before taking the lock, binder threads may be waiting on it.
+    for (auto& transaction : transactions) {
+        transaction.states.clear();
+    }
+    {
+        std::lock_guard lock{mRecycledComposerStatesMutex};
+        for (auto& transaction : transactions) {
+            if (mRecycledComposerStates.size() >= kMaxRecycledComposerStates) {
+                break;
+            }
+            // Don't pin the storage of unusually large transactions.
+            const size_t capacity = transaction.states.capacity();
+            if (capacity > 0 && capacity <= kMaxRecycledComposerStatesCapacity) {
+                mRecycledComposerStates.emplace_back(std::move(transaction.states));
+            }
+        }
+    }
+    transactions.clear();
+    mRecycledTransactions = std::move(transactions);
+}
+
+std::vector<ResolvedComposerState> TransactionHandler::obtainComposerStates() {
+    std::lock_guard lock{mRecycledComposerStatesMutex};
+    if (mRecycledComposerStates.empty()) {
+        return {};
+    }
+    std::vector<ResolvedComposerState> states = std::move(mRecycledComposerStates.back());
+    mRecycledComposerStates.pop_back();
+    return states;
+}
+
 void TransactionHandler::applyUnsignaledBufferTransaction(
         std::vector<TransactionState>& transactions, TransactionFlushState& flushState) {
     if (!flushState.queueWithUnsignaledBuffer) {
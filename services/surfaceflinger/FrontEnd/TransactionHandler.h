@@ -65,6 +65,15 @@ public:
     void addTransactionReadyFilter(TransactionFilter&&);
     void queueTransaction(TransactionState&&);
 
+    // Takes back the transactions returned by flushTransactions once they have been committed.
+    // Their states are destroyed, but the vectors holding them are kept to back the transactions
+    // of later frames. Must be called on the main thread without mStateLock held, since
+    // destroying the states can destroy layer handles.
+    void recycleTransactions(std::vector<TransactionState>&&);
+    // Returns an empty vector for the composer states of a new transaction, reusing the storage
+    // of a committed transaction when one is available. Safe to call from binder threads.
+    std::vector<ResolvedComposerState> obtainComposerStates();
+
     struct StalledTransactionInfo {
         pid_t pid;
         uint32_t layerId;
@@ -95,6 +104,15 @@ private:
     std::mutex mStalledMutex;
     std::unordered_map<uint64_t /* transactionId */, StalledTransactionInfo> mStalledTransactions
             GUARDED_BY(mStalledMutex);
+
+    // Storage of committed transactions, reused so that queueing and flushing a frame's
+    // transactions doesn't go to the allocator once the pools are warm.
+    static constexpr size_t kMaxRecycledComposerStates = 64;
+    static constexpr size_t kMaxRecycledComposerStatesCapacity = 32;
+    std::vector<TransactionState> mRecycledTransactions;
+    std::mutex mRecycledComposerStatesMutex;
+    std::vector<std::vector<ResolvedComposerState>> mRecycledComposerStates
+            GUARDED_BY(mRecycledComposerStatesMutex);
 };
 } // namespace surfaceflinger::frontend
 } // namespace android
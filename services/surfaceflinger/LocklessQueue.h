@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <optional>
 
 // Single consumer multi producer queue. We can understand the two operations independently to see
@@ -28,7 +30,8 @@
 // same value, one of them has to execute the compare_exchange first. The one that doesn't execute
 // the compare exchange first, will receive false from compare_exchange. previousHead is updated (by
 // compare_exchange) to the most recent value of mPush, and we try again. It's relatively clear to
-// see that the process can repeat with an arbitrary number of threads.
+// see that the process can repeat with an arbitrary number of threads. The release on a successful
+// compare_exchange publishes the entry, and pairs with the acquire in pop.
 //
 // Pop is much simpler. If mPop is empty (as it begins) it atomically exchanges
 // the entire push list with null. This is safe, since the only other reader (push)
@@ -36,29 +39,53 @@
 // then store the list and pop one element.
 //
 // If we already had something in the pop list we just pop directly.
-template <typename T>
+//
+// Entries come from a pool of PoolSize entries owned by the queue, so that pushing and popping
+// don't allocate while the queue holds fewer values than that. Pushing never fails: once the pool
+// is used up, entries are allocated on the heap, and freed again when they are popped. The pool's
+// free list is a stack of indices, tagged with a counter which changes on every update so that a
+// producer which was preempted in the middle of taking an entry can't corrupt it (ABA).
+template <typename T, size_t PoolSize = 32>
 class LocklessQueue {
 public:
-    bool isEmpty() { return (mPush.load() == nullptr) && (mPop.load() == nullptr); }
+    LocklessQueue() {
+        for (uint32_t i = 0; i < PoolSize; i++) {
+            mPool[i].mNextFree.store(i + 1 < PoolSize ? i + 2 : 0, std::memory_order_relaxed);
+        }
+        mFree.store(PoolSize > 0 ? 1 : 0, std::memory_order_relaxed);
+    }
+
+    ~LocklessQueue() {
+        while (pop()) {
+        }
+    }
+
+    LocklessQueue(const LocklessQueue&) = delete;
+    LocklessQueue& operator=(const LocklessQueue&) = delete;
+
+    bool isEmpty() const {
+        return (mPush.load(std::memory_order_acquire) == nullptr) &&
+                (mPop.load(std::memory_order_relaxed) == nullptr);
+    }
 
     void push(T value) {
-        Entry* entry = new Entry(std::move(value));
-        Entry* previousHead = mPush.load(/*std::memory_order_relaxed*/);
+        Entry* entry = allocate();
+        entry->mValue.emplace(std::move(value));
+        Entry* previousHead = mPush.load(std::memory_order_relaxed);
         do {
             entry->mNext = previousHead;
-        } while (!mPush.compare_exchange_weak(previousHead, entry)); /*std::memory_order_release*/
+        } while (!mPush.compare_exchange_weak(previousHead, entry, std::memory_order_release,
+                                              std::memory_order_relaxed));
     }
 
     std::optional<T> pop() {
-        Entry* popped = mPop.load(/*std::memory_order_acquire*/);
+        // Only the consumer changes mPop
+        Entry* popped = mPop.load(std::memory_order_relaxed);
         if (popped) {
-            // Single consumer so this is fine
-            mPop.store(popped->mNext /* , std::memory_order_release */);
-            auto value = std::move(popped->mValue);
-            delete popped;
-            return value;
+            mPop.store(popped->mNext, std::memory_order_relaxed);
+            return release(popped);
         } else {
-            Entry* grabbedList = mPush.exchange(nullptr /* , std::memory_order_acquire */);
+            Entry* grabbedList = mPush.exchange(nullptr, std::memory_order_acquire);
             if (!grabbedList) return std::nullopt;
             // Reverse the list
             while (grabbedList->mNext) {
@@ -67,20 +94,64 @@ public:
                 popped = grabbedList;
                 grabbedList = next;
             }
-            mPop.store(popped /* , std::memory_order_release */);
-            auto value = std::move(grabbedList->mValue);
-            delete grabbedList;
-            return value;
+            mPop.store(popped, std::memory_order_relaxed);
+            return release(grabbedList);
         }
     }
 
 private:
-    class Entry {
-    public:
-        T mValue;
-        std::atomic<Entry*> mNext;
-        Entry(T value) : mValue(value) {}
+    struct Entry {
+        std::optional<T> mValue;
+        // Written by the producer before publishing the entry, and then only by the consumer
+        Entry* mNext = nullptr;
+        // Index + 1 of the next entry in the free list, or 0, for entries in mPool
+        std::atomic<uint32_t> mNextFree = 0;
     };
-    std::atomic<Entry*> mPush = nullptr;
-    std::atomic<Entry*> mPop = nullptr;
+
+    static constexpr uint64_t kIndexMask = 0xffffffff;
+
+    bool isPooled(const Entry* entry) const {
+        return entry >= mPool.data() && entry < mPool.data() + PoolSize;
+    }
+
+    Entry* allocate() {
+        uint64_t head = mFree.load(std::memory_order_acquire);
+        while (true) {
+            const uint32_t index = static_cast<uint32_t>(head & kIndexMask);
+            if (index == 0) return new Entry();
+            // may be stale if another producer took this entry, but then the tag in mFree changed
+            const uint32_t next = mPool[index - 1].mNextFree.load(std::memory_order_relaxed);
+            const uint64_t newHead = ((head >> 32) + 1) << 32 | next;
+            if (mFree.compare_exchange_weak(head, newHead, std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+                return &mPool[index - 1];
+            }
+        }
+    }
+
+    std::optional<T> release(Entry* entry) {
+        std::optional<T> value = std::move(entry->mValue);
+        if (!isPooled(entry)) {
+            delete entry;
+            return value;
+        }
+        entry->mValue.reset();
+        const uint32_t index = static_cast<uint32_t>(entry - mPool.data()) + 1;
+        uint64_t head = mFree.load(std::memory_order_relaxed);
+        uint64_t newHead;
+        do {
+            entry->mNextFree.store(static_cast<uint32_t>(head & kIndexMask),
+                                   std::memory_order_relaxed);
+            newHead = ((head >> 32) + 1) << 32 | index;
+        } while (!mFree.compare_exchange_weak(head, newHead, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        return value;
+    }
+
+    // Producers update mPush and mFree, and the consumer mPop, so they're kept on separate cache
+    // lines to avoid false sharing.
+    alignas(64) std::atomic<Entry*> mPush = nullptr;
+    alignas(64) std::atomic<uint64_t> mFree = 0;
+    alignas(64) std::atomic<Entry*> mPop = nullptr;
+    std::array<Entry, PoolSize> mPool;
 };
@@ -218,6 +218,21 @@ binder::Status EventThreadConnection::stealReceiveChannel(gui::BitTube* outChann
     return binder::Status::ok();
 }
 
+binder::Status EventThreadConnection::getVsyncEventChannel(gui::VsyncEventChannel* outChannel) {
+    std::scoped_lock lock(mLock);
+    if (mVsyncChannel != nullptr) {
+        return binder::Status::fromStatusT(ALREADY_EXISTS);
+    }
+
+    // Only switch vsync delivery over once the receiver has everything it needs. If the channel
+    // can't be set up, outChannel stays uninitialized and vsync keeps going over the BitTube.
+    auto vsyncChannel = gui::VsyncEventChannel::create();
+    if (vsyncChannel != nullptr && vsyncChannel->duplicateFds(outChannel) == NO_ERROR) {
+        mVsyncChannel = std::move(vsyncChannel);
+    }
+    return binder::Status::ok();
+}
+
 binder::Status EventThreadConnection::setVsyncRate(int rate) {
     mEventThread->setVsyncRate(static_cast<uint32_t>(rate),
                                sp<EventThreadConnection>::fromExisting(this));
@@ -258,10 +273,19 @@ status_t EventThreadConnection::postEvent(const DisplayEventReceiver::Event& eve
         auto size = DisplayEventReceiver::sendEvents(&mChannel, mPendingEvents.data(),
                                                      mPendingEvents.size());
         mPendingEvents.clear();
+        if (size > 0) mEventsSent += static_cast<uint64_t>(size);
         return toStatus(size);
     }
 
+    if (event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+        std::scoped_lock lock(mLock);
+        if (mVsyncChannel != nullptr) {
+            return mVsyncChannel->publish(event, mEventsSent);
+        }
+    }
+
     auto size = DisplayEventReceiver::sendEvents(&mChannel, &event, 1);
+    if (size > 0) mEventsSent += static_cast<uint64_t>(size);
     return toStatus(size);
 }
 
@@ -20,6 +20,7 @@
 #include <android/gui/BnDisplayEventConnection.h>
 #include <gui/DisplayEventReceiver.h>
 #include <private/gui/BitTube.h>
+#include <private/gui/VsyncEventChannel.h>
 #include <sys/types.h>
 #include <utils/Errors.h>
 
@@ -75,6 +76,7 @@ public:
     virtual status_t postEvent(const DisplayEventReceiver::Event& event);
 
     binder::Status stealReceiveChannel(gui::BitTube* outChannel) override;
+    binder::Status getVsyncEventChannel(gui::VsyncEventChannel* outChannel) override;
     binder::Status setVsyncRate(int rate) override;
     binder::Status requestNextVsync() override; // asynchronous
     binder::Status getLatestVsyncEventData(ParcelableVsyncEventData* outVsyncEventData) override;
@@ -92,8 +94,12 @@ private:
     EventThread* const mEventThread;
     std::mutex mLock;
     gui::BitTube mChannel GUARDED_BY(mLock);
+    // Set once the receiver has taken the channel; vsync events go here instead of mChannel.
+    std::unique_ptr<gui::VsyncEventChannel> mVsyncChannel GUARDED_BY(mLock);
 
     std::vector<DisplayEventReceiver::Event> mPendingEvents;
+    // Events sent on mChannel, so the receiver can order the events of mVsyncChannel among them.
+    uint64_t mEventsSent = 0;
 };
 
 class EventThread {
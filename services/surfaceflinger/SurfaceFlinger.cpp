@@ -27,6 +27,7 @@
 #include <aidl/android/hardware/power/Boost.h>
 #include <android-base/parseint.h>
 #include <android-base/properties.h>
+#include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <android/configuration.h>
@@ -2413,6 +2414,12 @@ bool SurfaceFlinger::updateLayerSnapshots(VsyncId vsyncId, nsecs_t frameTimeNs,
         mLayerHierarchyBuilder.update(mLayerLifecycleManager);
     }
 
+    // Hand the committed transactions back to the TransactionHandler for reuse. This runs when
+    // the function returns, after mStateLock below is released, for the reason given above.
+    auto recycleTransactions = base::make_scope_guard([&]() FTL_FAKE_GUARD(kMainThreadContext) {
+        mTransactionHandler.recycleTransactions(std::move(update.transactions));
+    });
+
     // Keep a copy of the drawing state (that is going to be overwritten
     // by commitTransactionsLocked) outside of mStateLock so that the side
     // effects of the State assignment don't happen with mStateLock held,
@@ -4752,6 +4759,11 @@ status_t SurfaceFlinger::setTransactionState(
     }
 
     std::vector<ResolvedComposerState> resolvedStates;
+    {
+        // The pool of recycled states is thread safe, see TransactionHandler.
+        ftl::FakeGuard guard(kMainThreadContext);
+        resolvedStates = mTransactionHandler.obtainComposerStates();
+    }
     resolvedStates.reserve(states.size());
     for (auto& state : states) {
         resolvedStates.emplace_back(std::move(state));
@@ -8219,6 +8231,8 @@ std::shared_ptr<renderengine::ExternalTexture> SurfaceFlinger::getExternalTextur
             if (bufferData.releaseBufferListener) {
                 bufferData.releaseBufferListener->onTransactionQueueStalled(
                         String8("Buffer processing hung due to full buffer cache"));
+                // Let the client shrink its buffer cache and flush its pending uncaches.
+                bufferData.releaseBufferListener->onBufferCacheFull();
             }
         }
 
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "TransactionTracing"
+
+#include <android-base/stringprintf.h>
+#include <common/trace.h>
+#include <log/log.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "CompressedTraceHistory.h"
+
+namespace android {
+
+namespace {
+
+// Each entry in a segment is its size and timestamp, followed by the serialized proto.
+constexpr size_t kEntryHeaderSize = sizeof(uint32_t) + sizeof(int64_t);
+
+// Larger segments compress better, but each eviction drops a whole segment from the history.
+constexpr size_t kMaxSegmentSize = 64 * 1024;
+
+} // namespace
+
+void CompressedTraceHistory::setSize(size_t newSize, const EntryVisitor& onEvicted) {
+    mSizeInBytes = newSize;
+    if (mOpenSegment.size() >= maxOpenSegmentSize()) {
+        sealOpenSegment();
+    }
+    evictUntilFits(onEvicted);
+}
+
+void CompressedTraceHistory::append(std::string_view entry, int64_t timestamp,
+                                    const EntryVisitor& onEvicted) {
+    const auto entrySize = static_cast<uint32_t>(entry.size());
+    mOpenSegment.append(reinterpret_cast<const char*>(&entrySize), sizeof(entrySize));
+    mOpenSegment.append(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+    mOpenSegment.append(entry);
+    mOpenFrameCount++;
+    mFrameCount++;
+    mUsedInBytes += kEntryHeaderSize + entry.size();
+    mRawInBytes += kEntryHeaderSize + entry.size();
+
+    if (mOpenSegment.size() >= maxOpenSegmentSize()) {
+        sealOpenSegment();
+    }
+    evictUntilFits(onEvicted);
+}
+
+void CompressedTraceHistory::forEachEntry(const EntryVisitor& visitor) const {
+    for (const Segment& segment : mSegments) {
+        forEachEntryInSegment(segment, visitor);
+    }
+    forEachEntryIn(mOpenSegment, visitor);
+}
+
+void CompressedTraceHistory::reset() {
+    mSegments.clear();
+    mOpenSegment.clear();
+    mOpenSegment.shrink_to_fit();
+    mOpenFrameCount = 0U;
+    mUsedInBytes = 0U;
+    mRawInBytes = 0U;
+    mFrameCount = 0U;
+}
+
+void CompressedTraceHistory::dump(std::string& result) const {
+    base::StringAppendF(&result,
+                        "  compressed history: %zu entries in %zu segments (%.2fMB / %.2fMB, "
+                        "%.2fMB uncompressed)\n",
+                        frameCount(), segmentCount(), float(used()) / (1024.f * 1024.f),
+                        float(size()) / (1024.f * 1024.f),
+                        float(mRawInBytes) / (1024.f * 1024.f));
+}
+
+// A quarter of the size before compression, so that several sealed segments fit in the history
+// and evicting one of them only drops a small part of it.
+size_t CompressedTraceHistory::maxOpenSegmentSize() const {
+    return std::min(mSizeInBytes / 4, kMaxSegmentSize);
+}
+
+void CompressedTraceHistory::sealOpenSegment() {
+    if (mOpenSegment.empty()) {
+        return;
+    }
+    SFTRACE_CALL();
+    Segment segment;
+    segment.compressed = false;
+    segment.rawSize = mOpenSegment.size();
+    segment.frameCount = mOpenFrameCount;
+    uLongf compressedSize = compressBound(static_cast<uLong>(mOpenSegment.size()));
+    segment.bytes.resize(static_cast<size_t>(compressedSize));
+    if (compress2(reinterpret_cast<Bytef*>(segment.bytes.data()), &compressedSize,
+                  reinterpret_cast<const Bytef*>(mOpenSegment.data()),
+                  static_cast<uLong>(mOpenSegment.size()), Z_DEFAULT_COMPRESSION) == Z_OK &&
+        compressedSize < mOpenSegment.size()) {
+        segment.bytes.resize(static_cast<size_t>(compressedSize));
+        segment.bytes.shrink_to_fit();
+        segment.compressed = true;
+    } else {
+        segment.bytes = mOpenSegment;
+    }
+
+    mUsedInBytes = mUsedInBytes - mOpenSegment.size() + segment.bytes.size();
+    mSegments.push_back(std::move(segment));
+    // Keep the capacity of the open segment, it is refilled right away.
+    mOpenSegment.clear();
+    mOpenFrameCount = 0U;
+}
+
+void CompressedTraceHistory::evictOldestSegment(const EntryVisitor& onEvicted) {
+    Segment segment = std::move(mSegments.front());
+    mSegments.pop_front();
+    mUsedInBytes -= segment.bytes.size();
+    mRawInBytes -= segment.rawSize;
+    mFrameCount -= segment.frameCount;
+    if (onEvicted) {
+        forEachEntryInSegment(segment, onEvicted);
+    }
+}
+
+void CompressedTraceHistory::evictUntilFits(const EntryVisitor& onEvicted) {
+    while (mUsedInBytes > mSizeInBytes) {
+        if (mSegments.empty()) {
+            // The open segment alone doesn't fit, so it has to go as well.
+            sealOpenSegment();
+        }
+        evictOldestSegment(onEvicted);
+    }
+}
+
+void CompressedTraceHistory::forEachEntryInSegment(const Segment& segment,
+                                                   const EntryVisitor& visitor) {
+    if (!segment.compressed) {
+        forEachEntryIn(segment.bytes, visitor);
+        return;
+    }
+    std::string entries(segment.rawSize, '\0');
+    uLongf rawSize = static_cast<uLongf>(segment.rawSize);
+    if (uncompress(reinterpret_cast<Bytef*>(entries.data()), &rawSize,
+                   reinterpret_cast<const Bytef*>(segment.bytes.data()),
+                   static_cast<uLong>(segment.bytes.size())) != Z_OK ||
+        rawSize != segment.rawSize) {
+        ALOGE("Could not inflate %zu transaction trace entries", segment.frameCount);
+        return;
+    }
+    forEachEntryIn(entries, visitor);
+}
+
+void CompressedTraceHistory::forEachEntryIn(std::string_view entries,
+                                            const EntryVisitor& visitor) {
+    while (entries.size() >= kEntryHeaderSize) {
+        uint32_t entrySize;
+        int64_t timestamp;
+        std::memcpy(&entrySize, entries.data(), sizeof(entrySize));
+        std::memcpy(&timestamp, entries.data() + sizeof(entrySize), sizeof(timestamp));
+        entries.remove_prefix(kEntryHeaderSize);
+        if (entrySize > entries.size()) {
+            ALOGE("Transaction trace segment is truncated");
+            return;
+        }
+        visitor(entries.substr(0, entrySize), timestamp);
+        entries.remove_prefix(entrySize);
+    }
+}
+
+} // namespace android
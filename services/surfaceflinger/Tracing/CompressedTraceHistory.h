@@ -0,0 +1,81 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace android {
+
+// Trace entries that are older than the ones in the TransactionRingBuffer, kept compressed so
+// that the same memory holds more history.
+//
+// Entries are appended to an open segment as they are. Once the open segment is full, it is
+// compressed with zlib and sealed. When the history holds more than its size, the oldest sealed
+// segment is inflated and its entries are evicted, oldest first. Segments are compressed on the
+// thread that appends to the history, which is the tracing thread.
+class CompressedTraceHistory {
+public:
+    // The entry only stays valid for the duration of the call. Entries in sealed segments are
+    // inflated into a temporary buffer.
+    using EntryVisitor = std::function<void(std::string_view entry, int64_t timestamp)>;
+
+    size_t size() const { return mSizeInBytes; }
+    // Bytes held by the sealed segments, once compressed, and by the open segment.
+    size_t used() const { return mUsedInBytes; }
+    size_t frameCount() const { return mFrameCount; }
+    size_t segmentCount() const { return mSegments.size(); }
+
+    // Segments that no longer fit in the new size are evicted, oldest first.
+    void setSize(size_t newSize, const EntryVisitor& onEvicted);
+    // Appends an entry, which must be newer than every entry in the history, and evicts the
+    // oldest segments until the history fits in its size again.
+    void append(std::string_view entry, int64_t timestamp, const EntryVisitor& onEvicted);
+    void forEachEntry(const EntryVisitor& visitor) const;
+    void reset();
+    void dump(std::string& result) const;
+
+private:
+    struct Segment {
+        // The zlib stream of the entries, or the entries themselves if they didn't compress.
+        std::string bytes;
+        bool compressed;
+        size_t rawSize;
+        size_t frameCount;
+    };
+
+    size_t maxOpenSegmentSize() const;
+    void sealOpenSegment();
+    void evictOldestSegment(const EntryVisitor& onEvicted);
+    void evictUntilFits(const EntryVisitor& onEvicted);
+    static void forEachEntryInSegment(const Segment& segment, const EntryVisitor& visitor);
+    static void forEachEntryIn(std::string_view entries, const EntryVisitor& visitor);
+
+    std::deque<Segment> mSegments;
+    std::string mOpenSegment;
+    size_t mOpenFrameCount = 0U;
+    size_t mUsedInBytes = 0U;
+    // Size of the held entries before compression.
+    size_t mRawInBytes = 0U;
+    size_t mSizeInBytes = 0U;
+    size_t mFrameCount = 0U;
+};
+
+} // namespace android
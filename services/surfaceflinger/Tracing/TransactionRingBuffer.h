@@ -18,41 +18,91 @@
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
 
 #include <common/trace.h>
 #include <log/log.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <utils/Errors.h>
 #include <utils/Timers.h>
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <string_view>
 
 namespace android {
 
 class SurfaceFlinger;
 
+// Byte ring holding serialized trace entries back to back. The ring is mapped twice in a row so
+// every entry, including one that wraps past the end, can be read and written as a single
+// contiguous range. Entries are serialized straight into the ring and handed out as views into
+// it, so neither adding nor flushing an entry makes a copy.
+//
+// Entries in the ring are not compressed, so that the newest entries can be handed to perfetto
+// straight from the ring. TransactionTracing compresses entries once they are evicted, see
+// CompressedTraceHistory.
 template <typename FileProto, typename EntryProto>
 class TransactionRingBuffer {
 public:
+    // Called with the bytes of an entry just before it is overwritten.
+    using EvictedEntryVisitor = std::function<void(std::string_view entry, int64_t timestamp)>;
+    using EntryVisitor = std::function<void(std::string_view entry, int64_t timestamp)>;
+
+    TransactionRingBuffer() = default;
+    TransactionRingBuffer(const TransactionRingBuffer&) = delete;
+    TransactionRingBuffer& operator=(const TransactionRingBuffer&) = delete;
+    ~TransactionRingBuffer() { unmap(); }
+
     size_t size() const { return mSizeInBytes; }
     size_t used() const { return mUsedInBytes; }
-    size_t frameCount() const { return mStorage.size(); }
-    void setSize(size_t newSize) { mSizeInBytes = newSize; }
-    const std::string& front() const { return mStorage.front(); }
-    const std::string& back() const { return mStorage.back(); }
+    size_t frameCount() const { return mFrameCount; }
+    std::string_view front() const { return payload(mHead); }
+    std::string_view back() const { return payload(mBack); }
+    int64_t backVsyncId() const { return header(mBack).vsyncId; }
+
+    // Entries that no longer fit in the new size are evicted, oldest first.
+    void setSize(size_t newSize, const EvictedEntryVisitor& onEvicted = nullptr) {
+        mSizeInBytes = newSize;
+        while (mUsedInBytes > mSizeInBytes) {
+            evictFront(onEvicted);
+        }
+        if (mData && mCapacity != capacityFor(mSizeInBytes) && !remap()) {
+            // Keep using the old ring, but never let it hold more than it can fit.
+            mSizeInBytes = std::min(mSizeInBytes, mCapacity);
+        }
+    }
+
+    // Evicts every entry, oldest first.
+    void evictAll(const EvictedEntryVisitor& onEvicted) {
+        while (mFrameCount > 0) {
+            evictFront(onEvicted);
+        }
+    }
 
     void reset() {
-        // use the swap trick to make sure memory is released
-        std::deque<std::string>().swap(mStorage);
+        unmap();
+        mHead = mTail = mBack = 0U;
         mUsedInBytes = 0U;
+        mFrameCount = 0U;
+    }
+
+    void forEachEntry(const EntryVisitor& visitor) const {
+        for (uint64_t position = mHead; position < mTail; position += stride(header(position))) {
+            visitor(payload(position), header(position).timestamp);
+        }
     }
 
     void writeToProto(FileProto& fileProto) const {
-        fileProto.mutable_entry()->Reserve(static_cast<int>(mStorage.size()) +
+        fileProto.mutable_entry()->Reserve(static_cast<int>(mFrameCount) +
                                            fileProto.entry().size());
-        for (const std::string& entry : mStorage) {
+        forEachEntry([&](std::string_view entry, int64_t) {
             EntryProto* entryProto = fileProto.add_entry();
-            entryProto->ParseFromString(entry);
-        }
+            entryProto->ParseFromArray(entry.data(), static_cast<int>(entry.size()));
+        });
     }
 
     status_t appendToStream(FileProto& fileProto, std::ofstream& out) {
@@ -68,35 +118,38 @@ public:
         return NO_ERROR;
     }
 
-    std::vector<std::string> emplace(std::string&& serializedProto) {
-        std::vector<std::string> replacedEntries;
-        size_t protoSize = static_cast<size_t>(serializedProto.size());
-        while (mUsedInBytes + protoSize > mSizeInBytes) {
-            if (mStorage.empty()) {
-                return {};
-            }
-            mUsedInBytes -= static_cast<size_t>(mStorage.front().size());
-            replacedEntries.emplace_back(mStorage.front());
-            mStorage.pop_front();
+    // Serializes proto into the ring, evicting the oldest entries to make room. Returns a view of
+    // the new entry that stays valid until the next call that modifies the ring, or an empty view
+    // if the entry could not be stored.
+    std::string_view emplace(const EntryProto& proto, const EvictedEntryVisitor& onEvicted) {
+        const size_t protoSize = proto.ByteSizeLong();
+        const size_t entryStride = strideFor(protoSize);
+        if (entryStride > mSizeInBytes || (!mData && !remap())) {
+            return {};
+        }
+        while (mUsedInBytes + entryStride > mSizeInBytes) {
+            evictFront(onEvicted);
         }
-        mUsedInBytes += protoSize;
-        mStorage.emplace_back(serializedProto);
-        return replacedEntries;
-    }
 
-    std::vector<std::string> emplace(EntryProto&& proto) {
-        std::string serializedProto;
-        proto.SerializeToString(&serializedProto);
-        return emplace(std::move(serializedProto));
+        EntryHeader& entryHeader = header(mTail);
+        entryHeader.size = static_cast<uint32_t>(protoSize);
+        entryHeader.timestamp = proto.elapsed_realtime_nanos();
+        entryHeader.vsyncId = proto.vsync_id();
+        proto.SerializeWithCachedSizesToArray(
+                reinterpret_cast<uint8_t*>(&entryHeader) + sizeof(EntryHeader));
+
+        mBack = mTail;
+        mTail += entryStride;
+        mUsedInBytes += entryStride;
+        mFrameCount++;
+        return payload(mBack);
     }
 
     void dump(std::string& result) const {
         std::chrono::milliseconds duration(0);
         if (frameCount() > 0) {
-            EntryProto entry;
-            entry.ParseFromString(mStorage.front());
             duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::nanoseconds(systemTime() - entry.elapsed_realtime_nanos()));
+                    std::chrono::nanoseconds(systemTime() - header(mHead).timestamp));
         }
         const int64_t durationCount = duration.count();
         base::StringAppendF(&result,
@@ -106,9 +159,101 @@ public:
     }
 
 private:
+    struct EntryHeader {
+        uint32_t size;
+        uint32_t reserved;
+        int64_t timestamp;
+        int64_t vsyncId;
+    };
+    static constexpr size_t kEntryAlignment = alignof(EntryHeader);
+
+    static size_t strideFor(size_t protoSize) {
+        const size_t size = sizeof(EntryHeader) + protoSize;
+        return (size + kEntryAlignment - 1) & ~(kEntryAlignment - 1);
+    }
+    static size_t stride(const EntryHeader& entryHeader) { return strideFor(entryHeader.size); }
+
+    static size_t capacityFor(size_t size) {
+        const size_t pageSize = static_cast<size_t>(getpagesize());
+        return std::max((size + pageSize - 1) & ~(pageSize - 1), pageSize);
+    }
+
+    EntryHeader& header(uint64_t position) const {
+        return *reinterpret_cast<EntryHeader*>(mData + position % mCapacity);
+    }
+
+    std::string_view payload(uint64_t position) const {
+        const EntryHeader& entryHeader = header(position);
+        return {reinterpret_cast<const char*>(&entryHeader) + sizeof(EntryHeader),
+                entryHeader.size};
+    }
+
+    void evictFront(const EvictedEntryVisitor& onEvicted) {
+        const size_t entryStride = stride(header(mHead));
+        if (onEvicted) {
+            onEvicted(payload(mHead), header(mHead).timestamp);
+        }
+        mHead += entryStride;
+        mUsedInBytes -= entryStride;
+        mFrameCount--;
+    }
+
+    // Maps a ring sized for mSizeInBytes and moves any existing entries into it.
+    bool remap() {
+        SFTRACE_CALL();
+        const size_t capacity = capacityFor(mSizeInBytes);
+        base::unique_fd fd(memfd_create("transaction_trace_ring", MFD_CLOEXEC));
+        if (fd.get() < 0 || ftruncate(fd.get(), static_cast<off_t>(capacity)) != 0) {
+            ALOGE("Could not allocate transaction trace ring: %s", strerror(errno));
+            return false;
+        }
+        // Reserve twice the capacity, then map the same pages into both halves.
+        void* base = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            ALOGE("Could not reserve transaction trace ring: %s", strerror(errno));
+            return false;
+        }
+        uint8_t* data = static_cast<uint8_t*>(base);
+        for (size_t offset : {size_t(0), capacity}) {
+            if (mmap(data + offset, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                     fd.get(), 0) == MAP_FAILED) {
+                ALOGE("Could not map transaction trace ring: %s", strerror(errno));
+                munmap(base, 2 * capacity);
+                return false;
+            }
+        }
+
+        if (mData) {
+            // The live range is contiguous in the old mapping and fits in the new one.
+            std::memcpy(data, mData + mHead % mCapacity, mUsedInBytes);
+            unmap();
+        }
+        // mBack is left behind mHead once every entry has been evicted.
+        mBack = mUsedInBytes > 0 ? mBack - mHead : 0U;
+        mTail = mUsedInBytes;
+        mHead = 0U;
+        mData = data;
+        mCapacity = capacity;
+        return true;
+    }
+
+    void unmap() {
+        if (mData) {
+            munmap(mData, 2 * mCapacity);
+            mData = nullptr;
+            mCapacity = 0U;
+        }
+    }
+
+    uint8_t* mData = nullptr;
+    size_t mCapacity = 0U;
+    // Positions only ever grow and are wrapped by the capacity when the ring is accessed.
+    uint64_t mHead = 0U;
+    uint64_t mTail = 0U;
+    uint64_t mBack = 0U;
     size_t mUsedInBytes = 0U;
     size_t mSizeInBytes = 0U;
-    std::deque<std::string> mStorage;
+    size_t mFrameCount = 0U;
 };
 
 } // namespace android
@@ -33,7 +33,7 @@ TransactionTracing::TransactionTracing()
       : mProtoParser(std::make_unique<TransactionProtoParser::FlingerDataMapper>()) {
     std::scoped_lock lock(mTraceLock);
 
-    mBuffer.setSize(CONTINUOUS_TRACING_BUFFER_SIZE);
+    setBufferSizeLocked(CONTINUOUS_TRACING_BUFFER_SIZE);
 
     mStartingTimestamp = systemTime();
 
@@ -86,24 +86,34 @@ void TransactionTracing::onFlush(TransactionTracing::Mode mode) {
 
 void TransactionTracing::writeRingBufferToPerfetto(TransactionTracing::Mode mode) {
     // Write the ring buffer (starting state + following sequence of transactions) to perfetto
-    // tracing sessions with the specified mode.
-    const auto fileProto = writeToProto();
+    // tracing sessions with the specified mode. Entries are copied straight out of the ring, so
+    // hold the lock until they have all been written.
+    std::scoped_lock lock(mTraceLock);
+    std::string startingStateBytes;
+    int64_t startingStateTimestamp = 0;
+    if (const auto startingStateProto = createStartingStateProtoLocked()) {
+        startingStateProto->SerializeToString(&startingStateBytes);
+        startingStateTimestamp = startingStateProto->elapsed_realtime_nanos();
+    }
 
-    TransactionDataSource::Trace([&](TransactionDataSource::TraceContext context) {
+    TransactionDataSource::Trace([&](TransactionDataSource::TraceContext context)
+                                         REQUIRES(mTraceLock) {
         // Write packets only to tracing sessions with specified mode
         if (context.GetCustomTlsState()->mMode != mode) {
             return;
         }
-        for (const auto& entryProto : fileProto.entry()) {
-            const auto entryBytes = entryProto.SerializeAsString();
-
+        auto writeEntry = [&context](std::string_view entryBytes, int64_t timestamp) {
             auto packet = context.NewTracePacket();
-            packet->set_timestamp(static_cast<uint64_t>(entryProto.elapsed_realtime_nanos()));
+            packet->set_timestamp(static_cast<uint64_t>(timestamp));
             packet->set_timestamp_clock_id(perfetto::protos::pbzero::BUILTIN_CLOCK_MONOTONIC);
 
             auto* transactionsProto = packet->set_surfaceflinger_transactions();
             transactionsProto->AppendRawProtoBytes(entryBytes.data(), entryBytes.size());
+        };
+        if (!startingStateBytes.empty()) {
+            writeEntry(startingStateBytes, startingStateTimestamp);
         }
+        forEachEntryLocked(writeEntry);
         {
             // TODO (b/162206162): remove empty packet when perfetto bug is fixed.
             //  It is currently needed in order not to lose the last trace entry.
@@ -138,13 +148,51 @@ perfetto::protos::TransactionTraceFile TransactionTracing::writeToProto() {
     if (startingStateProto) {
         *fileProto.add_entry() = std::move(*startingStateProto);
     }
-    mBuffer.writeToProto(fileProto);
+    fileProto.mutable_entry()->Reserve(
+            static_cast<int>(mHistory.frameCount() + mBuffer.frameCount()) +
+            fileProto.entry().size());
+    forEachEntryLocked([&](std::string_view entry, int64_t) {
+        fileProto.add_entry()->ParseFromArray(entry.data(), static_cast<int>(entry.size()));
+    });
     return fileProto;
 }
 
 void TransactionTracing::setBufferSize(size_t bufferSizeInBytes) {
     std::scoped_lock lock(mTraceLock);
-    mBuffer.setSize(bufferSizeInBytes);
+    setBufferSizeLocked(bufferSizeInBytes);
+}
+
+void TransactionTracing::setBufferSizeLocked(size_t bufferSizeInBytes) {
+    const size_t ringSize = bufferSizeInBytes / 4;
+    // Shrink the history first, so that its entries are folded into the starting state before the
+    // ones the ring evicts into it.
+    mHistory.setSize(bufferSizeInBytes - ringSize,
+                     [this](std::string_view removedEntry, int64_t) REQUIRES(mTraceLock) {
+                         onEntryRemovedLocked(removedEntry);
+                     });
+    mBuffer.setSize(ringSize,
+                    [this](std::string_view entry, int64_t timestamp) REQUIRES(mTraceLock) {
+                        addToHistoryLocked(entry, timestamp);
+                    });
+}
+
+void TransactionTracing::addToHistoryLocked(std::string_view entry, int64_t timestamp) {
+    mHistory.append(entry, timestamp,
+                    [this](std::string_view removedEntry, int64_t) REQUIRES(mTraceLock) {
+                        onEntryRemovedLocked(removedEntry);
+                    });
+}
+
+void TransactionTracing::forEachEntryLocked(
+        const CompressedTraceHistory::EntryVisitor& visitor) const {
+    mHistory.forEachEntry(visitor);
+    mBuffer.forEachEntry(visitor);
+}
+
+void TransactionTracing::onEntryRemovedLocked(std::string_view removedEntry) {
+    perfetto::protos::TransactionTraceEntry removedEntryProto;
+    removedEntryProto.ParseFromArray(removedEntry.data(), static_cast<int>(removedEntry.size()));
+    updateStartingStateLocked(removedEntryProto);
 }
 
 perfetto::protos::TransactionTraceFile TransactionTracing::createTraceFileProto() const {
@@ -164,6 +212,7 @@ void TransactionTracing::dump(std::string& result) const {
     base::StringAppendF(&result, "  queued transactions=%zu created layers=%zu states=%zu\n",
                         mQueuedTransactions.size(), mCreatedLayers.size(), mStartingStates.size());
     mBuffer.dump(result);
+    mHistory.dump(result);
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
@@ -229,7 +278,6 @@ void TransactionTracing::loop() {
 void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committedUpdates,
                                   const std::vector<uint32_t>& destroyedLayers) {
     std::scoped_lock lock(mTraceLock);
-    std::vector<std::string> removedEntries;
     perfetto::protos::TransactionTraceEntry entryProto;
 
     while (auto incomingTransaction = mTransactionQueue.pop()) {
@@ -280,8 +328,21 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
             }
         }
 
-        std::string serializedProto;
-        entryProto.SerializeToString(&serializedProto);
+        // Entries leaving the ring are compressed into the history before they are
+        // overwritten.
+        auto addToHistory = [this](std::string_view entry, int64_t timestamp)
+                REQUIRES(mTraceLock) { addToHistoryLocked(entry, timestamp); };
+        std::string_view serializedProto = mBuffer.emplace(entryProto, addToHistory);
+        std::string historyEntry;
+        if (serializedProto.empty()) {
+            // The entry does not fit in the ring. Move the ring into the history first, so that
+            // the entry stays behind every older one, and hand active sessions this copy.
+            entryProto.SerializeToString(&historyEntry);
+            serializedProto = historyEntry;
+            mBuffer.evictAll(addToHistory);
+            addToHistoryLocked(historyEntry, entryProto.elapsed_realtime_nanos());
+        }
+        mLastAddedVsyncId = update.vsyncId;
 
         TransactionDataSource::Trace([&](TransactionDataSource::TraceContext context) {
             // In "active" mode write each committed transaction to perfetto.
@@ -304,20 +365,8 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
             }
         });
 
-        std::vector<std::string> entries = mBuffer.emplace(std::move(serializedProto));
-        removedEntries.reserve(removedEntries.size() + entries.size());
-        removedEntries.insert(removedEntries.end(), std::make_move_iterator(entries.begin()),
-                              std::make_move_iterator(entries.end()));
-
         entryProto.Clear();
     }
-
-    perfetto::protos::TransactionTraceEntry removedEntryProto;
-    for (const std::string& removedEntry : removedEntries) {
-        removedEntryProto.ParseFromString(removedEntry);
-        updateStartingStateLocked(removedEntryProto);
-        removedEntryProto.Clear();
-    }
     mTransactionsAddedToBufferCv.notify_one();
 }
 
@@ -337,12 +386,8 @@ void TransactionTracing::flush() {
     base::ScopedLockAssertion assumeLocked(mTraceLock);
     mTransactionsAddedToBufferCv.wait_for(lock, std::chrono::milliseconds(100),
                                           [&]() REQUIRES(mTraceLock) {
-                                              perfetto::protos::TransactionTraceEntry entry;
-                                              if (mBuffer.used() > 0) {
-                                                  entry.ParseFromString(mBuffer.back());
-                                              }
-                                              return mBuffer.used() > 0 &&
-                                                      entry.vsync_id() >= mLastUpdatedVsyncId;
+                                              return mLastAddedVsyncId >= 0 &&
+                                                      mLastAddedVsyncId >= mLastUpdatedVsyncId;
                                           });
 }
 
@@ -29,6 +29,7 @@
 
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerCreationArgs.h"
+#include "CompressedTraceHistory.h"
 #include "FrontEnd/Update.h"
 #include "LocklessStack.h"
 #include "TransactionProtoParser.h"
@@ -164,9 +165,15 @@ private:
     }
 
     mutable std::mutex mTraceLock;
+    // The newest entries, which get a quarter of the buffer size. Entries evicted from the ring
+    // move to mHistory, which gets the rest of it, and are folded into the starting state once
+    // they are evicted from there.
     TransactionRingBuffer<perfetto::protos::TransactionTraceFile,
                           perfetto::protos::TransactionTraceEntry>
             mBuffer GUARDED_BY(mTraceLock);
+    CompressedTraceHistory mHistory GUARDED_BY(mTraceLock);
+    // Vsync id of the newest entry, in the ring or in mHistory.
+    int64_t mLastAddedVsyncId GUARDED_BY(mTraceLock) = -1;
     std::unordered_map<uint64_t, perfetto::protos::TransactionState> mQueuedTransactions
             GUARDED_BY(mTraceLock);
     LocklessStack<perfetto::protos::TransactionState> mTransactionQueue;
@@ -202,7 +209,7 @@ private:
     std::vector<uint32_t /* layerId */> mPendingDestroyedLayers; // only accessed by main thread
     int64_t mLastUpdatedVsyncId = -1;
 
-    void writeRingBufferToPerfetto(TransactionTracing::Mode mode);
+    void writeRingBufferToPerfetto(TransactionTracing::Mode mode) EXCLUDES(mTraceLock);
     perfetto::protos::TransactionTraceFile createTraceFileProto() const;
     void loop();
     void addEntry(const std::vector<CommittedUpdates>& committedTransactions,
@@ -213,6 +220,12 @@ private:
             REQUIRES(mTraceLock);
     void updateStartingStateLocked(const perfetto::protos::TransactionTraceEntry& entry)
             REQUIRES(mTraceLock);
+    void onEntryRemovedLocked(std::string_view removedEntry) REQUIRES(mTraceLock);
+    void setBufferSizeLocked(size_t bufferSizeInBytes) REQUIRES(mTraceLock);
+    void addToHistoryLocked(std::string_view entry, int64_t timestamp) REQUIRES(mTraceLock);
+    // Visits every entry after the starting state, oldest first.
+    void forEachEntryLocked(const CompressedTraceHistory::EntryVisitor& visitor) const
+            REQUIRES(mTraceLock);
 };
 
 class TransactionTraceWriter : public Singleton<TransactionTraceWriter> {
@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <thread>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 
@@ -34,5 +40,79 @@ static void pushPop(benchmark::State& state) {
 }
 BENCHMARK(pushPop);
 
+// The simplest alternative, for comparison
+template <typename T>
+class MutexQueue {
+public:
+    void push(T value) {
+        std::lock_guard lock(mMutex);
+        mQueue.push_back(std::move(value));
+    }
+
+    std::optional<T> pop() {
+        std::lock_guard lock(mMutex);
+        if (mQueue.empty()) return std::nullopt;
+        T value = std::move(mQueue.front());
+        mQueue.pop_front();
+        return value;
+    }
+
+private:
+    std::mutex mMutex;
+    std::deque<T> mQueue;
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Item {
+    Clock::time_point pushTime;
+    // about the size of a small transaction's states
+    std::vector<uint32_t> payload;
+};
+
+// Several producers push as fast as they can, like binder threads queueing
+// transactions, while a single consumer drains the queue. Reports the time from
+// push to pop as latency percentiles.
+template <typename Queue>
+static void multiProducer(benchmark::State& state) {
+    const size_t producers = static_cast<size_t>(state.range(0));
+    constexpr size_t kItemsPerProducer = 2000;
+    std::vector<int64_t> latenciesNs;
+    latenciesNs.reserve(producers * kItemsPerProducer * state.max_iterations);
+
+    for (auto _ : state) {
+        Queue queue;
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; p++) {
+            threads.emplace_back([&queue] {
+                for (size_t i = 0; i < kItemsPerProducer; i++) {
+                    queue.push(Item{Clock::now(), std::vector<uint32_t>(16, i)});
+                }
+            });
+        }
+        for (size_t popped = 0; popped < producers * kItemsPerProducer;) {
+            std::optional<Item> item = queue.pop();
+            if (!item) continue;
+            latenciesNs.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                         item->pushTime)
+                            .count());
+            popped++;
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    auto percentile = [&](double p) {
+        return static_cast<double>(latenciesNs[static_cast<size_t>(p * (latenciesNs.size() - 1))]);
+    };
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+    state.SetItemsProcessed(static_cast<int64_t>(latenciesNs.size()));
+}
+BENCHMARK(multiProducer<LocklessQueue<Item>>)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+BENCHMARK(multiProducer<MutexQueue<Item>>)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
 } // namespace
 } // namespace android::surfaceflinger
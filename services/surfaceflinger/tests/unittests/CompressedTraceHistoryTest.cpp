@@ -0,0 +1,180 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Tracing/CompressedTraceHistory.h"
+
+namespace android {
+
+class CompressedTraceHistoryTest : public testing::Test {
+protected:
+    // An entry that starts with its index and is padded with text that compresses well.
+    static std::string makeEntry(int64_t index) {
+        std::string entry = std::to_string(index) + ":";
+        entry.resize(64 + static_cast<size_t>(index % 7), 'x');
+        return entry;
+    }
+
+    static int64_t indexOf(std::string_view entry) {
+        return std::stoll(std::string(entry.substr(0, entry.find(':'))));
+    }
+
+    // Appends entries [begin, end), with timestamps derived from their index.
+    void append(int64_t begin, int64_t end) {
+        for (int64_t index = begin; index < end; index++) {
+            mHistory.append(makeEntry(index), index * 1000, recordEvicted());
+        }
+    }
+
+    std::vector<int64_t> storedIndices() const {
+        std::vector<int64_t> indices;
+        mHistory.forEachEntry([&](std::string_view entry, int64_t timestamp) {
+            indices.push_back(indexOf(entry));
+            EXPECT_EQ(makeEntry(indices.back()), entry);
+            EXPECT_EQ(indices.back() * 1000, timestamp);
+        });
+        return indices;
+    }
+
+    // Keeps the indices of evicted entries, in the order they were evicted.
+    CompressedTraceHistory::EntryVisitor recordEvicted() {
+        return [this](std::string_view entry, int64_t timestamp) {
+            mEvicted.push_back(indexOf(entry));
+            EXPECT_EQ(makeEntry(mEvicted.back()), entry);
+            EXPECT_EQ(mEvicted.back() * 1000, timestamp);
+        };
+    }
+
+    // Every entry was either evicted or is still stored, oldest first.
+    void expectAllEntriesInOrder(int64_t count) const {
+        std::vector<int64_t> all = mEvicted;
+        const std::vector<int64_t> stored = storedIndices();
+        all.insert(all.end(), stored.begin(), stored.end());
+        ASSERT_EQ(static_cast<size_t>(count), all.size());
+        for (int64_t i = 0; i < count; i++) {
+            EXPECT_EQ(i, all[static_cast<size_t>(i)]);
+        }
+    }
+
+    CompressedTraceHistory mHistory;
+    std::vector<int64_t> mEvicted;
+};
+
+TEST_F(CompressedTraceHistoryTest, KeepsMoreThanItsSize) {
+    mHistory.setSize(16 * 1024, recordEvicted());
+    append(0, 5000);
+
+    EXPECT_LE(mHistory.used(), mHistory.size());
+    EXPECT_GT(mHistory.segmentCount(), 1u);
+    // the entries are alike, so several times more of them fit than without compression
+    EXPECT_GT(mHistory.frameCount() * 64, 3 * mHistory.size());
+    EXPECT_EQ(mHistory.frameCount(), storedIndices().size());
+    ASSERT_FALSE(mEvicted.empty());
+    expectAllEntriesInOrder(5000);
+}
+
+TEST_F(CompressedTraceHistoryTest, KeepsEntriesThatDontCompress) {
+    mHistory.setSize(16 * 1024, recordEvicted());
+    std::mt19937 random(42);
+    std::vector<std::string> entries;
+    for (int64_t index = 0; index < 1000; index++) {
+        std::string entry(100, '\0');
+        for (char& c : entry) {
+            c = static_cast<char>(random());
+        }
+        mHistory.append(entry, index, nullptr);
+        entries.push_back(std::move(entry));
+    }
+    EXPECT_LE(mHistory.used(), mHistory.size());
+
+    std::vector<std::string> stored;
+    int64_t expectedTimestamp = static_cast<int64_t>(entries.size() - mHistory.frameCount());
+    mHistory.forEachEntry([&](std::string_view entry, int64_t timestamp) {
+        stored.emplace_back(entry);
+        EXPECT_EQ(expectedTimestamp++, timestamp);
+    });
+    ASSERT_EQ(mHistory.frameCount(), stored.size());
+    ASSERT_FALSE(stored.empty());
+    const auto newest = entries.end() - static_cast<std::ptrdiff_t>(stored.size());
+    EXPECT_TRUE(std::equal(stored.begin(), stored.end(), newest));
+}
+
+TEST_F(CompressedTraceHistoryTest, ShrinkEvictsOldestFirst) {
+    mHistory.setSize(16 * 1024, recordEvicted());
+    append(0, 2000);
+    const size_t evictedBefore = mEvicted.size();
+
+    mHistory.setSize(4 * 1024, recordEvicted());
+    EXPECT_GT(mEvicted.size(), evictedBefore);
+    EXPECT_LE(mHistory.used(), mHistory.size());
+    expectAllEntriesInOrder(2000);
+
+    // the history still works at the new size
+    append(2000, 3000);
+    EXPECT_LE(mHistory.used(), mHistory.size());
+    expectAllEntriesInOrder(3000);
+
+    mHistory.setSize(0, recordEvicted());
+    EXPECT_EQ(0u, mHistory.used());
+    EXPECT_EQ(0u, mHistory.frameCount());
+    expectAllEntriesInOrder(3000);
+}
+
+TEST_F(CompressedTraceHistoryTest, EntryLargerThanSize) {
+    mHistory.setSize(1024, recordEvicted());
+    append(0, 5);
+
+    // random bytes, so that the entry doesn't fit even once compressed
+    std::mt19937 random(42);
+    std::string large(2048, '\0');
+    for (char& c : large) {
+        c = static_cast<char>(random());
+    }
+    mHistory.append(large, 5000, [&](std::string_view entry, int64_t timestamp) {
+        if (entry == large) {
+            EXPECT_EQ(5000, timestamp);
+            mEvicted.push_back(5);
+        } else {
+            mEvicted.push_back(indexOf(entry));
+        }
+    });
+    // the entry is evicted right away, behind every older one
+    EXPECT_EQ(0u, mHistory.frameCount());
+    expectAllEntriesInOrder(6);
+}
+
+TEST_F(CompressedTraceHistoryTest, Reset) {
+    mHistory.setSize(16 * 1024, recordEvicted());
+    append(0, 1000);
+    mHistory.reset();
+    EXPECT_EQ(0u, mHistory.used());
+    EXPECT_EQ(0u, mHistory.frameCount());
+    EXPECT_EQ(0u, mHistory.segmentCount());
+    EXPECT_TRUE(storedIndices().empty());
+
+    mEvicted.clear();
+    append(0, 10);
+    EXPECT_EQ((std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), storedIndices());
+}
+
+} // namespace android
@@ -21,6 +21,9 @@
 #undef LOG_TAG
 #define LOG_TAG "LibSurfaceFlingerUnittests"
 
+#include <poll.h>
+
+#include <binder/Parcel.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <log/log.h>
@@ -692,6 +695,44 @@ TEST_F(EventThreadTest, eventsDroppedIfNonfatalEventDeliveryError) {
     expectVSyncCallbackScheduleReceived(true);
 }
 
+TEST_F(EventThreadTest, vsyncEventsPublishedToSharedChannel) {
+    setupEventThread();
+
+    sp<EventThreadConnection> connection =
+            sp<EventThreadConnection>::make(mThread.get(), mConnectionUid,
+                                            gui::ISurfaceComposer::EventRegistration::
+                                                    sharedVsyncChannel);
+    gui::VsyncEventChannel channelFds;
+    ASSERT_TRUE(connection->getVsyncEventChannel(&channelFds).isOk());
+
+    // Receive the channel the way DisplayEventReceiver does.
+    Parcel parcel;
+    ASSERT_EQ(NO_ERROR, channelFds.writeToParcel(&parcel));
+    parcel.setDataPosition(0);
+    gui::VsyncEventChannel receiver;
+    ASSERT_EQ(NO_ERROR, receiver.readFromParcel(&parcel));
+    ASSERT_EQ(NO_ERROR, receiver.initCheck());
+
+    // Only one channel can be handed out per connection.
+    gui::VsyncEventChannel secondChannel;
+    EXPECT_FALSE(connection->getVsyncEventChannel(&secondChannel).isOk());
+
+    mThread->requestNextVsync(connection);
+    expectVSyncCallbackScheduleReceived(true);
+    onVSyncEvent(123, 456, 789);
+
+    pollfd pfd{.fd = receiver.getFd(), .events = POLLIN, .revents = 0};
+    ASSERT_EQ(1, poll(&pfd, 1, 1000 /* timeout */));
+    DisplayEventReceiver::Event event;
+    uint64_t eventsBefore;
+    ASSERT_TRUE(receiver.consume(&event, 0 /* eventsReceived */, &eventsBefore));
+    EXPECT_EQ(DisplayEventReceiver::DISPLAY_EVENT_VSYNC, event.header.type);
+    EXPECT_EQ(123, event.header.timestamp);
+    EXPECT_EQ(1u, event.vsync.count);
+    EXPECT_EQ(0u, eventsBefore);
+    EXPECT_FALSE(receiver.consume(&event, 0 /* eventsReceived */, &eventsBefore));
+}
+
 TEST_F(EventThreadTest, setPhaseOffsetForwardsToVSyncSource) {
     setupEventThread();
 
@@ -27,7 +27,9 @@
 #include <gtest/gtest.h>
 #include <log/log.h>
 #include <perfetto/trace/trace.pb.h>
+#include <algorithm>
 #include <cinttypes>
+#include <thread>
 
 using namespace std::chrono_literals;
 using testing::_;
@@ -147,7 +149,7 @@ public:
         for (size_t i = 0; i < maxTokens; i++) {
             mTokenManager->generateTokenForPredictions({});
         }
-        EXPECT_EQ(getPredictions().size(), maxTokens);
+        EXPECT_EQ(getNumberOfPredictions(), maxTokens);
     }
 
     SurfaceFrame& getSurfaceFrame(size_t displayFrameIdx, size_t surfaceFrameIdx) {
@@ -166,8 +168,12 @@ public:
                 a.presentTime == b.presentTime;
     }
 
-    const std::map<int64_t, TimelineItem>& getPredictions() const {
-        return mTokenManager->mPredictions;
+    size_t getNumberOfPredictions() const {
+        return static_cast<size_t>(
+                std::count_if(mTokenManager->mPredictions.begin(),
+                              mTokenManager->mPredictions.end(), [](const auto& slot) {
+                                  return slot.token.load() != FrameTimelineInfo::INVALID_VSYNC_ID;
+                              }));
     }
 
     uint32_t getNumberOfDisplayFrames() const {
@@ -211,7 +217,7 @@ public:
 
 TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     int64_t token1 = mTokenManager->generateTokenForPredictions({0, 0, 0});
-    EXPECT_EQ(getPredictions().size(), 1u);
+    EXPECT_EQ(getNumberOfPredictions(), 1u);
     flushTokens();
     int64_t token2 = mTokenManager->generateTokenForPredictions({10, 20, 30});
     std::optional<TimelineItem> predictions = mTokenManager->getPredictionsForToken(token1);
@@ -223,6 +229,38 @@ TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     EXPECT_EQ(compareTimelineItems(*predictions, TimelineItem(10, 20, 30)), true);
 }
 
+TEST_F(FrameTimelineTest, tokenManagerIgnoresUnknownTokens) {
+    int64_t token1 = mTokenManager->generateTokenForPredictions({10, 20, 30});
+
+    EXPECT_FALSE(mTokenManager->getPredictionsForToken(FrameTimelineInfo::INVALID_VSYNC_ID));
+    EXPECT_FALSE(mTokenManager->getPredictionsForToken(-static_cast<int64_t>(maxTokens)));
+    EXPECT_FALSE(mTokenManager->getPredictionsForToken(token1 + 1));
+    EXPECT_FALSE(
+            mTokenManager->getPredictionsForToken(token1 + static_cast<int64_t>(maxTokens)));
+    EXPECT_TRUE(mTokenManager->getPredictionsForToken(token1));
+}
+
+TEST_F(FrameTimelineTest, tokenManagerConcurrentLookupsSeeMatchingPredictions) {
+    // Predictions are derived from the token, so a torn read shows up as a mismatch.
+    std::atomic<bool> done = false;
+    std::thread reader([&] {
+        while (!done) {
+            for (int64_t token = 0; token < static_cast<int64_t>(2 * maxTokens); token++) {
+                if (auto predictions = mTokenManager->getPredictionsForToken(token)) {
+                    EXPECT_EQ(predictions->startTime, token);
+                    EXPECT_EQ(predictions->endTime, token + 1);
+                    EXPECT_EQ(predictions->presentTime, token + 2);
+                }
+            }
+        }
+    });
+    for (int64_t token = 0; token < static_cast<int64_t>(2 * maxTokens); token++) {
+        EXPECT_EQ(mTokenManager->generateTokenForPredictions({token, token + 1, token + 2}), token);
+    }
+    done = true;
+    reader.join();
+}
+
 TEST_F(FrameTimelineTest, createSurfaceFrameForToken_getOwnerPidReturnsCorrectPid) {
     auto surfaceFrame1 =
             mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "LocklessQueue.h"
+
+namespace android {
+namespace {
+
+TEST(LocklessQueueTest, popEmpty) {
+    LocklessQueue<int> queue;
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_EQ(std::nullopt, queue.pop());
+}
+
+TEST(LocklessQueueTest, fifo) {
+    LocklessQueue<int> queue;
+    for (int i = 0; i < 10; i++) queue.push(i);
+    EXPECT_FALSE(queue.isEmpty());
+    for (int i = 0; i < 10; i++) EXPECT_EQ(i, queue.pop());
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST(LocklessQueueTest, overflowsPool) {
+    LocklessQueue<int, 4> queue;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 10; i++) queue.push(i);
+        for (int i = 0; i < 10; i++) EXPECT_EQ(i, queue.pop());
+        EXPECT_EQ(std::nullopt, queue.pop());
+    }
+}
+
+TEST(LocklessQueueTest, destroysPendingValues) {
+    auto value = std::make_shared<int>(0);
+    {
+        LocklessQueue<std::shared_ptr<int>, 2> queue;
+        for (int i = 0; i < 4; i++) queue.push(value);
+        EXPECT_EQ(5, value.use_count());
+    }
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(LocklessQueueTest, multipleProducers) {
+    constexpr int kProducers = 4;
+    constexpr int kValues = 10000;
+    LocklessQueue<std::pair<int, int>, 8> queue;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; p++) {
+        threads.emplace_back([&queue, p] {
+            for (int i = 0; i < kValues; i++) queue.push({p, i});
+        });
+    }
+
+    // values from each producer must come out in the order that it pushed them
+    std::vector<int> next(kProducers, 0);
+    for (int popped = 0; popped < kProducers * kValues;) {
+        auto value = queue.pop();
+        if (!value) continue;
+        auto [p, i] = *value;
+        EXPECT_EQ(next[p], i);
+        next[p] = i + 1;
+        popped++;
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+} // namespace
+} // namespace android
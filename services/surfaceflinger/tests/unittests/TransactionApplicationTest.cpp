@@ -1099,4 +1099,19 @@ TEST(TransactionHandlerTest, CanAddTransactionWithFullMergedIds) {
                            transaction1Id) > 0);
 }
 
+TEST(TransactionHandlerTest, RecyclesComposerStateStorage) {
+    TransactionHandler handler;
+    EXPECT_EQ(0u, handler.obtainComposerStates().capacity());
+
+    std::vector<TransactionState> transactions(1);
+    transactions[0].states.resize(4);
+    const ResolvedComposerState* storage = transactions[0].states.data();
+    handler.recycleTransactions(std::move(transactions));
+
+    std::vector<ResolvedComposerState> states = handler.obtainComposerStates();
+    EXPECT_TRUE(states.empty());
+    EXPECT_EQ(storage, states.data());
+    EXPECT_EQ(0u, handler.obtainComposerStates().capacity());
+}
+
 } // namespace android
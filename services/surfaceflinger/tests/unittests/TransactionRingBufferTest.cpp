@@ -0,0 +1,248 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <layerproto/TransactionProto.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "Tracing/TransactionRingBuffer.h"
+
+namespace android {
+
+using Entry = perfetto::protos::TransactionTraceEntry;
+using RingBuffer = TransactionRingBuffer<perfetto::protos::TransactionTraceFile, Entry>;
+
+// must match TransactionRingBuffer::EntryHeader
+constexpr size_t kEntryHeaderSize = 24;
+
+class TransactionRingBufferTest : public testing::Test {
+protected:
+    // An entry whose vsync id says in which order it was added, padded with a varying number of
+    // layer ids so that entries don't evenly divide the ring.
+    static Entry makeEntry(int64_t vsyncId, int destroyedLayerCount = -1) {
+        if (destroyedLayerCount < 0) {
+            destroyedLayerCount = 37 + static_cast<int>(vsyncId % 5);
+        }
+        Entry entry;
+        entry.set_vsync_id(vsyncId);
+        entry.set_elapsed_realtime_nanos(vsyncId * 1000);
+        for (int i = 0; i < destroyedLayerCount; i++) {
+            entry.add_destroyed_layers(static_cast<uint32_t>(i));
+        }
+        return entry;
+    }
+
+    static int64_t vsyncIdOf(std::string_view bytes) {
+        Entry entry;
+        EXPECT_TRUE(entry.ParseFromArray(bytes.data(), static_cast<int>(bytes.size())));
+        return entry.vsync_id();
+    }
+
+    static std::vector<int64_t> storedVsyncIds(const RingBuffer& buffer) {
+        std::vector<int64_t> vsyncIds;
+        buffer.forEachEntry([&](std::string_view bytes, int64_t timestamp) {
+            vsyncIds.push_back(vsyncIdOf(bytes));
+            EXPECT_EQ(vsyncIds.back() * 1000, timestamp);
+        });
+        return vsyncIds;
+    }
+
+    // Keeps the vsync ids of evicted entries, in the order they were evicted.
+    RingBuffer::EvictedEntryVisitor recordEvicted() {
+        return [this](std::string_view bytes, int64_t timestamp) {
+            mEvicted.push_back(vsyncIdOf(bytes));
+            EXPECT_EQ(mEvicted.back() * 1000, timestamp);
+        };
+    }
+
+    const size_t mPageSize = static_cast<size_t>(getpagesize());
+    RingBuffer mBuffer;
+    std::vector<int64_t> mEvicted;
+};
+
+TEST_F(TransactionRingBufferTest, WriteAcrossMirrorBoundary) {
+    mBuffer.setSize(mPageSize);
+    const Entry first = makeEntry(0);
+    const std::string_view firstBytes = mBuffer.emplace(first, recordEvicted());
+    ASSERT_FALSE(firstBytes.empty());
+    // The first entry is at the start of the ring, which is mapped twice in a row.
+    const char* ringStart = firstBytes.data() - kEntryHeaderSize;
+
+    // wrap around the ring several times, so that entries straddle the end of the first mapping
+    size_t straddlingEntries = 0;
+    for (int64_t vsyncId = 1; vsyncId < 1000; vsyncId++) {
+        const Entry entry = makeEntry(vsyncId);
+        const std::string_view bytes = mBuffer.emplace(entry, recordEvicted());
+        ASSERT_EQ(entry.ByteSizeLong(), bytes.size());
+        ASSERT_EQ(vsyncId, vsyncIdOf(bytes));
+        EXPECT_EQ(vsyncId, mBuffer.backVsyncId());
+
+        const char* ringEnd = ringStart + mPageSize;
+        if (bytes.data() < ringEnd && bytes.data() + bytes.size() > ringEnd) {
+            straddlingEntries++;
+            // the part past the end is the start of the ring
+            const size_t wrapped = bytes.data() + bytes.size() - ringEnd;
+            EXPECT_EQ(0, std::memcmp(ringEnd, ringStart, wrapped));
+        }
+    }
+    EXPECT_GT(straddlingEntries, 0u);
+
+    // everything which wasn't evicted reads back in order
+    std::vector<int64_t> stored = storedVsyncIds(mBuffer);
+    ASSERT_FALSE(stored.empty());
+    EXPECT_EQ(999, stored.back());
+    for (size_t i = 1; i < stored.size(); i++) {
+        EXPECT_EQ(stored[i - 1] + 1, stored[i]);
+    }
+    EXPECT_EQ(stored.size(), mBuffer.frameCount());
+    EXPECT_LE(mBuffer.used(), mBuffer.size());
+}
+
+TEST_F(TransactionRingBufferTest, EvictsOldestFirst) {
+    mBuffer.setSize(mPageSize);
+    for (int64_t vsyncId = 0; vsyncId < 100; vsyncId++) {
+        ASSERT_FALSE(mBuffer.emplace(makeEntry(vsyncId), recordEvicted()).empty());
+    }
+
+    // every entry was either evicted or is still stored, oldest first
+    ASSERT_FALSE(mEvicted.empty());
+    std::vector<int64_t> all = mEvicted;
+    std::vector<int64_t> stored = storedVsyncIds(mBuffer);
+    all.insert(all.end(), stored.begin(), stored.end());
+    ASSERT_EQ(100u, all.size());
+    for (int64_t i = 0; i < 100; i++) {
+        EXPECT_EQ(i, all[i]);
+    }
+    EXPECT_EQ(stored.front(), vsyncIdOf(mBuffer.front()));
+    EXPECT_EQ(99, vsyncIdOf(mBuffer.back()));
+
+    // shrinking evicts through the same callback
+    const size_t evictedBefore = mEvicted.size();
+    mBuffer.setSize(mBuffer.used() / 2, recordEvicted());
+    ASSERT_GT(mEvicted.size(), evictedBefore);
+    EXPECT_EQ(stored.front(), mEvicted[evictedBefore]);
+    EXPECT_EQ(mEvicted.back() + 1, vsyncIdOf(mBuffer.front()));
+    EXPECT_EQ(99, vsyncIdOf(mBuffer.back()));
+}
+
+TEST_F(TransactionRingBufferTest, ResizeKeepsContents) {
+    mBuffer.setSize(mPageSize);
+    // wrap first, so that the live entries don't start at the beginning of the ring
+    for (int64_t vsyncId = 0; vsyncId < 50; vsyncId++) {
+        ASSERT_FALSE(mBuffer.emplace(makeEntry(vsyncId), recordEvicted()).empty());
+    }
+    ASSERT_FALSE(mEvicted.empty());
+    const std::vector<int64_t> beforeGrow = storedVsyncIds(mBuffer);
+
+    // growing remaps the ring and keeps every entry
+    const size_t evictedBeforeGrow = mEvicted.size();
+    mBuffer.setSize(4 * mPageSize, recordEvicted());
+    EXPECT_EQ(evictedBeforeGrow, mEvicted.size());
+    EXPECT_EQ(beforeGrow, storedVsyncIds(mBuffer));
+    EXPECT_EQ(49, mBuffer.backVsyncId());
+
+    // the bigger ring is used
+    for (int64_t vsyncId = 50; vsyncId < 100; vsyncId++) {
+        ASSERT_FALSE(mBuffer.emplace(makeEntry(vsyncId), recordEvicted()).empty());
+    }
+    EXPECT_EQ(evictedBeforeGrow, mEvicted.size());
+    EXPECT_GT(mBuffer.used(), mPageSize);
+
+    // shrinking keeps the newest entries that fit
+    mBuffer.setSize(mPageSize, recordEvicted());
+    std::vector<int64_t> afterShrink = storedVsyncIds(mBuffer);
+    ASSERT_FALSE(afterShrink.empty());
+    EXPECT_EQ(99, afterShrink.back());
+    EXPECT_EQ(mEvicted.back() + 1, afterShrink.front());
+    EXPECT_LE(mBuffer.used(), mPageSize);
+
+    // and still wraps correctly afterwards
+    for (int64_t vsyncId = 100; vsyncId < 150; vsyncId++) {
+        ASSERT_EQ(vsyncId, vsyncIdOf(mBuffer.emplace(makeEntry(vsyncId), recordEvicted())));
+    }
+    EXPECT_EQ(149, storedVsyncIds(mBuffer).back());
+}
+
+TEST_F(TransactionRingBufferTest, ShrinkEvictingEverything) {
+    mBuffer.setSize(4 * mPageSize);
+    for (int64_t vsyncId = 0; vsyncId < 50; vsyncId++) {
+        ASSERT_FALSE(mBuffer.emplace(makeEntry(vsyncId), recordEvicted()).empty());
+    }
+
+    // smaller than any entry, so the remapped ring starts out empty
+    mBuffer.setSize(kEntryHeaderSize, recordEvicted());
+    EXPECT_EQ(50u, mEvicted.size());
+    EXPECT_EQ(0u, mBuffer.used());
+    EXPECT_EQ(0u, mBuffer.frameCount());
+
+    mBuffer.setSize(mPageSize, recordEvicted());
+    for (int64_t vsyncId = 50; vsyncId < 100; vsyncId++) {
+        ASSERT_EQ(vsyncId, vsyncIdOf(mBuffer.emplace(makeEntry(vsyncId), recordEvicted())));
+        EXPECT_EQ(vsyncId, mBuffer.backVsyncId());
+    }
+    std::vector<int64_t> stored = storedVsyncIds(mBuffer);
+    ASSERT_FALSE(stored.empty());
+    EXPECT_EQ(mEvicted.back() + 1, stored.front());
+    EXPECT_EQ(99, stored.back());
+}
+
+TEST_F(TransactionRingBufferTest, EvictAll) {
+    mBuffer.setSize(mPageSize);
+    for (int64_t vsyncId = 0; vsyncId < 100; vsyncId++) {
+        ASSERT_FALSE(mBuffer.emplace(makeEntry(vsyncId), recordEvicted()).empty());
+    }
+    mBuffer.evictAll(recordEvicted());
+    EXPECT_EQ(0u, mBuffer.used());
+    EXPECT_TRUE(storedVsyncIds(mBuffer).empty());
+    ASSERT_EQ(100u, mEvicted.size());
+    for (int64_t i = 0; i < 100; i++) {
+        EXPECT_EQ(i, mEvicted[i]);
+    }
+
+    EXPECT_EQ(100, vsyncIdOf(mBuffer.emplace(makeEntry(100), recordEvicted())));
+    EXPECT_EQ((std::vector<int64_t>{100}), storedVsyncIds(mBuffer));
+}
+
+TEST_F(TransactionRingBufferTest, RejectsEntryLargerThanRing) {
+    mBuffer.setSize(mPageSize);
+    ASSERT_FALSE(mBuffer.emplace(makeEntry(0), recordEvicted()).empty());
+
+    const Entry oversized = makeEntry(1, static_cast<int>(mPageSize));
+    EXPECT_TRUE(mBuffer.emplace(oversized, recordEvicted()).empty());
+    EXPECT_TRUE(mEvicted.empty());
+    EXPECT_EQ((std::vector<int64_t>{0}), storedVsyncIds(mBuffer));
+}
+
+TEST_F(TransactionRingBufferTest, ResetReleasesEntries) {
+    mBuffer.setSize(mPageSize);
+    for (int64_t vsyncId = 0; vsyncId < 10; vsyncId++) {
+        ASSERT_FALSE(mBuffer.emplace(makeEntry(vsyncId), recordEvicted()).empty());
+    }
+    mBuffer.reset();
+    EXPECT_EQ(0u, mBuffer.frameCount());
+    EXPECT_EQ(0u, mBuffer.used());
+    EXPECT_TRUE(storedVsyncIds(mBuffer).empty());
+
+    // the ring is mapped again when needed
+    EXPECT_EQ(10, vsyncIdOf(mBuffer.emplace(makeEntry(10), recordEvicted())));
+    EXPECT_EQ((std::vector<int64_t>{10}), storedVsyncIds(mBuffer));
+}
+
+} // namespace android
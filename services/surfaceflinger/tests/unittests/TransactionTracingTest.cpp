@@ -40,10 +40,17 @@ protected:
     void flush() { mTracing.flush(); }
     perfetto::protos::TransactionTraceFile writeToProto() { return mTracing.writeToProto(); }
 
+    // The oldest entry that has not been folded into the starting state, which may be in the
+    // compressed history rather than in the ring.
     perfetto::protos::TransactionTraceEntry bufferFront() {
         std::scoped_lock<std::mutex> lock(mTracing.mTraceLock);
         perfetto::protos::TransactionTraceEntry entry;
-        entry.ParseFromString(mTracing.mBuffer.front());
+        bool found = false;
+        mTracing.forEachEntryLocked([&](std::string_view bytes, int64_t) {
+            if (!found) {
+                found = entry.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()));
+            }
+        });
         return entry;
     }
 
@@ -124,6 +131,42 @@ TEST_F(TransactionTracingTest, addTransactions) {
     verifyEntry(proto.entry(1), secondUpdate.transactions, secondTransactionSetVsyncId);
 }
 
+TEST_F(TransactionTracingTest, keepsEntriesEvictedFromRingInHistory) {
+    mTracing.setBufferSize(SMALL_BUFFER_SIZE * 4);
+    for (int64_t vsyncId = 1; vsyncId <= 1000; vsyncId++) {
+        queueAndCommitTransaction(vsyncId);
+    }
+
+    std::vector<int64_t> vsyncIds;
+    size_t historyCount;
+    size_t ringCount;
+    {
+        std::scoped_lock<std::mutex> lock(mTracing.mTraceLock);
+        mTracing.forEachEntryLocked([&](std::string_view bytes, int64_t) {
+            perfetto::protos::TransactionTraceEntry entry;
+            entry.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()));
+            vsyncIds.push_back(entry.vsync_id());
+        });
+        historyCount = mTracing.mHistory.frameCount();
+        ringCount = mTracing.mBuffer.frameCount();
+    }
+    // The history gets three times the size of the ring. The entries are alike, so compressing
+    // them has to fit many more entries in it than in the ring.
+    ASSERT_GT(ringCount, 0u);
+    EXPECT_GT(historyCount, 6 * ringCount);
+    ASSERT_EQ(historyCount + ringCount, vsyncIds.size());
+    EXPECT_EQ(1000, vsyncIds.back());
+    for (size_t i = 1; i < vsyncIds.size(); i++) {
+        EXPECT_EQ(vsyncIds[i - 1] + 1, vsyncIds[i]);
+    }
+
+    // the oldest entries were evicted, and the trace has everything else
+    EXPECT_GT(vsyncIds.front(), 1);
+    perfetto::protos::TransactionTraceFile proto = writeToProto();
+    ASSERT_EQ(static_cast<int>(vsyncIds.size()), proto.entry().size());
+    EXPECT_EQ(vsyncIds.front(), proto.entry(0).vsync_id());
+}
+
 class TransactionTracingLayerHandlingTest : public TransactionTracingTest {
 protected:
     void SetUp() override {